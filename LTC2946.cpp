@@ -31,28 +31,63 @@ Shutdown mode reduces power consumption to 15uA.
 */
 
 
-#include <Arduino.h>
 #include <stdint.h>
 #include "LTC2946.h"
-#include <i2c_t3.h>
-//#include <Wire.h>
+#include "LTC2946_Unpack.h"
+
+// Hand-written register addresses, codes and masks against LTC2946_Registers.h
+static_assert(LTC2946_Map::SIZE == LTC2946_REGISTER_COUNT, "register count");
+static_assert(LTC2946_Map::CTRLA.address == LTC2946_CTRLA_REG && LTC2946_Map::CTRLB.address == LTC2946_CTRLB_REG &&
+              LTC2946_Map::FAULT1.address == LTC2946_FAULT1_REG && LTC2946_Map::POWER.address == LTC2946_POWER_MSB2_REG &&
+              LTC2946_Map::DELTA_SENSE.address == LTC2946_DELTA_SENSE_MSB_REG && LTC2946_Map::VIN.address == LTC2946_VIN_MSB_REG &&
+              LTC2946_Map::ADIN.address == LTC2946_ADIN_MSB_REG && LTC2946_Map::GPIO_CFG.address == LTC2946_GPIO_CFG_REG &&
+              LTC2946_Map::TIME_COUNTER.address == LTC2946_TIME_COUNTER_MSB3_REG && LTC2946_Map::CHARGE.address == LTC2946_CHARGE_MSB3_REG &&
+              LTC2946_Map::ENERGY.address == LTC2946_ENERGY_MSB3_REG && LTC2946_Map::FAULT2.address == LTC2946_FAULT2_REG &&
+              LTC2946_Map::CLK_DIV.address == LTC2946_CLK_DIV_REG, "register address");
+static_assert(LTC2946_Map::Span(LTC2946_Map::TIME_COUNTER, LTC2946_Map::ENERGY) == LTC2946_ENERGY_LSB_REG - LTC2946_TIME_COUNTER_MSB3_REG + 1 &&
+              LTC2946_Map::Contiguous(LTC2946_CTRLA_REG, LTC2946_CLK_DIV_REG), "register span");
+static_assert(LTC2946_Map::CTRLA_ADIN.Keep() == LTC2946_CTRLA_ADIN_MASK && LTC2946_Map::CTRLA_OFFSET.Keep() == LTC2946_CTRLA_OFFSET_MASK &&
+              LTC2946_Map::CTRLA_VOLTAGE_SEL.Keep() == LTC2946_CTRLA_VOLTAGE_SEL_MASK &&
+              LTC2946_Map::CTRLA_CHANNEL_CONFIG.Keep() == LTC2946_CTRLA_CHANNEL_CONFIG_MASK &&
+              LTC2946_Map::CTRLB_ACC.Keep() == LTC2946_CTRLB_ACC_MASK && LTC2946_Map::CTRLB_RESET.Keep() == LTC2946_CTRLB_RESET_MASK &&
+              LTC2946_Map::GPIOCFG_GPIO1.Keep() == LTC2946_GPIOCFG_GPIO1_MASK && LTC2946_Map::GPIOCFG_GPIO2.Keep() == LTC2946_GPIOCFG_GPIO2_MASK &&
+              LTC2946_Map::GPIOCFG_GPIO3.Keep() == LTC2946_GPIOCFG_GPIO3_MASK && LTC2946_Map::GPIOCFG_GPIO2_OUT.Keep() == LTC2946_GPIOCFG_GPIO2_OUT_MASK &&
+              LTC2946_Map::GPIO3_CTRL_GPIO3.Keep() == LTC2946_GPIO3_CTRL_GPIO3_MASK &&
+              LTC2946_Map::CLK_DIV_DIVIDER.Keep() == LTC2946_CLK_DIV_MASK, "field mask");
+static_assert(LTC2946_Map::CTRLB_ALERT_CLEAR.Value(1) == LTC2946_ENABLE_ALERT_CLEAR && LTC2946_Map::CTRLB_SHUTDOWN.Value(1) == LTC2946_ENABLE_SHUTDOWN &&
+              LTC2946_Map::CTRLB_CLEARED_ON_READ.Value(1) == LTC2946_ENABLE_CLEARED_ON_READ &&
+              LTC2946_Map::CTRLB_STUCK_BUS_RECOVER.Value(1) == LTC2946_ENABLE_STUCK_BUS_RECOVER &&
+              LTC2946_Map::CTRLB_ALERT_CLEAR.Keep() == LTC2946_DISABLE_ALERT_CLEAR && LTC2946_Map::CTRLB_SHUTDOWN.Keep() == LTC2946_DISABLE_SHUTDOWN &&
+              LTC2946_Map::CTRLB_CLEARED_ON_READ.Keep() == LTC2946_DISABLE_CLEARED_ON_READ &&
+              LTC2946_Map::CTRLB_STUCK_BUS_RECOVER.Keep() == LTC2946_DISABLE_STUCK_BUS_RECOVER, "CTRLB enable/disable codes");
+static_assert(LTC2946_Map::CTRLB_ACC.Value(2) == LTC2946_ACC_PIN_CONTROL && LTC2946_Map::CTRLB_ACC.Value(1) == LTC2946_DISABLE_ACC &&
+              LTC2946_Map::CTRLB_RESET.Value(3) == LTC2946_RESET_ALL && LTC2946_Map::CTRLB_RESET.Value(2) == LTC2946_RESET_ACC &&
+              LTC2946_Map::CTRLB_RESET.Value(1) == LTC2946_ENABLE_AUTO_RESET, "CTRLB mode codes");
+static_assert(LTC2946_Map::CTRLA_VOLTAGE_SEL.Value(3) == LTC2946_SENSE_PLUS && LTC2946_Map::CTRLA_OFFSET.Value(3) == LTC2946_OFFSET_CAL_LAST &&
+              LTC2946_Map::CTRLA_ADIN.Value(1) == LTC2946_ADIN_INTVCC && LTC2946_Map::CTRLA_CHANNEL_CONFIG.Value(7) == LTC2946_CHANNEL_CONFIG_SNAPSHOT &&
+              LTC2946_Map::CTRLA.reset == (LTC2946_CHANNEL_CONFIG_V_C_3|LTC2946_SENSE_PLUS|LTC2946_OFFSET_CAL_EVERY|LTC2946_ADIN_GND), "CTRLA codes");
+static_assert(LTC2946_Map::GPIOCFG_GPIO1.Value(3) == LTC2946_GPIO1_IN_ACTIVE_HIGH && LTC2946_Map::GPIOCFG_GPIO2.Value(3) == LTC2946_GPIO2_IN_ACTIVE_HIGH &&
+              LTC2946_Map::GPIOCFG_GPIO3.Value(3) == LTC2946_GPIO3_IN_ACTIVE_HIGH && LTC2946_Map::GPIOCFG_GPIO3.Value(2) == LTC2946_GPIO3_IN_ACTIVE_LOW &&
+              LTC2946_Map::GPIO3_CTRL_GPIO3.Value(1) == LTC2946_GPIO3_OUT_LOW, "GPIO codes");
 
 LTC2946::LTC2946(uint8_t wire_num,uint8_t wire_addr) //!constructor
 {
     I2C_WIRE = wire_num;
     I2C_ADDRESS = wire_addr;
+    bus = LTC2946_platform_bus(wire_num);
+}
+
+LTC2946::LTC2946(LTC2946_Bus &wire_bus, uint8_t wire_addr) //!constructor
+{
+    I2C_ADDRESS = wire_addr;
+    bus = &wire_bus;
 }
 
 void LTC2946::Setup()
 {
-    if(I2C_WIRE == 0){
-        Wire.begin();
-    }else if(I2C_WIRE == 1){
-        Wire1.begin();
-    }else if(I2C_WIRE == 2){
-        Wire2.begin();
-    }else if(I2C_WIRE == 3){
-        Wire3.begin();
+    if(bus != 0)
+    {
+        I2C_ACK |= bus->Begin();
     }
 }
 
@@ -67,10 +102,16 @@ bool LTC2946::ErrorCheck()
     }
 }
 
+LTC2946_Bus *LTC2946::GetBus()
+{
+    return(bus);
+}
+
 //! Set the constants for converting RAW to values
-void LTC2946::SetVINConst(float vin_const){VIN_CONST = vin_const;}
-void LTC2946::SetAmperageConst(float i_const){CURRENT_CONST = i_const;}
-void LTC2946::SetPowerConst(float w_const){POWER_CONST = w_const;}
+void LTC2946::SetVINConst(float vin_const, float vin_offset){VIN_CONST = vin_const; VIN_OFFSET = vin_offset;}
+void LTC2946::SetAmperageConst(float i_const, float i_offset){CURRENT_CONST = i_const; CURRENT_OFFSET = i_offset;}
+void LTC2946::SetPowerConst(float w_const, float w_offset){POWER_CONST = w_const; POWER_OFFSET = w_offset;}
+void LTC2946::SetADINConst(float a_const, float a_offset){ADIN_CONST = a_const; ADIN_OFFSET = a_offset;}
 
 void LTC2946::SetContinuous()
 // Set default LTC2946 values for Continuous capture mode
@@ -88,6 +129,121 @@ void LTC2946::SetSnapShot()
     LTC2946_mode = 1;
 }
 
+void LTC2946::SetShutdown(bool state)
+// Shutdown stops the ADC and reduces supply current to ~15uA. Conversions restart from the beginning of a cycle on wake.
+{
+    if(state)
+    {
+        CTRLB |= LTC2946_ENABLE_SHUTDOWN;
+    }
+    else
+    {
+        CTRLB &= LTC2946_DISABLE_SHUTDOWN;
+    }
+
+    I2C_ACK |= LTC2946_write(LTC2946_CTRLB_REG, CTRLB);
+}
+
+int8_t LTC2946::SetAccumulation(uint8_t acc_mode, bool write)
+// The time counter, charge and energy accumulate only while enabled. Pin control lets one logic signal
+// gate several LTC2946s over exactly the same interval.
+{
+    int8_t ack = 0;
+
+    CTRLB = (CTRLB & LTC2946_CTRLB_ACC_MASK) | (acc_mode & ~LTC2946_CTRLB_ACC_MASK);
+    if(!write) return(0);
+
+    //! 1) GPIO2 must be the ACC input for pin control, keep the other GPIO settings
+    if((acc_mode & ~LTC2946_CTRLB_ACC_MASK) == LTC2946_ACC_PIN_CONTROL)
+    {
+        ack |= WriteField(LTC2946_Map::GPIOCFG_GPIO2, LTC2946_Map::GPIOCFG_GPIO2.Extract(LTC2946_GPIO2_IN_ACC));
+    }
+
+    //! 2) Accumulation mode
+    ack |= LTC2946_write(LTC2946_CTRLB_REG, CTRLB);
+
+    //update error
+    I2C_ACK |= ack;
+
+    return(ack);
+}
+
+uint8_t LTC2946::GetAccumulation()
+{
+    return(CTRLB & ~LTC2946_CTRLB_ACC_MASK);
+}
+
+int8_t LTC2946::ResetAccumulators()
+// The reset command is written on its own, then CTRLB is restored so the reset bits are never left set.
+{
+    int8_t ack = 0;
+
+    ack |= LTC2946_write(LTC2946_CTRLB_REG, (CTRLB & LTC2946_CTRLB_RESET_MASK) | LTC2946_RESET_ACC);
+    ack |= LTC2946_write(LTC2946_CTRLB_REG, CTRLB);
+
+    //update error
+    I2C_ACK |= ack;
+
+    return(ack);
+}
+
+uint8_t LTC2946::GetControlB()
+{
+    return(CTRLB);
+}
+
+int8_t LTC2946::SetClearedOnRead(bool state)
+{
+    if(state)
+    {
+        CTRLB |= LTC2946_ENABLE_CLEARED_ON_READ;
+    }
+    else
+    {
+        CTRLB &= LTC2946_DISABLE_CLEARED_ON_READ;
+    }
+
+    int8_t ack = LTC2946_write(LTC2946_CTRLB_REG, CTRLB);
+
+    //update error
+    I2C_ACK |= ack;
+
+    return(ack);
+}
+
+int8_t LTC2946::SetAutoReset(bool state)
+{
+    CTRLB = (CTRLB & LTC2946_CTRLB_RESET_MASK) | (state ? LTC2946_ENABLE_AUTO_RESET : LTC2946_DISABLE_AUTO_RESET);
+
+    int8_t ack = LTC2946_write(LTC2946_CTRLB_REG, CTRLB);
+
+    //update error
+    I2C_ACK |= ack;
+
+    return(ack);
+}
+
+int8_t LTC2946::ReadAccumulators(uint32_t *time_code, uint32_t *charge_code, uint32_t *energy_code, uint8_t *fault2)
+// Auto-reset and cleared-on-read act on the read itself, so the whole interval is one transaction.
+{
+    uint8_t block[LTC2946_FAULT2_REG - LTC2946_TIME_COUNTER_MSB3_REG + 1];
+    uint8_t length = fault2 ? sizeof(block) : LTC2946_ENERGY_LSB_REG - LTC2946_TIME_COUNTER_MSB3_REG + 1;
+
+    int8_t ack = LTC2946_read_block(LTC2946_TIME_COUNTER_MSB3_REG, block, length);
+    if(ack == 0)
+    {
+        *time_code = LTC2946_unpack_32(block);
+        *charge_code = LTC2946_unpack_32(block + LTC2946_CHARGE_MSB3_REG - LTC2946_TIME_COUNTER_MSB3_REG);
+        *energy_code = LTC2946_unpack_32(block + LTC2946_ENERGY_MSB3_REG - LTC2946_TIME_COUNTER_MSB3_REG);
+        if(fault2) *fault2 = block[LTC2946_FAULT2_REG - LTC2946_TIME_COUNTER_MSB3_REG];
+    }
+
+    //update error
+    I2C_ACK |= ack;
+
+    return(ack);
+}
+
 void LTC2946::EnableConversion(bool state)
 {
     use_conversion = state;
@@ -98,65 +254,120 @@ void LTC2946::EnableLegacy(bool state)
     use_legacy = state;
 }
 
-float LTC2946::ReadVIN()
+void LTC2946::EnableBidirectional(bool state, uint16_t zero_code)
+// The LTC2946 delta sense input is unipolar. For bidirectional rails the sense is offset referenced,
+// (e.g. level shifted so zero current sits mid scale), and codes below zero_code are negative current.
 {
-    int8_t ack = 0;
-    uint16_t VIN_code;
-    float VIN_Return = 0;
+    use_bidirectional = state;
+    CURRENT_ZERO_CODE = zero_code;
+}
 
-    //Continuous Request
-    if(LTC2946_mode == 0)
+void LTC2946::SetClock(bool external, uint32_t clk_hz, uint8_t clk_div)
+{
+    if(!external || clk_hz == 0)
     {
-        ack |= LTC2946_read_12_bits(LTC2946_VIN_MSB_REG, &VIN_code);
+        //Internal oscillator, CLK_DIV is not used
+        CLK_DIV = 0;
+        TIME_LSB_NUM = LTC2946_TIME_COUNTER_TICKS;
+        TIME_LSB_DEN = LTC2946_INTERNAL_CLK_HZ;
     }
-    //Snapshot Request
-    else if(LTC2946_mode == 1)
+    else
     {
-        int8_t LTC2946_mode;
-        LTC2946_mode = LTC2946_CHANNEL_CONFIG_SNAPSHOT | LTC2946_VDD;
-        ack |= LTC2946_write(LTC2946_CTRLA_REG, LTC2946_mode);
-
-        uint8_t busy;
-        do
+        //! 1) Divider that brings the external clock nearest to the 250kHz time base
+        if(clk_div == 0)
         {
-            ack |= LTC2946_read(LTC2946_STATUS2_REG, &busy);
+            uint32_t div = (clk_hz + LTC2946_INTERNAL_CLK_HZ/2)/LTC2946_INTERNAL_CLK_HZ;
+            if(div < 1) div = 1;
+            if(div > LTC2946_CLK_DIV_MAX) div = LTC2946_CLK_DIV_MAX;
+            clk_div = (uint8_t)div;
         }
-        while (0x8 & busy);
+        CLK_DIV = LTC2946_Map::CLK_DIV_DIVIDER.Value(clk_div);
+
+        //! 2) Program CLK_DIV, keeping the other bits of the register
+        int8_t ack = 0;
+        uint8_t reg;
+        ack |= LTC2946_read(LTC2946_CLK_DIV_REG, &reg);
+        ack |= LTC2946_write(LTC2946_CLK_DIV_REG, (reg & LTC2946_CLK_DIV_MASK) | CLK_DIV);
+        I2C_ACK |= ack;
+
+        //! 3) Time lsb = 4101 / (fCLK/CLK_DIV) = (4101*CLK_DIV)/fCLK
+        TIME_LSB_NUM = LTC2946_TIME_COUNTER_TICKS*CLK_DIV;
+        TIME_LSB_DEN = clk_hz;
+    }
+}
 
-        ack |= LTC2946_read_12_bits(LTC2946_VIN_MSB_REG, &VIN_code);
+uint8_t LTC2946::GetClockDivider()
+{
+    return(CLK_DIV);
+}
+
+void LTC2946::GetTimeLSBRatio(uint32_t *numerator, uint32_t *denominator)
+{
+    *numerator = TIME_LSB_NUM;
+    *denominator = TIME_LSB_DEN;
+}
+
+float LTC2946::GetTimeLSB()
+// Derived from the exact ratio, so float and ratio cannot disagree
+{
+    return((float)((double)TIME_LSB_NUM/(double)TIME_LSB_DEN));
+}
+
+float LTC2946::GetChargeLSB()
+{
+    return((LTC2946_DELTA_SENSE_lsb/resistor)*16*GetTimeLSB());
+}
+
+float LTC2946::GetEnergyLSB()
+{
+    return((LTC2946_Power_lsb/resistor)*65536*GetTimeLSB());
+}
+
+void LTC2946::SetVoltageSource(uint8_t voltage_sel)
+// Select what the VIN register measures (and power multiplies): LTC2946_VDD, LTC2946_SENSE_PLUS or LTC2946_ADIN.
+{
+    VOLTAGE_SEL = voltage_sel & ~LTC2946_CTRLA_VOLTAGE_SEL_MASK;
+    CTRLA = (CTRLA & LTC2946_CTRLA_VOLTAGE_SEL_MASK) | VOLTAGE_SEL;
+
+    //Snapshot writes CTRLA on every read, only continuous mode needs an update now
+    if(LTC2946_mode == 0)
+    {
+        I2C_ACK |= LTC2946_write(LTC2946_CTRLA_REG, CTRLA);
     }
+}
+
+uint8_t LTC2946::GetVoltageSource()
+{
+    return(VOLTAGE_SEL);
+}
 
-    //Conversion
-    if(use_conversion)
+float LTC2946::ReadVIN()
+{
+    int8_t ack = 0;
+    uint16_t VIN_code = 0;
+
+    //Continuous Request
+    if(LTC2946_mode == 0)
     {
-        if(use_legacy)
-        {
-            //Legacy conversion
-            VIN_Return = LTC2946_VIN_code_to_voltage(VIN_code);
-        }
-        else
-        {
-            //Experimental conversion
-            VIN_Return = (float)VIN_code*VIN_CONST;
-        }
+        ack |= LTC2946_read_12_bits(LTC2946_VIN_MSB_REG, &VIN_code);
     }
-    else
+    //Snapshot Request
+    else if(LTC2946_mode == 1)
     {
-        //Return RAW value
-        VIN_Return = (float)VIN_code;
+        ack |= LTC2946_snapshot(VOLTAGE_SEL);
+        ack |= LTC2946_read_12_bits(LTC2946_VIN_MSB_REG, &VIN_code);
     }
 
     //update error
     I2C_ACK |= ack;
 
-    return(VIN_Return);
+    return(LTC2946_convert_VIN(VIN_code));
 }
 
 float LTC2946::ReadCurrent()
 {
     int8_t ack = 0;
-    uint16_t current_code;
-    float current_Return = 0;
+    uint16_t current_code = 0;
 
     //Continuous Request
     if(LTC2946_mode == 0)
@@ -166,476 +377,373 @@ float LTC2946::ReadCurrent()
     //Snapshot Request
     else if(LTC2946_mode == 1)
     {
-        int8_t LTC2946_mode;
-        LTC2946_mode = LTC2946_CHANNEL_CONFIG_SNAPSHOT | LTC2946_DELTA_SENSE;
-        ack |= LTC2946_write(LTC2946_CTRLA_REG, LTC2946_mode);
-
-        uint8_t busy;
-        do
-        {
-            ack |= LTC2946_read(LTC2946_STATUS2_REG, &busy);        //!< Check to see if conversion is still in process
-        }
-        while (0x8 & busy);
-
+        ack |= LTC2946_snapshot(LTC2946_DELTA_SENSE);
         ack |= LTC2946_read_12_bits(LTC2946_DELTA_SENSE_MSB_REG, &current_code);
     }
 
-    //Conversion
-    if(use_conversion)
+    //update error
+    I2C_ACK |= ack;
+
+    return(LTC2946_convert_current(LTC2946_signed_current_code(current_code)));
+}
+
+float LTC2946::ReadPower()
+{
+    int8_t ack = 0;
+    uint32_t power_code = 0;
+    uint16_t VIN_code = 0;
+
+    //Continuous Request
+    if(LTC2946_mode == 0)
     {
-        if(use_legacy)
+        if(use_bidirectional)
         {
-            //Legacy conversion
-            current_Return = LTC2946_code_to_current(current_code);
+            //Signed power needs the VIN code the power was multiplied from: one burst POWER_MSB2..VIN_LSB
+            uint8_t block[LTC2946_VIN_LSB_REG - LTC2946_POWER_MSB2_REG + 1];
+            ack |= LTC2946_read_block(LTC2946_POWER_MSB2_REG, block, sizeof(block));
+            power_code = LTC2946_block_24_bits(block, 0);
+            VIN_code = LTC2946_block_12_bits(block, LTC2946_VIN_MSB_REG - LTC2946_POWER_MSB2_REG);
         }
         else
         {
-            //Experimental conversion
-            current_Return = (float)current_code*CURRENT_CONST;
+            ack |= LTC2946_read_24_bits(LTC2946_POWER_MSB2_REG, &power_code);
         }
     }
-    else
+    //Snapshot Request
+    else if(LTC2946_mode == 1)
     {
-        //Return RAW value
-        current_Return = (float)current_code;
+        //Not available Yet
     }
 
     //update error
     I2C_ACK |= ack;
 
-    return(current_Return);
+    return(LTC2946_convert_power(LTC2946_signed_power_code(power_code, VIN_code)));
 }
 
-float LTC2946::ReadPower()
+float LTC2946::ReadADIN()
 {
     int8_t ack = 0;
-    uint32_t power_code;
-    float power_Return = 0;
+    uint16_t ADIN_code = 0;
 
     //Continuous Request
     if(LTC2946_mode == 0)
     {
-        ack |= LTC2946_read_24_bits(LTC2946_POWER_MSB2_REG, &power_code);
+        ack |= LTC2946_read_12_bits(LTC2946_ADIN_MSB_REG, &ADIN_code);
     }
     //Snapshot Request
     else if(LTC2946_mode == 1)
     {
-        //Not available Yet
-    }
-
-    //Conversion
-    if(use_conversion)
-    {
-        if(use_legacy)
-        {
-            //Legacy conversion
-            //Not available yet
-        }
-        else
-        {
-            //Experimental conversion
-            power_Return = (float)power_code*POWER_CONST;
-        }
-    }
-    else
-    {
-        //Return RAW value
-        power_Return = (float)power_code;
+        ack |= LTC2946_snapshot(LTC2946_ADIN);
+        ack |= LTC2946_read_12_bits(LTC2946_ADIN_MSB_REG, &ADIN_code);
     }
 
     //update error
     I2C_ACK |= ack;
 
-    return(power_Return);
+    return(LTC2946_convert_ADIN(ADIN_code));
 }
 
+int8_t LTC2946::ReadAll(float *vin, float *current, float *power, float *adin)
+// Continuous mode: one I2C transaction from POWER_MSB2 (0x05) through ADIN_LSB (0x29).
+// Snapshot mode converts one channel at a time, so ReadAllCodes reads them one by one (power not available).
+{
+    uint16_t VIN_code, current_code, ADIN_code;
+    uint32_t power_code;
 
+    int8_t ack = ReadAllCodes(&VIN_code, &current_code, &power_code, &ADIN_code);
 
+    *vin = LTC2946_convert_VIN(VIN_code);
+    *current = LTC2946_convert_current(LTC2946_signed_current_code(current_code));
+    *power = (LTC2946_mode == 1) ? 0 : LTC2946_convert_power(LTC2946_signed_power_code(power_code, VIN_code));
+    *adin = LTC2946_convert_ADIN(ADIN_code);
 
-/*
-Here is where I would add provisions for limits and colombs and joules, if I ever find time for that
-*/
-
-
-
-
-
+    return(ack);
+}
 
-// Write an 8-bit code to the LTC2946.
-int8_t LTC2946::LTC2946_write(uint8_t adc_command, uint8_t code)
-// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+int8_t LTC2946::ReadAllCodes(uint16_t *vin_code, uint16_t *current_code, uint32_t *power_code, uint16_t *adin_code)
+// Continuous mode: one I2C transaction from POWER_MSB2 (0x05) through ADIN_LSB (0x29).
 {
-    int8_t ack;
-
-//  ack = i2c_write_byte_data(i2c_address, adc_command, code);
+    int8_t ack = 0;
 
-    if(I2C_WIRE == 0){
-        Wire.beginTransmission(I2C_ADDRESS);
-        Wire.write(adc_command);
+    if(LTC2946_mode == 1)
+    {
+        ack |= LTC2946_snapshot(VOLTAGE_SEL);
+        ack |= LTC2946_read_12_bits(LTC2946_VIN_MSB_REG, vin_code);
+        ack |= LTC2946_snapshot(LTC2946_DELTA_SENSE);
+        ack |= LTC2946_read_12_bits(LTC2946_DELTA_SENSE_MSB_REG, current_code);
+        ack |= LTC2946_snapshot(LTC2946_ADIN);
+        ack |= LTC2946_read_12_bits(LTC2946_ADIN_MSB_REG, adin_code);
+        *power_code = 0;
+    }
+    else
+    {
+        uint8_t block[LTC2946_ADIN_LSB_REG_REG - LTC2946_POWER_MSB2_REG + 1];
+        ack = LTC2946_read_block(LTC2946_POWER_MSB2_REG, block, sizeof(block));
 
-        Wire.write(code);
-        ack = Wire.endTransmission(false);
-    }else if(I2C_WIRE == 1){
-        Wire1.beginTransmission(I2C_ADDRESS);
-        Wire1.write(adc_command);
+        LTC2946_CodeColumns columns = {power_code, current_code, vin_code, adin_code};
+        LTC2946_unpack_blocks(block, 1, sizeof(block), LTC2946_POWER_MSB2_REG, sizeof(block), &columns);
+    }
 
-        Wire1.write(code);
-        ack = Wire1.endTransmission(false);
-    }else if(I2C_WIRE == 2){
-        Wire2.beginTransmission(I2C_ADDRESS);
-        Wire2.write(adc_command);
+    //update error
+    I2C_ACK |= ack;
 
-        Wire2.write(code);
-        ack = Wire2.endTransmission(false);
-    }else if(I2C_WIRE == 3){
-        Wire3.beginTransmission(I2C_ADDRESS);
-        Wire3.write(adc_command);
+    return(ack);
+}
 
-        Wire3.write(code);
-        ack = Wire3.endTransmission(false);
-    }
+int8_t LTC2946::ReadMinMax(LTC2946_MinMax *stats)
+// One I2C transaction from MAX_POWER_MSB2 (0x08) through MIN_ADIN_LSB (0x2D).
+{
+    uint8_t block[LTC2946_MIN_ADIN_LSB_REG - LTC2946_MAX_POWER_MSB2_REG + 1];
+    int8_t ack = LTC2946_read_block(LTC2946_MAX_POWER_MSB2_REG, block, sizeof(block));
+
+    //! 1) Codes. DELTA_SENSE_MSB (0x14) through MIN_ADIN_LSB are all 12-bit registers, decoded in one run
+    uint16_t codes[(LTC2946_MIN_ADIN_LSB_REG - LTC2946_DELTA_SENSE_MSB_REG + 1)/2];
+    LTC2946_unpack_12_array(block + LTC2946_DELTA_SENSE_MSB_REG - LTC2946_MAX_POWER_MSB2_REG, codes, sizeof(codes)/sizeof(codes[0]));
+    uint32_t max_power = LTC2946_block_24_bits(block, LTC2946_MAX_POWER_MSB2_REG - LTC2946_MAX_POWER_MSB2_REG);
+    uint32_t min_power = LTC2946_block_24_bits(block, LTC2946_MIN_POWER_MSB2_REG - LTC2946_MAX_POWER_MSB2_REG);
+    uint16_t max_current = codes[(LTC2946_MAX_DELTA_SENSE_MSB_REG - LTC2946_DELTA_SENSE_MSB_REG)/2];
+    uint16_t min_current = codes[(LTC2946_MIN_DELTA_SENSE_MSB_REG - LTC2946_DELTA_SENSE_MSB_REG)/2];
+
+    //! 2) Conversion, current signed in bidirectional mode. The chip keeps the extremes of the unsigned
+    //! power product; signing one needs the VIN code of its conversion, which is not kept, so power stays unsigned
+    stats->vin_max = LTC2946_convert_VIN(codes[(LTC2946_MAX_VIN_MSB_REG - LTC2946_DELTA_SENSE_MSB_REG)/2]);
+    stats->vin_min = LTC2946_convert_VIN(codes[(LTC2946_MIN_VIN_MSB_REG - LTC2946_DELTA_SENSE_MSB_REG)/2]);
+    stats->current_max = LTC2946_convert_current(LTC2946_signed_current_code(max_current));
+    stats->current_min = LTC2946_convert_current(LTC2946_signed_current_code(min_current));
+    stats->power_max = LTC2946_convert_power((int32_t)max_power);
+    stats->power_min = LTC2946_convert_power((int32_t)min_power);
+    stats->adin_max = LTC2946_convert_ADIN(codes[(LTC2946_MAX_ADIN_MSB_REG - LTC2946_DELTA_SENSE_MSB_REG)/2]);
+    stats->adin_min = LTC2946_convert_ADIN(codes[(LTC2946_MIN_ADIN_MSB_REG - LTC2946_DELTA_SENSE_MSB_REG)/2]);
 
-    return ack;
+    //update error
+    I2C_ACK |= ack;
 
+    return(ack);
 }
 
-// Write a 16-bit code to the LTC2946.
-int8_t LTC2946::LTC2946_write_16_bits(uint8_t adc_command, uint16_t code)
-// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+int8_t LTC2946::ReadRegisters(uint8_t reg, uint8_t *buffer, uint8_t length)
 {
-  int8_t ack;
-
-  union
-  {
-    uint8_t b[2];
-    uint16_t w;
-  } data;
-
-  data.w = code;
-
-//  ack = i2c_write_word_data(i2c_address, adc_command, code);
-
-    if(I2C_WIRE == 0){
-        Wire.beginTransmission(I2C_ADDRESS);
-        Wire.write(adc_command);
-
-        Wire.write(data.b[1]);
-        Wire.write(data.b[0]);
-        ack = Wire.endTransmission(false);
-    }else if(I2C_WIRE == 1){
-        Wire1.beginTransmission(I2C_ADDRESS);
-        Wire1.write(adc_command);
-
-        Wire1.write(data.b[1]);
-        Wire1.write(data.b[0]);
-        ack = Wire1.endTransmission(false);
-    }else if(I2C_WIRE == 2){
-        Wire2.beginTransmission(I2C_ADDRESS);
-        Wire2.write(adc_command);
-
-        Wire2.write(data.b[1]);
-        Wire2.write(data.b[0]);
-        ack = Wire2.endTransmission(false);
-    }else if(I2C_WIRE == 3){
-        Wire3.beginTransmission(I2C_ADDRESS);
-        Wire3.write(adc_command);
-
-        Wire3.write(data.b[1]);
-        Wire3.write(data.b[0]);
-        ack = Wire3.endTransmission(false);
-    }
+    int8_t ack = LTC2946_read_block(reg, buffer, length);
+
+    //update error
+    I2C_ACK |= ack;
 
-  return(ack);
+    return(ack);
 }
 
-// Write a 24-bit code to the LTC2946.
-int8_t LTC2946::LTC2946_write_24_bits(uint8_t adc_command, uint32_t code)
-// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+int8_t LTC2946::ReadField(const LTC2946_Field &field, uint8_t *value)
 {
-    int8_t ack;
+    uint8_t reg;
+    int8_t ack = LTC2946_read(field.address, &reg);
+    if(ack == 0) *value = field.Extract(reg);
 
-    union
-    {
-        int32_t MY_int32;    //!< 32-bit signed integer to be converted to four bytes
-        uint32_t MY_uint32;  //!< 32-bit unsigned integer to be converted to four bytes
-        uint8_t MY_byte[4];  //!< 4 bytes (unsigned 8-bit integers) to be converted to a 32-bit signed or unsigned integer
-    } data;
-
-
-    data.MY_int32 = code;
-
-    //  ack = i2c_write_block_data(i2c_address, adc_command, (uint8_t) 3, data.LT_byte);
-
-    if(I2C_WIRE == 0){
-        Wire.beginTransmission(I2C_ADDRESS);
-        Wire.write(adc_command);
-
-        Wire.write(data.MY_byte[2]);
-        Wire.write(data.MY_byte[1]);
-        Wire.write(data.MY_byte[0]);
-        ack = Wire.endTransmission(false);
-    }else if(I2C_WIRE == 1){
-        Wire1.beginTransmission(I2C_ADDRESS);
-        Wire1.write(adc_command);
-
-        Wire1.write(data.MY_byte[2]);
-        Wire1.write(data.MY_byte[1]);
-        Wire1.write(data.MY_byte[0]);
-        ack = Wire1.endTransmission(false);
-    }else if(I2C_WIRE == 2){
-        Wire2.beginTransmission(I2C_ADDRESS);
-        Wire2.write(adc_command);
-
-        Wire2.write(data.MY_byte[2]);
-        Wire2.write(data.MY_byte[1]);
-        Wire2.write(data.MY_byte[0]);
-        ack = Wire2.endTransmission(false);
-    }else if(I2C_WIRE == 3){
-        Wire3.beginTransmission(I2C_ADDRESS);
-        Wire3.write(adc_command);
-
-        Wire3.write(data.MY_byte[2]);
-        Wire3.write(data.MY_byte[1]);
-        Wire3.write(data.MY_byte[0]);
-        ack = Wire3.endTransmission(false);
-    }
+    //update error
+    I2C_ACK |= ack;
 
     return(ack);
 }
 
-int8_t LTC2946::LTC2946_write_32_bits(uint8_t adc_command, uint32_t code)
-// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+int8_t LTC2946::WriteField(const LTC2946_Field &field, uint8_t value)
 {
-    int8_t ack;
-
-    union
+    uint8_t reg;
+    int8_t ack = LTC2946_read(field.address, &reg);
+    if(ack == 0 && field.Extract(reg) != field.Extract(field.Value(value)))
     {
-        int32_t MY_int32;    //!< 32-bit signed integer to be converted to four bytes
-        uint32_t MY_uint32;  //!< 32-bit unsigned integer to be converted to four bytes
-        uint8_t MY_byte[4];  //!< 4 bytes (unsigned 8-bit integers) to be converted to a 32-bit signed or unsigned integer
-    } data;
-
-
-    data.MY_int32 = code;
-
-    if(I2C_WIRE == 0){
-        Wire.beginTransmission(I2C_ADDRESS);
-        Wire.write(adc_command);
-
-        Wire.write(data.MY_byte[3]);
-        Wire.write(data.MY_byte[2]);
-        Wire.write(data.MY_byte[1]);
-        Wire.write(data.MY_byte[0]);
-        ack = Wire.endTransmission(false);
-    }else if(I2C_WIRE == 1){
-        Wire1.beginTransmission(I2C_ADDRESS);
-        Wire1.write(adc_command);
-
-        Wire1.write(data.MY_byte[3]);
-        Wire1.write(data.MY_byte[2]);
-        Wire1.write(data.MY_byte[1]);
-        Wire1.write(data.MY_byte[0]);
-        ack = Wire1.endTransmission(false);
-    }else if(I2C_WIRE == 2){
-        Wire2.beginTransmission(I2C_ADDRESS);
-        Wire2.write(adc_command);
-
-        Wire2.write(data.MY_byte[3]);
-        Wire2.write(data.MY_byte[2]);
-        Wire2.write(data.MY_byte[1]);
-        Wire2.write(data.MY_byte[0]);
-        ack = Wire2.endTransmission(false);
-    }else if(I2C_WIRE == 3){
-        Wire3.beginTransmission(I2C_ADDRESS);
-        Wire3.write(adc_command);
-
-        Wire3.write(data.MY_byte[3]);
-        Wire3.write(data.MY_byte[2]);
-        Wire3.write(data.MY_byte[1]);
-        Wire3.write(data.MY_byte[0]);
-        ack = Wire3.endTransmission(false);
+        ack |= LTC2946_write(field.address, field.Insert(reg, value));
     }
 
-    // ack = i2c_write_block_data(i2c_address, adc_command, (uint8_t) 4, data.LT_byte);
+    //update error
+    I2C_ACK |= ack;
 
     return(ack);
 }
 
-// Reads an 8-bit adc_code from LTC2946
-int8_t LTC2946::LTC2946_read(uint8_t adc_command, uint8_t *adc_code)
-// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+int8_t LTC2946::ReadStatus(uint8_t *status1, uint8_t *fault1)
 {
-    int8_t ack;
-
-    //  ack = i2c_read_byte_data(i2c_address, adc_command, adc_code);
+    uint8_t block[2];
+    int8_t ack = LTC2946_read_block(LTC2946_STATUS1_REG, block, sizeof(block));
 
-    if(I2C_WIRE == 0){
-        Wire.beginTransmission(I2C_ADDRESS);
-        Wire.write(adc_command);
+    *status1 = block[0];
+    *fault1 = block[1];
 
-        ack = Wire.endTransmission(false);
-
-        Wire.requestFrom(I2C_ADDRESS, (uint8_t)1);
-
-        *adc_code = Wire.read();
-    }else if(I2C_WIRE == 1){
-        Wire1.beginTransmission(I2C_ADDRESS);
-        Wire1.write(adc_command);
+    //update error
+    I2C_ACK |= ack;
 
-        ack = Wire1.endTransmission(false);
+    return(ack);
+}
 
-        Wire1.requestFrom(I2C_ADDRESS, (uint8_t)1);
+int8_t LTC2946::ClearFaults()
+{
+    int8_t ack = LTC2946_write(LTC2946_FAULT1_REG, 0x00);
 
-        *adc_code = Wire1.read();
-    }else if(I2C_WIRE == 2){
-        Wire2.beginTransmission(I2C_ADDRESS);
-        Wire2.write(adc_command);
+    //update error
+    I2C_ACK |= ack;
 
-        ack = Wire2.endTransmission(false);
+    return(ack);
+}
 
-        Wire2.requestFrom(I2C_ADDRESS, (uint8_t)1);
+int8_t LTC2946::ClearFault2(uint8_t bits)
+// Fault bits are only cleared by writing 0, bits written 1 are left as they are
+{
+    int8_t ack = LTC2946_write(LTC2946_FAULT2_REG, (uint8_t)~bits);
 
-        *adc_code = Wire2.read();
-    }else if(I2C_WIRE == 3){
-        Wire3.beginTransmission(I2C_ADDRESS);
-        Wire3.write(adc_command);
+    //update error
+    I2C_ACK |= ack;
 
-        ack = Wire3.endTransmission(false);
+    return(ack);
+}
 
-        Wire3.requestFrom(I2C_ADDRESS, (uint8_t)1);
+int8_t LTC2946::LTC2946_snapshot(uint8_t channel)
+// Start a single conversion of channel (voltage selection code) and wait for the ADC to finish.
+{
+    int8_t ack = 0;
+    uint8_t busy;
 
-        *adc_code = Wire3.read();
+    ack |= LTC2946_write(LTC2946_CTRLA_REG, LTC2946_CHANNEL_CONFIG_SNAPSHOT | channel);
+    do
+    {
+        ack |= LTC2946_read(LTC2946_STATUS2_REG, &busy);        //!< Check to see if conversion is still in process
     }
+    while ((LTC2946_STATUS2_ADC_BUSY & busy) && ack == 0);
 
-    return ack;
+    return(ack);
 }
 
-// Reads a 12-bit adc_code from LTC2946
-int8_t LTC2946::LTC2946_read_12_bits(uint8_t adc_command, uint16_t *adc_code)
-// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+float LTC2946::LTC2946_convert_VIN(uint16_t VIN_code)
 {
-    // Use union type defined in Linduino.h to combine two uint8_t's (8-bit unsigned integers) into one uint16_t (unsigned 16-bit integer)
-    // Then, shift by 4 bits and return in *adc_code
-    int8_t ack;
+    if(!use_conversion) return((float)VIN_code);    //Return RAW value
+    if(use_legacy) return(LTC2946_VIN_code_to_voltage(VIN_code));
+    return((float)VIN_code*VIN_CONST + VIN_OFFSET);
+}
 
-    union
-    {
-        uint8_t b[2];
-        uint16_t w;
-    } data;
+float LTC2946::LTC2946_convert_current(int32_t current_signed)
+// RAW value is signed in bidirectional mode
+{
+    if(!use_conversion) return((float)current_signed);
+    if(use_legacy) return(LTC2946_code_to_current(current_signed));
+    return((float)current_signed*CURRENT_CONST + CURRENT_OFFSET);
+}
 
+float LTC2946::LTC2946_convert_power(int32_t power_signed)
+// RAW value is signed in bidirectional mode
+{
+    if(!use_conversion) return((float)power_signed);
+    if(use_legacy) return(LTC2946_code_to_power(power_signed));
+    return((float)power_signed*POWER_CONST + POWER_OFFSET);
+}
 
-    //  ack = i2c_read_word_data(i2c_address, adc_command, adc_code);
+float LTC2946::LTC2946_convert_ADIN(uint16_t ADIN_code)
+{
+    if(!use_conversion) return((float)ADIN_code);
+    if(use_legacy) return(LTC2946_ADIN_code_to_voltage(ADIN_code));
+    return((float)ADIN_code*ADIN_CONST + ADIN_OFFSET);
+}
 
-    if(I2C_WIRE == 0){
-        Wire.beginTransmission(I2C_ADDRESS);
-        Wire.write(adc_command);
 
-        ack = Wire.endTransmission(false);
 
-        Wire.requestFrom(I2C_ADDRESS, (uint8_t)2);
 
-        data.b[1] = Wire.read();
-        data.b[0] = Wire.read();
-    }else if(I2C_WIRE == 1){
-        Wire1.beginTransmission(I2C_ADDRESS);
-        Wire1.write(adc_command);
+int32_t LTC2946::LTC2946_signed_current_code(uint16_t current_code)
+{
+    if(!use_bidirectional) return((int32_t)current_code);
+    return((int32_t)current_code - (int32_t)CURRENT_ZERO_CODE);
+}
 
-        ack = Wire1.endTransmission(false);
+int32_t LTC2946::LTC2946_signed_power_code(uint32_t power_code, uint16_t vin_code)
+{
+    if(!use_bidirectional) return((int32_t)power_code);
+    return((int32_t)power_code - (int32_t)CURRENT_ZERO_CODE*(int32_t)vin_code);      //! P = V*(I - I0) = V*I - V*I0
+}
 
-        Wire1.requestFrom(I2C_ADDRESS, (uint8_t)2);
+int64_t LTC2946::LTC2946_signed_charge_code(uint32_t charge_code, uint32_t time_code)
+{
+    if(!use_bidirectional) return((int64_t)charge_code);
+    return((int64_t)charge_code - ((int64_t)CURRENT_ZERO_CODE*time_code)/16);
+}
 
-        data.b[1] = Wire1.read();
-        data.b[0] = Wire1.read();
-    }else if(I2C_WIRE == 2){
-        Wire2.beginTransmission(I2C_ADDRESS);
-        Wire2.write(adc_command);
+int64_t LTC2946::LTC2946_signed_energy_code(uint32_t energy_code, uint32_t time_code, uint16_t vin_code)
+{
+    if(!use_bidirectional) return((int64_t)energy_code);
+    return((int64_t)energy_code - ((int64_t)CURRENT_ZERO_CODE*vin_code*time_code)/65536);
+}
 
-        ack = Wire2.endTransmission(false);
 
-        Wire2.requestFrom(I2C_ADDRESS, (uint8_t)2);
+/*
+Here is where I would add provisions for limits and colombs and joules, if I ever find time for that
+*/
 
-        data.b[1] = Wire2.read();
-        data.b[0] = Wire2.read();
-    }else if(I2C_WIRE == 3){
-        Wire3.beginTransmission(I2C_ADDRESS);
-        Wire3.write(adc_command);
 
-        ack = Wire3.endTransmission(false);
 
-        Wire3.requestFrom(I2C_ADDRESS, (uint8_t)2);
 
-        data.b[1] = Wire3.read();
-        data.b[0] = Wire3.read();
-    }
 
-    //Serial.print(data.b[1],BIN); Serial.print(" | "); Serial.print(data.b[0],BIN); Serial.print(" | "); Serial.print(data.w,BIN); Serial.print(" | ");
 
-    *adc_code = data.w;
+// Write an 8-bit code to the LTC2946.
+int8_t LTC2946::LTC2946_write(uint8_t adc_command, uint8_t code)
+// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+{
+    uint8_t data[2] = {adc_command, code};
 
-    *adc_code >>= 4;
-    return ack;
+    return(LTC2946_transfer(data, 2, 0, 0));
 }
 
-// Reads a 16-bit adc_code from LTC2946
-int8_t LTC2946::LTC2946_read_16_bits(uint8_t adc_command, uint16_t *adc_code)
+// Write a 16-bit code to the LTC2946.
+int8_t LTC2946::LTC2946_write_16_bits(uint8_t adc_command, uint16_t code)
 // The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
 {
-    int8_t ack;
+    uint8_t buffer[3] = {adc_command, (uint8_t)(code >> 8), (uint8_t)code};
 
-    union
-    {
-        uint8_t b[2];
-        uint16_t w;
-    } data;
-
-    // ack = i2c_read_word_data(i2c_address, adc_command, adc_code);
-
-    if(I2C_WIRE == 0){
-        Wire.beginTransmission(I2C_ADDRESS);
-        Wire.write(adc_command);
-
-        ack = Wire.endTransmission(false);
-
-        Wire.requestFrom(I2C_ADDRESS, (uint8_t)2);
-
-        data.b[1] = Wire.read();
-        data.b[0] = Wire.read();
-    }else if(I2C_WIRE == 1){
-        Wire1.beginTransmission(I2C_ADDRESS);
-        Wire1.write(adc_command);
+    return(LTC2946_transfer(buffer, 3, 0, 0));
+}
 
-        ack = Wire1.endTransmission(false);
+// Write a 24-bit code to the LTC2946.
+int8_t LTC2946::LTC2946_write_24_bits(uint8_t adc_command, uint32_t code)
+// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+{
+    uint8_t buffer[4] = {adc_command, (uint8_t)(code >> 16), (uint8_t)(code >> 8), (uint8_t)code};
 
-        Wire1.requestFrom(I2C_ADDRESS, (uint8_t)2);
+    return(LTC2946_transfer(buffer, 4, 0, 0));
+}
 
-        data.b[1] = Wire1.read();
-        data.b[0] = Wire1.read();
-    }else if(I2C_WIRE == 2){
-        Wire2.beginTransmission(I2C_ADDRESS);
-        Wire2.write(adc_command);
+int8_t LTC2946::LTC2946_write_32_bits(uint8_t adc_command, uint32_t code)
+// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+{
+    uint8_t buffer[5] = {adc_command, (uint8_t)(code >> 24), (uint8_t)(code >> 16), (uint8_t)(code >> 8), (uint8_t)code};
 
-        ack = Wire2.endTransmission(false);
+    return(LTC2946_transfer(buffer, 5, 0, 0));
+}
 
-        Wire2.requestFrom(I2C_ADDRESS, (uint8_t)2);
+// Reads an 8-bit adc_code from LTC2946
+int8_t LTC2946::LTC2946_read(uint8_t adc_command, uint8_t *adc_code)
+// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+{
+    return(LTC2946_transfer(&adc_command, 1, adc_code, 1));
+}
 
-        data.b[1] = Wire2.read();
-        data.b[0] = Wire2.read();
-    }else if(I2C_WIRE == 3){
-        Wire3.beginTransmission(I2C_ADDRESS);
-        Wire3.write(adc_command);
+// Reads a 12-bit adc_code from LTC2946
+int8_t LTC2946::LTC2946_read_12_bits(uint8_t adc_command, uint16_t *adc_code)
+// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+{
+    // Registers are MSB first; shifts assemble the code independent of host byte order
+    int8_t ack;
+    uint8_t buffer[2];
 
-        ack = Wire3.endTransmission(false);
+    ack = LTC2946_transfer(&adc_command, 1, buffer, 2);
 
-        Wire3.requestFrom(I2C_ADDRESS, (uint8_t)2);
+    *adc_code = LTC2946_unpack_12(buffer);
+    return(ack);
+}
 
-        data.b[1] = Wire3.read();
-        data.b[0] = Wire3.read();
-    }
+// Reads a 16-bit adc_code from LTC2946
+int8_t LTC2946::LTC2946_read_16_bits(uint8_t adc_command, uint16_t *adc_code)
+// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+{
+    int8_t ack;
+    uint8_t buffer[2];
 
-    *adc_code = data.w;
+    ack = LTC2946_transfer(&adc_command, 1, buffer, 2);
 
-    return ack;
+    *adc_code = LTC2946_unpack_16(buffer);
+    return(ack);
 }
 
 // Reads a 24-bit adc_code from LTC2946
@@ -643,63 +751,11 @@ int8_t LTC2946::LTC2946_read_24_bits(uint8_t adc_command, uint32_t *adc_code)
 // The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
 {
     int8_t ack;
+    uint8_t buffer[3];
 
-    union
-    {
-        int32_t MY_int32;    //!< 32-bit signed integer to be converted to four bytes
-        uint32_t MY_uint32;  //!< 32-bit unsigned integer to be converted to four bytes
-        uint8_t MY_byte[4];  //!< 4 bytes (unsigned 8-bit integers) to be converted to a 32-bit signed or unsigned integer
-    } data;
-
-    // ack = i2c_read_block_data(i2c_address, adc_command, (uint8_t)3, data.LT_byte);
-
-    if(I2C_WIRE == 0){
-        Wire.beginTransmission(I2C_ADDRESS);
-        Wire.write(adc_command);
-
-        ack = Wire.endTransmission(false);
-
-        Wire.requestFrom(I2C_ADDRESS, (uint8_t)3);
-
-        data.MY_byte[2] = Wire.read();
-        data.MY_byte[1] = Wire.read();
-        data.MY_byte[0] = Wire.read();
-    }else if(I2C_WIRE == 1){
-        Wire1.beginTransmission(I2C_ADDRESS);
-        Wire1.write(adc_command);
-
-        ack = Wire1.endTransmission(false);
-
-        Wire1.requestFrom(I2C_ADDRESS, (uint8_t)3);
-
-        data.MY_byte[2] = Wire1.read();
-        data.MY_byte[1] = Wire1.read();
-        data.MY_byte[0] = Wire1.read();
-    }else if(I2C_WIRE == 2){
-        Wire2.beginTransmission(I2C_ADDRESS);
-        Wire2.write(adc_command);
+    ack = LTC2946_transfer(&adc_command, 1, buffer, 3);
 
-        ack = Wire2.endTransmission(false);
-
-        Wire2.requestFrom(I2C_ADDRESS, (uint8_t)3);
-
-        data.MY_byte[2] = Wire2.read();
-        data.MY_byte[1] = Wire2.read();
-        data.MY_byte[0] = Wire2.read();
-    }else if(I2C_WIRE == 3){
-        Wire3.beginTransmission(I2C_ADDRESS);
-        Wire3.write(adc_command);
-
-        ack = Wire3.endTransmission(false);
-
-        Wire3.requestFrom(I2C_ADDRESS, (uint8_t)3);
-
-        data.MY_byte[2] = Wire3.read();
-        data.MY_byte[1] = Wire3.read();
-        data.MY_byte[0] = Wire3.read();
-    }
-
-    *adc_code = 0x0FFFFFF & data.MY_int32;
+    *adc_code = LTC2946_unpack_24(buffer);
     return(ack);
 }
 
@@ -708,70 +764,47 @@ int8_t LTC2946::LTC2946_read_32_bits(uint8_t adc_command, uint32_t *adc_code)
 // The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
 {
     int8_t ack;
+    uint8_t buffer[4];
 
-    union
-    {
-        int32_t MY_int32;    //!< 32-bit signed integer to be converted to four bytes
-        uint32_t MY_uint32;  //!< 32-bit unsigned integer to be converted to four bytes
-        uint8_t MY_byte[4];  //!< 4 bytes (unsigned 8-bit integers) to be converted to a 32-bit signed or unsigned integer
-    } data;
-
-    // ack = i2c_read_block_data(i2c_address, adc_command, (uint8_t) 4, data.LT_byte);
-
-    if(I2C_WIRE == 0){
-        Wire.beginTransmission(I2C_ADDRESS);
-        Wire.write(adc_command);
-
-        ack = Wire.endTransmission(false);
+    ack = LTC2946_transfer(&adc_command, 1, buffer, 4);
 
-        Wire.requestFrom(I2C_ADDRESS, (uint8_t)4);
-
-        data.MY_byte[3] = Wire.read();
-        data.MY_byte[2] = Wire.read();
-        data.MY_byte[1] = Wire.read();
-        data.MY_byte[0] = Wire.read();
-    }else if(I2C_WIRE == 1){
-        Wire1.beginTransmission(I2C_ADDRESS);
-        Wire1.write(adc_command);
-
-        ack = Wire1.endTransmission(false);
-
-        Wire1.requestFrom(I2C_ADDRESS, (uint8_t)4);
-
-        data.MY_byte[3] = Wire1.read();
-        data.MY_byte[2] = Wire1.read();
-        data.MY_byte[1] = Wire1.read();
-        data.MY_byte[0] = Wire1.read();
-    }else if(I2C_WIRE == 2){
-        Wire2.beginTransmission(I2C_ADDRESS);
-        Wire2.write(adc_command);
-
-        ack = Wire2.endTransmission(false);
-
-        Wire2.requestFrom(I2C_ADDRESS, (uint8_t)4);
-
-        data.MY_byte[3] = Wire2.read();
-        data.MY_byte[2] = Wire2.read();
-        data.MY_byte[1] = Wire2.read();
-        data.MY_byte[0] = Wire2.read();
-    }else if(I2C_WIRE == 3){
-        Wire3.beginTransmission(I2C_ADDRESS);
-        Wire3.write(adc_command);
+    *adc_code = LTC2946_unpack_32(buffer);
+    return(ack);
+}
 
-        ack = Wire3.endTransmission(false);
+// Reads a block of consecutive registers from LTC2946
+int8_t LTC2946::LTC2946_read_block(uint8_t adc_command, uint8_t *buffer, uint8_t length)
+// The LTC2946 auto-increments the register address, so one transaction covers length registers.
+// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+{
+    return(LTC2946_transfer(&adc_command, 1, buffer, length));
+}
 
-        Wire3.requestFrom(I2C_ADDRESS, (uint8_t)4);
+// One combined I2C transaction with the LTC2946
+int8_t LTC2946::LTC2946_transfer(const uint8_t *write_data, uint8_t write_length, uint8_t *read_data, uint8_t read_length)
+// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+{
+    int8_t ack = 1;
+    if(bus != 0) ack = bus->Transfer(I2C_ADDRESS, write_data, write_length, read_data, read_length);
 
-        data.MY_byte[3] = Wire3.read();
-        data.MY_byte[2] = Wire3.read();
-        data.MY_byte[1] = Wire3.read();
-        data.MY_byte[0] = Wire3.read();
+    //A failed read holds whatever the bus left (0xFF after a NACK or lost arbitration); give zeros instead
+    if(ack != 0)
+    {
+        for(uint8_t i = 0; i < read_length; i++) read_data[i] = 0;
     }
+    return(ack);
+}
 
+// Extract a 12-bit code (left justified, MSB first) from a register block
+uint16_t LTC2946::LTC2946_block_12_bits(const uint8_t *block, uint8_t offset)
+{
+    return(LTC2946_unpack_12(block + offset));
+}
 
-
-    *adc_code = 0xFFFFFFFF & data.MY_int32;
-    return(ack);
+// Extract a 24-bit code (MSB first) from a register block
+uint32_t LTC2946::LTC2946_block_24_bits(const uint8_t *block, uint8_t offset)
+{
+    return(LTC2946_unpack_24(block + offset));
 }
 
 // Calculate the LTC2946 VIN voltage
@@ -795,7 +828,7 @@ float LTC2946::LTC2946_ADIN_code_to_voltage(uint16_t adc_code)
 }
 
 // Calculate the LTC2946 current with a sense resistor
-float LTC2946::LTC2946_code_to_current(uint16_t adc_code)
+float LTC2946::LTC2946_code_to_current(int32_t adc_code)
 // Returns the LTC2946 current in Amps
 //Legacy code
 {
@@ -823,7 +856,7 @@ float LTC2946::LTC2946_code_to_energy(int32_t adc_code)
 //Legacy code
 {
   float energy_lsb, energy;
-  energy_lsb=(float)(LTC2946_Power_lsb/resistor)*65536*LTC2946_TIME_lsb;   //! 1) Calculate Energy lsb from Power lsb and Time lsb
+  energy_lsb=GetEnergyLSB();                                  //! 1) Calculate Energy lsb from Power lsb and Time lsb
   energy = adc_code*energy_lsb;                               //! 2) Calculate Energy using Energy lsb and adc code
   return(energy);
 }
@@ -834,7 +867,7 @@ float LTC2946::LTC2946_code_to_coulombs(int32_t adc_code)
 //Legacy code
 {
   float coulomb_lsb, coulombs;
-  coulomb_lsb=(float)(LTC2946_DELTA_SENSE_lsb/resistor)*16*LTC2946_TIME_lsb;   //! 1) Calculate Coulomb lsb Current lsb and Time lsb
+  coulomb_lsb=GetChargeLSB();                                                  //! 1) Calculate Coulomb lsb Current lsb and Time lsb
   coulombs = adc_code*coulomb_lsb;                                             //! 2) Calculate Coulombs using Coulomb lsb and adc code
   return(coulombs);
 }
@@ -844,6 +877,6 @@ float LTC2946::LTC2946_code_to_time(float time_code)
 //Legacy code
 {
   float seconds;
-  seconds = LTC2946_TIME_lsb * time_code;
+  seconds = GetTimeLSB() * time_code;
   return seconds;
 }
@@ -75,7 +75,14 @@ Read power, current, voltage, charge and energy.
 #ifndef LTC2946_H
 #define LTC2946_H
 
+#ifdef ARDUINO
 #include <Arduino.h>
+#else
+#include <stdint.h>
+typedef uint8_t byte;
+#endif
+#include "LTC2946_Bus.h"
+#include "LTC2946_Registers.h"
 
 //! Use table to select address
 /*!
@@ -268,6 +275,8 @@ Read power, current, voltage, charge and energy.
 #define LTC2946_GPIO3_CTRL_REG                      0x42
 #define LTC2946_CLK_DIV_REG                         0x43
 
+#define LTC2946_REGISTER_COUNT                      0x44    //!< Registers 0x00 (CTRLA) to 0x43 (CLK_DIV)
+
 
 /*!
 | Voltage Selection Command            | Value |
@@ -363,8 +372,8 @@ Read power, current, voltage, charge and energy.
 | LTC2946_GPIO2_OUT_HIGH_Z               		|	0x10    |
 | LTC2946_GPIO2_OUT_LOW                  		|	0x12    |
 | LTC2946_GPIO2_IN_ACC                   		|	0x00    |
-| LTC2946_GPIO3_IN_ACTIVE_HIGH           		|	0x18    |
-| LTC2946_GPIO3_IN_ACTIVE_LOW            		|	0x10    |
+| LTC2946_GPIO3_IN_ACTIVE_HIGH           		|	0x0C    |
+| LTC2946_GPIO3_IN_ACTIVE_LOW            		|	0x08    |
 | LTC2946_GPIO3_OUT_REG_42               		|	0x04    |
 | LTC2946_GPIO3_OUT_ALERT                		|	0x00    |
 | LTC2946_GPIO3_OUT_LOW                  		|	0x40    |
@@ -482,6 +491,41 @@ Read power, current, voltage, charge and energy.
 #define LTC2946_GPIO_ALERT_CLEAR                0x00
 
 
+/*!
+| Status and Fault Bits                | Value |
+| :------------------------------------| :---: |
+| LTC2946_FAULT1_MAX_POWER             |  0x80 |
+| LTC2946_FAULT1_MIN_POWER             |  0x40 |
+| LTC2946_FAULT1_MAX_I_SENSE           |  0x20 |
+| LTC2946_FAULT1_MIN_I_SENSE           |  0x10 |
+| LTC2946_FAULT1_MAX_VIN               |  0x08 |
+| LTC2946_FAULT1_MIN_VIN               |  0x04 |
+| LTC2946_FAULT1_MAX_ADIN              |  0x02 |
+| LTC2946_FAULT1_MIN_ADIN              |  0x01 |
+| LTC2946_STATUS2_ADC_BUSY             |  0x08 |
+| LTC2946_FAULT2_ADC_DONE              |  0x80 |
+| LTC2946_FAULT2_ENERGY_OVERFLOW       |  0x04 |
+| LTC2946_FAULT2_CHARGE_OVERFLOW       |  0x02 |
+| LTC2946_FAULT2_COUNTER_OVERFLOW      |  0x01 |
+*/
+
+// FAULT1 bits are the latched versions of STATUS1, at the same positions
+#define LTC2946_FAULT1_MAX_POWER                0x80
+#define LTC2946_FAULT1_MIN_POWER                0x40
+#define LTC2946_FAULT1_MAX_I_SENSE              0x20
+#define LTC2946_FAULT1_MIN_I_SENSE              0x10
+#define LTC2946_FAULT1_MAX_VIN                  0x08
+#define LTC2946_FAULT1_MIN_VIN                  0x04
+#define LTC2946_FAULT1_MAX_ADIN                 0x02
+#define LTC2946_FAULT1_MIN_ADIN                 0x01
+
+#define LTC2946_STATUS2_ADC_BUSY                0x08
+#define LTC2946_FAULT2_ADC_DONE                 0x80
+#define LTC2946_FAULT2_ENERGY_OVERFLOW          0x04
+#define LTC2946_FAULT2_CHARGE_OVERFLOW          0x02
+#define LTC2946_FAULT2_COUNTER_OVERFLOW         0x01
+
+
 /*!
 | Register Mask Command                | Value |
 | :------------------------------------| :---: |
@@ -496,6 +540,7 @@ Read power, current, voltage, charge and energy.
 | LTC2946_GPIOCFG_GPIO3_MASK           |  0xF3 |
 | LTC2946_GPIOCFG_GPIO2_OUT_MASK       |  0xFD |
 | LTC2946_GPIO3_CTRL_GPIO3_MASK        |  0xBF |
+| LTC2946_CLK_DIV_MASK                 |  0xE0 |
 */
 
 // Register Mask Command
@@ -510,6 +555,46 @@ Read power, current, voltage, charge and energy.
 #define LTC2946_GPIOCFG_GPIO3_MASK             0xF3
 #define LTC2946_GPIOCFG_GPIO2_OUT_MASK         0xFD
 #define LTC2946_GPIO3_CTRL_GPIO3_MASK          0xBF
+#define LTC2946_CLK_DIV_MASK                   0xE0
+
+
+/*!
+| Time Base                            | Value  |
+| :------------------------------------| :----: |
+| LTC2946_INTERNAL_CLK_HZ              | 250000 |
+| LTC2946_TIME_COUNTER_TICKS           | 4101   |
+| LTC2946_CLK_DIV_MAX                  | 31     |
+*/
+
+// Time Base
+// Time counter LSB = LTC2946_TIME_COUNTER_TICKS / (time base frequency)
+// Internal oscillator: time base = 250kHz. External clock on CLKIN: time base = fCLKIN / CLK_DIV
+#define LTC2946_INTERNAL_CLK_HZ                250000UL
+#define LTC2946_TIME_COUNTER_TICKS             4101UL
+#define LTC2946_CLK_DIV_MAX                    31
+
+
+/*!
+| Bidirectional                        | Value  |
+| :------------------------------------| :----: |
+| LTC2946_CURRENT_ZERO_CODE            | 2048   |
+*/
+
+// Default delta sense code at zero current for an offset referenced sense (mid scale)
+#define LTC2946_CURRENT_ZERO_CODE              2048
+
+//! MIN/MAX statistics of every channel, converted like the present value reads (ReadMinMax)
+struct LTC2946_MinMax
+{
+    float vin_min;
+    float vin_max;
+    float current_min;
+    float current_max;
+    float power_min;        //!< Unsigned product even in bidirectional mode (no VIN code is kept with it to sign it)
+    float power_max;
+    float adin_min;
+    float adin_max;
+};
 
 
 class LTC2946 {
@@ -518,40 +603,122 @@ public:
 	static const byte H = 1; //high
 	static const byte F = 2; //float
 
-    LTC2946(uint8_t wire_num, //! <Wire address. For Teensy 3.6, valid values are 0-2>
+    LTC2946(uint8_t wire_num, //! <Wire address. For Teensy 3.6, valid values are 0-3. On Linux, the N of /dev/i2c-N>
             uint8_t wire_addr //! <I2C address for LTC2946 on specified wire>
             );
+    LTC2946(LTC2946_Bus &wire_bus, //! <Any bus backend, see LTC2946_Bus.h>
+            uint8_t wire_addr //! <I2C address for LTC2946 on specified bus>
+            );
 
     void Setup(); //! <Initializes wire, call in Setup loop>
     bool ErrorCheck(); //! <Check the ack variable for errors. Returns True if no errors present. Resets ack variable on read>
+    LTC2946_Bus *GetBus(); //! <Bus backend of this device, 0 if the wire number does not exist on this platform>
 
-    //! Set the constants for converting RAW to values
-    void SetVINConst(float vin_const);
-    void SetAmperageConst(float i_const);
-    void SetPowerConst(float w_const);
+    //! Set the constants for converting RAW to values (Measured value = RAW * Constant + Offset)
+    void SetVINConst(float vin_const, float vin_offset = 0);
+    void SetAmperageConst(float i_const, float i_offset = 0);
+    void SetPowerConst(float w_const, float w_offset = 0);
+    void SetADINConst(float a_const, float a_offset = 0);
 
     void SetContinuous(); //! <Set default LTC2946 values for Continuous capture mode>
     void SetSnapShot(); //! <Set snapshot mode (does not directly write over I2C)>
+    void SetShutdown(bool state); //! <Enter (true) or leave (false) low power shutdown. Register contents are kept>
+    //! Accumulation mode: LTC2946_ENABLE_ACC, LTC2946_DISABLE_ACC or LTC2946_ACC_PIN_CONTROL (accumulate while the
+    //! ACC/GPIO2 input is high; GPIO2 is configured as ACC input). write=false only updates the driver's copy of CTRLB,
+    //! after the register was written another way (mass write). @return 0=acknowledge
+    int8_t SetAccumulation(uint8_t acc_mode, bool write = true);
+    uint8_t GetAccumulation(); //! <Accumulation mode in use>
+    int8_t ResetAccumulators(); //! <Clear time counter, charge and energy (LTC2946_RESET_ACC). @return 0=acknowledge>
+    uint8_t GetControlB(); //! <CTRLB value the driver writes>
+    //! Interval modes. Cleared-on-read: reading FAULT1/FAULT2 clears them (no ClearFaults write). Auto-reset: reading
+    //! the accumulators resets them, so each ReadAccumulators returns the interval since the previous one. @return 0=acknowledge
+    int8_t SetClearedOnRead(bool state);
+    int8_t SetAutoReset(bool state);
+    //! Time counter, charge and energy codes in one burst (0x34..0x3F). With fault2 the burst runs on to FAULT2 (0x41),
+    //! which cleared-on-read also clears. @return 0=acknowledge
+    int8_t ReadAccumulators(uint32_t *time_code, uint32_t *charge_code, uint32_t *energy_code, uint8_t *fault2 = 0);
     void EnableConversion(bool state); //! <Enable conversion to standard unit from RAW value>
     void EnableLegacy(bool state); //! <Enable use of legacy conversions, where available. If false, returns RAW value>
+    void EnableBidirectional(bool state, uint16_t zero_code = LTC2946_CURRENT_ZERO_CODE); //! <Treat the delta sense code as signed around zero_code (offset referenced sense). Current, power and charge become signed>
 
     float ReadVIN(); //! <Read VIN from the LTC2946>
     float ReadCurrent(); //! <Read Current from the LTC2946>
     float ReadPower(); //! <Read Power from the LTC2946>
+    float ReadADIN(); //! <Read the ADIN auxiliary voltage from the LTC2946>
+
+    //! Read VIN, Current, Power and ADIN in one I2C transaction (continuous mode). Values follow the same conversion settings as the single reads.
+    //! @return 0=acknowledge, non-zero=error (also recorded for ErrorCheck)
+    int8_t ReadAll(float *vin, float *current, float *power, float *adin);
+    //! RAW codes of VIN, delta sense, power and ADIN, without conversion. Snapshot mode reads one channel at a time and gives power 0.
+    //! @return 0=acknowledge, non-zero=error (also recorded for ErrorCheck)
+    int8_t ReadAllCodes(uint16_t *vin_code, uint16_t *current_code, uint32_t *power_code, uint16_t *adin_code);
+    //! MIN/MAX registers of VIN, delta sense, power and ADIN in one I2C transaction (0x08..0x2D). In bidirectional
+    //! mode current is signed but power is not: the chip keeps the extremes of the unsigned product. @return 0=acknowledge
+    int8_t ReadMinMax(LTC2946_MinMax *stats);
+    //! Read length consecutive registers starting at reg in one transaction (register pointer auto-increments). @return 0=acknowledge
+    int8_t ReadRegisters(uint8_t reg, uint8_t *buffer, uint8_t length);
+    //! One field of a one byte register (LTC2946_Map), e.g. ReadField(LTC2946_Map::GPIOCFG_GPIO2, &mode). @return 0=acknowledge
+    int8_t ReadField(const LTC2946_Field &field, uint8_t *value);
+    //! Read-modify-write of one field, the other bits of the register are kept. @return 0=acknowledge
+    int8_t WriteField(const LTC2946_Field &field, uint8_t value);
+    //! STATUS1 (present over/undervalue) and FAULT1 (latched) in one transaction. @return 0=acknowledge
+    int8_t ReadStatus(uint8_t *status1, uint8_t *fault1);
+    int8_t ClearFaults(); //! <Clear the latched FAULT1 bits. @return 0=acknowledge>
+    int8_t ClearFault2(uint8_t bits); //! <Clear the given latched FAULT2 bits (e.g. LTC2946_FAULT2_ADC_DONE), keep the others. @return 0=acknowledge>
+
+    //! Declare the time base. Internal: clk_hz is ignored (250kHz oscillator). External: CLK_DIV is chosen to bring
+    //! clk_hz nearest to 250kHz (or clk_div if non-zero) and written to the LTC2946. Updates time/charge/energy LSBs.
+    void SetClock(bool external, uint32_t clk_hz = LTC2946_INTERNAL_CLK_HZ, uint8_t clk_div = 0);
+    uint8_t GetClockDivider(); //! <CLK_DIV in use (0 for internal oscillator)>
+    //! Exact time counter LSB as the ratio numerator/denominator seconds
+    void GetTimeLSBRatio(uint32_t *numerator, uint32_t *denominator);
+    float GetTimeLSB(); //! <Time counter LSB in seconds>
+    float GetChargeLSB(); //! <Charge LSB in coulombs (legacy delta sense lsb and resistor)>
+    float GetEnergyLSB(); //! <Energy LSB in joules (legacy power lsb and resistor)>
+
+    void SetVoltageSource(uint8_t voltage_sel); //! <Select VIN source: LTC2946_VDD, LTC2946_SENSE_PLUS or LTC2946_ADIN. Power is VIN source * current>
+    uint8_t GetVoltageSource(); //! <Currently selected VIN source>
+
+    //! Signed decode of RAW codes. Return the RAW code unchanged unless bidirectional mode is enabled.
+    //! Apply equally to the present, MIN/MAX and threshold registers.
+    //! @return Delta sense code relative to the zero current code
+    int32_t LTC2946_signed_current_code(uint16_t current_code   //!< 12-bit delta sense code
+                                    );
+    //! @return Power code relative to zero current. Power = VIN code * delta sense code, so the offset depends on VIN.
+    int32_t LTC2946_signed_power_code(uint32_t power_code,      //!< 24-bit power code
+                                      uint16_t vin_code         //!< 12-bit VIN code of the same conversion
+                                    );
+    //! @return Charge code relative to zero current. The charge register adds delta sense/16 per time counter tick.
+    int64_t LTC2946_signed_charge_code(uint32_t charge_code,    //!< 32-bit charge code
+                                       uint32_t time_code       //!< 32-bit time counter code over the same interval
+                                    );
+    //! @return Energy code relative to zero current. The energy register adds power/65536 per time counter tick.
+    int64_t LTC2946_signed_energy_code(uint32_t energy_code,    //!< 32-bit energy code
+                                       uint32_t time_code,      //!< 32-bit time counter code over the same interval
+                                       uint16_t vin_code        //!< Average VIN code over the interval
+                                    );
 
 
 private:
     byte I2C_ADDRESS; //stored I2C address of the LTC2946
     uint8_t I2C_WIRE = 0; //stored wire number to use.
+    LTC2946_Bus *bus = 0; //bus backend, 0 if the wire number does not exist on this platform
     uint8_t I2C_ACK = 0; //variable that tracks acknowledgements for errors.
     uint8_t LTC2946_mode = 0; //variable that stores capture mode (0=continuous, 1=snapshot)
     bool use_conversion = false;
     bool use_legacy = false; //boolean T/F. Use legacy or experimental calculations (where available)
+    bool use_bidirectional = false; //boolean T/F. Decode delta sense as signed around CURRENT_ZERO_CODE
+    uint16_t CURRENT_ZERO_CODE = LTC2946_CURRENT_ZERO_CODE; //delta sense code at zero current in bidirectional mode
 
     //Constants for converting RAW to values. Experimentally calibrated for R = 0.02 ohm
     float VIN_CONST = 0.02485474;
     float CURRENT_CONST = 0.00119677419;
     float POWER_CONST = 0.00003171126055;
+    float VIN_OFFSET = 0;
+    float CURRENT_OFFSET = 0;
+    float POWER_OFFSET = 0;
+    float ADIN_CONST = 5.001221E-04;
+    float ADIN_OFFSET = 0;
 
     //Legacy weight constants
     float resistor = 0.02;                                                //! <Resistance of power resistor, ohm>
@@ -560,15 +727,17 @@ private:
     const float LTC2946_VIN_lsb = 2.5006105E-02;                          //!< Typical VIN lsb weight in volts
     const float LTC2946_Power_lsb = 6.25305E-07;                          //!< Typical POWER lsb weight in V^2 VIN_lsb * DELTA_SENSE_lsb
     const float LTC2946_ADIN_DELTA_SENSE_lsb = 1.25061E-08;               //!< Typical sense lsb weight in V^2  *ADIN_lsb * DELTA_SENSE_lsb
-    const float LTC2946_INTERNAL_TIME_lsb = 4101.00/250000.00;            //!< Internal TimeBase lsb. Use LTC2946_TIME_lsb if an external CLK is used. See Settings menu for how to calculate Time LSB.
-    const float LTC2946_TIME_lsb = 16.39543E-3;                          //!< Static variable which is based off of the default clk frequency of 250KHz.
+    const float LTC2946_INTERNAL_TIME_lsb = (float)LTC2946_TIME_COUNTER_TICKS/LTC2946_INTERNAL_CLK_HZ;  //!< Internal TimeBase lsb (16.404ms). GetTimeLSB() gives the lsb in use.
+    uint32_t TIME_LSB_NUM = LTC2946_TIME_COUNTER_TICKS;                   //!< Time lsb in use = TIME_LSB_NUM/TIME_LSB_DEN seconds, set by SetClock. The only source of the time lsb
+    uint32_t TIME_LSB_DEN = LTC2946_INTERNAL_CLK_HZ;
+    uint8_t CLK_DIV = 0;                                                  //!< CLK_DIV written to the LTC2946, 0 = internal oscillator
 
     //Legacy default settings
-    const uint8_t CTRLA = LTC2946_CHANNEL_CONFIG_V_C_3|LTC2946_SENSE_PLUS|LTC2946_OFFSET_CAL_EVERY|LTC2946_ADIN_GND;    //! Set Control A register to default value.
-    const uint8_t CTRLB = LTC2946_DISABLE_ALERT_CLEAR&LTC2946_DISABLE_SHUTDOWN&LTC2946_DISABLE_CLEARED_ON_READ&LTC2946_DISABLE_STUCK_BUS_RECOVER&LTC2946_ENABLE_ACC&LTC2946_DISABLE_AUTO_RESET;     //! Set Control B Register to default value
+    uint8_t CTRLA = LTC2946_CHANNEL_CONFIG_V_C_3|LTC2946_SENSE_PLUS|LTC2946_OFFSET_CAL_EVERY|LTC2946_ADIN_GND;    //! Set Control A register to default value.
+    uint8_t CTRLB = LTC2946_Map::CTRLB_ALERT_CLEAR.Value(0)|LTC2946_Map::CTRLB_SHUTDOWN.Value(0)|LTC2946_Map::CTRLB_CLEARED_ON_READ.Value(0)|LTC2946_Map::CTRLB_STUCK_BUS_RECOVER.Value(0)|LTC2946_Map::CTRLB_ACC.Value(0)|LTC2946_Map::CTRLB_RESET.Value(0);     //! Set Control B Register to default value (accumulate, no auto-reset)
     const uint8_t GPIO_CFG = LTC2946_GPIO1_OUT_LOW |LTC2946_GPIO2_IN_ACC|LTC2946_GPIO3_OUT_ALERT;                       //! Set GPIO_CFG Register to Default value
     const uint8_t GPIO3_CTRL = LTC2946_GPIO3_OUT_HIGH_Z;                                                                //! Set GPIO3_CTRL to Default Value
-    const uint8_t VOLTAGE_SEL = LTC2946_SENSE_PLUS;                                                                     //! Set Voltage selection to default value.
+    uint8_t VOLTAGE_SEL = LTC2946_SENSE_PLUS;                                                                           //! Set Voltage selection to default value.
 
     //! Write an 8-bit code to the LTC2946.
     //! @return The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
@@ -618,6 +787,32 @@ private:
                             uint32_t *adc_code    //!< Value that will be read from the register.
                            );
 
+    //! One combined write-then-read I2C transaction with the LTC2946. All register access goes through here.
+    //! @return The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+    int8_t LTC2946_transfer(const uint8_t *write_data, uint8_t write_length, uint8_t *read_data, uint8_t read_length);
+
+    //! Reads a block of consecutive registers from LTC2946 in one transaction
+    //! @return The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, 1=no acknowledge.
+    int8_t LTC2946_read_block(uint8_t adc_command, //!< The "command byte" of the first register
+                          uint8_t *buffer,     //!< Register values, in register order
+                          uint8_t length       //!< Number of registers to read
+                         );
+    //! Extract a 12-bit code from a register block read with LTC2946_read_block
+    uint16_t LTC2946_block_12_bits(const uint8_t *block, uint8_t offset);
+    //! Extract a 24-bit code from a register block read with LTC2946_read_block
+    uint32_t LTC2946_block_24_bits(const uint8_t *block, uint8_t offset);
+
+    //! Start a snapshot conversion of one channel and wait until the ADC is idle
+    //! @return The function returns the state of the acknowledge bit. 0=acknowledge, 1=no acknowledge.
+    int8_t LTC2946_snapshot(uint8_t channel      //!< Voltage selection code of the channel to convert
+                           );
+
+    //! Convert RAW codes according to the use_conversion/use_legacy settings
+    float LTC2946_convert_VIN(uint16_t VIN_code);
+    float LTC2946_convert_current(int32_t current_signed);
+    float LTC2946_convert_power(int32_t power_signed);
+    float LTC2946_convert_ADIN(uint16_t ADIN_code);
+
     //! Calculate the LTC2946 VIN voltage
     //! @return Returns the VIN Voltage in Volts
     float LTC2946_VIN_code_to_voltage(uint16_t adc_code          //!< The ADC value
@@ -628,7 +823,7 @@ private:
                                     );
     //! Calculate the LTC2946 current with a sense resistor
     //! @return The LTC2946 current in Amps
-    float LTC2946_code_to_current(uint16_t adc_code              //!< The ADC value
+    float LTC2946_code_to_current(int32_t adc_code               //!< The ADC value
                                     );
     //! Calculate the LTC2946 power
     //! @return The LTC2946 power in Watts
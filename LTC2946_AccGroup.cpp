@@ -0,0 +1,133 @@
+/*!
+LTC2946 Accumulator Group
+
+Group-wide accumulator control. See LTC2946_AccGroup.h.
+*/
+
+#include <stdint.h>
+#include "LTC2946_AccGroup.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+LTC2946_AccGroup::LTC2946_AccGroup(LTC2946_Bus &bus) //!constructor
+    : bus(bus)
+{
+}
+
+bool LTC2946_AccGroup::Add(LTC2946 &device)
+{
+    if(device_count >= LTC2946_ACCGROUP_MAX_DEVICES) return(false);
+
+    devices[device_count++] = &device;
+    return(true);
+}
+
+void LTC2946_AccGroup::SetGate(void (*gate_function)(bool level))
+{
+    gate = gate_function;
+    gate_pin = -1;
+}
+
+#ifdef ARDUINO
+void LTC2946_AccGroup::SetGatePin(uint8_t pin)
+{
+    gate = 0;
+    gate_pin = pin;
+}
+#endif
+
+int8_t LTC2946_AccGroup::Setup()
+{
+    int8_t ack = 0;
+
+    running = false;
+    if(Gated())
+    {
+        //! 1) Gate low first, so no device starts when it enters pin control
+#ifdef ARDUINO
+        if(gate_pin >= 0) pinMode(gate_pin, OUTPUT);
+#endif
+        Drive(false);
+        for(uint8_t i = 0; i < device_count; i++) ack |= devices[i]->SetAccumulation(LTC2946_ACC_PIN_CONTROL);
+    }
+    else
+    {
+        //! 1) Stopped through CTRLB
+        ack |= MassSetAccumulation(LTC2946_DISABLE_ACC);
+    }
+
+    return(ack);
+}
+
+int8_t LTC2946_AccGroup::Start()
+{
+    int8_t ack = 0;
+
+    if(Gated()) Drive(true);
+    else ack = MassSetAccumulation(LTC2946_ENABLE_ACC);
+
+    if(ack == 0) running = true;
+    return(ack);
+}
+
+int8_t LTC2946_AccGroup::Stop()
+{
+    int8_t ack = 0;
+
+    if(Gated()) Drive(false);
+    else ack = MassSetAccumulation(LTC2946_DISABLE_ACC);
+
+    if(ack == 0) running = false;
+    return(ack);
+}
+
+int8_t LTC2946_AccGroup::Reset()
+// Reset command on its own, then CTRLB restored, as LTC2946::ResetAccumulators does for one device.
+{
+    if(device_count == 0) return(0);
+
+    uint8_t ctrlb = devices[0]->GetControlB();
+    int8_t ack = 0;
+
+    ack |= MassWriteCTRLB((ctrlb & LTC2946_CTRLB_RESET_MASK) | LTC2946_RESET_ACC);
+    ack |= MassWriteCTRLB(ctrlb);
+    return(ack);
+}
+
+bool LTC2946_AccGroup::Running(){return(running);}
+
+int8_t LTC2946_AccGroup::MassWriteCTRLB(uint8_t value)
+{
+    uint8_t data[2] = {LTC2946_CTRLB_REG, value};
+    return(bus.Transfer(LTC2946_I2C_MASS_WRITE >> 1, data, 2, 0, 0));
+}
+
+int8_t LTC2946_AccGroup::MassSetAccumulation(uint8_t acc_mode)
+{
+    if(device_count == 0) return(0);
+
+    uint8_t ctrlb = (devices[0]->GetControlB() & LTC2946_CTRLB_ACC_MASK) | acc_mode;
+    int8_t ack = MassWriteCTRLB(ctrlb);
+
+    //Keep each driver's copy in step, later CTRLB writes (SetShutdown etc.) must not undo it
+    if(ack == 0)
+    {
+        for(uint8_t i = 0; i < device_count; i++) devices[i]->SetAccumulation(acc_mode, false);
+    }
+    return(ack);
+}
+
+void LTC2946_AccGroup::Drive(bool level)
+{
+    if(gate != 0) gate(level);
+#ifdef ARDUINO
+    else if(gate_pin >= 0) digitalWrite(gate_pin, level ? HIGH : LOW);
+#endif
+}
+
+bool LTC2946_AccGroup::Gated()
+{
+    return(gate != 0 || gate_pin >= 0);
+}
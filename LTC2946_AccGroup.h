@@ -0,0 +1,80 @@
+/*!
+LTC2946 Accumulator Group
+
+Starts, stops and resets the accumulators (time counter, charge, energy) of several LTC2946s on one
+bus together, so every rail integrates over the same interval and their energies can be compared
+or summed without synchronized high-rate polling.
+
+Two ways to switch them together:
+    Gate        Every ACC (GPIO2) input is wired to one logic output. The devices are put in
+                LTC2946_ACC_PIN_CONTROL and Start/Stop drive the output: all devices see the same
+                edge. Set with SetGatePin (Arduino) or SetGate (any function driving the line).
+    Mass write  Without a gate, Start/Stop write CTRLB through the LTC2946 mass write address
+                (LTC2946_I2C_MASS_WRITE): one transaction reaches every device at once.
+Reset always uses the mass write address. Mass writes set the whole CTRLB register, so the devices
+must share their CTRLB settings; the first device added supplies them.
+
+Membership: a mass write reaches every LTC2946 on the bus, added or not. The group is therefore
+every LTC2946 on its bus: Reset (always) and Start/Stop/Setup (without a gate) also reset, start or
+stop, and overwrite the CTRLB of any device left out. A device that must keep its own accumulators
+or CTRLB needs another bus; the gate does not protect it from Reset.
+
+    LTC2946_AccGroup group(*LTC2946_platform_bus(0));
+    group.Add(rail_12v);
+    group.Add(rail_5v);
+    group.SetGatePin(9);
+    group.Setup();          //Stopped
+    group.Reset();
+    group.Start();
+    ...
+    group.Stop();           //Both accumulators now hold the same interval
+
+Single devices: LTC2946::SetAccumulation and LTC2946::ResetAccumulators.
+*/
+
+#ifndef LTC2946_ACCGROUP_H
+#define LTC2946_ACCGROUP_H
+
+#include <stdint.h>
+#include "LTC2946.h"
+#include "LTC2946_Bus.h"
+
+#define LTC2946_ACCGROUP_MAX_DEVICES    9       //!< One per LTC2946 address
+
+class LTC2946_AccGroup {
+public:
+    LTC2946_AccGroup(LTC2946_Bus &bus //! <Bus the devices share, for mass writes. Every LTC2946 on it belongs to the group>
+                     );
+
+    //! Add every LTC2946 on the bus (mass writes reach the others anyway). @return false if the group is full
+    bool Add(LTC2946 &device);
+
+    //! Drive the ACC inputs through gate(level) instead of CTRLB mass writes
+    void SetGate(void (*gate)(bool level));
+#ifdef ARDUINO
+    void SetGatePin(uint8_t pin); //! <Drive the ACC inputs from a digital pin>
+#endif
+
+    //! Configure the devices for the gate (or mass write) and stop accumulation. @return 0=acknowledge
+    int8_t Setup();
+
+    int8_t Start(); //! <Start accumulating on every device. @return 0=acknowledge>
+    int8_t Stop(); //! <Stop accumulating on every device. Registers keep their values. @return 0=acknowledge>
+    int8_t Reset(); //! <Clear the accumulators of every LTC2946 on the bus (mass write). @return 0=acknowledge>
+    bool Running();
+
+private:
+    int8_t MassWriteCTRLB(uint8_t value);
+    int8_t MassSetAccumulation(uint8_t acc_mode);
+    void Drive(bool level);
+    bool Gated();
+
+    LTC2946_Bus &bus;
+    LTC2946 *devices[LTC2946_ACCGROUP_MAX_DEVICES];
+    uint8_t device_count = 0;
+    void (*gate)(bool level) = 0;
+    int16_t gate_pin = -1;
+    bool running = false;
+};
+
+#endif  // LTC2946_ACCGROUP_H
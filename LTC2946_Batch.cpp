@@ -0,0 +1,114 @@
+/*!
+LTC2946 Batch
+
+Arena allocator and structure-of-arrays sample batch. See LTC2946_Batch.h.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "LTC2946_Batch.h"
+#include "LTC2946_Unpack.h"
+
+LTC2946_Arena::LTC2946_Arena(void *memory, size_t size) //!constructor
+    : base((uint8_t *)memory), size(size)
+{
+}
+
+void *LTC2946_Arena::Allocate(size_t bytes, size_t align)
+{
+    uintptr_t start = ((uintptr_t)base + used + align - 1) & ~(uintptr_t)(align - 1);
+    size_t offset = start - (uintptr_t)base;
+
+    if(offset > size || bytes > size - offset) return(0);
+
+    used = offset + bytes;
+    return((void *)start);
+}
+
+void LTC2946_Arena::Reset(){used = 0;}
+size_t LTC2946_Arena::Used(){return(used);}
+size_t LTC2946_Arena::Size(){return(size);}
+
+LTC2946_SampleBatch::LTC2946_SampleBatch(LTC2946_Arena &arena, uint32_t capacity) //!constructor
+{
+    time = (uint32_t *)arena.Allocate(capacity*sizeof(uint32_t));
+    vin = (uint16_t *)arena.Allocate(capacity*sizeof(uint16_t));
+    current = (uint16_t *)arena.Allocate(capacity*sizeof(uint16_t));
+    power = (uint32_t *)arena.Allocate(capacity*sizeof(uint32_t));
+    adin = (uint16_t *)arena.Allocate(capacity*sizeof(uint16_t));
+    status = (uint8_t *)arena.Allocate(capacity*sizeof(uint8_t));
+
+    if(Valid()) this->capacity = capacity;
+}
+
+size_t LTC2946_SampleBatch::ArenaBytes(uint32_t capacity)
+{
+    //Each column may need up to LTC2946_ARENA_ALIGN - 1 bytes of padding in front
+    return((size_t)capacity*(sizeof(uint32_t) + 3*sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint8_t)) + 6*(LTC2946_ARENA_ALIGN - 1));
+}
+
+bool LTC2946_SampleBatch::Valid()
+{
+    return(time != 0 && vin != 0 && current != 0 && power != 0 && adin != 0 && status != 0);
+}
+
+bool LTC2946_SampleBatch::Append(uint32_t t, uint16_t vin_code, uint16_t current_code, uint32_t power_code, uint16_t adin_code, uint8_t flags)
+{
+    if(count >= capacity) return(false);
+
+    time[count] = t;
+    vin[count] = vin_code;
+    current[count] = current_code;
+    power[count] = power_code;
+    adin[count] = adin_code;
+    status[count] = flags;
+    count++;
+    return(true);
+}
+
+uint32_t LTC2946_SampleBatch::AppendBlocks(const uint8_t *blocks, uint32_t block_count, size_t stride, uint8_t first_reg, uint8_t block_length,
+                                           const uint32_t *times, uint8_t flags)
+{
+    if(block_count > capacity - count) block_count = capacity - count;
+
+    //! 1) Channels straight into the columns
+    if(first_reg > LTC2946_POWER_MSB2_REG || first_reg + block_length <= LTC2946_ADIN_LSB_REG_REG)
+    {
+        memset(power + count, 0, block_count*sizeof(uint32_t));
+        memset(current + count, 0, block_count*sizeof(uint16_t));
+        memset(vin + count, 0, block_count*sizeof(uint16_t));
+        memset(adin + count, 0, block_count*sizeof(uint16_t));
+    }
+    LTC2946_CodeColumns columns = {power + count, current + count, vin + count, adin + count};
+    LTC2946_unpack_blocks(blocks, block_count, stride, first_reg, block_length, &columns);
+
+    //! 2) Time and status
+    memcpy(time + count, times, block_count*sizeof(uint32_t));
+    memset(status + count, flags, block_count);
+    count += block_count;
+    return(block_count);
+}
+
+bool LTC2946_SampleBatch::Acquire(LTC2946 &device, uint32_t t)
+{
+    uint16_t vin_code, current_code, adin_code;
+    uint32_t power_code;
+
+    if(count >= capacity) return(false);
+
+    int8_t ack = device.ReadAllCodes(&vin_code, &current_code, &power_code, &adin_code);
+    return(Append(t, vin_code, current_code, power_code, adin_code, ack ? LTC2946_SAMPLE_I2C_ERROR : 0));
+}
+
+void LTC2946_SampleBatch::Clear(){count = 0;}
+uint32_t LTC2946_SampleBatch::Count(){return(count);}
+uint32_t LTC2946_SampleBatch::Capacity(){return(capacity);}
+bool LTC2946_SampleBatch::Full(){return(count >= capacity);}
+
+const uint32_t *LTC2946_SampleBatch::Time(){return(time);}
+const uint16_t *LTC2946_SampleBatch::VIN(){return(vin);}
+const uint16_t *LTC2946_SampleBatch::Current(){return(current);}
+const uint32_t *LTC2946_SampleBatch::Power(){return(power);}
+const uint16_t *LTC2946_SampleBatch::ADIN(){return(adin);}
+const uint8_t *LTC2946_SampleBatch::Status(){return(status);}
@@ -0,0 +1,114 @@
+/*!
+LTC2946 Batch
+
+Structure-of-arrays sample storage for acquisition pipelines. Each quantity lives in its own
+contiguous column, so filters, statistics, LTC2946_Convert and serializers walk dense arrays instead
+of striding over per-sample structs. Columns are carved out of an LTC2946_Arena once; appending a
+sample never allocates.
+
+    static uint8_t memory[16384];
+    LTC2946_Arena arena(memory, sizeof(memory));
+    LTC2946_SampleBatch batch(arena, 1000);
+    LTC2946 monitor(0, 0x6F);
+    monitor.SetVINConst(VIN_GAIN, VIN_OFFSET);      //Constants of this board, used again below
+    ...
+    batch.Acquire(monitor, micros());
+    if(batch.Full()){
+        LTC2946_convert_12_bits(batch.VIN(), volts, batch.Count(), VIN_GAIN, VIN_OFFSET);
+        batch.Clear();
+    }
+
+| Column  | Type     | Contents                                   |
+| :------ | :------- | :----------------------------------------- |
+| Time    | uint32_t | Caller timestamp (e.g. micros())           |
+| VIN     | uint16_t | 12-bit VIN code                            |
+| Current | uint16_t | 12-bit delta sense code                    |
+| Power   | uint32_t | 24-bit power code                          |
+| ADIN    | uint16_t | 12-bit ADIN code                           |
+| Status  | uint8_t  | LTC2946_SAMPLE_* flags                     |
+*/
+
+#ifndef LTC2946_BATCH_H
+#define LTC2946_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LTC2946.h"
+
+#define LTC2946_ARENA_ALIGN     32      //Column alignment, one AVX2 vector / Cortex-M7 cache line
+
+//Status column flags
+#define LTC2946_SAMPLE_I2C_ERROR    0x01    //!< Transaction not acknowledged, codes are not valid
+#define LTC2946_SAMPLE_INCOHERENT   0x02    //!< Power does not match VIN * delta sense, channels from different conversions
+#define LTC2946_SAMPLE_DUPLICATE    0x04    //!< No conversion finished since the previous sample (FAULT2 ADC done clear)
+#define LTC2946_SAMPLE_STALE        0x08    //!< No conversion finished for longer than the stale time, ADC not converting
+#define LTC2946_SAMPLE_VIN_ONLY     0x10    //!< Only VIN converted since delta sense: power is still the product with the VIN before
+
+//! Bump allocator over caller supplied memory. Nothing is freed individually; Reset releases everything.
+class LTC2946_Arena {
+public:
+    LTC2946_Arena(void *memory, size_t size); //!constructor
+
+    //! @return bytes aligned to align (power of two), or 0 if the arena is exhausted
+    void *Allocate(size_t bytes, size_t align = LTC2946_ARENA_ALIGN);
+    void Reset(); //! <Release all allocations. Objects using the memory must no longer be used>
+
+    size_t Used(); //! <Bytes handed out, including alignment padding>
+    size_t Size(); //! <Total bytes>
+
+private:
+    uint8_t *base;
+    size_t size;
+    size_t used = 0;
+};
+
+//! Fixed capacity batch of RAW samples stored as columns
+class LTC2946_SampleBatch {
+public:
+    //! Allocate columns for capacity samples from arena. Check Valid() if the arena may be too small.
+    LTC2946_SampleBatch(LTC2946_Arena &arena, uint32_t capacity);
+
+    //! Bytes of arena needed for capacity samples, including alignment padding
+    static size_t ArenaBytes(uint32_t capacity);
+
+    bool Valid(); //! <True if all columns were allocated>
+
+    //! Append one sample. @return false if the batch is full
+    bool Append(uint32_t time, uint16_t vin_code, uint16_t current_code, uint32_t power_code, uint16_t adin_code, uint8_t status = 0);
+
+    //! Append block_count ReadAll bursts (registers first_reg..first_reg+block_length-1, stride bytes
+    //! apart), e.g. gathered by LTC2946_SharedBus, decoded with LTC2946_unpack_blocks. Channels the
+    //! blocks do not hold read 0.
+    //! @return samples appended, fewer than block_count if the batch fills up
+    uint32_t AppendBlocks(const uint8_t *blocks, uint32_t block_count, size_t stride, uint8_t first_reg, uint8_t block_length,
+                          const uint32_t *times, uint8_t status = 0);
+
+    //! Read all channels of device with ReadAllCodes and append them, flagging I2C errors.
+    //! @return false if the batch is full (device is not read)
+    bool Acquire(LTC2946 &device, uint32_t time);
+
+    void Clear(); //! <Discard all samples, keep the columns>
+    uint32_t Count(); //! <Samples held>
+    uint32_t Capacity(); //! <Samples that fit>
+    bool Full(); //! <Count() == Capacity()>
+
+    //! Columns, Count() entries each
+    const uint32_t *Time();
+    const uint16_t *VIN();
+    const uint16_t *Current();
+    const uint32_t *Power();
+    const uint16_t *ADIN();
+    const uint8_t *Status();
+
+private:
+    uint32_t *time = 0;
+    uint16_t *vin = 0;
+    uint16_t *current = 0;
+    uint32_t *power = 0;
+    uint16_t *adin = 0;
+    uint8_t *status = 0;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+};
+
+#endif  // LTC2946_BATCH_H
@@ -0,0 +1,179 @@
+/*!
+LTC2946 Bus
+
+Teensy (i2c_t3) backend and platform bus selection. See LTC2946_Bus.h.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "LTC2946_Bus.h"
+#include "LTC2946_Registers.h"
+
+#if defined(ARDUINO)
+
+#include <Arduino.h>
+#include <i2c_t3.h>
+
+LTC2946_WireBus::LTC2946_WireBus(i2c_t3 &wire_obj, uint8_t default_pins) //!constructor
+    : wire(wire_obj), default_pins(default_pins)
+{
+}
+
+LTC2946_WireBus *LTC2946_WireBus::Get(uint8_t wire_num)
+// One bus object per Wire, shared by every LTC2946 on that wire.
+{
+    static LTC2946_WireBus bus0(Wire, I2C_PINS_18_19);
+    static LTC2946_WireBus bus1(Wire1, I2C_PINS_37_38);
+    static LTC2946_WireBus bus2(Wire2, I2C_PINS_3_4);
+    static LTC2946_WireBus bus3(Wire3, I2C_PINS_56_57);
+
+    if(wire_num == 0){
+        return(&bus0);
+    }else if(wire_num == 1){
+        return(&bus1);
+    }else if(wire_num == 2){
+        return(&bus2);
+    }else if(wire_num == 3){
+        return(&bus3);
+    }
+    return(0);
+}
+
+int8_t LTC2946_WireBus::Begin()
+{
+    if(!started)
+    {
+        uint8_t pins = (config.pins == LTC2946_BUS_DEFAULT_PINS) ? default_pins : config.pins;
+        wire.begin(I2C_MASTER, 0x00, (i2c_pins)pins,
+                   config.pullup == LTC2946_BUS_PULLUP_INT ? I2C_PULLUP_INT : I2C_PULLUP_EXT, config.rate_hz);
+        wire.setDefaultTimeout(config.timeout_us);
+        started = true;
+    }
+    return(0);
+}
+
+int8_t LTC2946_WireBus::Configure(const LTC2946_BusConfig &bus_config)
+{
+    config = bus_config;
+
+    //Already running: begin again with the new settings
+    if(started)
+    {
+        started = false;
+        return(Begin());
+    }
+    return(0);
+}
+
+uint32_t LTC2946_WireBus::ClockHz()
+{
+    return(started ? wire.getClock() : config.rate_hz);
+}
+
+int8_t LTC2946_WireBus::Transfer(uint8_t address, const uint8_t *write_data, uint8_t write_length, uint8_t *read_data, uint8_t read_length)
+// The function returns the state of the acknowledge bit after the I2C address write. 0=acknowledge, non-zero=no acknowledge.
+{
+    int8_t ack;
+
+    wire.beginTransmission(address);
+    for(uint8_t i = 0; i < write_length; i++)
+    {
+        wire.write(write_data[i]);
+    }
+
+    //Repeated start when a read follows, stop otherwise
+    ack = wire.endTransmission(read_length == 0);
+
+    if(read_length > 0)
+    {
+        uint8_t received = wire.requestFrom(address, (size_t)read_length);
+
+        for(uint8_t i = 0; i < read_length; i++)
+        {
+            read_data[i] = wire.read();
+        }
+
+        if(ack == 0 && received != read_length) ack = 1;
+    }
+
+    return(ack);
+}
+
+LTC2946_Bus *LTC2946_platform_bus(uint8_t wire_num)
+{
+    return(LTC2946_WireBus::Get(wire_num));
+}
+
+#elif defined(__linux__)
+
+#include <time.h>
+#include "LTC2946_LinuxBus.h"
+
+LTC2946_Bus *LTC2946_platform_bus(uint8_t wire_num)
+{
+    return(LTC2946_LinuxBus::Get(wire_num));
+}
+
+#else
+
+LTC2946_Bus *LTC2946_platform_bus(uint8_t wire_num)
+{
+    (void)wire_num;
+    return(0);   //No platform bus, use LTC2946(bus, address)
+}
+
+#endif
+
+static uint32_t LTC2946_check_clock(uint32_t (*clock)())
+{
+    if(clock != 0) return(clock());
+#if defined(ARDUINO)
+    return(micros());
+#elif defined(__linux__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((uint32_t)((uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000));
+#else
+    return(0);
+#endif
+}
+
+int8_t LTC2946_check_bus(LTC2946_Bus &bus, uint8_t address, uint16_t transfers, LTC2946_BusCheck *result, uint32_t (*clock)())
+// MAX_POWER_THRESHOLD to MIN_POWER_THRESHOLD: 6 bytes only the application writes.
+{
+    const uint8_t reg = LTC2946_Map::MAX_POWER_THRESHOLD.address;
+    const uint8_t length = LTC2946_Map::Span(LTC2946_Map::MAX_POWER_THRESHOLD, LTC2946_Map::MIN_POWER_THRESHOLD);
+    uint8_t expected[length], data[length];
+    bool have_expected = false;
+
+    memset(result, 0, sizeof(*result));
+    uint32_t start = LTC2946_check_clock(clock);
+    for(uint16_t i = 0; i < transfers; i++)
+    {
+        int8_t ack = bus.Transfer(address, &reg, 1, data, length);
+        result->transfers++;
+        if(ack != 0)
+        {
+            result->errors++;
+        }
+        else if(!have_expected)
+        {
+            memcpy(expected, data, length);
+            have_expected = true;
+        }
+        else if(memcmp(expected, data, length) != 0)
+        {
+            result->errors++;
+        }
+    }
+    result->elapsed_us = LTC2946_check_clock(clock) - start;
+
+    uint64_t bits = (uint64_t)result->transfers*LTC2946_transaction_bits(1, length);
+    if(result->elapsed_us > 0) result->achieved_hz = (uint32_t)(bits*1000000/result->elapsed_us);
+    if(result->transfers > 0)
+    {
+        result->transfer_us = result->elapsed_us/result->transfers;
+        result->error_rate = (float)result->errors/result->transfers;
+    }
+    return(result->errors == 0 ? 0 : 1);
+}
@@ -0,0 +1,144 @@
+/*!
+LTC2946 Bus
+
+I2C bus layer used by the LTC2946 class. Every register access is one combined transaction:
+START, address+W, write bytes, repeated START, address+R, read bytes, STOP.
+
+| Backend             | Platform                       | File                  |
+| :------------------ | :----------------------------- | :-------------------- |
+| LTC2946_WireBus     | Teensy, i2c_t3 Wire..Wire3     | LTC2946_Bus.cpp       |
+| LTC2946_LinuxBus    | Linux /dev/i2c-N (I2C_RDWR)    | LTC2946_LinuxBus.cpp  |
+| LTC2946_FakeBus     | Any, in-memory register file   | LTC2946_FakeBus.cpp   |
+
+LTC2946(wire_num, address) uses the platform bus for wire_num (WireN on Teensy, /dev/i2c-N on Linux).
+LTC2946(bus, address) uses any other LTC2946_Bus.
+
+Clock, pins, pull-ups and timeout are set per bus with Configure, before LTC2946::Setup. Teensy buses
+start at 100kHz standard mode, as plain Wire.begin() did, on the Wire's default pins with external
+pull-ups; 400kHz (the LTC2946's fast mode limit) takes a Configure, as below.
+On Linux the clock is fixed by the adapter (device tree or module parameter); Configure sets the
+timeout and records the rate for ClockHz. LTC2946_check_bus measures what a bus actually achieves:
+
+    LTC2946_BusConfig config = LTC2946_bus_config(400000);
+    config.pins = I2C_PINS_16_17;
+    LTC2946_platform_bus(0)->Configure(config);
+    LTC2946.Setup();
+    LTC2946_BusCheck check;
+    LTC2946_check_bus(*LTC2946_platform_bus(0), 0x6F, 1000, &check);     //check.achieved_hz, check.errors
+*/
+
+#ifndef LTC2946_BUS_H
+#define LTC2946_BUS_H
+
+#include <stdint.h>
+
+#define LTC2946_BUS_DEFAULT_HZ      100000  //!< Standard mode, the Wire default
+#define LTC2946_BUS_DEFAULT_PINS    0xFF    //!< The Wire's default pin set
+#define LTC2946_BUS_PULLUP_EXT      0       //!< i2c_t3 I2C_PULLUP_EXT
+#define LTC2946_BUS_PULLUP_INT      1       //!< i2c_t3 I2C_PULLUP_INT
+
+//! Per-bus settings for LTC2946_Bus::Configure
+struct LTC2946_BusConfig
+{
+    uint32_t rate_hz;       //!< SCL frequency
+    uint8_t pins;           //!< i2c_t3 i2c_pins value (e.g. I2C_PINS_18_19), LTC2946_BUS_DEFAULT_PINS for the default
+    uint8_t pullup;         //!< LTC2946_BUS_PULLUP_EXT or LTC2946_BUS_PULLUP_INT
+    uint32_t timeout_us;    //!< Transaction timeout, 0 = none (Linux: rounded up to 10ms)
+};
+
+//! Config at rate_hz, default pins, external pull-ups, no timeout
+static inline LTC2946_BusConfig LTC2946_bus_config(uint32_t rate_hz = LTC2946_BUS_DEFAULT_HZ)
+{
+    LTC2946_BusConfig config = {rate_hz, LTC2946_BUS_DEFAULT_PINS, LTC2946_BUS_PULLUP_EXT, 0};
+    return(config);
+}
+
+//! Clocks of one Transfer on the wire: START, address and write bytes, repeated START (when both
+//! phases are present), address and read bytes, STOP; 9 clocks per byte with its ACK. The bus time
+//! model of LTC2946_Plan, LTC2946_Scheduler and LTC2946_check_bus; LTC2946_SimBus counts the same clocks.
+static inline uint32_t LTC2946_transaction_bits(uint8_t write_length, uint8_t read_length)
+{
+    uint32_t bits = 2;
+    if(write_length > 0) bits += 9*(1 + (uint32_t)write_length);
+    if(read_length > 0) bits += 9*(1 + (uint32_t)read_length) + (write_length > 0 ? 1 : 0);
+    return(bits);
+}
+
+//! Modeled time of one Transfer in nanoseconds. bus_hz 0 (ClockHz() of a bus that does not know) =
+//! LTC2946_BUS_DEFAULT_HZ
+static inline uint32_t LTC2946_transaction_ns(uint8_t write_length, uint8_t read_length, uint32_t bus_hz)
+{
+    if(bus_hz == 0) bus_hz = LTC2946_BUS_DEFAULT_HZ;
+    return((uint32_t)(LTC2946_transaction_bits(write_length, read_length)*1000000000ULL/bus_hz));
+}
+
+class LTC2946_Bus {
+public:
+    virtual ~LTC2946_Bus() {}
+
+    //! Prepare the bus for use. Called from LTC2946::Setup(), may be called more than once.
+    //! @return 0=success
+    virtual int8_t Begin() { return(0); }
+
+    //! Write write_length bytes, then read read_length bytes from the device at address (7-bit),
+    //! in one transaction. Either length may be 0.
+    //! @return 0=acknowledge, non-zero=no acknowledge or bus error
+    virtual int8_t Transfer(uint8_t address,
+                            const uint8_t *write_data, uint8_t write_length,
+                            uint8_t *read_data, uint8_t read_length) = 0;
+
+    //! Clock, pins, pull-ups and timeout. Takes effect at the next Begin, or at once if already begun.
+    //! @return 0=applied, 1=not supported by this backend
+    virtual int8_t Configure(const LTC2946_BusConfig &config) { (void)config; return(1); }
+
+    //! SCL frequency the bus is set to, 0 if unknown
+    virtual uint32_t ClockHz() { return(0); }
+};
+
+#ifdef ARDUINO
+class i2c_t3;
+
+//! i2c_t3 Wire objects on the Teensy
+class LTC2946_WireBus : public LTC2946_Bus {
+public:
+    //! Bus for wire number 0-3 (Wire, Wire1, Wire2, Wire3). Returns 0 for other numbers.
+    static LTC2946_WireBus *Get(uint8_t wire_num);
+
+    int8_t Begin();
+    int8_t Transfer(uint8_t address,
+                    const uint8_t *write_data, uint8_t write_length,
+                    uint8_t *read_data, uint8_t read_length);
+    int8_t Configure(const LTC2946_BusConfig &config);
+    uint32_t ClockHz();
+
+private:
+    LTC2946_WireBus(i2c_t3 &wire_obj, uint8_t default_pins);
+
+    i2c_t3 &wire; //Wire object of this bus
+    uint8_t default_pins;
+    LTC2946_BusConfig config = LTC2946_bus_config();
+    bool started = false;
+};
+#endif  // ARDUINO
+
+//! Bus used by LTC2946(wire_num, address) on this platform. Returns 0 if wire_num does not exist.
+LTC2946_Bus *LTC2946_platform_bus(uint8_t wire_num);
+
+//! Result of LTC2946_check_bus
+struct LTC2946_BusCheck
+{
+    uint32_t transfers;     //!< Transactions made
+    uint32_t errors;        //!< Not acknowledged, or data different from the first good read
+    uint32_t elapsed_us;
+    uint32_t achieved_hz;   //!< Bits on the wire / elapsed time: the effective SCL rate, gaps and overhead included
+    uint32_t transfer_us;   //!< Average time per transaction
+    float error_rate;       //!< errors / transfers
+};
+
+//! Read the threshold registers of the LTC2946 at address transfers times and time it. The registers hold
+//! still, so any read differing from the first is a bus error. clock gives microseconds, 0 = platform
+//! clock (micros() on Arduino, CLOCK_MONOTONIC on Linux). @return 0 if every transfer was good
+int8_t LTC2946_check_bus(LTC2946_Bus &bus, uint8_t address, uint16_t transfers, LTC2946_BusCheck *result,
+                         uint32_t (*clock)() = 0);
+
+#endif  // LTC2946_BUS_H
@@ -0,0 +1,193 @@
+/*!
+LTC2946 Calibration
+
+Least-squares fit of the experimental conversion constants. See LTC2946_Calibration.h.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "LTC2946_Calibration.h"
+
+LTC2946_Calibration::LTC2946_Calibration() //!constructor
+{
+    Clear();
+}
+
+void LTC2946_Calibration::Clear()
+{
+    for(uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        Clear((Channel)i);
+    }
+}
+
+void LTC2946_Calibration::Clear(Channel channel)
+{
+    Sums &s = sums[channel];
+    s.n = 0;
+    s.mean_x = 0;
+    s.mean_y = 0;
+    s.xx = 0;
+    s.xy = 0;
+    s.yy = 0;
+
+    fitted[channel] = false;
+}
+
+void LTC2946_Calibration::AddPoint(Channel channel, uint32_t raw, float reference)
+{
+    Sums &s = sums[channel];
+    double x = (double)raw;
+    double y = (double)reference;
+
+    if(s.n < LTC2946_CAL_POINTS)
+    {
+        points[channel][s.n].raw = raw;
+        points[channel][s.n].reference = reference;
+    }
+
+    //Welford: deviations from the old mean times deviations from the new one
+    s.n++;
+    double dx = x - s.mean_x;
+    double dy = y - s.mean_y;
+    s.mean_x += dx/s.n;
+    s.mean_y += dy/s.n;
+    s.xx += dx*(x - s.mean_x);
+    s.xy += dx*(y - s.mean_y);
+    s.yy += dy*(y - s.mean_y);
+}
+
+bool LTC2946_Calibration::ParseLine(const char *line)
+// Accepts "<V|I|P|A>,<raw>,<reference>". Whitespace around the fields is ignored.
+{
+    Channel channel;
+    char *end;
+
+    while(*line == ' ' || *line == '\t') line++;
+
+    if(*line == 'V' || *line == 'v'){
+        channel = VIN;
+    }else if(*line == 'I' || *line == 'i'){
+        channel = CURRENT;
+    }else if(*line == 'P' || *line == 'p'){
+        channel = POWER;
+    }else if(*line == 'A' || *line == 'a'){
+        channel = ADIN;
+    }else{
+        return(false);
+    }
+    line++;
+
+    while(*line == ' ' || *line == '\t') line++;
+    if(*line++ != ',') return(false);
+
+    //strtoul would take "-5" as 2^32 - 5
+    while(*line == ' ' || *line == '\t') line++;
+    if(*line == '-') return(false);
+
+    uint32_t raw = strtoul(line, &end, 10);
+    if(end == line) return(false);
+    line = end;
+
+    while(*line == ' ' || *line == '\t') line++;
+    if(*line++ != ',') return(false);
+
+    float reference = (float)strtod(line, &end);
+    if(end == line) return(false);
+
+    AddPoint(channel, raw, reference);
+    return(true);
+}
+
+bool LTC2946_Calibration::Fit(Channel channel, LTC2946_CalFit *fit, bool fit_offset)
+{
+    const Sums &s = sums[channel];
+    double gain, offset;
+
+    if(fit_offset)
+    {
+        //! 1) Ordinary least squares on the centered sums: gain = Sxy/Sxx, through the means
+        if(s.n < 2 || s.xx <= 0) return(false);
+
+        gain = s.xy/s.xx;
+        offset = s.mean_y - gain*s.mean_x;
+    }
+    else
+    {
+        //! 1) Line through the origin: gain = sum(x*y)/sum(x*x), rebuilt from the centered sums
+        double xx = s.xx + s.n*s.mean_x*s.mean_x;
+        if(s.n < 1 || xx <= 0) return(false);
+
+        gain = (s.xy + s.n*s.mean_x*s.mean_y)/xx;
+        offset = 0;
+    }
+
+    //! 2) Sum of squared residuals: the spread about the means plus the line's miss at the means
+    double miss = s.mean_y - gain*s.mean_x - offset;
+    double sse = s.yy - 2*gain*s.xy + gain*gain*s.xx + s.n*miss*miss;
+    if(sse < 0) sse = 0;    //Rounding on near perfect fits
+
+    LTC2946_CalFit &f = fits[channel];
+    f.gain = (float)gain;
+    f.offset = (float)offset;
+    f.rms_residual = (float)sqrt(sse/(double)s.n);
+    f.max_residual = 0;
+    f.points = s.n;
+    fitted[channel] = true;
+
+    //! 3) Largest residual over the stored points
+    uint32_t stored = s.n < LTC2946_CAL_POINTS ? s.n : LTC2946_CAL_POINTS;
+    for(uint32_t i = 0; i < stored; i++)
+    {
+        Residual(channel, points[channel][i].raw, points[channel][i].reference);
+    }
+
+    *fit = f;
+    return(true);
+}
+
+float LTC2946_Calibration::Residual(Channel channel, uint32_t raw, float reference)
+{
+    if(!fitted[channel]) return(0);
+
+    LTC2946_CalFit &f = fits[channel];
+    float residual = (float)raw*f.gain + f.offset - reference;
+
+    if(fabsf(residual) > f.max_residual) f.max_residual = fabsf(residual);
+
+    return(residual);
+}
+
+size_t LTC2946_Calibration::FormatProfile(char *buffer, size_t length)
+{
+    static const char *names[CHANNEL_COUNT] = {"VIN", "CURRENT", "POWER", "ADIN"};
+    size_t written = 0;
+
+    if(length == 0) return(0);
+    buffer[0] = 0;
+
+    for(uint8_t i = 0; i < CHANNEL_COUNT; i++)
+    {
+        if(!fitted[i]) continue;
+
+        const LTC2946_CalFit &f = fits[i];
+        int n = snprintf(buffer + written, length - written, "%s_CONST=%.9g %s_OFFSET=%.9g RMS=%.6g N=%lu\n",
+                         names[i], (double)f.gain, names[i], (double)f.offset, (double)f.rms_residual, (unsigned long)f.points);
+        if(n < 0) break;
+        if((size_t)n >= length - written)
+        {
+            written = length - 1;   //Truncated
+            break;
+        }
+        written += n;
+    }
+
+    return(written);
+}
+
+uint32_t LTC2946_Calibration::Points(Channel channel)
+{
+    return(sums[channel].n);
+}
@@ -0,0 +1,106 @@
+/*!
+LTC2946 Calibration
+
+Least-squares fit of the experimental conversion constants used by the LTC2946 class.
+Collect pairs of (RAW code, reference meter value) per channel, then fit:
+             Measured value = LTC2946 Raw Value * Gain + Offset
+The fit keeps running sums, so any number of points can be fed in; only the first
+LTC2946_CAL_POINTS points of each channel are also stored, to find the largest residual in Fit().
+Has no hardware dependencies; can be used on the Teensy (points fed over Serial) or on a host
+against recorded data.
+
+Example:
+    LTC2946_Calibration cal;
+    cal.AddPoint(LTC2946_Calibration::VIN, vin_raw, meter_volts);   //Repeat for each reference point
+    cal.ParseLine("I,835,1.0012");                                  //Or feed "<V|I|P|A>,<raw>,<reference>" lines
+    LTC2946_CalFit fit;
+    if(cal.Fit(LTC2946_Calibration::VIN, &fit)){
+        LTC2946.SetVINConst(fit.gain, fit.offset);
+    }
+*/
+
+#ifndef LTC2946_CALIBRATION_H
+#define LTC2946_CALIBRATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef LTC2946_CAL_POINTS
+#define LTC2946_CAL_POINTS 32   //!< Points per channel kept for max_residual (8 bytes each)
+#endif
+
+//! Result of a least-squares fit for one channel
+struct LTC2946_CalFit
+{
+    float gain;          //!< Constant multiplied with the RAW value
+    float offset;        //!< Constant added after the multiplication
+    float rms_residual;  //!< RMS of (fitted - reference) over all points, in engineering units
+    float max_residual;  //!< Largest absolute residual over the stored points, raised by later Residual() calls
+    uint32_t points;     //!< Number of points used in the fit
+};
+
+class LTC2946_Calibration {
+public:
+    //! Channels that can be calibrated. Match the SetVINConst/SetAmperageConst/SetPowerConst/SetADINConst setters.
+    enum Channel
+    {
+        VIN = 0,
+        CURRENT = 1,
+        POWER = 2,
+        ADIN = 3,
+        CHANNEL_COUNT = 4
+    };
+
+    LTC2946_Calibration();
+
+    void Clear(); //! <Discard all collected points on every channel>
+    void Clear(Channel channel); //! <Discard all collected points on one channel>
+
+    //! Add a reference point. raw is the unconverted code returned with EnableConversion(false).
+    void AddPoint(Channel channel, uint32_t raw, float reference);
+
+    //! Parse a "<V|I|P|A>,<raw>,<reference>" line (as received over Serial) and add the point.
+    //! @return true if the line was understood
+    bool ParseLine(const char *line);
+
+    //! Fit gain/offset for a channel. Requires two or more distinct RAW values.
+    //! max_residual covers the first LTC2946_CAL_POINTS points; the RMS covers all of them.
+    //! With fit_offset false the line is forced through zero (matches the original single constant method).
+    //! @return true if the fit is valid
+    bool Fit(Channel channel, LTC2946_CalFit *fit, bool fit_offset = true);
+
+    //! Residual (fitted - reference) of a point against the last fit of the channel. Tracks max_residual.
+    float Residual(Channel channel, uint32_t raw, float reference);
+
+    //! Write the fitted profile as text, one "<NAME>_CONST=<gain> <NAME>_OFFSET=<offset> RMS=<rms> N=<points>" line per fitted channel.
+    //! @return Number of characters written (excluding terminator)
+    size_t FormatProfile(char *buffer, size_t length);
+
+    uint32_t Points(Channel channel); //! <Number of points collected on a channel>
+
+private:
+    //Running means and centered sums (Welford), so clustered 24-bit power codes lose no precision
+    struct Sums
+    {
+        uint32_t n;
+        double mean_x;
+        double mean_y;
+        double xx;          //sum of (x - mean_x)^2
+        double xy;          //sum of (x - mean_x)*(y - mean_y)
+        double yy;          //sum of (y - mean_y)^2
+    };
+
+    //A stored point for max_residual
+    struct Point
+    {
+        uint32_t raw;
+        float reference;
+    };
+
+    Sums sums[CHANNEL_COUNT];
+    Point points[CHANNEL_COUNT][LTC2946_CAL_POINTS];
+    LTC2946_CalFit fits[CHANNEL_COUNT];
+    bool fitted[CHANNEL_COUNT];
+};
+
+#endif  // LTC2946_CALIBRATION_H
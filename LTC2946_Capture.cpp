@@ -0,0 +1,176 @@
+/*!
+LTC2946 Capture
+
+Triggered capture with a pre-trigger buffer. See LTC2946_Capture.h.
+*/
+
+#include <stdint.h>
+#include "LTC2946_Capture.h"
+
+LTC2946_Capture::LTC2946_Capture(LTC2946_Arena &arena, uint16_t pre_samples, uint16_t post_samples) //!constructor
+    : pre(pre_samples), post(post_samples)
+{
+    uint32_t size = (uint32_t)pre_samples + 1 + post_samples;
+    if(size > 0xFFFF) return;
+
+    time = (uint32_t *)arena.Allocate(size*sizeof(uint32_t));
+    vin = (uint16_t *)arena.Allocate(size*sizeof(uint16_t));
+    current = (uint16_t *)arena.Allocate(size*sizeof(uint16_t));
+    power = (uint32_t *)arena.Allocate(size*sizeof(uint32_t));
+    adin = (uint16_t *)arena.Allocate(size*sizeof(uint16_t));
+    fault = (uint8_t *)arena.Allocate(size*sizeof(uint8_t));
+
+    if(Valid()) capacity = (uint16_t)size;
+}
+
+bool LTC2946_Capture::Valid()
+{
+    return(time != 0 && vin != 0 && current != 0 && power != 0 && adin != 0 && fault != 0);
+}
+
+void LTC2946_Capture::SetThreshold(Channel channel, uint32_t level, bool above)
+{
+    use_threshold = channel < CHANNEL_COUNT;
+    threshold_channel = channel;
+    threshold_level = level;
+    threshold_above = above;
+}
+
+void LTC2946_Capture::SetSlope(Channel channel, uint32_t step, bool rising)
+{
+    use_slope = channel < CHANNEL_COUNT;
+    slope_channel = channel;
+    slope_step = step;
+    slope_rising = rising;
+}
+
+void LTC2946_Capture::SetFaultMask(uint8_t fault1_mask){fault_mask = fault1_mask;}
+
+void LTC2946_Capture::ClearTriggers()
+{
+    use_threshold = false;
+    use_slope = false;
+    fault_mask = 0;
+}
+
+void LTC2946_Capture::Arm()
+{
+    if(capacity == 0) return;
+
+    head = 0;
+    held = 0;
+    cause = CAUSE_NONE;
+    forced = false;
+    have_previous = false;
+    state = ARMED;
+}
+
+void LTC2946_Capture::Force(){forced = true;}
+void LTC2946_Capture::Disarm(){state = IDLE;}
+
+LTC2946_Capture::State LTC2946_Capture::Add(uint32_t t, uint16_t vin_code, uint16_t current_code, uint32_t power_code, uint16_t adin_code, uint8_t fault1)
+{
+    if(state != ARMED && state != TRIGGERED) return(state);
+
+    //! 1) Store in the ring
+    time[head] = t;
+    vin[head] = vin_code;
+    current[head] = current_code;
+    power[head] = power_code;
+    adin[head] = adin_code;
+    fault[head] = fault1;
+    head = (head + 1 == capacity) ? 0 : head + 1;
+    if(held < capacity) held++;
+
+    uint32_t code[CHANNEL_COUNT] = {vin_code, current_code, power_code, adin_code};
+
+    if(state == ARMED)
+    {
+        //! 2) Check triggers. Keep at most pre samples of history before the trigger sample.
+        uint8_t met = Check(code, fault1);
+        if(forced) met |= CAUSE_FORCED;
+
+        if(met)
+        {
+            if(held > (uint16_t)(pre + 1)) held = pre + 1;
+            trigger_index = held - 1;
+            cause = met;
+            post_left = post;
+            state = (post_left == 0) ? DONE : TRIGGERED;
+        }
+        else if(held > pre)
+        {
+            held = pre;
+        }
+    }
+    else
+    {
+        //! 3) Post-trigger samples
+        if(--post_left == 0) state = DONE;
+    }
+
+    for(uint8_t c = 0; c < CHANNEL_COUNT; c++) previous[c] = code[c];
+    have_previous = true;
+
+    return(state);
+}
+
+LTC2946_Capture::State LTC2946_Capture::Poll(LTC2946 &device, uint32_t t)
+{
+    uint16_t vin_code, current_code, adin_code;
+    uint32_t power_code;
+    uint8_t status1, fault1 = 0;
+
+    if(state != ARMED && state != TRIGGERED) return(state);
+
+    if(device.ReadAllCodes(&vin_code, &current_code, &power_code, &adin_code) != 0) return(state);
+
+    if(fault_mask != 0 && device.ReadStatus(&status1, &fault1) == 0 && (fault1 & fault_mask))
+    {
+        //Latched: clear so the next capture is not triggered by the same event
+        device.ClearFaults();
+    }
+
+    return(Add(t, vin_code, current_code, power_code, adin_code, fault1));
+}
+
+uint8_t LTC2946_Capture::Check(const uint32_t *code, uint8_t fault1)
+{
+    uint8_t met = CAUSE_NONE;
+
+    if(use_threshold)
+    {
+        uint32_t c = code[threshold_channel];
+        if(threshold_above ? c > threshold_level : c < threshold_level) met |= CAUSE_THRESHOLD;
+    }
+
+    if(use_slope && have_previous)
+    {
+        uint32_t now = code[slope_channel], before = previous[slope_channel];
+        if(slope_rising ? (now > before && now - before >= slope_step) : (before > now && before - now >= slope_step)) met |= CAUSE_SLOPE;
+    }
+
+    if(fault1 & fault_mask) met |= CAUSE_FAULT;
+
+    return(met);
+}
+
+LTC2946_Capture::State LTC2946_Capture::GetState(){return(state);}
+uint8_t LTC2946_Capture::GetCause(){return(cause);}
+uint16_t LTC2946_Capture::Count(){return(state == DONE ? held : 0);}
+uint16_t LTC2946_Capture::TriggerIndex(){return(trigger_index);}
+
+bool LTC2946_Capture::Get(uint16_t index, LTC2946_CaptureSample *sample)
+{
+    if(state != DONE || index >= held) return(false);
+
+    //Oldest sample is held positions behind head
+    uint16_t i = (uint16_t)(((uint32_t)head + capacity - held + index) % capacity);
+    sample->time = time[i];
+    sample->vin = vin[i];
+    sample->current = current[i];
+    sample->power = power[i];
+    sample->adin = adin[i];
+    sample->fault1 = fault[i];
+    return(true);
+}
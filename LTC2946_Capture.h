@@ -0,0 +1,145 @@
+/*!
+LTC2946 Capture
+
+Triggered capture of RAW samples, like an oscilloscope's single shot. While armed every sample goes
+into a circular pre-trigger buffer; when a trigger condition is met, post-trigger samples are added
+and the capture freezes with pre_samples before and post_samples after the trigger sample.
+Sampling can then run fast without logging anything until something happens.
+
+Triggers (any enabled one fires):
+    Threshold   channel code above (or below) a level
+    Slope       channel code changes by at least a step between consecutive samples
+    Fault       any of the selected FAULT1 bits latched (read with ReadStatus, cleared after firing)
+
+    static uint8_t memory[8192];
+    LTC2946_Arena arena(memory, sizeof(memory));
+    LTC2946_Capture capture(arena, 200, 300);
+    capture.SetThreshold(LTC2946_Capture::CURRENT, 3000, true);
+    capture.SetFaultMask(LTC2946_FAULT1_MAX_I_SENSE);
+    capture.Arm();
+    void loop(){
+        if(capture.Poll(LTC2946, micros()) == LTC2946_Capture::DONE){
+            for(uint16_t i = 0; i < capture.Count(); i++){ ... capture.Get(i, &sample) ... }
+            capture.Arm();
+        }
+    }
+*/
+
+#ifndef LTC2946_CAPTURE_H
+#define LTC2946_CAPTURE_H
+
+#include <stdint.h>
+#include "LTC2946.h"
+#include "LTC2946_Batch.h"
+
+//! One captured sample
+struct LTC2946_CaptureSample
+{
+    uint32_t time;
+    uint16_t vin;
+    uint16_t current;
+    uint32_t power;
+    uint16_t adin;
+    uint8_t fault1;     //!< FAULT1 read with the sample (0 if faults are not read)
+};
+
+class LTC2946_Capture {
+public:
+    //! Channels for triggers
+    enum Channel
+    {
+        VIN = 0,
+        CURRENT = 1,
+        POWER = 2,
+        ADIN = 3,
+        CHANNEL_COUNT = 4
+    };
+
+    //! Capture states
+    enum State
+    {
+        IDLE = 0,       //!< Not armed, samples are ignored
+        ARMED = 1,      //!< Filling the pre-trigger buffer, checking triggers
+        TRIGGERED = 2,  //!< Collecting post-trigger samples
+        DONE = 3        //!< Capture frozen until the next Arm()
+    };
+
+    //! Causes reported by Cause()
+    enum Cause
+    {
+        CAUSE_NONE = 0,
+        CAUSE_THRESHOLD = 1,
+        CAUSE_SLOPE = 2,
+        CAUSE_FAULT = 4,
+        CAUSE_FORCED = 8
+    };
+
+    //! Allocate room for pre_samples + 1 + post_samples from arena. Check Valid() if it may be too small.
+    LTC2946_Capture(LTC2946_Arena &arena, uint16_t pre_samples, uint16_t post_samples);
+
+    bool Valid(); //! <True if the buffer was allocated>
+
+    //! Trigger when channel goes above (or below, above=false) level. Replaces the previous threshold.
+    void SetThreshold(Channel channel, uint32_t level, bool above = true);
+    //! Trigger when channel changes by step or more between samples, rising (or falling, rising=false).
+    void SetSlope(Channel channel, uint32_t step, bool rising = true);
+    void SetFaultMask(uint8_t fault1_mask); //! <Trigger on these FAULT1 bits, 0 disables. Poll() reads FAULT1 only if non-zero>
+    void ClearTriggers(); //! <Disable all triggers (Force() still works)>
+
+    void Arm(); //! <Discard any capture and start filling the pre-trigger buffer>
+    void Force(); //! <Trigger on the next sample regardless of conditions>
+    void Disarm(); //! <Stop without capturing>
+
+    //! Offer one sample. @return state after the sample
+    State Add(uint32_t time, uint16_t vin_code, uint16_t current_code, uint32_t power_code, uint16_t adin_code, uint8_t fault1 = 0);
+
+    //! Read device (ReadAllCodes, plus ReadStatus when a fault mask is set) and Add the sample.
+    //! Samples with I2C errors are dropped. @return state after the sample
+    State Poll(LTC2946 &device, uint32_t time);
+
+    State GetState();
+    uint8_t GetCause(); //! <Cause bits of the trigger (CAUSE_*)>
+
+    //! Samples of a finished capture, oldest first. Fewer than pre + 1 + post if triggered before the pre-trigger buffer filled.
+    uint16_t Count();
+    uint16_t TriggerIndex(); //! <Index of the trigger sample within the capture>
+    //! @return false if index >= Count() or the capture is not DONE
+    bool Get(uint16_t index, LTC2946_CaptureSample *sample);
+
+private:
+    uint8_t Check(const uint32_t *code, uint8_t fault1); //cause bits of triggers met by a sample
+
+    //Ring buffer columns, capacity = pre + 1 + post
+    uint32_t *time = 0;
+    uint16_t *vin = 0;
+    uint16_t *current = 0;
+    uint32_t *power = 0;
+    uint16_t *adin = 0;
+    uint8_t *fault = 0;
+    uint16_t capacity = 0;
+    uint16_t pre;
+    uint16_t post;
+
+    uint16_t head = 0;          //next write position
+    uint16_t held = 0;          //valid samples in the ring
+    uint16_t post_left = 0;
+    uint16_t trigger_index = 0;
+    State state = IDLE;
+    uint8_t cause = CAUSE_NONE;
+    bool forced = false;
+
+    //Triggers
+    uint32_t previous[CHANNEL_COUNT] = {0, 0, 0, 0};
+    bool have_previous = false;
+    bool use_threshold = false;
+    Channel threshold_channel = CURRENT;
+    uint32_t threshold_level = 0;
+    bool threshold_above = true;
+    bool use_slope = false;
+    Channel slope_channel = CURRENT;
+    uint32_t slope_step = 0;
+    bool slope_rising = true;
+    uint8_t fault_mask = 0;
+};
+
+#endif  // LTC2946_CAPTURE_H
@@ -0,0 +1,116 @@
+/*!
+LTC2946 Coherent
+
+Coherent burst reads of one conversion cycle. See LTC2946_Coherent.h.
+*/
+
+#include <stdint.h>
+#include "LTC2946_Coherent.h"
+#include "LTC2946_Unpack.h"
+
+//Burst through ADIN_LSB, from POWER_MSB2 or, with the faults, from STATUS1
+#define COHERENT_LAST       LTC2946_ADIN_LSB_REG_REG
+#define COHERENT_MAX        (COHERENT_LAST - LTC2946_STATUS1_REG + 1)
+
+LTC2946_Coherent::LTC2946_Coherent(LTC2946 &device, uint8_t attempts, uint32_t stale_us) //!constructor
+    : dev(device), attempts(attempts ? attempts : 1), stale_time(stale_us)
+{
+}
+
+void LTC2946_Coherent::SetTolerance(uint32_t power_codes){tolerance = power_codes;}
+void LTC2946_Coherent::ReadFaults(bool state){read_faults = state;}
+
+bool LTC2946_Coherent::Coherent(uint16_t vin, uint16_t current, uint32_t power)
+{
+    uint32_t product = (uint32_t)vin*current;
+    uint32_t difference = (product > power) ? product - power : power - product;
+    uint32_t allowed = tolerance ? tolerance : (uint32_t)vin + current;
+    return(difference <= allowed);
+}
+
+uint8_t LTC2946_Coherent::Read(uint32_t now, LTC2946_CoherentSample *sample)
+{
+    uint8_t block[COHERENT_MAX];
+    uint8_t first = read_faults ? LTC2946_STATUS1_REG : LTC2946_POWER_MSB2_REG;
+    uint8_t fault2;
+
+    sample->time = now;
+    sample->flags = 0;
+    sample->attempts = 0;
+
+    //! 1) FAULT2 ADC done: has a conversion finished since the last sample?
+    if(dev.ReadRegisters(LTC2946_FAULT2_REG, &fault2, 1) != 0)
+    {
+        sample->flags = LTC2946_SAMPLE_I2C_ERROR;
+        return(sample->flags);
+    }
+    if(primed && !(fault2 & LTC2946_FAULT2_ADC_DONE))
+    {
+        //No burst: the registers still hold the last sample
+        *sample = last;
+        sample->time = now;
+        sample->attempts = 0;
+        sample->flags = LTC2946_SAMPLE_DUPLICATE;
+        if(now - last_change >= stale_time) sample->flags |= LTC2946_SAMPLE_STALE;
+        duplicates++;
+        reads++;
+        return(sample->flags);
+    }
+
+    //! 2) Burst until power matches VIN * delta sense, or the mismatch is a VIN-only update
+    bool coherent;
+    bool vin_only = false;
+    LTC2946_CoherentSample previous;
+    do
+    {
+        previous = *sample;
+        sample->attempts++;
+        bursts++;
+
+        if(dev.ReadRegisters(first, block, COHERENT_LAST - first + 1) != 0)
+        {
+            sample->flags = LTC2946_SAMPLE_I2C_ERROR;
+            return(sample->flags);
+        }
+
+        sample->status1 = read_faults ? block[LTC2946_STATUS1_REG - first] : 0;
+        sample->fault1 = read_faults ? block[LTC2946_FAULT1_REG - first] : 0;
+        sample->power = LTC2946_unpack_24(block + LTC2946_POWER_MSB2_REG - first);
+        sample->current = LTC2946_unpack_12(block + LTC2946_DELTA_SENSE_MSB_REG - first);
+        sample->vin = LTC2946_unpack_12(block + LTC2946_VIN_MSB_REG - first);
+        sample->adin = LTC2946_unpack_12(block + LTC2946_ADIN_MSB_REG - first);
+
+        coherent = Coherent(sample->vin, sample->current, sample->power);
+        if(!coherent && sample->attempts == 1)
+        {
+            //Power and delta sense of the last sample, still matching the VIN they were made with
+            vin_only = primed && sample->power == last.power && sample->current == last.current &&
+                       Coherent(power_vin, sample->current, sample->power);
+        }
+        else if(!coherent)
+        {
+            //Nothing changed since the burst before: the registers are settled, a retry cannot help
+            vin_only = sample->power == previous.power && sample->current == previous.current && sample->vin == previous.vin;
+        }
+    }
+    while(!coherent && !vin_only && sample->attempts < attempts);
+
+    if(coherent) power_vin = sample->vin;
+    else sample->flags |= vin_only ? LTC2946_SAMPLE_VIN_ONLY : LTC2946_SAMPLE_INCOHERENT;
+
+    //! 3) Acknowledge the conversion after the burst, unless the FAULT2 read already cleared it
+    if(!(dev.GetControlB() & LTC2946_ENABLE_CLEARED_ON_READ) && (fault2 & LTC2946_FAULT2_ADC_DONE))
+    {
+        if(dev.ClearFault2(LTC2946_FAULT2_ADC_DONE) != 0) sample->flags |= LTC2946_SAMPLE_I2C_ERROR;
+    }
+
+    last = *sample;
+    last_change = now;
+    primed = true;
+    reads++;
+    return(sample->flags);
+}
+
+uint32_t LTC2946_Coherent::Reads(){return(reads);}
+uint32_t LTC2946_Coherent::Bursts(){return(bursts);}
+uint32_t LTC2946_Coherent::Duplicates(){return(duplicates);}
@@ -0,0 +1,96 @@
+/*!
+LTC2946 Coherent
+
+Reads all channels of one LTC2946 conversion cycle. ReadVIN/ReadCurrent/ReadPower are separate
+transactions, so the ADC can finish a conversion between them and V * I no longer matches P.
+Here one burst from POWER_MSB2 (0x05) through ADIN_LSB (0x29) returns every result register
+together (from STATUS1 (0x03) with ReadFaults, as FAULT1 is cleared by the read in cleared-on-read
+mode), and the result is checked:
+
+    Coherent    power code == VIN code * delta sense code (the chip's own product), within
+                tolerance. Otherwise a register was updated during the burst; it is read again.
+    VIN only    the mismatch stays because only VIN converted since delta sense: the chip
+                multiplies each delta sense by the VIN it has then, so power keeps the previous
+                VIN's product until the next delta sense conversion. Recognised without a retry
+                when power and delta sense are the last sample's and match its VIN, otherwise
+                when a retry reads the same codes again; not retried further.
+    Duplicate   FAULT2 ADC done not set: no conversion finished since the last sample, so the
+                burst is skipped and the last sample returned for consumers to skip.
+    Stale       no conversion finished for longer than the stale time: the ADC is not converting
+                (shutdown, snapshot mode, or a stuck device).
+
+New data is recognised by the ADC done flag, not by changed codes, so a steady rail still gives new
+samples. The flag is cleared after the burst; a conversion that finishes after the burst passed its
+registers is reported with the next one. In cleared-on-read mode the FAULT2 read clears the flag
+(and the overflow flags) before the burst, so such a conversion is delivered again on the next Read.
+LTC2946_ENABLE_ADC_DONE_ALERT in ALERT2 brings the same flag out on the ALERT pin.
+
+    LTC2946_Coherent coherent(LTC2946);
+    LTC2946_CoherentSample s;
+    if(coherent.Read(micros(), &s) == 0){
+        //VIN, current and power of the same conversion, not seen before
+    }
+*/
+
+#ifndef LTC2946_COHERENT_H
+#define LTC2946_COHERENT_H
+
+#include <stdint.h>
+#include "LTC2946.h"
+#include "LTC2946_Batch.h"
+
+//! Codes of one conversion cycle
+struct LTC2946_CoherentSample
+{
+    uint32_t time;      //!< Caller time of the read
+    uint8_t status1;    //!< Present over/undervalue flags (with ReadFaults)
+    uint8_t fault1;     //!< Latched fault flags (with ReadFaults)
+    uint16_t vin;
+    uint16_t current;
+    uint32_t power;
+    uint16_t adin;
+    uint8_t flags;      //!< LTC2946_SAMPLE_* flags, 0 for a new coherent sample
+    uint8_t attempts;   //!< Bursts needed, 1 unless a register changed during a burst (or 2 to tell a VIN-only update), 0 for a duplicate
+};
+
+class LTC2946_Coherent {
+public:
+    LTC2946_Coherent(LTC2946 &device,           //! <Device in continuous mode>
+                     uint8_t attempts = 3,      //! <Bursts tried before returning an incoherent sample>
+                     uint32_t stale_us = 200000 //! <Unchanged codes for this long are flagged stale (caller time units)>
+                     );
+
+    //! Allowed |power - VIN * delta sense| in power codes. Default 0 means one LSB of either factor (VIN + delta sense codes).
+    void SetTolerance(uint32_t power_codes);
+
+    //! Include STATUS1 and FAULT1 in the burst. In cleared-on-read mode this clears FAULT1. Default off (0 in the sample).
+    void ReadFaults(bool state);
+
+    //! Check ADC done, then burst read and check.
+    //! @return sample->flags: 0 for a new coherent sample
+    uint8_t Read(uint32_t now, LTC2946_CoherentSample *sample);
+
+    uint32_t Reads(); //! <Samples returned>
+    uint32_t Bursts(); //! <Burst transactions made (duplicates need none, the rest are retries)>
+    uint32_t Duplicates(); //! <Samples flagged duplicate>
+
+private:
+    bool Coherent(uint16_t vin, uint16_t current, uint32_t power);
+
+    LTC2946 &dev;
+    uint8_t attempts;
+    uint32_t stale_time;
+    uint32_t tolerance = 0;
+    bool read_faults = false;
+
+    LTC2946_CoherentSample last;
+    uint16_t power_vin = 0;     //VIN code of the last coherent sample, which its power was made with
+    uint32_t last_change = 0;
+    bool primed = false;
+
+    uint32_t reads = 0;
+    uint32_t bursts = 0;
+    uint32_t duplicates = 0;
+};
+
+#endif  // LTC2946_COHERENT_H
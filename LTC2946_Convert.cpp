@@ -0,0 +1,149 @@
+/*!
+LTC2946 Convert
+
+Batch RAW code conversion. See LTC2946_Convert.h.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LTC2946_Convert.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LTC2946_CONVERT_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LTC2946_CONVERT_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LTC2946_CONVERT_NEON
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// Scalar reference
+
+void LTC2946_convert_12_bits_scalar(const uint16_t *codes, float *values, size_t count, float gain, float offset, int32_t zero_code)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        float scaled = (float)((int32_t)codes[i] - zero_code)*gain;
+        values[i] = scaled + offset;
+    }
+}
+
+void LTC2946_convert_24_bits_scalar(const uint32_t *codes, float *values, size_t count, float gain, float offset)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        float scaled = (float)(int32_t)codes[i]*gain;
+        values[i] = scaled + offset;
+    }
+}
+
+void LTC2946_convert_signed_scalar(const int32_t *codes, float *values, size_t count, float gain, float offset)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        float scaled = (float)codes[i]*gain;
+        values[i] = scaled + offset;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Vector versions. Each handles whole vectors and leaves the tail to the scalar code.
+
+void LTC2946_convert_12_bits(const uint16_t *codes, float *values, size_t count, float gain, float offset, int32_t zero_code)
+{
+    size_t i = 0;
+
+#if defined(LTC2946_CONVERT_AVX2)
+    const __m256 g = _mm256_set1_ps(gain);
+    const __m256 o = _mm256_set1_ps(offset);
+    const __m256i z = _mm256_set1_epi32(zero_code);
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256i c = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(codes + i)));
+        __m256 f = _mm256_cvtepi32_ps(_mm256_sub_epi32(c, z));
+        _mm256_storeu_ps(values + i, _mm256_add_ps(_mm256_mul_ps(f, g), o));
+    }
+#elif defined(LTC2946_CONVERT_SSE2)
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 o = _mm_set1_ps(offset);
+    const __m128i z = _mm_set1_epi32(zero_code);
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 8 <= count; i += 8)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i *)(codes + i));
+        __m128 low = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpacklo_epi16(c, zero), z));
+        __m128 high = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpackhi_epi16(c, zero), z));
+        _mm_storeu_ps(values + i, _mm_add_ps(_mm_mul_ps(low, g), o));
+        _mm_storeu_ps(values + i + 4, _mm_add_ps(_mm_mul_ps(high, g), o));
+    }
+#elif defined(LTC2946_CONVERT_NEON)
+    const float32x4_t g = vdupq_n_f32(gain);
+    const float32x4_t o = vdupq_n_f32(offset);
+    const int32x4_t z = vdupq_n_s32(zero_code);
+    for(; i + 8 <= count; i += 8)
+    {
+        uint16x8_t c = vld1q_u16(codes + i);
+        int32x4_t low = vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(c))), z);
+        int32x4_t high = vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(c))), z);
+        vst1q_f32(values + i, vaddq_f32(vmulq_f32(vcvtq_f32_s32(low), g), o));
+        vst1q_f32(values + i + 4, vaddq_f32(vmulq_f32(vcvtq_f32_s32(high), g), o));
+    }
+#endif
+
+    LTC2946_convert_12_bits_scalar(codes + i, values + i, count - i, gain, offset, zero_code);
+}
+
+void LTC2946_convert_24_bits(const uint32_t *codes, float *values, size_t count, float gain, float offset)
+{
+    //24-bit codes are positive as int32, so the signed conversion instructions are exact
+    LTC2946_convert_signed((const int32_t *)codes, values, count, gain, offset);
+}
+
+void LTC2946_convert_signed(const int32_t *codes, float *values, size_t count, float gain, float offset)
+{
+    size_t i = 0;
+
+#if defined(LTC2946_CONVERT_AVX2)
+    const __m256 g = _mm256_set1_ps(gain);
+    const __m256 o = _mm256_set1_ps(offset);
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 f = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(codes + i)));
+        _mm256_storeu_ps(values + i, _mm256_add_ps(_mm256_mul_ps(f, g), o));
+    }
+#elif defined(LTC2946_CONVERT_SSE2)
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 o = _mm_set1_ps(offset);
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 f = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(codes + i)));
+        _mm_storeu_ps(values + i, _mm_add_ps(_mm_mul_ps(f, g), o));
+    }
+#elif defined(LTC2946_CONVERT_NEON)
+    const float32x4_t g = vdupq_n_f32(gain);
+    const float32x4_t o = vdupq_n_f32(offset);
+    for(; i + 4 <= count; i += 4)
+    {
+        float32x4_t f = vcvtq_f32_s32(vld1q_s32(codes + i));
+        vst1q_f32(values + i, vaddq_f32(vmulq_f32(f, g), o));
+    }
+#endif
+
+    LTC2946_convert_signed_scalar(codes + i, values + i, count - i, gain, offset);
+}
+
+const char *LTC2946_convert_isa()
+{
+#if defined(LTC2946_CONVERT_AVX2)
+    return("avx2");
+#elif defined(LTC2946_CONVERT_SSE2)
+    return("sse2");
+#elif defined(LTC2946_CONVERT_NEON)
+    return("neon");
+#else
+    return("scalar");
+#endif
+}
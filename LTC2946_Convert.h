@@ -0,0 +1,39 @@
+/*!
+LTC2946 Convert
+
+Batch conversion of arrays of RAW codes to engineering units:
+             value = (code - zero_code) * gain + offset
+gain/offset are the experimental constants (SetVINConst etc.) or the fitted calibration, zero_code is
+the bidirectional zero current code (0 for unipolar channels).
+
+Uses SSE2/AVX2 on x86 and NEON on ARM application processors when the compiler targets them,
+scalar code otherwise (including the Teensy, whose FPU has no vector float instructions).
+Every path does the same two rounded float operations per code (multiply, then add) so results are
+bit-identical to the scalar path. Build with -ffp-contract=off on targets with fused multiply-add.
+*/
+
+#ifndef LTC2946_CONVERT_H
+#define LTC2946_CONVERT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//! Convert 12-bit codes (VIN, delta sense, ADIN). values may not alias codes.
+void LTC2946_convert_12_bits(const uint16_t *codes, float *values, size_t count, float gain, float offset, int32_t zero_code = 0);
+
+//! Convert 24-bit codes (power). For bidirectional power subtract the zero code per sample with
+//! LTC2946::LTC2946_signed_power_code first and pass the signed codes to LTC2946_convert_signed.
+void LTC2946_convert_24_bits(const uint32_t *codes, float *values, size_t count, float gain, float offset);
+
+//! Convert signed codes, |code| < 2^24.
+void LTC2946_convert_signed(const int32_t *codes, float *values, size_t count, float gain, float offset);
+
+//! Scalar reference versions, always available
+void LTC2946_convert_12_bits_scalar(const uint16_t *codes, float *values, size_t count, float gain, float offset, int32_t zero_code = 0);
+void LTC2946_convert_24_bits_scalar(const uint32_t *codes, float *values, size_t count, float gain, float offset);
+void LTC2946_convert_signed_scalar(const int32_t *codes, float *values, size_t count, float gain, float offset);
+
+//! Name of the instruction set used by the batch functions ("avx2", "sse2", "neon" or "scalar")
+const char *LTC2946_convert_isa();
+
+#endif  // LTC2946_CONVERT_H
@@ -0,0 +1,66 @@
+/*!
+LTC2946 Deadband
+
+Report-by-exception filter on RAW codes. See LTC2946_Deadband.h.
+*/
+
+#include <stdint.h>
+#include "LTC2946_Deadband.h"
+
+LTC2946_Deadband::LTC2946_Deadband(uint32_t max_silence) //!constructor
+    : max_silence(max_silence)
+{
+}
+
+void LTC2946_Deadband::SetDeadband(Channel channel, uint32_t codes)
+{
+    if(channel < CHANNEL_COUNT) deadband[channel] = codes;
+}
+
+void LTC2946_Deadband::SetMaxSilence(uint32_t silence)
+{
+    max_silence = silence;
+}
+
+bool LTC2946_Deadband::Update(uint32_t now, uint16_t vin_code, uint16_t current_code, uint32_t power_code, uint16_t adin_code)
+{
+    uint32_t code[CHANNEL_COUNT] = {vin_code, current_code, power_code, adin_code};
+    uint8_t moved = 0;
+
+    seen++;
+
+    for(uint8_t c = 0; c < CHANNEL_COUNT; c++)
+    {
+        uint32_t change = (code[c] > last[c]) ? code[c] - last[c] : last[c] - code[c];
+        if(change > deadband[c]) moved |= 1 << c;
+    }
+
+    //Unsigned difference stays valid across millis() wrap
+    bool silent_too_long = max_silence != 0 && now - last_report >= max_silence;
+
+    if(primed && moved == 0 && !silent_too_long) return(false);
+
+    changed = primed ? moved : 0;
+    for(uint8_t c = 0; c < CHANNEL_COUNT; c++) last[c] = code[c];
+    last_report = now;
+    primed = true;
+    reported++;
+    return(true);
+}
+
+bool LTC2946_Deadband::Poll(LTC2946 &device, uint32_t now)
+{
+    uint16_t vin_code, current_code, adin_code;
+    uint32_t power_code;
+
+    if(device.ReadAllCodes(&vin_code, &current_code, &power_code, &adin_code) != 0) return(false);
+
+    return(Update(now, vin_code, current_code, power_code, adin_code));
+}
+
+void LTC2946_Deadband::Reset(){primed = false;}
+
+uint32_t LTC2946_Deadband::Code(Channel channel){return(channel < CHANNEL_COUNT ? last[channel] : 0);}
+uint8_t LTC2946_Deadband::Changed(){return(changed);}
+uint32_t LTC2946_Deadband::Seen(){return(seen);}
+uint32_t LTC2946_Deadband::Reported(){return(reported);}
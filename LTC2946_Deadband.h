@@ -0,0 +1,73 @@
+/*!
+LTC2946 Deadband
+
+Report-by-exception filter on RAW codes. A sample is reported only when a channel has moved more
+than its deadband away from the last reported value, or when max_silence has passed since the last
+report (so a quiet rail still shows it is alive). Steady rails produce a few reports per max_silence
+interval instead of one per poll, while any step larger than the deadband is reported on the poll
+that sees it.
+
+Between reports every channel is within its deadband of the last reported code, so holding the last
+report reconstructs the signal to within the deadband.
+
+    LTC2946_Deadband deadband(1000);                        //At least one report per second
+    deadband.SetDeadband(LTC2946_Deadband::CURRENT, 4);     //+-4 delta sense codes
+    void loop(){
+        if(deadband.Poll(LTC2946, millis())){
+            Serial.println(deadband.Code(LTC2946_Deadband::CURRENT));
+        }
+    }
+*/
+
+#ifndef LTC2946_DEADBAND_H
+#define LTC2946_DEADBAND_H
+
+#include <stdint.h>
+#include "LTC2946.h"
+
+class LTC2946_Deadband {
+public:
+    //! Channels, also the bit numbers of Changed()
+    enum Channel
+    {
+        VIN = 0,
+        CURRENT = 1,
+        POWER = 2,
+        ADIN = 3,
+        CHANNEL_COUNT = 4
+    };
+
+    LTC2946_Deadband(uint32_t max_silence = 0 //! <Report at least this often (caller time units), 0=only on change>
+                     );
+
+    //! Largest change in RAW codes that is not reported. Default 0: any change is reported.
+    void SetDeadband(Channel channel, uint32_t codes);
+    void SetMaxSilence(uint32_t max_silence); //! <0 disables the periodic report>
+
+    //! Offer a sample. The first sample after construction or Reset() is always reported.
+    //! @return true if the sample should be reported; it becomes the new reference
+    bool Update(uint32_t now, uint16_t vin_code, uint16_t current_code, uint32_t power_code, uint16_t adin_code);
+
+    //! Read device with ReadAllCodes and Update. Samples with I2C errors are dropped (check ErrorCheck()).
+    //! @return true if the sample should be reported
+    bool Poll(LTC2946 &device, uint32_t now);
+
+    void Reset(); //! <Report the next sample regardless of change>
+
+    uint32_t Code(Channel channel); //! <Code of the last reported sample>
+    uint8_t Changed(); //! <Channels outside their deadband in the last report (bit = 1 << Channel). 0 for a max_silence or first report>
+    uint32_t Seen(); //! <Samples offered>
+    uint32_t Reported(); //! <Samples reported>
+
+private:
+    uint32_t deadband[CHANNEL_COUNT] = {0, 0, 0, 0};
+    uint32_t last[CHANNEL_COUNT] = {0, 0, 0, 0};
+    uint32_t max_silence;
+    uint32_t last_report = 0;
+    uint32_t seen = 0;
+    uint32_t reported = 0;
+    uint8_t changed = 0;
+    bool primed = false;
+};
+
+#endif  // LTC2946_DEADBAND_H
@@ -0,0 +1,122 @@
+/*!
+LTC2946 Duty Cycle
+
+Shutdown based duty cycling of an LTC2946. See LTC2946_DutyCycle.h.
+*/
+
+#include <stdint.h>
+#include "LTC2946_DutyCycle.h"
+
+LTC2946_DutyCycle::LTC2946_DutyCycle(LTC2946 &device, uint32_t period_ms, uint32_t wake_ms) //!constructor
+    : dev(device)
+{
+    SetTiming(period_ms, wake_ms);
+}
+
+void LTC2946_DutyCycle::Start(uint32_t now_ms)
+{
+    dev.SetShutdown(true);
+    next_wake = now_ms;
+    samples = 0;
+    errors = 0;
+    state = SHUTDOWN;
+}
+
+void LTC2946_DutyCycle::Stop()
+{
+    if(state != IDLE)
+    {
+        dev.SetShutdown(false);
+    }
+    state = IDLE;
+}
+
+bool LTC2946_DutyCycle::Update(uint32_t now_ms)
+{
+    //Differences of unsigned times stay valid across millis() wrap
+    switch(state)
+    {
+        case SHUTDOWN:
+            if((int32_t)(now_ms - next_wake) >= 0)
+            {
+                dev.SetShutdown(false);
+                awake_at = now_ms;
+                next_wake += period;
+                state = WAKING;
+            }
+            break;
+
+        case WAKING:
+            if(now_ms - awake_at >= wake_time)
+            {
+                float v, i, p, a;
+                int8_t ack = dev.ReadAll(&v, &i, &p, &a);
+                dev.SetShutdown(true);
+
+                //Fell behind (e.g. long blocking code in loop), skip missed periods instead of bursting
+                if((int32_t)(now_ms - next_wake) >= 0)
+                {
+                    next_wake = now_ms + period - wake_time;
+                }
+                state = SHUTDOWN;
+
+                //Not acknowledged: keep the last sample, try again next period
+                if(ack != 0)
+                {
+                    errors++;
+                    return(false);
+                }
+                vin = v;
+                current = i;
+                power = p;
+                adin = a;
+                samples++;
+                return(true);
+            }
+            break;
+
+        case IDLE:
+        default:
+            break;
+    }
+
+    return(false);
+}
+
+void LTC2946_DutyCycle::SetTiming(uint32_t period_ms, uint32_t wake_ms)
+{
+    period = period_ms;
+    wake_time = (wake_ms > period_ms) ? period_ms : wake_ms;
+}
+
+void LTC2946_DutyCycle::SetSupplyCurrents(float active_ua, float shutdown_ua)
+{
+    active_current = active_ua;
+    shutdown_current = shutdown_ua;
+}
+
+float LTC2946_DutyCycle::ModelAverageCurrent()
+{
+    float duty = ModelDutyCycle();
+    return(active_current*duty + shutdown_current*(1 - duty));
+}
+
+float LTC2946_DutyCycle::ModelDutyCycle()
+{
+    if(period == 0) return(1);
+    return((float)wake_time/(float)period);
+}
+
+uint32_t LTC2946_DutyCycle::ModelLatency()
+{
+    return(wake_time);
+}
+
+LTC2946_DutyCycle::State LTC2946_DutyCycle::GetState(){return(state);}
+uint32_t LTC2946_DutyCycle::Samples(){return(samples);}
+uint32_t LTC2946_DutyCycle::Errors(){return(errors);}
+
+float LTC2946_DutyCycle::VIN(){return(vin);}
+float LTC2946_DutyCycle::Current(){return(current);}
+float LTC2946_DutyCycle::Power(){return(power);}
+float LTC2946_DutyCycle::ADIN(){return(adin);}
@@ -0,0 +1,86 @@
+/*!
+LTC2946 Duty Cycle
+
+Keeps an LTC2946 in shutdown (~15uA) between samples. Every period the device is woken, left to
+complete a conversion cycle, read with ReadAll() and shut down again.
+
+The controller is driven by the caller's clock so it never blocks:
+    LTC2946_DutyCycle duty(LTC2946, 5000);   //One sample every 5 seconds
+    void loop(){
+        if(duty.Update(millis())){
+            Serial.println(duty.VIN());
+        }
+    }
+
+Timing model (all times in ms):
+    |<-------------------------- period ------------------------->|
+    | wake_time (converting) | read |       shutdown               |
+Average supply current = (active * wake_time + shutdown * (period - wake_time)) / period
+Latency from wake to sample is wake_time. Shorter periods or longer wake times trade battery for data.
+*/
+
+#ifndef LTC2946_DUTYCYCLE_H
+#define LTC2946_DUTYCYCLE_H
+
+#include <stdint.h>
+#include "LTC2946.h"
+
+class LTC2946_DutyCycle {
+public:
+    //! States of the controller
+    enum State
+    {
+        IDLE = 0,       //!< Not started, device untouched
+        SHUTDOWN = 1,   //!< Device in shutdown, waiting for the next period
+        WAKING = 2      //!< Device awake, waiting for a complete conversion cycle
+    };
+
+    LTC2946_DutyCycle(LTC2946 &device,          //! <Device to control. Must be in continuous mode>
+                      uint32_t period_ms,       //! <Time between samples>
+                      uint32_t wake_ms = 40     //! <Settle + conversion time after leaving shutdown>
+                      );
+
+    void Start(uint32_t now_ms); //! <Shut the device down and take the first sample at now_ms>
+    void Stop(); //! <Leave the device awake in continuous mode>
+
+    //! Advance the state machine. Call often with a monotonic millisecond clock (may wrap).
+    //! @return true when a new sample has just been read, false also when the read was not acknowledged
+    bool Update(uint32_t now_ms);
+
+    void SetTiming(uint32_t period_ms, uint32_t wake_ms); //! <Change period and wake time. wake_ms is clamped to period_ms>
+    void SetSupplyCurrents(float active_ua, float shutdown_ua); //! <Supply currents used by the model, in uA>
+
+    float ModelAverageCurrent(); //! <Modelled average supply current in uA>
+    float ModelDutyCycle(); //! <Fraction of time awake, 0-1>
+    uint32_t ModelLatency(); //! <Time from wake to sample in ms>
+
+    State GetState();
+    uint32_t Samples(); //! <Number of samples taken since Start>
+    uint32_t Errors(); //! <Reads not acknowledged since Start (no sample, the last one is kept)>
+
+    //! Last sample, converted according to the device settings
+    float VIN();
+    float Current();
+    float Power();
+    float ADIN();
+
+private:
+    LTC2946 &dev;
+    State state = IDLE;
+    uint32_t period = 0;
+    uint32_t wake_time = 0;
+    uint32_t next_wake = 0;     //time of the next wake-up
+    uint32_t awake_at = 0;      //time the device was woken
+    uint32_t samples = 0;
+    uint32_t errors = 0;
+
+    float active_current = 900; //uA, LTC2946 typical supply current while converting
+    float shutdown_current = 15; //uA, LTC2946 typical shutdown current
+
+    float vin = 0;
+    float current = 0;
+    float power = 0;
+    float adin = 0;
+};
+
+#endif  // LTC2946_DUTYCYCLE_H
@@ -0,0 +1,123 @@
+/*!
+LTC2946 Energy
+
+Accumulator based energy accounting. See LTC2946_Energy.h.
+*/
+
+#include <stdint.h>
+#include "LTC2946_Energy.h"
+
+LTC2946_Energy::LTC2946_Energy(LTC2946 &device) //!constructor
+    : dev(device)
+{
+}
+
+int8_t LTC2946_Energy::Update(uint32_t now_ms)
+{
+    uint32_t time, charge, energy;
+    int8_t ack = dev.ReadAccumulators(&time, &charge, &energy);
+    if(ack != 0) return(ack);
+
+    //In auto-reset mode every read restarts the accumulators, each reading is the whole interval
+    bool auto_reset = (dev.GetControlB() & ~LTC2946_CTRLB_RESET_MASK) == LTC2946_ENABLE_AUTO_RESET;
+
+    if(!primed)
+    {
+        //! 1) Baseline
+        primed = true;
+    }
+    else
+    {
+        //! 2) Change since the last Update, modulo 2^32
+        uint32_t ticks = time - last_time;
+        bool restarted = reset_pending || auto_reset;
+
+        if(!restarted && time < last_time)
+        {
+            //Wrap if the caller's elapsed time allows that many ticks (50% margin for clock error)
+            double ticks_max = (double)(now_ms - last_update)*1.5/(dev.GetTimeLSB()*1000) + 2;
+            if(ticks <= ticks_max)
+            {
+                wraps++;
+            }
+            else
+            {
+                restarted = true;
+                resets++;
+            }
+        }
+        if(restarted)
+        {
+            last_time = 0;
+            last_charge = 0;
+            last_energy = 0;
+            ticks = time;
+        }
+
+        //! 3) Add to the totals
+        previous = total;
+        total.ticks += ticks;
+        total.charge += dev.LTC2946_signed_charge_code(charge - last_charge, ticks);
+        total.energy += (uint32_t)(energy - last_energy);
+    }
+
+    reset_pending = false;
+    last_time = time;
+    last_charge = charge;
+    last_energy = energy;
+    last_update = now_ms;
+    return(0);
+}
+
+void LTC2946_Energy::AccumulatorsReset()
+{
+    reset_pending = true;
+    primed = true;
+    resets++;
+}
+
+double LTC2946_Energy::Seconds(){return((double)total.ticks*dev.GetTimeLSB());}
+double LTC2946_Energy::Charge(){return((double)total.charge*dev.GetChargeLSB());}
+double LTC2946_Energy::Energy(){return((double)total.energy*dev.GetEnergyLSB());}
+
+float LTC2946_Energy::AveragePower()
+{
+    double seconds = Seconds();
+    return(seconds > 0 ? (float)(Energy()/seconds) : 0);
+}
+
+float LTC2946_Energy::AverageCurrent()
+{
+    double seconds = Seconds();
+    return(seconds > 0 ? (float)(Charge()/seconds) : 0);
+}
+
+float LTC2946_Energy::Power(){return(AveragePower(previous));}
+float LTC2946_Energy::Current(){return(AverageCurrent(previous));}
+
+void LTC2946_Energy::Mark(LTC2946_EnergyMark *mark)
+{
+    *mark = total;
+}
+
+double LTC2946_Energy::Seconds(const LTC2946_EnergyMark &since){return((double)(total.ticks - since.ticks)*dev.GetTimeLSB());}
+double LTC2946_Energy::Charge(const LTC2946_EnergyMark &since){return((double)(total.charge - since.charge)*dev.GetChargeLSB());}
+double LTC2946_Energy::Energy(const LTC2946_EnergyMark &since){return((double)(total.energy - since.energy)*dev.GetEnergyLSB());}
+
+float LTC2946_Energy::AveragePower(const LTC2946_EnergyMark &since)
+{
+    double seconds = Seconds(since);
+    return(seconds > 0 ? (float)(Energy(since)/seconds) : 0);
+}
+
+float LTC2946_Energy::AverageCurrent(const LTC2946_EnergyMark &since)
+{
+    double seconds = Seconds(since);
+    return(seconds > 0 ? (float)(Charge(since)/seconds) : 0);
+}
+
+uint64_t LTC2946_Energy::TimeCode(){return(total.ticks);}
+int64_t LTC2946_Energy::ChargeCode(){return(total.charge);}
+uint64_t LTC2946_Energy::EnergyCode(){return(total.energy);}
+uint32_t LTC2946_Energy::Resets(){return(resets);}
+uint32_t LTC2946_Energy::Wraps(){return(wraps);}
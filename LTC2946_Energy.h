@@ -0,0 +1,105 @@
+/*!
+LTC2946 Energy
+
+Energy accounting for one rail from the on-chip accumulators. The LTC2946 integrates every
+conversion into the charge and energy registers and counts time base ticks in the time counter,
+so polling the three (one 12 byte burst from 0x34) once a second gives exact totals that
+integrating ReadPower() samples against millis() only approximates at hundreds of reads a second.
+
+Each Update adds the change of the time, charge and energy codes since the previous one to 64-bit
+lifetime totals:
+    Wrap        32-bit registers wrap (energy after ~76h at full scale). Differences are taken
+                modulo 2^32, so one wrap between Updates is exact.
+    Reset       LTC2946_RESET_ACC, auto-reset or a power cycle restarts all three at 0. A time
+                counter that went backwards by more than a wrap could explain (from the caller's
+                elapsed time) is taken as a reset, and the new codes are counted from 0. Energy
+                between the last Update and the reset is lost; call AccumulatorsReset() when the
+                application resets them itself.
+
+Marks save the totals, so energy, charge and average power over any window are differences:
+    LTC2946_Energy meter(LTC2946);
+    LTC2946_EnergyMark hour;
+    meter.Update(millis());
+    meter.Mark(&hour);
+    ...
+    meter.Update(millis());                  //Once a second is plenty
+    float watts = meter.AveragePower(hour);  //Average since the mark
+    double joules = meter.Energy();          //Lifetime total
+
+Units follow the device's charge/energy/time LSBs (GetChargeLSB etc., SetClock for an external time
+base). Charge is signed in bidirectional mode; energy is the unsigned register total.
+*/
+
+#ifndef LTC2946_ENERGY_H
+#define LTC2946_ENERGY_H
+
+#include <stdint.h>
+#include "LTC2946.h"
+
+#define LTC2946_ACCUMULATOR_BYTES   12      //!< Time counter, charge and energy registers 0x34..0x3F
+
+//! Totals at one moment, from LTC2946_Energy::Mark
+struct LTC2946_EnergyMark
+{
+    uint64_t ticks;             //!< Time counter ticks
+    int64_t charge;             //!< Charge codes
+    uint64_t energy;            //!< Energy codes
+};
+
+class LTC2946_Energy {
+public:
+    LTC2946_Energy(LTC2946 &device //! <Device whose accumulators are enabled>
+                   );
+
+    //! Read the accumulators and add their change to the totals. The first Update only takes a
+    //! baseline, unless AccumulatorsReset() was called before it.
+    //! @return 0=acknowledge. Totals are unchanged on error
+    int8_t Update(uint32_t now_ms);
+
+    //! The accumulators were reset (LTC2946_RESET_ACC). The next Update counts their codes from 0.
+    void AccumulatorsReset();
+
+    //! Lifetime totals since the first Update
+    double Seconds();
+    double Charge(); //! <Coulombs>
+    double Energy(); //! <Joules>
+    float AveragePower(); //! <W, Energy()/Seconds()>
+    float AverageCurrent(); //! <A, Charge()/Seconds()>
+
+    //! Rate of change over the last Update interval
+    float Power(); //! <W>
+    float Current(); //! <A>
+
+    //! Windows: save the totals now, then query the change since
+    void Mark(LTC2946_EnergyMark *mark);
+    double Seconds(const LTC2946_EnergyMark &since);
+    double Charge(const LTC2946_EnergyMark &since);
+    double Energy(const LTC2946_EnergyMark &since);
+    float AveragePower(const LTC2946_EnergyMark &since);
+    float AverageCurrent(const LTC2946_EnergyMark &since);
+
+    //! Lifetime totals in register codes
+    uint64_t TimeCode();
+    int64_t ChargeCode();
+    uint64_t EnergyCode();
+
+    uint32_t Resets(); //! <Accumulator resets seen (detected or reported)>
+    uint32_t Wraps(); //! <Time counter wraps seen>
+
+private:
+    LTC2946 &dev;
+    LTC2946_EnergyMark total = {0, 0, 0};
+    LTC2946_EnergyMark previous = {0, 0, 0};    //totals before the last Update
+
+    uint32_t last_time = 0;     //register codes at the last Update
+    uint32_t last_charge = 0;
+    uint32_t last_energy = 0;
+    uint32_t last_update = 0;   //caller time of the last Update
+    bool primed = false;
+    bool reset_pending = false; //count the next codes from 0
+
+    uint32_t resets = 0;
+    uint32_t wraps = 0;
+};
+
+#endif  // LTC2946_ENERGY_H
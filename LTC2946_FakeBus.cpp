@@ -0,0 +1,108 @@
+/*!
+LTC2946 Fake Bus
+
+In-memory register file bus. See LTC2946_FakeBus.h.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "LTC2946_FakeBus.h"
+
+LTC2946_FakeBus::LTC2946_FakeBus() //!constructor
+{
+}
+
+bool LTC2946_FakeBus::AddDevice(uint8_t address)
+{
+    if(device_count >= LTC2946_FAKEBUS_MAX_DEVICES || Find(address) != 0) return(false);
+
+    Device &d = devices[device_count++];
+    d.address = address;
+    d.pointer = 0;
+    memset(d.registers, 0, sizeof(d.registers));
+    return(true);
+}
+
+uint8_t *LTC2946_FakeBus::Registers(uint8_t address)
+{
+    Device *d = Find(address);
+    return(d ? d->registers : 0);
+}
+
+bool LTC2946_FakeBus::SetRegister(uint8_t address, uint8_t reg, uint8_t value)
+{
+    Device *d = Find(address);
+    if(d == 0 || reg >= LTC2946_REGISTER_COUNT) return(false);
+
+    d->registers[reg] = value;
+    return(true);
+}
+
+bool LTC2946_FakeBus::SetRegister(uint8_t address, uint8_t reg, uint8_t msb, uint8_t lsb)
+{
+    return(SetRegister(address, reg, msb) && SetRegister(address, reg + 1, lsb));
+}
+
+int8_t LTC2946_FakeBus::Transfer(uint8_t address, const uint8_t *write_data, uint8_t write_length, uint8_t *read_data, uint8_t read_length)
+// Returns 1 (no acknowledge) when no device answers at address, like a real bus.
+{
+    Device *d = Find(address);
+
+    transactions++;
+    bytes_written += write_length;
+    bytes_read += read_length;
+
+    if(d == 0)
+    {
+        memset(read_data, 0xFF, read_length);  //Bus pulled high
+        return(1);
+    }
+
+    //! 1) First written byte is the register pointer, the rest are data
+    if(write_length > 0)
+    {
+        d->pointer = write_data[0];
+        for(uint8_t i = 1; i < write_length; i++)
+        {
+            if(d->pointer < LTC2946_REGISTER_COUNT) d->registers[d->pointer] = write_data[i];
+            d->pointer++;
+        }
+    }
+
+    //! 2) Reads continue from the pointer, auto-incrementing
+    for(uint8_t i = 0; i < read_length; i++)
+    {
+        read_data[i] = (d->pointer < LTC2946_REGISTER_COUNT) ? d->registers[d->pointer] : 0;
+        d->pointer++;
+    }
+
+    return(0);
+}
+
+int8_t LTC2946_FakeBus::Configure(const LTC2946_BusConfig &config)
+{
+    bus_hz = config.rate_hz;
+    return(0);
+}
+
+uint32_t LTC2946_FakeBus::ClockHz(){return(bus_hz);}
+
+uint32_t LTC2946_FakeBus::Transactions(){return(transactions);}
+uint32_t LTC2946_FakeBus::BytesWritten(){return(bytes_written);}
+uint32_t LTC2946_FakeBus::BytesRead(){return(bytes_read);}
+
+void LTC2946_FakeBus::ResetCounters()
+{
+    transactions = 0;
+    bytes_written = 0;
+    bytes_read = 0;
+}
+
+LTC2946_FakeBus::Device *LTC2946_FakeBus::Find(uint8_t address)
+{
+    for(uint8_t i = 0; i < device_count; i++)
+    {
+        if(devices[i].address == address) return(&devices[i]);
+    }
+    return(0);
+}
@@ -0,0 +1,71 @@
+/*!
+LTC2946 Fake Bus
+
+In-memory stand-in for an I2C bus with LTC2946s on it, for running the driver without hardware.
+Each device is a plain 0x44 byte register file with the LTC2946 auto-incrementing register pointer:
+the first byte written sets the pointer, further written bytes are stored, reads return bytes from
+the pointer onwards. Nothing is measured or computed; tests set register values with SetRegister.
+
+Example:
+    LTC2946_FakeBus bus;
+    bus.AddDevice(0x6F);
+    bus.SetRegister(0x6F, LTC2946_VIN_MSB_REG, 0x7D, 0x00);
+    LTC2946 monitor(bus, 0x6F);
+    float raw_vin = monitor.ReadVIN();      //2000 with conversion disabled
+*/
+
+#ifndef LTC2946_FAKEBUS_H
+#define LTC2946_FAKEBUS_H
+
+#include <stdint.h>
+#include "LTC2946.h"
+#include "LTC2946_Bus.h"
+
+#define LTC2946_FAKEBUS_MAX_DEVICES     9       //!< One per LTC2946 address
+
+class LTC2946_FakeBus : public LTC2946_Bus {
+public:
+    LTC2946_FakeBus();
+
+    //! Add an LTC2946 at address (7-bit) with all registers 0.
+    //! @return false if full or already present
+    bool AddDevice(uint8_t address);
+
+    //! Register file of a device, LTC2946_REGISTER_COUNT bytes. 0 if no device at address.
+    uint8_t *Registers(uint8_t address);
+
+    //! Set consecutive registers starting at reg. Returns false if no device at address.
+    bool SetRegister(uint8_t address, uint8_t reg, uint8_t value);
+    bool SetRegister(uint8_t address, uint8_t reg, uint8_t msb, uint8_t lsb);
+
+    int8_t Transfer(uint8_t address,
+                    const uint8_t *write_data, uint8_t write_length,
+                    uint8_t *read_data, uint8_t read_length);
+    int8_t Configure(const LTC2946_BusConfig &config); //! <Records the clock for ClockHz, transfers still take no time>
+    uint32_t ClockHz(); //! <Clock from Configure, 0 until then>
+
+    //! Traffic counters, for measuring transactions and bytes per sample
+    uint32_t Transactions();
+    uint32_t BytesWritten();
+    uint32_t BytesRead();
+    void ResetCounters();
+
+private:
+    struct Device
+    {
+        uint8_t address;
+        uint8_t pointer;
+        uint8_t registers[LTC2946_REGISTER_COUNT];
+    };
+
+    Device *Find(uint8_t address);
+
+    Device devices[LTC2946_FAKEBUS_MAX_DEVICES];
+    uint8_t device_count = 0;
+    uint32_t transactions = 0;
+    uint32_t bytes_written = 0;
+    uint32_t bytes_read = 0;
+    uint32_t bus_hz = 0;
+};
+
+#endif  // LTC2946_FAKEBUS_H
@@ -0,0 +1,130 @@
+/*!
+LTC2946 Link
+
+Byte stream backends. See LTC2946_Link.h.
+*/
+
+#include <stdint.h>
+#include "LTC2946_Link.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+LTC2946_StreamLink::LTC2946_StreamLink(Stream &stream) //!constructor
+    : stream(stream)
+{
+}
+
+int16_t LTC2946_StreamLink::Read(uint8_t *data, uint16_t length)
+{
+    int16_t count = 0;
+
+    while(count < (int16_t)length && stream.available() > 0)
+    {
+        data[count++] = (uint8_t)stream.read();
+    }
+    return(count);
+}
+
+int8_t LTC2946_StreamLink::Write(const uint8_t *data, uint16_t length)
+{
+    return(stream.write(data, length) == length ? 0 : 1);
+}
+
+bool LTC2946_StreamLink::Writable(uint16_t length)
+{
+    (void)length;
+    return(stream.availableForWrite() > 0);
+}
+#endif  // ARDUINO
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+LTC2946_SerialLink::LTC2946_SerialLink(const char *device_path) //!constructor
+{
+    strncpy(path, device_path, sizeof(path) - 1);
+    path[sizeof(path) - 1] = 0;
+}
+
+LTC2946_SerialLink::LTC2946_SerialLink(int descriptor) //!constructor
+    : fd(descriptor), owned(false)
+{
+    path[0] = 0;
+}
+
+LTC2946_SerialLink::~LTC2946_SerialLink()
+{
+    End();
+}
+
+int8_t LTC2946_SerialLink::Begin()
+{
+    //! 1) Open, unless given a descriptor
+    if(fd < 0)
+    {
+        fd = open(path, O_RDWR | O_NOCTTY);
+        if(fd < 0) return(1);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    //! 2) Raw: no echo, no line editing, no CR/LF translation. The baud rate means nothing on USB CDC
+    struct termios tio;
+    if(tcgetattr(fd, &tio) != 0) return(1);
+    cfmakeraw(&tio);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    return(tcsetattr(fd, TCSANOW, &tio) == 0 ? 0 : 1);
+}
+
+void LTC2946_SerialLink::End()
+{
+    if(fd >= 0 && owned) close(fd);
+    if(owned) fd = -1;
+}
+
+int16_t LTC2946_SerialLink::Read(uint8_t *data, uint16_t length)
+{
+    ssize_t count = read(fd, data, length > 0x7FFF ? 0x7FFF : length);
+    if(count >= 0) return((int16_t)count);
+    return(errno == EAGAIN || errno == EINTR ? 0 : -1);
+}
+
+int8_t LTC2946_SerialLink::Write(const uint8_t *data, uint16_t length)
+{
+    while(length > 0)
+    {
+        ssize_t count = write(fd, data, length);
+        if(count < 0)
+        {
+            if(errno != EAGAIN && errno != EINTR) return(1);
+            struct pollfd p = {fd, POLLOUT, 0};
+            poll(&p, 1, 100);
+            continue;
+        }
+        data += count;
+        length -= (uint16_t)count;
+    }
+    return(0);
+}
+
+bool LTC2946_SerialLink::Writable(uint16_t length)
+{
+    (void)length;
+    struct pollfd p = {fd, POLLOUT, 0};
+    return(poll(&p, 1, 0) == 1 && (p.revents & POLLOUT));
+}
+
+bool LTC2946_SerialLink::Wait(uint32_t timeout_ms)
+{
+    struct pollfd p = {fd, POLLIN, 0};
+    return(poll(&p, 1, (int)timeout_ms) == 1);
+}
+
+#endif  // __linux__ && !ARDUINO
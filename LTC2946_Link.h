@@ -0,0 +1,87 @@
+/*!
+LTC2946 Link
+
+Byte stream layer used by LTC2946_Telemetry and its host client: a serial port seen as a pipe of
+bytes, with non-blocking reads.
+
+| Backend              | Platform                              | File              |
+| :------------------- | :------------------------------------ | :---------------- |
+| LTC2946_StreamLink   | Arduino Stream (Serial, USB serial)   | LTC2946_Link.cpp  |
+| LTC2946_SerialLink   | Linux tty or pty, raw mode            | LTC2946_Link.cpp  |
+
+On the Teensy, Serial is USB full speed regardless of the baud rate given to Serial.begin.
+
+    LTC2946_StreamLink link(Serial);                    //Teensy
+    LTC2946_SerialLink link("/dev/ttyACM0");            //Linux host
+    link.Begin();
+*/
+
+#ifndef LTC2946_LINK_H
+#define LTC2946_LINK_H
+
+#include <stdint.h>
+
+class LTC2946_Link {
+public:
+    virtual ~LTC2946_Link() {}
+
+    //! Open or prepare the link. @return 0=success
+    virtual int8_t Begin() { return(0); }
+
+    //! Read up to length bytes that have already arrived, without waiting.
+    //! @return bytes read, -1 if the link failed
+    virtual int16_t Read(uint8_t *data, uint16_t length) = 0;
+
+    //! Write all length bytes, waiting for room if needed. @return 0=success
+    virtual int8_t Write(const uint8_t *data, uint16_t length) = 0;
+
+    //! True if length bytes can be written now without waiting (as far as the backend can tell)
+    virtual bool Writable(uint16_t length) { (void)length; return(true); }
+
+    //! Wait up to timeout_ms for bytes to read. @return true if there may be some
+    virtual bool Wait(uint32_t timeout_ms) { (void)timeout_ms; return(true); }
+};
+
+#ifdef ARDUINO
+class Stream;
+
+//! Any Arduino Stream, e.g. Serial
+class LTC2946_StreamLink : public LTC2946_Link {
+public:
+    LTC2946_StreamLink(Stream &stream); //!constructor
+
+    int16_t Read(uint8_t *data, uint16_t length);
+    int8_t Write(const uint8_t *data, uint16_t length);
+    bool Writable(uint16_t length); //! <availableForWrite() is not 0: USB serial reports at most a packet, so any room means the host is reading>
+
+private:
+    Stream &stream;
+};
+#endif  // ARDUINO
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+//! A Linux tty (e.g. /dev/ttyACM0) or pty, in raw mode
+class LTC2946_SerialLink : public LTC2946_Link {
+public:
+    LTC2946_SerialLink(const char *device_path); //! <Link on a device node, opened by Begin>
+    LTC2946_SerialLink(int fd); //! <Link on an open descriptor (e.g. a pty master), not closed by End>
+    ~LTC2946_SerialLink();
+
+    int8_t Begin(); //! <Open the node if needed and set raw mode. 0=success>
+    void End(); //! <Close the node>
+
+    int16_t Read(uint8_t *data, uint16_t length);
+    int8_t Write(const uint8_t *data, uint16_t length);
+    bool Writable(uint16_t length); //! <poll() reports the descriptor writable>
+    bool Wait(uint32_t timeout_ms);
+
+private:
+    char path[64];
+    int fd = -1;
+    bool owned = true;
+};
+
+#endif  // __linux__ && !ARDUINO
+
+#endif  // LTC2946_LINK_H
@@ -0,0 +1,124 @@
+/*!
+LTC2946 Linux Bus
+
+i2c-dev backend. See LTC2946_LinuxBus.h.
+*/
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include "LTC2946_LinuxBus.h"
+
+LTC2946_LinuxBus *LTC2946_LinuxBus::Get(uint8_t adapter)
+// Created on first use and kept for the life of the program, shared by every LTC2946 on the adapter.
+{
+    static LTC2946_LinuxBus *buses[LTC2946_LINUX_MAX_ADAPTERS];
+
+    if(adapter >= LTC2946_LINUX_MAX_ADAPTERS) return(0);
+
+    if(buses[adapter] == 0)
+    {
+        char device_path[16];
+        snprintf(device_path, sizeof(device_path), "/dev/i2c-%u", (unsigned)adapter);
+        buses[adapter] = new LTC2946_LinuxBus(device_path);
+    }
+    return(buses[adapter]);
+}
+
+LTC2946_LinuxBus::LTC2946_LinuxBus(const char *device_path) //!constructor
+{
+    strncpy(path, device_path, sizeof(path) - 1);
+    path[sizeof(path) - 1] = 0;
+}
+
+LTC2946_LinuxBus::~LTC2946_LinuxBus()
+{
+    End();
+}
+
+int8_t LTC2946_LinuxBus::Begin()
+{
+    if(fd >= 0) return(0);
+
+    fd = open(path, O_RDWR);
+    if(fd < 0) return(1);
+    return(ApplyTimeout());
+}
+
+int8_t LTC2946_LinuxBus::Configure(const LTC2946_BusConfig &bus_config)
+{
+    config = bus_config;
+    return(fd >= 0 ? ApplyTimeout() : 0);
+}
+
+uint32_t LTC2946_LinuxBus::ClockHz(){return(config.rate_hz);}
+
+int8_t LTC2946_LinuxBus::ApplyTimeout()
+// I2C_TIMEOUT is in units of 10ms; 0 leaves the adapter default.
+{
+    if(config.timeout_us == 0) return(0);
+
+    unsigned long jiffies = (config.timeout_us + 9999)/10000;
+    return(ioctl(fd, I2C_TIMEOUT, jiffies) < 0 ? 1 : 0);
+}
+
+void LTC2946_LinuxBus::End()
+{
+    if(fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+}
+
+int8_t LTC2946_LinuxBus::Transfer(uint8_t address, const uint8_t *write_data, uint8_t write_length, uint8_t *read_data, uint8_t read_length)
+// The function returns the state of the acknowledge bit. 0=acknowledge, 1=no acknowledge or bus error.
+{
+    struct i2c_msg messages[2];
+    struct i2c_rdwr_ioctl_data transfer;
+    int count = 0;
+
+    if(fd < 0 && Begin() != 0) return(1);
+
+    if(write_length > 0)
+    {
+        messages[count].addr = address;
+        messages[count].flags = 0;
+        messages[count].len = write_length;
+        messages[count].buf = (uint8_t *)write_data;     //Not modified by the kernel for writes
+        count++;
+    }
+    if(read_length > 0)
+    {
+        messages[count].addr = address;
+        messages[count].flags = I2C_M_RD;
+        messages[count].len = read_length;
+        messages[count].buf = read_data;
+        count++;
+    }
+    if(count == 0) return(0);
+
+    transfer.msgs = messages;
+    transfer.nmsgs = count;
+
+    syscalls++;
+    if(ioctl(fd, I2C_RDWR, &transfer) != count)
+    {
+        return(1);
+    }
+    return(0);
+}
+
+uint32_t LTC2946_LinuxBus::Syscalls()
+{
+    return(syscalls);
+}
+
+#endif  // __linux__ && !ARDUINO
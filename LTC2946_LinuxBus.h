@@ -0,0 +1,57 @@
+/*!
+LTC2946 Linux Bus
+
+LTC2946_Bus backend for embedded Linux hosts using the i2c-dev interface (/dev/i2c-N).
+Each Transfer is a single I2C_RDWR ioctl carrying the register write and the read as two
+messages joined by a repeated start, so a burst read costs one system call.
+
+The calling user needs read/write access to /dev/i2c-N (usually the i2c group).
+
+Example:
+    LTC2946 monitor(1, 0x6F);         //Device 0x6F on /dev/i2c-1
+    monitor.Setup();                  //Opens the adapter
+*/
+
+#ifndef LTC2946_LINUXBUS_H
+#define LTC2946_LINUXBUS_H
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <stdint.h>
+#include "LTC2946_Bus.h"
+
+#define LTC2946_LINUX_MAX_ADAPTERS 16
+
+class LTC2946_LinuxBus : public LTC2946_Bus {
+public:
+    //! Shared bus object for /dev/i2c-<adapter>. Returns 0 for adapter >= LTC2946_LINUX_MAX_ADAPTERS.
+    static LTC2946_LinuxBus *Get(uint8_t adapter);
+
+    LTC2946_LinuxBus(const char *device_path); //! <Bus on any i2c-dev node, e.g. "/dev/i2c-1">
+    ~LTC2946_LinuxBus();
+
+    int8_t Begin(); //! <Open the device node. 0=success>
+    void End(); //! <Close the device node>
+    int8_t Transfer(uint8_t address,
+                    const uint8_t *write_data, uint8_t write_length,
+                    uint8_t *read_data, uint8_t read_length);
+
+    //! Sets the adapter timeout (I2C_TIMEOUT). The clock is fixed by the adapter driver; rate_hz is only
+    //! recorded for ClockHz. Pins and pull-ups do not apply.
+    int8_t Configure(const LTC2946_BusConfig &config);
+    uint32_t ClockHz();
+
+    uint32_t Syscalls(); //! <Number of ioctl calls made, for measuring transactions per sample>
+
+private:
+    int8_t ApplyTimeout();
+
+    char path[32];
+    int fd = -1;
+    uint32_t syscalls = 0;
+    LTC2946_BusConfig config = LTC2946_bus_config();
+};
+
+#endif  // __linux__ && !ARDUINO
+
+#endif  // LTC2946_LINUXBUS_H
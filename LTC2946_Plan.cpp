@@ -0,0 +1,93 @@
+/*!
+LTC2946 Plan
+
+Burst-range planner. See LTC2946_Plan.h.
+*/
+
+#include <stdint.h>
+#include "LTC2946_Plan.h"
+
+LTC2946_Plan::LTC2946_Plan(uint64_t requested, uint32_t bus_hz, uint32_t overhead_ns, uint8_t max_length, uint64_t keep_out) //!constructor
+{
+    //! 1) Requested registers in address order (the map is sorted), dropping any the bus cannot read at all
+    uint8_t regs[LTC2946_Map::REGISTER_COUNT];
+    uint8_t n = 0;
+    for(uint8_t i = 0; i < LTC2946_Map::REGISTER_COUNT; i++)
+    {
+        if((requested & (1ULL << i)) && LTC2946_Map::REGISTERS[i].width <= max_length)
+        {
+            regs[n++] = i;
+            quantities |= 1ULL << i;
+        }
+    }
+    if(n == 0) return;
+
+    //! 2) cost[j] = cheapest plan for regs[0..j-1]; start[j] = first register of its last burst
+    uint32_t cost[LTC2946_Map::REGISTER_COUNT + 1];
+    uint8_t start[LTC2946_Map::REGISTER_COUNT + 1];
+    cost[0] = 0;
+    for(uint8_t j = 1; j <= n; j++)
+    {
+        const LTC2946_Register &last = LTC2946_Map::REGISTERS[regs[j - 1]];
+        cost[j] = 0xFFFFFFFF;
+        for(int16_t i = j - 1; i >= 0; i--)
+        {
+            const LTC2946_Register &first = LTC2946_Map::REGISTERS[regs[i]];
+            uint16_t span = LTC2946_Map::Span(first, last);
+            if(span > max_length) break;
+
+            //Unrequested registers between regs[i] and regs[i+1] join the burst from here on
+            if(i < j - 1)
+            {
+                bool blocked = false;
+                for(uint8_t k = regs[i] + 1; k < regs[i + 1]; k++) blocked |= (keep_out >> k) & 1;
+                if(blocked) break;
+            }
+
+            uint32_t c = cost[i] + TransactionNs((uint8_t)span, bus_hz, overhead_ns);
+            if(c < cost[j])
+            {
+                cost[j] = c;
+                start[j] = (uint8_t)i;
+            }
+        }
+    }
+
+    //! 3) Walk back from the end
+    uint8_t count = 0;
+    for(uint8_t j = n; j > 0; j = start[j]) count++;
+    burst_count = count;
+    for(uint8_t j = n; j > 0; j = start[j])
+    {
+        const LTC2946_Register &first = LTC2946_Map::REGISTERS[regs[start[j]]];
+        const LTC2946_Register &last = LTC2946_Map::REGISTERS[regs[j - 1]];
+        LTC2946_Burst &b = bursts[--count];
+        b.reg = first.address;
+        b.length = LTC2946_Map::Span(first, last);
+        bytes += b.length;
+    }
+    nanoseconds = cost[n];
+}
+
+int8_t LTC2946_Plan::Read(LTC2946 &device, uint8_t *image)
+{
+    int8_t ack = 0;
+
+    for(uint8_t i = 0; i < burst_count; i++)
+    {
+        ack |= device.ReadRegisters(bursts[i].reg, image + bursts[i].reg, bursts[i].length);
+    }
+    return(ack);
+}
+
+uint8_t LTC2946_Plan::Count(){return(burst_count);}
+LTC2946_Burst LTC2946_Plan::Burst(uint8_t i){return(bursts[i]);}
+uint16_t LTC2946_Plan::Bytes(){return(bytes);}
+uint32_t LTC2946_Plan::Nanoseconds(){return(nanoseconds);}
+uint64_t LTC2946_Plan::Quantities(){return(quantities);}
+
+uint32_t LTC2946_Plan::TransactionNs(uint8_t length, uint32_t bus_hz, uint32_t overhead_ns)
+{
+    //Register pointer write, then length bytes read
+    return(LTC2946_transaction_ns(1, length, bus_hz) + overhead_ns);
+}
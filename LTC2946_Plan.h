@@ -0,0 +1,99 @@
+/*!
+LTC2946 Plan
+
+Burst-range planner. Given the quantities a consumer wants from one device, it computes the
+fewest-cost set of contiguous register reads: two requested registers share a burst when reading
+the unrequested bytes between them costs less bus time than a second transaction.
+
+Cost of one write-then-read transaction of n bytes (the LTC2946_SimBus bit model):
+    (30 + 9*n) bit times at bus_hz + overhead_ns
+30 bits are START, address, register pointer, repeated START, address and STOP. overhead_ns is
+the per-transaction cost outside the bus (driver and OS call, e.g. ~50-100us for Linux I2C_RDWR,
+a few us on a Teensy). The plan is exact (dynamic programming over the requested registers) and is
+computed once, at construction.
+
+Bursts never cover an unrequested register in keep_out. The default keeps out the latched
+registers (FAULT1, FAULT2): in cleared-on-read mode an over-read would clear faults nobody saw.
+Add LTC2946_PLAN_ACCUMULATORS in auto-reset mode, where reading them restarts them.
+
+    LTC2946_Plan plan(LTC2946_PLAN_POWER | LTC2946_PLAN_VIN, 400000);
+    uint8_t image[LTC2946_REGISTER_COUNT];
+    plan.Read(LTC2946, image);
+    uint32_t power_code = LTC2946_unpack_24(image + LTC2946_POWER_MSB2_REG);
+    uint16_t vin_code = LTC2946_unpack_12(image + LTC2946_VIN_MSB_REG);
+
+Quantities are one bit per LTC2946_Map register, LTC2946_plan_quantity(LTC2946_Map::...) for any
+register not named below.
+*/
+
+#ifndef LTC2946_PLAN_H
+#define LTC2946_PLAN_H
+
+#include <stdint.h>
+#include "LTC2946.h"
+#include "LTC2946_Registers.h"
+
+//! Quantity bit of a register in the map
+constexpr uint64_t LTC2946_plan_quantity(const LTC2946_Register &reg)
+{
+    return(1ULL << LTC2946_Map::Index(reg.address));
+}
+
+//! Quantity bits of every register with the given access type
+constexpr uint64_t LTC2946_plan_access(uint8_t access, uint8_t i = 0)
+{
+    return(i >= LTC2946_Map::REGISTER_COUNT ? 0 :
+           ((LTC2946_Map::REGISTERS[i].access == access) ? (1ULL << i) : 0) | LTC2946_plan_access(access, i + 1));
+}
+
+#define LTC2946_PLAN_POWER          LTC2946_plan_quantity(LTC2946_Map::POWER)
+#define LTC2946_PLAN_CURRENT        LTC2946_plan_quantity(LTC2946_Map::DELTA_SENSE)
+#define LTC2946_PLAN_VIN            LTC2946_plan_quantity(LTC2946_Map::VIN)
+#define LTC2946_PLAN_ADIN           LTC2946_plan_quantity(LTC2946_Map::ADIN)
+#define LTC2946_PLAN_TIME           LTC2946_plan_quantity(LTC2946_Map::TIME_COUNTER)
+#define LTC2946_PLAN_CHARGE         LTC2946_plan_quantity(LTC2946_Map::CHARGE)
+#define LTC2946_PLAN_ENERGY         LTC2946_plan_quantity(LTC2946_Map::ENERGY)
+#define LTC2946_PLAN_STATUS         (LTC2946_plan_quantity(LTC2946_Map::STATUS1) | LTC2946_plan_quantity(LTC2946_Map::FAULT1))
+#define LTC2946_PLAN_MEASUREMENTS   (LTC2946_PLAN_POWER | LTC2946_PLAN_CURRENT | LTC2946_PLAN_VIN | LTC2946_PLAN_ADIN)
+#define LTC2946_PLAN_ACCUMULATORS   (LTC2946_PLAN_TIME | LTC2946_PLAN_CHARGE | LTC2946_PLAN_ENERGY)
+#define LTC2946_PLAN_LATCHED        LTC2946_plan_access(LTC2946_ACCESS_RC)
+
+//! One register read: length bytes from reg
+struct LTC2946_Burst
+{
+    uint8_t reg;
+    uint8_t length;
+};
+
+class LTC2946_Plan {
+public:
+    LTC2946_Plan(uint64_t quantities,                           //! <LTC2946_PLAN_* bits to read>
+                 uint32_t bus_hz = 400000,                      //! <SCL frequency, 0 (unknown) = LTC2946_BUS_DEFAULT_HZ>
+                 uint32_t overhead_ns = 0,                      //! <Per-transaction cost outside the bus>
+                 uint8_t max_length = LTC2946_REGISTER_COUNT,   //! <Longest read the bus backend takes (e.g. 32 for AVR Wire)>
+                 uint64_t keep_out = LTC2946_PLAN_LATCHED       //! <Registers never read unless requested>
+                 );
+
+    //! Read every burst of the plan from device into image, indexed by register address
+    //! (LTC2946_REGISTER_COUNT bytes). Bytes outside the plan are left alone. @return 0=acknowledge
+    int8_t Read(LTC2946 &device, uint8_t *image);
+
+    uint8_t Count(); //! <Bursts (transactions) per Read>
+    LTC2946_Burst Burst(uint8_t i);
+    uint16_t Bytes(); //! <Bytes read per Read, requested and over-read>
+    uint32_t Nanoseconds(); //! <Modeled time of one Read>
+    uint64_t Quantities(); //! <Requested bits that are in the plan>
+
+    //! Modeled time of one transaction reading length bytes (LTC2946_transaction_ns of the pointer write and the
+    //! read, plus overhead_ns). bus_hz 0 = LTC2946_BUS_DEFAULT_HZ
+    static uint32_t TransactionNs(uint8_t length, uint32_t bus_hz, uint32_t overhead_ns);
+
+private:
+    LTC2946_Burst bursts[LTC2946_Map::REGISTER_COUNT];
+    uint8_t burst_count = 0;
+    uint16_t bytes = 0;
+    uint32_t nanoseconds = 0;
+    uint64_t quantities = 0;
+};
+
+#endif  // LTC2946_PLAN_H
@@ -0,0 +1,352 @@
+/*!
+LTC2946 Record
+
+Bus trace recording and replay. See LTC2946_Record.h.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "LTC2946_Record.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#elif defined(__linux__)
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#endif
+
+static void put16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t value)
+{
+    put16(p, (uint16_t)value);
+    put16(p + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get16(const uint8_t *p){return((uint16_t)(p[0] | (p[1] << 8)));}
+static uint32_t get32(const uint8_t *p){return(get16(p) | ((uint32_t)get16(p + 2) << 16));}
+
+LTC2946_RecordBus::LTC2946_RecordBus(LTC2946_Bus &bus, uint8_t *buffer, size_t size) //!constructor
+    : bus(bus), buffer(buffer), size(size)
+{
+    Restart();
+}
+
+void LTC2946_RecordBus::SetClock(uint32_t (*clock_source)()){clock = clock_source;}
+void LTC2946_RecordBus::Pause(bool state){paused = state;}
+
+int8_t LTC2946_RecordBus::Begin()
+{
+    return(bus.Begin());
+}
+
+int8_t LTC2946_RecordBus::Configure(const LTC2946_BusConfig &config)
+{
+    return(bus.Configure(config));
+}
+
+uint32_t LTC2946_RecordBus::ClockHz()
+{
+    return(bus.ClockHz());
+}
+
+int8_t LTC2946_RecordBus::Transfer(uint8_t address, const uint8_t *write_data, uint8_t write_length, uint8_t *read_data, uint8_t read_length)
+{
+    uint32_t start = Clock();
+    int8_t ack = bus.Transfer(address, write_data, write_length, read_data, read_length);
+    uint32_t duration = Clock() - start;
+
+    if(paused) return(ack);
+
+    size_t record_length = LTC2946_BUSTRACE_RECORD_SIZE + write_length + read_length;
+    if(length + record_length > size)
+    {
+        dropped++;
+        return(ack);
+    }
+
+    uint8_t *r = buffer + length;
+    put32(r, start - last_start);
+    put16(r + 4, duration > 0xFFFF ? 0xFFFF : (uint16_t)duration);
+    r[6] = address;
+    r[7] = (uint8_t)ack;
+    r[8] = write_length;
+    r[9] = read_length;
+    memcpy(r + LTC2946_BUSTRACE_RECORD_SIZE, write_data, write_length);
+    memcpy(r + LTC2946_BUSTRACE_RECORD_SIZE + write_length, read_data, read_length);
+
+    length += record_length;
+    last_start = start;
+    records++;
+    return(ack);
+}
+
+const uint8_t *LTC2946_RecordBus::Data(){return(buffer);}
+size_t LTC2946_RecordBus::Length(){return(length);}
+void LTC2946_RecordBus::Clear(){length = 0;}
+uint32_t LTC2946_RecordBus::Records(){return(records);}
+uint32_t LTC2946_RecordBus::Dropped(){return(dropped);}
+
+void LTC2946_RecordBus::Restart()
+{
+    length = 0;
+    records = 0;
+    dropped = 0;
+    last_start = Clock();
+    if(size < LTC2946_BUSTRACE_HEADER_SIZE) return;
+
+    memcpy(buffer, LTC2946_BUSTRACE_MAGIC, 8);
+    put16(buffer + 8, LTC2946_BUSTRACE_VERSION);
+    put16(buffer + 10, LTC2946_BUSTRACE_HEADER_SIZE);
+    put32(buffer + 12, last_start);
+    length = LTC2946_BUSTRACE_HEADER_SIZE;
+}
+
+uint32_t LTC2946_RecordBus::Clock()
+{
+    if(clock != 0) return(clock());
+#if defined(ARDUINO)
+    return(micros());
+#elif defined(__linux__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((uint32_t)((uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000));
+#else
+    return(0);
+#endif
+}
+
+#if defined(__linux__) && !defined(ARDUINO)
+bool LTC2946_RecordBus::Save(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if(file == 0) return(false);
+
+    bool ok = fwrite(buffer, 1, length, file) == length;
+    ok = (fclose(file) == 0) && ok;
+    return(ok);
+}
+#endif
+
+bool LTC2946_BusTraceReader::Open(const uint8_t *trace, size_t trace_length)
+{
+    data = 0;
+    if(trace_length < LTC2946_BUSTRACE_HEADER_SIZE || memcmp(trace, LTC2946_BUSTRACE_MAGIC, 8) != 0) return(false);
+
+    memcpy(header.magic, trace, 8);
+    header.version = get16(trace + 8);
+    header.header_size = get16(trace + 10);
+    header.start_us = get32(trace + 12);
+    if(header.version != LTC2946_BUSTRACE_VERSION || header.header_size < LTC2946_BUSTRACE_HEADER_SIZE ||
+       header.header_size > trace_length) return(false);
+
+    data = trace;
+    length = trace_length;
+    Rewind();
+    return(true);
+}
+
+bool LTC2946_BusTraceReader::Next(LTC2946_BusRecord *record)
+{
+    if(data == 0 || position + LTC2946_BUSTRACE_RECORD_SIZE > length) return(false);
+
+    const uint8_t *r = data + position;
+    size_t record_length = LTC2946_BUSTRACE_RECORD_SIZE + r[8] + r[9];
+    if(position + record_length > length) return(false);
+
+    time += get32(r);
+    record->time_us = time;
+    record->duration_us = get16(r + 4);
+    record->address = r[6];
+    record->ack = (int8_t)r[7];
+    record->write_length = r[8];
+    record->read_length = r[9];
+    record->write_data = r + LTC2946_BUSTRACE_RECORD_SIZE;
+    record->read_data = r + LTC2946_BUSTRACE_RECORD_SIZE + r[8];
+
+    position += record_length;
+    return(true);
+}
+
+void LTC2946_BusTraceReader::Rewind()
+{
+    position = header.header_size;
+    time = 0;
+}
+
+const LTC2946_BusTraceHeader *LTC2946_BusTraceReader::Header(){return(data ? &header : 0);}
+
+LTC2946_ReplayBus::LTC2946_ReplayBus() //!constructor
+{
+}
+
+LTC2946_ReplayBus::~LTC2946_ReplayBus()
+{
+#if defined(__linux__) && !defined(ARDUINO)
+    free(owned);
+#endif
+}
+
+bool LTC2946_ReplayBus::Open(const uint8_t *data, size_t length)
+{
+    if(!reader.Open(data, length)) return(false);
+    Rewind();
+    return(true);
+}
+
+#if defined(__linux__) && !defined(ARDUINO)
+bool LTC2946_ReplayBus::Load(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if(file == 0) return(false);
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t *data = (length > 0) ? (uint8_t *)malloc(length) : 0;
+    bool ok = data != 0 && fread(data, 1, length, file) == (size_t)length;
+    fclose(file);
+
+    if(!ok || !Open(data, length))
+    {
+        free(data);
+        return(false);
+    }
+    free(owned);
+    owned = data;
+    return(true);
+}
+#endif
+
+int8_t LTC2946_ReplayBus::Transfer(uint8_t address, const uint8_t *write_data, uint8_t write_length, uint8_t *read_data, uint8_t read_length)
+{
+    //! 1) Recorded counterpart among the next records
+    Fill();
+    for(uint8_t i = 0; i < pending_count; i++)
+    {
+        if(!Matches(pending[i], address, write_data, write_length, read_length)) continue;
+
+        for(uint8_t s = 0; s < i; s++) Apply(pending[s]);  //Passed over, but their registers still count
+        skipped += i;
+        matched++;
+        misses = 0;
+
+        LTC2946_BusRecord record = pending[i];
+        Apply(record);
+        memcpy(read_data, record.read_data, read_length);
+        now = record.time_us;
+
+        pending_count -= i + 1;
+        memmove(pending, pending + i + 1, pending_count*sizeof(pending[0]));
+        return(record.ack);
+    }
+
+    //! 2) Not recorded: answer from the registers seen so far. After a run of misses the driver
+    //! no longer makes the recorded transactions, so one is passed over per miss to keep the
+    //! trace moving.
+    extra++;
+    if(misses < LTC2946_REPLAY_LOOKAHEAD) misses++;
+    if(misses >= LTC2946_REPLAY_LOOKAHEAD && pending_count > 0)
+    {
+        Apply(pending[0]);
+        skipped++;
+        now = pending[0].time_us;
+        pending_count--;
+        memmove(pending, pending + 1, pending_count*sizeof(pending[0]));
+    }
+
+    Device *d = Find(address, false);
+    if(d == 0)
+    {
+        memset(read_data, 0xFF, read_length);
+        return(1);
+    }
+    if(write_length > 0)
+    {
+        d->pointer = write_data[0];
+        for(uint8_t i = 1; i < write_length; i++)
+        {
+            if(d->pointer < LTC2946_REGISTER_COUNT) d->registers[d->pointer] = write_data[i];
+            d->pointer++;
+        }
+    }
+    for(uint8_t i = 0; i < read_length; i++)
+    {
+        read_data[i] = (d->pointer < LTC2946_REGISTER_COUNT) ? d->registers[d->pointer] : 0;
+        d->pointer++;
+    }
+    return(0);
+}
+
+bool LTC2946_ReplayBus::Done()
+{
+    Fill();
+    return(pending_count == 0);
+}
+
+uint32_t LTC2946_ReplayBus::Now(){return(now);}
+
+void LTC2946_ReplayBus::Rewind()
+{
+    reader.Rewind();
+    pending_count = 0;
+    device_count = 0;
+    now = 0;
+    misses = 0;
+    matched = 0;
+    extra = 0;
+    skipped = 0;
+}
+
+uint32_t LTC2946_ReplayBus::Matched(){return(matched);}
+uint32_t LTC2946_ReplayBus::Extra(){return(extra);}
+uint32_t LTC2946_ReplayBus::Skipped(){return(skipped);}
+
+void LTC2946_ReplayBus::Fill()
+{
+    while(pending_count < LTC2946_REPLAY_LOOKAHEAD && reader.Next(&pending[pending_count])) pending_count++;
+}
+
+bool LTC2946_ReplayBus::Matches(const LTC2946_BusRecord &record, uint8_t address, const uint8_t *write_data, uint8_t write_length, uint8_t read_length)
+{
+    return(record.address == address && record.write_length == write_length && record.read_length == read_length &&
+           memcmp(record.write_data, write_data, write_length) == 0);
+}
+
+void LTC2946_ReplayBus::Apply(const LTC2946_BusRecord &record)
+{
+    if(record.ack != 0) return;
+    Device *d = Find(record.address, true);
+    if(d == 0) return;
+
+    if(record.write_length > 0) d->pointer = record.write_data[0];
+    for(uint8_t i = 1; i < record.write_length; i++, d->pointer++)
+    {
+        if(d->pointer < LTC2946_REGISTER_COUNT) d->registers[d->pointer] = record.write_data[i];
+    }
+    for(uint8_t i = 0; i < record.read_length; i++, d->pointer++)
+    {
+        if(d->pointer < LTC2946_REGISTER_COUNT) d->registers[d->pointer] = record.read_data[i];
+    }
+}
+
+LTC2946_ReplayBus::Device *LTC2946_ReplayBus::Find(uint8_t address, bool add)
+{
+    for(uint8_t i = 0; i < device_count; i++)
+    {
+        if(devices[i].address == address) return(&devices[i]);
+    }
+    if(!add || device_count >= LTC2946_REPLAY_MAX_DEVICES) return(0);
+
+    Device &d = devices[device_count++];
+    d.address = address;
+    d.pointer = 0;
+    memset(d.registers, 0, sizeof(d.registers));
+    return(&d);
+}
@@ -0,0 +1,197 @@
+/*!
+LTC2946 Record
+
+Bus trace recording and replay. LTC2946_RecordBus wraps any LTC2946_Bus and appends every
+transaction (address, bytes written and read, acknowledge, start time and duration) to a caller
+supplied buffer. LTC2946_ReplayBus feeds a recorded trace back to the LTC2946 class, so driver
+changes can be run and benchmarked against field workloads on a host, and extra or missing
+transactions show up as counts.
+
+Trace layout (little endian):
+    LTC2946_BusTraceHeader                      16 bytes, once at the start
+    record 0 .. record N-1
+        delta_us        uint32                  start time since the previous record's start
+        duration_us     uint16                  transaction time, saturated at 65535
+        address         uint8                   7-bit address
+        ack             uint8                   Transfer() return value
+        write_length    uint8
+        read_length     uint8
+        write bytes     write_length            first byte is the register pointer
+        read bytes      read_length
+
+A ReadVIN is a 13 byte record. Recording on a Teensy:
+    static uint8_t trace[32768];
+    LTC2946_RecordBus recorder(*LTC2946_platform_bus(0), trace, sizeof(trace));
+    LTC2946 LTC2946(recorder, 0x6F);
+    ...
+    Serial.write(recorder.Data(), recorder.Length());   //Drain, then
+    recorder.Clear();                                   //keep recording after the drained part
+
+Timestamps come from micros() on Arduino and CLOCK_MONOTONIC on Linux, or from SetClock.
+*/
+
+#ifndef LTC2946_RECORD_H
+#define LTC2946_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LTC2946.h"
+#include "LTC2946_Bus.h"
+
+#define LTC2946_BUSTRACE_MAGIC          "LTC2946B"
+#define LTC2946_BUSTRACE_VERSION        1
+#define LTC2946_BUSTRACE_HEADER_SIZE    16
+#define LTC2946_BUSTRACE_RECORD_SIZE    10      //!< Record bytes before the data bytes
+#define LTC2946_REPLAY_MAX_DEVICES      9       //!< One per LTC2946 address
+#define LTC2946_REPLAY_LOOKAHEAD        8       //!< Records searched for a match before answering from registers
+
+//! File header. Stored byte by byte, little endian.
+struct LTC2946_BusTraceHeader
+{
+    char magic[8];              //!< LTC2946_BUSTRACE_MAGIC, not terminated
+    uint16_t version;
+    uint16_t header_size;       //!< Bytes before the first record
+    uint32_t start_us;          //!< Clock at the start of recording
+};
+
+//! One decoded record. Data points into the trace.
+struct LTC2946_BusRecord
+{
+    uint32_t time_us;           //!< Start time since the start of the trace
+    uint16_t duration_us;
+    uint8_t address;
+    int8_t ack;
+    uint8_t write_length;
+    uint8_t read_length;
+    const uint8_t *write_data;
+    const uint8_t *read_data;
+};
+
+//! Records every transaction of another bus into a buffer
+class LTC2946_RecordBus : public LTC2946_Bus {
+public:
+    LTC2946_RecordBus(LTC2946_Bus &bus,        //! <Bus that carries the transactions>
+                      uint8_t *buffer,          //! <Trace storage>
+                      size_t size               //! <Bytes in buffer, at least LTC2946_BUSTRACE_HEADER_SIZE>
+                      );
+
+    //! Replace the timestamp source (microseconds). 0 restores the platform clock.
+    void SetClock(uint32_t (*clock)());
+
+    //! Stop or resume recording. Transactions still reach the bus while paused.
+    void Pause(bool state);
+
+    int8_t Begin();
+    int8_t Transfer(uint8_t address,
+                    const uint8_t *write_data, uint8_t write_length,
+                    uint8_t *read_data, uint8_t read_length);
+    int8_t Configure(const LTC2946_BusConfig &config); //! <Passed to the recorded bus, not recorded>
+    uint32_t ClockHz(); //! <The recorded bus's clock>
+
+    const uint8_t *Data(); //! <Trace bytes recorded since the last Clear (header first, until the first Clear)>
+    size_t Length(); //! <Bytes in Data()>
+    void Clear(); //! <Discard Data() after draining it. Recording continues, timestamps stay relative>
+    void Restart(); //! <Start a new trace with a new header>
+
+    uint32_t Records(); //! <Transactions recorded since Restart>
+    uint32_t Dropped(); //! <Transactions not recorded because the buffer was full>
+
+#if defined(__linux__) && !defined(ARDUINO)
+    //! Write Data() to path. @return true on success
+    bool Save(const char *path);
+#endif
+
+private:
+    uint32_t Clock();
+
+    LTC2946_Bus &bus;
+    uint8_t *buffer;
+    size_t size;
+    size_t length = 0;
+    uint32_t (*clock)() = 0;
+    uint32_t last_start = 0;
+    uint32_t records = 0;
+    uint32_t dropped = 0;
+    bool paused = false;
+};
+
+//! Reads records from a trace in memory
+class LTC2946_BusTraceReader {
+public:
+    //! @return false if data does not start with a valid header
+    bool Open(const uint8_t *data, size_t length);
+
+    //! Next record. @return false at the end of the trace or on a truncated record
+    bool Next(LTC2946_BusRecord *record);
+
+    void Rewind();
+    const LTC2946_BusTraceHeader *Header();
+
+private:
+    const uint8_t *data = 0;
+    size_t length = 0;
+    size_t position = 0;
+    uint32_t time = 0;
+    LTC2946_BusTraceHeader header;
+};
+
+//! Answers the LTC2946 class from a recorded trace
+class LTC2946_ReplayBus : public LTC2946_Bus {
+public:
+    LTC2946_ReplayBus();
+    ~LTC2946_ReplayBus();
+
+    //! Replay a trace in memory. data must stay valid. @return false if it is not a trace
+    bool Open(const uint8_t *data, size_t length);
+
+#if defined(__linux__) && !defined(ARDUINO)
+    //! Load a trace file. @return false if it cannot be read or is not a trace
+    bool Load(const char *path);
+#endif
+
+    //! Transactions matching the next recorded ones (address, written bytes, read length) get the
+    //! recorded read bytes and acknowledge. Others are looked for in the next
+    //! LTC2946_REPLAY_LOOKAHEAD records (records passed over count as skipped); if not found they
+    //! are answered from the register contents seen in the trace so far and count as extra. From
+    //! LTC2946_REPLAY_LOOKAHEAD misses in a row on, each miss also skips one record.
+    int8_t Transfer(uint8_t address,
+                    const uint8_t *write_data, uint8_t write_length,
+                    uint8_t *read_data, uint8_t read_length);
+
+    bool Done(); //! <All records replayed or skipped>
+    uint32_t Now(); //! <Trace time of the last replayed record, us>
+    void Rewind();
+
+    uint32_t Matched(); //! <Transactions answered by their recorded record>
+    uint32_t Extra(); //! <Transactions with no recorded counterpart>
+    uint32_t Skipped(); //! <Recorded transactions the driver did not make>
+
+private:
+    struct Device
+    {
+        uint8_t address;
+        uint8_t pointer;
+        uint8_t registers[LTC2946_REGISTER_COUNT];
+    };
+
+    void Fill();                                     //top up pending from the trace
+    bool Matches(const LTC2946_BusRecord &record, uint8_t address, const uint8_t *write_data, uint8_t write_length, uint8_t read_length);
+    void Apply(const LTC2946_BusRecord &record);    //update register contents from a record
+    Device *Find(uint8_t address, bool add);
+
+    LTC2946_BusTraceReader reader;
+    LTC2946_BusRecord pending[LTC2946_REPLAY_LOOKAHEAD];
+    uint8_t pending_count = 0;
+    uint8_t *owned = 0;                              //trace loaded by Load
+    uint32_t now = 0;
+    uint8_t misses = 0;                              //extra transactions in a row
+
+    Device devices[LTC2946_REPLAY_MAX_DEVICES];
+    uint8_t device_count = 0;
+
+    uint32_t matched = 0;
+    uint32_t extra = 0;
+    uint32_t skipped = 0;
+};
+
+#endif  // LTC2946_RECORD_H
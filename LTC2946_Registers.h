@@ -0,0 +1,163 @@
+/*!
+LTC2946 Registers
+
+Typed register and field map of the LTC2946, written once in LTC2946_REGISTER_MAP and
+LTC2946_FIELD_MAP. Everything here is constexpr: register spans, burst lengths, field masks and
+encoded values are folded by the compiler, so using the map costs nothing at run time.
+
+| Access                 | Meaning                                                           |
+| :--------------------- | :---------------------------------------------------------------- |
+| LTC2946_ACCESS_NONE    | Not a register                                                    |
+| LTC2946_ACCESS_R       | Read only, writes are ignored                                     |
+| LTC2946_ACCESS_RW      | Read and write                                                    |
+| LTC2946_ACCESS_RC      | Latched bits: written bits can only be cleared (FAULT1/FAULT2)    |
+
+Registers are MSB first and width bytes wide; reset is the power-on value of the whole register.
+Fields are bits wide starting at bit shift of a one byte register:
+
+    uint8_t ctrla = LTC2946_Map::CTRLA_VOLTAGE_SEL.Insert(ctrla, 3);           //SENSE+
+    static_assert(LTC2946_Map::Span(LTC2946_Map::TIME_COUNTER, LTC2946_Map::ENERGY) == 12, "");
+
+The LTC2946_*_REG, command code and mask #defines in LTC2946.h remain, and are checked against this
+map at compile time (LTC2946.cpp).
+*/
+
+#ifndef LTC2946_REGISTERS_H
+#define LTC2946_REGISTERS_H
+
+#include <stdint.h>
+
+#define LTC2946_ACCESS_NONE     0
+#define LTC2946_ACCESS_R        1
+#define LTC2946_ACCESS_RW       2
+#define LTC2946_ACCESS_RC       3
+
+//! X(name, address, width, access, reset)
+#define LTC2946_REGISTER_MAP(X) \
+    X(CTRLA,                        0x00, 1, LTC2946_ACCESS_RW, 0x18) \
+    X(CTRLB,                        0x01, 1, LTC2946_ACCESS_RW, 0x00) \
+    X(ALERT1,                       0x02, 1, LTC2946_ACCESS_RW, 0x00) \
+    X(STATUS1,                      0x03, 1, LTC2946_ACCESS_R,  0x00) \
+    X(FAULT1,                       0x04, 1, LTC2946_ACCESS_RC, 0x00) \
+    X(POWER,                        0x05, 3, LTC2946_ACCESS_R,  0x000000) \
+    X(MAX_POWER,                    0x08, 3, LTC2946_ACCESS_RW, 0x000000) \
+    X(MIN_POWER,                    0x0B, 3, LTC2946_ACCESS_RW, 0xFFFFFF) \
+    X(MAX_POWER_THRESHOLD,          0x0E, 3, LTC2946_ACCESS_RW, 0xFFFFFF) \
+    X(MIN_POWER_THRESHOLD,          0x11, 3, LTC2946_ACCESS_RW, 0x000000) \
+    X(DELTA_SENSE,                  0x14, 2, LTC2946_ACCESS_R,  0x0000) \
+    X(MAX_DELTA_SENSE,              0x16, 2, LTC2946_ACCESS_RW, 0x0000) \
+    X(MIN_DELTA_SENSE,              0x18, 2, LTC2946_ACCESS_RW, 0xFFF0) \
+    X(MAX_DELTA_SENSE_THRESHOLD,    0x1A, 2, LTC2946_ACCESS_RW, 0xFFF0) \
+    X(MIN_DELTA_SENSE_THRESHOLD,    0x1C, 2, LTC2946_ACCESS_RW, 0x0000) \
+    X(VIN,                          0x1E, 2, LTC2946_ACCESS_R,  0x0000) \
+    X(MAX_VIN,                      0x20, 2, LTC2946_ACCESS_RW, 0x0000) \
+    X(MIN_VIN,                      0x22, 2, LTC2946_ACCESS_RW, 0xFFF0) \
+    X(MAX_VIN_THRESHOLD,            0x24, 2, LTC2946_ACCESS_RW, 0xFFF0) \
+    X(MIN_VIN_THRESHOLD,            0x26, 2, LTC2946_ACCESS_RW, 0x0000) \
+    X(ADIN,                         0x28, 2, LTC2946_ACCESS_R,  0x0000) \
+    X(MAX_ADIN,                     0x2A, 2, LTC2946_ACCESS_RW, 0x0000) \
+    X(MIN_ADIN,                     0x2C, 2, LTC2946_ACCESS_RW, 0xFFF0) \
+    X(MAX_ADIN_THRESHOLD,           0x2E, 2, LTC2946_ACCESS_RW, 0xFFF0) \
+    X(MIN_ADIN_THRESHOLD,           0x30, 2, LTC2946_ACCESS_RW, 0x0000) \
+    X(ALERT2,                       0x32, 1, LTC2946_ACCESS_RW, 0x00) \
+    X(GPIO_CFG,                     0x33, 1, LTC2946_ACCESS_RW, 0x00) \
+    X(TIME_COUNTER,                 0x34, 4, LTC2946_ACCESS_RW, 0x00000000) \
+    X(CHARGE,                       0x38, 4, LTC2946_ACCESS_RW, 0x00000000) \
+    X(ENERGY,                       0x3C, 4, LTC2946_ACCESS_RW, 0x00000000) \
+    X(STATUS2,                      0x40, 1, LTC2946_ACCESS_R,  0x00) \
+    X(FAULT2,                       0x41, 1, LTC2946_ACCESS_RC, 0x00) \
+    X(GPIO3_CTRL,                   0x42, 1, LTC2946_ACCESS_RW, 0x00) \
+    X(CLK_DIV,                      0x43, 1, LTC2946_ACCESS_RW, 0x00)
+
+//! X(name, register, shift, bits)
+#define LTC2946_FIELD_MAP(X) \
+    X(CTRLA_ADIN,                   CTRLA,      7, 1) \
+    X(CTRLA_OFFSET,                 CTRLA,      5, 2) \
+    X(CTRLA_VOLTAGE_SEL,            CTRLA,      3, 2) \
+    X(CTRLA_CHANNEL_CONFIG,         CTRLA,      0, 3) \
+    X(CTRLB_ALERT_CLEAR,            CTRLB,      7, 1) \
+    X(CTRLB_SHUTDOWN,               CTRLB,      6, 1) \
+    X(CTRLB_CLEARED_ON_READ,        CTRLB,      5, 1) \
+    X(CTRLB_STUCK_BUS_RECOVER,      CTRLB,      4, 1) \
+    X(CTRLB_ACC,                    CTRLB,      2, 2) \
+    X(CTRLB_RESET,                  CTRLB,      0, 2) \
+    X(GPIOCFG_GPIO1,                GPIO_CFG,   6, 2) \
+    X(GPIOCFG_GPIO2,                GPIO_CFG,   4, 2) \
+    X(GPIOCFG_GPIO3,                GPIO_CFG,   2, 2) \
+    X(GPIOCFG_GPIO2_OUT,            GPIO_CFG,   1, 1) \
+    X(GPIO3_CTRL_GPIO3,             GPIO3_CTRL, 6, 1) \
+    X(CLK_DIV_DIVIDER,              CLK_DIV,    0, 5)
+
+struct LTC2946_Register
+{
+    uint8_t address;
+    uint8_t width;              //!< Bytes, MSB first
+    uint8_t access;             //!< LTC2946_ACCESS_*
+    uint32_t reset;             //!< Power-on value
+
+    constexpr uint8_t Last() const {return(address + width - 1);}
+    constexpr bool Writable() const {return(access == LTC2946_ACCESS_RW || access == LTC2946_ACCESS_RC);}
+};
+
+struct LTC2946_Field
+{
+    uint8_t address;
+    uint8_t shift;
+    uint8_t bits;
+
+    constexpr uint8_t Mask() const {return((uint8_t)(((1u << bits) - 1) << shift));}            //!< Bits of the field
+    constexpr uint8_t Keep() const {return((uint8_t)~Mask());}                                //!< Bits around it (the *_MASK #defines)
+    constexpr uint8_t Value(uint8_t value) const {return((uint8_t)((value << shift) & Mask()));}  //!< value in place
+    constexpr uint8_t Insert(uint8_t reg, uint8_t value) const {return((uint8_t)((reg & Keep()) | Value(value)));}
+    constexpr uint8_t Extract(uint8_t reg) const {return((uint8_t)((reg & Mask()) >> shift));}
+};
+
+namespace LTC2946_Map
+{
+#define LTC2946_MAP_REGISTER(name, address, width, access, reset) constexpr LTC2946_Register name = {address, width, access, reset};
+#define LTC2946_MAP_FIELD(name, reg, shift, bits) constexpr LTC2946_Field name = {reg.address, shift, bits};
+    LTC2946_REGISTER_MAP(LTC2946_MAP_REGISTER)
+    LTC2946_FIELD_MAP(LTC2946_MAP_FIELD)
+#undef LTC2946_MAP_REGISTER
+#undef LTC2946_MAP_FIELD
+
+#define LTC2946_MAP_ENTRY(name, address, width, access, reset) name,
+    constexpr LTC2946_Register REGISTERS[] = {LTC2946_REGISTER_MAP(LTC2946_MAP_ENTRY)};
+#undef LTC2946_MAP_ENTRY
+    constexpr uint8_t REGISTER_COUNT = sizeof(REGISTERS)/sizeof(REGISTERS[0]);
+    constexpr uint8_t SIZE = REGISTERS[REGISTER_COUNT - 1].address + REGISTERS[REGISTER_COUNT - 1].width;    //!< Register file bytes
+
+    //! Bytes of one burst from the first byte of first to the last byte of last
+    constexpr uint8_t Span(const LTC2946_Register &first, const LTC2946_Register &last)
+    {
+        return(last.address + last.width - first.address);
+    }
+
+    //! Index into REGISTERS of the register holding byte address, REGISTER_COUNT if none
+    constexpr uint8_t Index(uint8_t address, uint8_t i = 0)
+    {
+        return(i >= REGISTER_COUNT ? REGISTER_COUNT :
+               (address >= REGISTERS[i].address && address <= REGISTERS[i].Last()) ? i : Index(address, i + 1));
+    }
+
+    //! LTC2946_ACCESS_* of byte address
+    constexpr uint8_t Access(uint8_t address)
+    {
+        return(Index(address) < REGISTER_COUNT ? REGISTERS[Index(address)].access : LTC2946_ACCESS_NONE);
+    }
+
+    //! Power-on value of byte address
+    constexpr uint8_t Reset(uint8_t address)
+    {
+        return(Index(address) < REGISTER_COUNT ?
+               (uint8_t)(REGISTERS[Index(address)].reset >> (8*(REGISTERS[Index(address)].Last() - address))) : 0);
+    }
+
+    //! True if every byte from first to last is a register (one burst can cover them)
+    constexpr bool Contiguous(uint8_t first, uint8_t last)
+    {
+        return(first > last || (Access(first) != LTC2946_ACCESS_NONE && Contiguous(first + 1, last)));
+    }
+}
+
+#endif  // LTC2946_REGISTERS_H
@@ -0,0 +1,192 @@
+/*!
+LTC2946 Scheduler
+
+Adaptive polling of several LTC2946s under a bus budget. See LTC2946_Scheduler.h.
+*/
+
+#include <stdint.h>
+#include "LTC2946_Scheduler.h"
+
+LTC2946_Scheduler::LTC2946_Scheduler(float utilization) //!constructor
+    : utilization(utilization)
+{
+    Rebudget();
+}
+
+int8_t LTC2946_Scheduler::Add(LTC2946 &device, float min_rate, float max_rate)
+{
+    if(count >= LTC2946_SCHEDULER_MAX_DEVICES || min_rate <= 0 || max_rate < min_rate) return(-1);
+
+    Slot &s = slots[count];
+    s.device = &device;
+    s.min_rate = min_rate;
+    s.max_rate = max_rate;
+    s.rate = min_rate;
+    s.next_poll = 0;
+    s.alert_until = 0;
+    s.polls = 0;
+    for(uint8_t c = 0; c < CHANNEL_COUNT; c++) s.code[c] = 0;
+    s.activity = 0;
+    s.alert = false;
+    s.error = false;
+    s.primed = false;
+    count++;
+
+    //The bus is configured by now (Configure before Setup); a bus that does not know gives 0
+    if(count == 1 && device.GetBus() != 0)
+    {
+        bus_hz = device.GetBus()->ClockHz();
+        Rebudget();
+    }
+    Allocate();
+    return(count - 1);
+}
+
+void LTC2946_Scheduler::SetActivity(uint16_t quiet_codes, uint16_t busy_codes)
+{
+    activity_quiet = quiet_codes;
+    activity_busy = (busy_codes > quiet_codes) ? busy_codes : quiet_codes + 1;
+}
+void LTC2946_Scheduler::SetAlertHold(uint32_t hold_us){alert_hold = hold_us;}
+
+void LTC2946_Scheduler::CheckFaults(bool state)
+{
+    check_faults = state;
+    Rebudget();
+    Allocate();
+}
+
+void LTC2946_Scheduler::SetBudget(float polls_per_second)
+{
+    budget = polls_per_second;
+    budget_set = true;
+    Allocate();
+}
+
+void LTC2946_Scheduler::Alert(uint8_t index, uint32_t now_us)
+{
+    if(index >= count) return;
+
+    Slot &s = slots[index];
+    s.alert = true;
+    s.alert_until = now_us + alert_hold;
+    Allocate();
+
+    //Do not wait out the old (slow) period
+    if((int32_t)(s.next_poll - now_us) > (int32_t)(1e6f/s.rate)) s.next_poll = now_us;
+}
+
+int8_t LTC2946_Scheduler::Update(uint32_t now_us)
+{
+    int8_t due = -1;
+    int32_t most_late = 0;
+
+    //! 1) Most overdue device. Signed differences stay valid across micros() wrap.
+    for(uint8_t i = 0; i < count; i++)
+    {
+        int32_t late = (int32_t)(now_us - slots[i].next_poll);
+        if(late >= 0 && (due < 0 || late > most_late))
+        {
+            due = i;
+            most_late = late;
+        }
+    }
+    if(due < 0) return(-1);
+
+    //! 2) Poll it
+    Slot &s = slots[due];
+    uint16_t vin_code, current_code, adin_code;
+    uint32_t power_code;
+
+    s.error = s.device->ReadAllCodes(&vin_code, &current_code, &power_code, &adin_code) != 0;
+    s.polls++;
+
+    if(!s.error)
+    {
+        //! 3) Activity: running average (1/4 weight) of the larger VIN or delta sense change
+        if(s.primed)
+        {
+            uint16_t dv = (vin_code > s.code[VIN]) ? vin_code - s.code[VIN] : s.code[VIN] - vin_code;
+            uint16_t di = (current_code > s.code[CURRENT]) ? current_code - s.code[CURRENT] : s.code[CURRENT] - current_code;
+            uint32_t change = ((dv > di) ? dv : di)*16UL;
+            if(change > 0xFFFF) change = 0xFFFF;
+            s.activity = (uint16_t)((3UL*s.activity + change)/4);
+        }
+        s.code[VIN] = vin_code;
+        s.code[CURRENT] = current_code;
+        s.code[POWER] = power_code;
+        s.code[ADIN] = adin_code;
+        s.primed = true;
+
+        if(check_faults)
+        {
+            uint8_t status1, fault1;
+            if(s.device->ReadStatus(&status1, &fault1) == 0 && fault1 != 0)
+            {
+                s.device->ClearFaults();
+                s.alert = true;
+                s.alert_until = now_us + alert_hold;
+            }
+        }
+    }
+
+    if(s.alert && (int32_t)(now_us - s.alert_until) >= 0) s.alert = false;
+
+    //! 4) Re-split the budget and schedule the next poll of this device
+    Allocate();
+    s.next_poll = now_us + (uint32_t)(1e6f/s.rate);
+
+    return(due);
+}
+
+void LTC2946_Scheduler::Rebudget()
+{
+    if(!budget_set) budget = utilization/PollTime(bus_hz, check_faults);
+}
+
+void LTC2946_Scheduler::Allocate()
+{
+    float wanted[LTC2946_SCHEDULER_MAX_DEVICES];
+    float total_min = 0, total_extra = 0;
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        Slot &s = slots[i];
+        float share = ((float)s.activity/16.0f - activity_quiet)/(float)(activity_busy - activity_quiet);
+        if(share < 0) share = 0;
+        if(share > 1 || s.alert) share = 1;
+        wanted[i] = (s.max_rate - s.min_rate)*share;
+        total_min += s.min_rate;
+        total_extra += wanted[i];
+    }
+
+    //Minimum rates first, scaled down together if even they do not fit; then the extra in proportion
+    float min_scale = (total_min > budget) ? budget/total_min : 1;
+    float spare = budget - total_min*min_scale;
+    float extra_scale = (total_extra > spare) ? spare/total_extra : 1;
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        slots[i].rate = slots[i].min_rate*min_scale + wanted[i]*extra_scale;
+    }
+}
+
+uint32_t LTC2946_Scheduler::Code(uint8_t index, Channel channel)
+{
+    if(index >= count || channel >= CHANNEL_COUNT) return(0);
+    return(slots[index].code[channel]);
+}
+
+bool LTC2946_Scheduler::Error(uint8_t index){return(index < count ? slots[index].error : true);}
+float LTC2946_Scheduler::Rate(uint8_t index){return(index < count ? slots[index].rate : 0);}
+uint32_t LTC2946_Scheduler::Polls(uint8_t index){return(index < count ? slots[index].polls : 0);}
+float LTC2946_Scheduler::Budget(){return(budget);}
+uint8_t LTC2946_Scheduler::Devices(){return(count);}
+
+float LTC2946_Scheduler::PollTime(uint32_t bus_hz, bool check_faults)
+{
+    //ReadAll: register pointer, then 37 bytes; STATUS1/FAULT1: register pointer, then 2 bytes
+    uint32_t ns = LTC2946_transaction_ns(1, LTC2946_ADIN_LSB_REG_REG - LTC2946_POWER_MSB2_REG + 1, bus_hz);
+    if(check_faults) ns += LTC2946_transaction_ns(1, 2, bus_hz);
+    return(ns*1e-9f);
+}
@@ -0,0 +1,113 @@
+/*!
+LTC2946 Scheduler
+
+Adaptive polling of several LTC2946s sharing a bus. Each device is polled between a minimum and a
+maximum rate: quiet rails drop toward the minimum, rails whose codes are moving (or that raised a
+fault) climb toward the maximum. The sum of all rates is kept within a bus budget, so bandwidth is
+moved to the rails that need it instead of being spent evenly.
+
+Activity is a running average of the largest change of the VIN or delta sense code between polls.
+Below the quiet level (noise) it earns nothing above the minimum rate, at the busy level it earns the
+maximum rate. A fault (FAULT1 read after every poll when
+CheckFaults is on, or Alert() from an ALERT pin interrupt) holds the device at its maximum rate for
+SetAlertHold() microseconds.
+
+Budget: one poll is a ReadAll burst (plus a STATUS1/FAULT1 read when checking faults). PollTime()
+models its duration with the library's bus time model (LTC2946_transaction_ns) at the clock the
+devices' bus reports (ClockHz, set by Configure), and the constructor's utilization sets the
+fraction of the bus the scheduler may use.
+
+    LTC2946_Scheduler scheduler(0.5);               //Use at most half of the bus
+    scheduler.Add(LTC2946_A, 1, 500);               //1 to 500 polls per second
+    scheduler.Add(LTC2946_B, 1, 500);
+    void loop(){
+        int8_t polled = scheduler.Update(micros());
+        if(polled >= 0) Serial.println(scheduler.Code(polled, LTC2946_Scheduler::CURRENT));
+    }
+*/
+
+#ifndef LTC2946_SCHEDULER_H
+#define LTC2946_SCHEDULER_H
+
+#include <stdint.h>
+#include "LTC2946.h"
+
+#define LTC2946_SCHEDULER_MAX_DEVICES   16
+
+class LTC2946_Scheduler {
+public:
+    //! Channels for Code()
+    enum Channel
+    {
+        VIN = 0,
+        CURRENT = 1,
+        POWER = 2,
+        ADIN = 3,
+        CHANNEL_COUNT = 4
+    };
+
+    LTC2946_Scheduler(float utilization = 0.5       //! <Fraction of the bus polls may occupy>
+                      );
+
+    //! Add a device polled between min_rate and max_rate (polls per second). The first device's bus
+    //! gives the clock for the budget; all devices are expected on that bus.
+    //! @return index of the device, -1 if full or the rates are invalid
+    int8_t Add(LTC2946 &device, float min_rate, float max_rate);
+
+    //! Average code change per poll treated as noise (default 2) and that earns the maximum rate (default 16)
+    void SetActivity(uint16_t quiet_codes, uint16_t busy_codes);
+    void SetAlertHold(uint32_t hold_us); //! <Time a fault keeps a device at its maximum rate (default 1s)>
+    void CheckFaults(bool state); //! <Read and clear FAULT1 after every poll (default off)>
+    void SetBudget(float polls_per_second); //! <Override the budget computed from the bus clock and utilization>
+
+    //! Raise a device to its maximum rate, e.g. from an ALERT pin interrupt
+    void Alert(uint8_t index, uint32_t now_us);
+
+    //! Poll the most overdue device, if any is due. Call as often as possible.
+    //! @return index of the device polled, -1 if none was due
+    int8_t Update(uint32_t now_us);
+
+    uint32_t Code(uint8_t index, Channel channel); //! <RAW code of the last poll of a device>
+    bool Error(uint8_t index); //! <Last poll of a device was not acknowledged>
+    float Rate(uint8_t index); //! <Current poll rate of a device in polls per second>
+    uint32_t Polls(uint8_t index); //! <Number of polls of a device>
+    float Budget(); //! <Total polls per second allowed>
+    uint8_t Devices(); //! <Number of devices added>
+
+    //! Modeled bus time of one poll in seconds: ReadAll burst of 37 registers, plus the 2 register status read if
+    //! check_faults. bus_hz 0 = LTC2946_BUS_DEFAULT_HZ
+    static float PollTime(uint32_t bus_hz, bool check_faults);
+
+private:
+    struct Slot
+    {
+        LTC2946 *device;
+        float min_rate;
+        float max_rate;
+        float rate;
+        uint32_t next_poll;
+        uint32_t alert_until;
+        uint32_t polls;
+        uint32_t code[CHANNEL_COUNT];
+        uint16_t activity;      //running average of the code change, 1/16 codes
+        bool alert;
+        bool error;
+        bool primed;
+    };
+
+    void Allocate(); //split the budget between the devices
+    void Rebudget(); //budget from the bus clock, unless SetBudget gave one
+
+    Slot slots[LTC2946_SCHEDULER_MAX_DEVICES];
+    uint8_t count = 0;
+    uint32_t bus_hz = 0;
+    float utilization;
+    float budget;
+    bool budget_set = false;
+    uint16_t activity_quiet = 2;
+    uint16_t activity_busy = 16;
+    uint32_t alert_hold = 1000000;
+    bool check_faults = false;
+};
+
+#endif  // LTC2946_SCHEDULER_H
@@ -0,0 +1,261 @@
+/*!
+LTC2946 Shared Bus
+
+Bus ownership and transaction queue. See LTC2946_SharedBus.h.
+*/
+
+#include <stdint.h>
+#include "LTC2946_SharedBus.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+LTC2946_SharedBus::LTC2946_SharedBus(LTC2946_Bus &bus) //!constructor
+    : bus(bus)
+{
+}
+
+int8_t LTC2946_SharedBus::Begin()
+{
+    int8_t ack = 0;
+
+    Lock();
+    if(!started)
+    {
+        ack = bus.Begin();
+        started = (ack == 0);
+    }
+    Unlock();
+    return(ack);
+}
+
+int8_t LTC2946_SharedBus::Configure(const LTC2946_BusConfig &config)
+// Owns the bus meanwhile, so the clock never changes in the middle of a transaction.
+{
+    Lock();
+#if defined(ARDUINO)
+    if(busy)
+    {
+        Unlock();
+        return(LTC2946_SHAREDBUS_BUSY);
+    }
+#else
+    while(busy) changed.wait(mutex);
+#endif
+    busy = true;
+    Unlock();
+
+    int8_t ack = bus.Configure(config);
+
+    Lock();
+    busy = false;
+    Notify();
+    Unlock();
+    return(ack);
+}
+
+uint32_t LTC2946_SharedBus::ClockHz()
+{
+    return(bus.ClockHz());
+}
+
+int8_t LTC2946_SharedBus::Transfer(uint8_t priority, uint8_t address, const uint8_t *write_data, uint8_t write_length,
+                                   uint8_t *read_data, uint8_t read_length)
+// The transaction lives on this stack; Drain does not touch it after marking it done.
+{
+    LTC2946_Transaction t = {address, write_data, write_length, read_data, read_length, priority, 0, 0,
+                             LTC2946_TRANSACTION_IDLE, 0, 0};
+
+    Lock();
+#if defined(ARDUINO)
+    //! 1) Only an interrupt handler can find the bus owned, and it cannot wait for the code it interrupted
+    if(busy)
+    {
+        Unlock();
+        return(LTC2946_SHAREDBUS_BUSY);
+    }
+    if(!Enqueue(&t))
+    {
+        Unlock();
+        return(LTC2946_SHAREDBUS_FULL);
+    }
+    busy = true;
+    Unlock();
+
+    //! 2) Run the queue up to this transaction; what is queued behind it waits for Poll
+    Drain(&t);
+    Lock();
+    busy = false;
+    Unlock();
+#else
+    //! 1) Queue it, waiting for space if needed
+    while(!Enqueue(&t)) changed.wait(mutex);
+
+    //! 2) Until it has run: own the bus and run the queue up to it, or wait for the owner to run it.
+    //!    The owner hands the bus over once its own transaction is done, so one Transfer never runs
+    //!    the transactions other threads keep queueing behind it
+    while(t.state != LTC2946_TRANSACTION_DONE)
+    {
+        if(!busy)
+        {
+            busy = true;
+            Unlock();
+            Drain(&t);
+            Lock();
+            busy = false;
+            Notify();
+        }
+        else
+        {
+            changed.wait(mutex);
+        }
+    }
+    Unlock();
+#endif
+
+    return(t.ack);
+}
+
+bool LTC2946_SharedBus::Submit(LTC2946_Transaction *transaction)
+{
+    Lock();
+    bool queued_ok = transaction->state != LTC2946_TRANSACTION_PENDING && Enqueue(transaction);
+    Unlock();
+    return(queued_ok);
+}
+
+uint16_t LTC2946_SharedBus::Poll()
+{
+    Lock();
+    if(busy)
+    {
+        Unlock();
+        return(0);
+    }
+    busy = true;
+    Unlock();
+
+    uint16_t count = Drain();
+
+    Lock();
+    busy = false;
+    Notify();
+    Unlock();
+    return(count);
+}
+
+uint8_t LTC2946_SharedBus::Pending(){return(queued);}
+uint32_t LTC2946_SharedBus::Completed(){return(completed);}
+uint32_t LTC2946_SharedBus::Contended(){return(contended);}
+
+bool LTC2946_SharedBus::Enqueue(LTC2946_Transaction *transaction)
+// Called locked.
+{
+    if(queued >= LTC2946_SHAREDBUS_QUEUE) return(false);
+    if(busy) contended++;
+
+    if(transaction->priority >= LTC2946_PRIORITY_LEVELS) transaction->priority = LTC2946_PRIORITY_LEVELS - 1;
+    transaction->state = LTC2946_TRANSACTION_PENDING;
+    transaction->sequence = sequence++;
+    queue[queued++] = transaction;
+    return(true);
+}
+
+LTC2946_Transaction *LTC2946_SharedBus::Dequeue()
+// Called locked. Highest priority, oldest first; the queue is short, so a scan beats keeping it sorted.
+{
+    if(queued == 0) return(0);
+
+    uint8_t best = 0;
+    for(uint8_t i = 1; i < queued; i++)
+    {
+        LTC2946_Transaction *a = queue[i], *b = queue[best];
+        if(a->priority < b->priority || (a->priority == b->priority && (int32_t)(a->sequence - b->sequence) < 0)) best = i;
+    }
+
+    LTC2946_Transaction *transaction = queue[best];
+    queue[best] = queue[--queued];
+    return(transaction);
+}
+
+uint16_t LTC2946_SharedBus::Drain(const LTC2946_Transaction *own)
+// Called unlocked by the owner of the bus. Stops after own (compared, never dereferenced: it may be
+// gone once done) or when the queue is empty.
+{
+    uint16_t count = 0;
+
+    for(;;)
+    {
+        Lock();
+        LTC2946_Transaction *t = Dequeue();
+        Unlock();
+        if(t == 0) break;
+
+        int8_t ack = bus.Transfer(t->address, t->write_data, t->write_length, t->read_data, t->read_length);
+        void (*done)(LTC2946_Transaction *transaction) = t->done;
+
+        //A blocking caller may return as soon as its transaction is done, so t is not used after that
+        Lock();
+        t->ack = ack;
+        t->state = LTC2946_TRANSACTION_DONE;
+        completed++;
+        Notify();
+        Unlock();
+
+        if(done != 0) done(t);
+        count++;
+        if(t == own) break;
+    }
+    return(count);
+}
+
+#if defined(ARDUINO)
+void LTC2946_SharedBus::Lock()
+// Submit may be called with interrupts already off (from a handler's own critical section), so the
+// previous PRIMASK is kept and restored rather than interrupts enabled. Locks never nest.
+{
+    uint32_t primask;
+    __asm__ volatile("mrs %0, primask\n" : "=r" (primask) :: "memory");
+    __disable_irq();
+    saved_primask = primask;
+}
+
+void LTC2946_SharedBus::Unlock()
+{
+    uint32_t primask = saved_primask;
+    __asm__ volatile("msr primask, %0\n" :: "r" (primask) : "memory");
+}
+
+void LTC2946_SharedBus::Notify(){}
+#else
+void LTC2946_SharedBus::Lock(){mutex.lock();}
+void LTC2946_SharedBus::Unlock(){mutex.unlock();}
+void LTC2946_SharedBus::Notify(){changed.notify_all();}
+#endif
+
+LTC2946_BusPort::LTC2946_BusPort(LTC2946_SharedBus &shared, uint8_t priority) //!constructor
+    : shared(shared), priority(priority)
+{
+}
+
+int8_t LTC2946_BusPort::Begin()
+{
+    return(shared.Begin());
+}
+
+int8_t LTC2946_BusPort::Transfer(uint8_t address, const uint8_t *write_data, uint8_t write_length,
+                                 uint8_t *read_data, uint8_t read_length)
+{
+    return(shared.Transfer(priority, address, write_data, write_length, read_data, read_length));
+}
+
+int8_t LTC2946_BusPort::Configure(const LTC2946_BusConfig &config)
+{
+    return(shared.Configure(config));
+}
+
+uint32_t LTC2946_BusPort::ClockHz()
+{
+    return(shared.ClockHz());
+}
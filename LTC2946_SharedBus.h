@@ -0,0 +1,149 @@
+/*!
+LTC2946 Shared Bus
+
+Bus ownership for several LTC2946 objects (and other drivers) on one bus. Without it, two users of
+the same Wire interleave beginTransmission/requestFrom, and a reader in an interrupt corrupts the
+transaction the loop was in the middle of.
+
+Every transaction goes through one queue per bus. Whoever owns the bus runs the queue, highest
+priority first, first come first served within a priority:
+    LTC2946_PRIORITY_ALERT      alert servicing
+    LTC2946_PRIORITY_SAMPLE     periodic sampling
+    LTC2946_PRIORITY_CONFIG     configuration
+
+Blocking use: an LTC2946_BusPort is an LTC2946_Bus at one priority; give it to the LTC2946 objects.
+Transfer queues the transaction and returns once it has run, running the queue itself if the bus is
+free: everything ahead of it in queue order, then its own, then it hands the bus over. Non-blocking
+use: Submit queues an LTC2946_Transaction and returns at once; it runs when a blocking Transfer
+finds it ahead of its own, or at the next Poll (which empties the queue), then done() is called
+from there.
+
+Host (threads): a mutex and condition variable; threads wait for the bus and one of them runs it.
+Teensy (interrupts): the queue is guarded by disabling interrupts for a few instructions, restoring
+the previous interrupt mask afterwards, so Submit is safe inside a critical section too. The loop
+owns the bus; interrupt handlers must only Submit (a blocking Transfer from an interrupt that
+finds the bus owned returns LTC2946_SHAREDBUS_BUSY instead of waiting), and the loop calls Poll.
+
+    LTC2946_SharedBus shared(*LTC2946_platform_bus(0));
+    LTC2946_BusPort sampling(shared, LTC2946_PRIORITY_SAMPLE);
+    LTC2946 rail_12v(sampling, 0x6F);
+    LTC2946 rail_5v(sampling, 0x6A);
+
+    uint8_t alert_response[1];
+    LTC2946_Transaction alert = {0x0C, 0, 0, alert_response, 1, LTC2946_PRIORITY_ALERT, on_response, 0,
+                                 LTC2946_TRANSACTION_IDLE, 0, 0};
+    void on_alert(){ shared.Submit(&alert); }     //ALERT pin interrupt
+    void loop(){ shared.Poll(); ... }
+*/
+
+#ifndef LTC2946_SHAREDBUS_H
+#define LTC2946_SHAREDBUS_H
+
+#include <stdint.h>
+#include "LTC2946_Bus.h"
+
+#if !defined(ARDUINO)
+#include <mutex>
+#include <condition_variable>
+#endif
+
+#define LTC2946_PRIORITY_ALERT          0
+#define LTC2946_PRIORITY_SAMPLE         1
+#define LTC2946_PRIORITY_CONFIG         2
+#define LTC2946_PRIORITY_LEVELS         3
+
+#define LTC2946_SHAREDBUS_QUEUE         16      //!< Pending transactions per bus
+#define LTC2946_SHAREDBUS_BUSY          2       //!< Transfer result: bus owned by the code this interrupted
+#define LTC2946_SHAREDBUS_FULL          3       //!< Transfer result: queue full
+
+//! Transaction states
+#define LTC2946_TRANSACTION_IDLE        0
+#define LTC2946_TRANSACTION_PENDING     1
+#define LTC2946_TRANSACTION_DONE        2
+
+//! One queued transaction. The caller owns it and the data it points to until it is done.
+struct LTC2946_Transaction
+{
+    uint8_t address;                                    //!< 7-bit
+    const uint8_t *write_data;
+    uint8_t write_length;
+    uint8_t *read_data;
+    uint8_t read_length;
+    uint8_t priority;                                   //!< LTC2946_PRIORITY_*
+    void (*done)(LTC2946_Transaction *transaction);     //!< Called after it ran, may Submit it again. 0 = none
+    void *context;                                      //!< For done()
+    volatile uint8_t state;                             //!< LTC2946_TRANSACTION_*
+    int8_t ack;                                         //!< Transfer() result, valid when done
+    uint32_t sequence;                                  //!< Queue order, set by the bus
+};
+
+class LTC2946_SharedBus {
+public:
+    LTC2946_SharedBus(LTC2946_Bus &bus //! <Bus to arbitrate, used only through this object afterwards>
+                      );
+
+    int8_t Begin(); //! <Begin the underlying bus once>
+
+    //! Configure the underlying bus between transactions. @return its result, or LTC2946_SHAREDBUS_BUSY
+    //! from an interrupt that finds the bus owned
+    int8_t Configure(const LTC2946_BusConfig &config);
+    uint32_t ClockHz(); //! <Clock of the underlying bus>
+
+    //! Queue a transaction and wait until it ran. @return its ack, LTC2946_SHAREDBUS_BUSY or LTC2946_SHAREDBUS_FULL
+    int8_t Transfer(uint8_t priority, uint8_t address,
+                    const uint8_t *write_data, uint8_t write_length,
+                    uint8_t *read_data, uint8_t read_length);
+
+    //! Queue a transaction without waiting. Safe from interrupts. @return false if the queue is full
+    //! or the transaction is already pending
+    bool Submit(LTC2946_Transaction *transaction);
+
+    //! Run the queued transactions if the bus is free. @return transactions run
+    uint16_t Poll();
+
+    uint8_t Pending(); //! <Transactions queued>
+    uint32_t Completed(); //! <Transactions run>
+    uint32_t Contended(); //! <Transactions queued while the bus was owned>
+
+private:
+    bool Enqueue(LTC2946_Transaction *transaction);
+    LTC2946_Transaction *Dequeue();
+    uint16_t Drain(const LTC2946_Transaction *own = 0);
+    void Lock();
+    void Unlock();
+    void Notify();
+
+    LTC2946_Bus &bus;
+    LTC2946_Transaction *queue[LTC2946_SHAREDBUS_QUEUE];
+    volatile uint8_t queued = 0;
+    volatile bool busy = false;
+    bool started = false;
+    uint32_t sequence = 0;
+    uint32_t completed = 0;
+    uint32_t contended = 0;
+#if defined(ARDUINO)
+    uint32_t saved_primask = 0;                 //Interrupt mask from before Lock
+#else
+    std::mutex mutex;
+    std::condition_variable_any changed;        //Transaction done, bus released or queue space freed
+#endif
+};
+
+//! LTC2946_Bus at one priority of a shared bus, for LTC2946(port, address)
+class LTC2946_BusPort : public LTC2946_Bus {
+public:
+    LTC2946_BusPort(LTC2946_SharedBus &shared, uint8_t priority = LTC2946_PRIORITY_SAMPLE); //!constructor
+
+    int8_t Begin();
+    int8_t Transfer(uint8_t address,
+                    const uint8_t *write_data, uint8_t write_length,
+                    uint8_t *read_data, uint8_t read_length);
+    int8_t Configure(const LTC2946_BusConfig &config); //! <Configures the shared bus, for every port>
+    uint32_t ClockHz();
+
+private:
+    LTC2946_SharedBus &shared;
+    uint8_t priority;
+};
+
+#endif  // LTC2946_SHAREDBUS_H
@@ -0,0 +1,566 @@
+/*!
+LTC2946 Simulated Bus
+
+Behavioural model of LTC2946s on a simulated clock. See LTC2946_SimBus.h.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "LTC2946_SimBus.h"
+
+#define SIM_NONE    0xFFFFFFFFFFFFFFFFULL   //no pending event
+
+// Load a big endian register value of bytes length
+static uint32_t sim_load(const uint8_t *reg, uint8_t bytes)
+{
+    uint32_t value = 0;
+    for(uint8_t i = 0; i < bytes; i++) value = (value << 8) | reg[i];
+    return(value);
+}
+
+// Store a big endian register value of bytes length
+static void sim_store(uint8_t *reg, uint8_t bytes, uint32_t value)
+{
+    for(uint8_t i = bytes; i > 0; i--)
+    {
+        reg[i - 1] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+LTC2946_SimBus::LTC2946_SimBus(uint32_t bus_hz) //!constructor
+    : bus_hz(bus_hz)
+{
+}
+
+bool LTC2946_SimBus::AddDevice(uint8_t address)
+{
+    if(device_count >= LTC2946_SIMBUS_MAX_DEVICES || Find(address) != 0) return(false);
+    if(address == LTC2946_SIM_MASS_WRITE || address == LTC2946_SIM_ALERT_RESPONSE) return(false);
+
+    Device &d = devices[device_count++];
+    memset(&d, 0, sizeof(d));
+    d.address = address;
+    PowerOn(d);
+    return(true);
+}
+
+bool LTC2946_SimBus::SetInputs(uint8_t address, uint16_t sense_code, uint16_t vdd_code, uint16_t sense_plus_code, uint16_t adin_code)
+{
+    Device *d = Find(address);
+    if(d == 0) return(false);
+
+    d->sense = sense_code & 0xFFF;
+    d->vdd = vdd_code & 0xFFF;
+    d->sense_plus = sense_plus_code & 0xFFF;
+    d->adin = adin_code & 0xFFF;
+    return(true);
+}
+
+bool LTC2946_SimBus::SetExternalClock(uint8_t address, uint32_t clk_hz)
+{
+    Device *d = Find(address);
+    if(d == 0) return(false);
+
+    d->ext_clk_hz = clk_hz;
+    UpdateTimeBase(*d);
+    return(true);
+}
+
+bool LTC2946_SimBus::SetAccPin(uint8_t address, bool high)
+{
+    Device *d = Find(address);
+    if(d == 0) return(false);
+
+    d->acc_pin = high;
+    return(true);
+}
+
+bool LTC2946_SimBus::AlertPin(uint8_t address)
+{
+    Device *d = Find(address);
+    return(d ? d->alert : false);
+}
+
+uint8_t LTC2946_SimBus::Register(uint8_t address, uint8_t reg)
+{
+    Device *d = Find(address);
+    return(d ? Read(*d, reg) : 0);
+}
+
+void LTC2946_SimBus::SetBusClock(uint32_t hz){bus_hz = hz;}
+
+void LTC2946_SimBus::SetConversionTimes(uint32_t sense_ns, uint32_t voltage_ns)
+{
+    sense_time = sense_ns;
+    voltage_time = voltage_ns;
+}
+
+int8_t LTC2946_SimBus::Configure(const LTC2946_BusConfig &config)
+{
+    SetBusClock(config.rate_hz);
+    return(0);
+}
+
+uint32_t LTC2946_SimBus::ClockHz(){return(bus_hz);}
+
+void LTC2946_SimBus::Advance(uint64_t ns){Run(now + ns);}
+uint64_t LTC2946_SimBus::Now(){return(now);}
+
+int8_t LTC2946_SimBus::Transfer(uint8_t address, const uint8_t *write_data, uint8_t write_length, uint8_t *read_data, uint8_t read_length)
+// Returns 1 (no acknowledge) when no device answers at address, like a real bus.
+{
+    transactions++;
+    bytes_written += write_length;
+    bytes_read += read_length;
+
+    Bits(10);   //START, address
+
+    //! 1) Mass write: every device takes the write, nobody answers reads (or anything, with no device)
+    if(address == LTC2946_SIM_MASS_WRITE)
+    {
+        if(read_length > 0 || write_length == 0 || device_count == 0)
+        {
+            memset(read_data, 0xFF, read_length);
+            Bits(1);
+            return(1);
+        }
+        bool ctrla = false, ctrlb = false, acc = false, clk = false;
+        uint8_t pointer = write_data[0];     //The same on every device
+        for(uint8_t i = 0; i < device_count; i++) devices[i].pointer = pointer;
+        Bits(9);
+        for(uint8_t b = 1; b < write_length; b++)
+        {
+            uint8_t reg = pointer++;
+            ctrla |= reg == LTC2946_CTRLA_REG;
+            ctrlb |= reg == LTC2946_CTRLB_REG;
+            acc |= reg >= LTC2946_TIME_COUNTER_MSB3_REG && reg <= LTC2946_ENERGY_LSB_REG;
+            clk |= reg == LTC2946_CLK_DIV_REG;
+            for(uint8_t i = 0; i < device_count; i++) Write(devices[i], devices[i].pointer++, write_data[b]);
+            Bits(9);
+        }
+        for(uint8_t i = 0; i < device_count; i++) AfterWrite(devices[i], ctrla, ctrlb, acc, clk);
+        Bits(1);
+        return(0);
+    }
+
+    //! 2) Alert response: lowest alerting address wins arbitration and releases ALERT
+    if(address == LTC2946_SIM_ALERT_RESPONSE)
+    {
+        Device *alerting = 0;
+        for(uint8_t i = 0; i < device_count; i++)
+        {
+            if(devices[i].alert && (alerting == 0 || devices[i].address < alerting->address)) alerting = &devices[i];
+        }
+        memset(read_data, 0xFF, read_length);
+        if(write_length > 0 || read_length == 0 || alerting == 0)
+        {
+            Bits(1);
+            return(1);
+        }
+        read_data[0] = alerting->address << 1;
+        alerting->alert = false;
+        Bits(9*read_length + 1);
+        return(0);
+    }
+
+    //! 3) Register access
+    Device *d = Find(address);
+    if(d == 0)
+    {
+        memset(read_data, 0xFF, read_length);
+        Bits(1);
+        return(1);
+    }
+
+    if(write_length > 0)
+    {
+        bool ctrla = false, ctrlb = false, acc = false, clk = false;
+        d->pointer = write_data[0];
+        Bits(9);
+        for(uint8_t b = 1; b < write_length; b++)
+        {
+            uint8_t reg = d->pointer++;
+            ctrla |= reg == LTC2946_CTRLA_REG;
+            ctrlb |= reg == LTC2946_CTRLB_REG;
+            acc |= reg >= LTC2946_TIME_COUNTER_MSB3_REG && reg <= LTC2946_ENERGY_LSB_REG;
+            clk |= reg == LTC2946_CLK_DIV_REG;
+            Write(*d, reg, write_data[b]);
+            Bits(9);
+        }
+        AfterWrite(*d, ctrla, ctrlb, acc, clk);
+    }
+
+    if(read_length > 0)
+    {
+        bool read_acc = false, read_fault1 = false, read_fault2 = false;
+        if(write_length > 0) Bits(10);  //Repeated START, address
+        for(uint8_t b = 0; b < read_length; b++)
+        {
+            uint8_t reg = d->pointer++;
+            read_acc |= reg >= LTC2946_TIME_COUNTER_MSB3_REG && reg <= LTC2946_ENERGY_LSB_REG;
+            read_fault1 |= reg == LTC2946_FAULT1_REG;
+            read_fault2 |= reg == LTC2946_FAULT2_REG;
+            read_data[b] = Read(*d, reg);     //Byte is latched, then clocked out
+            Bits(9);
+        }
+
+        uint8_t ctrlb = d->reg[LTC2946_CTRLB_REG];
+        if(read_acc && (ctrlb & ~LTC2946_CTRLB_RESET_MASK) == LTC2946_ENABLE_AUTO_RESET)
+        {
+            memset(&d->reg[LTC2946_TIME_COUNTER_MSB3_REG], 0, LTC2946_ENERGY_LSB_REG - LTC2946_TIME_COUNTER_MSB3_REG + 1);
+            d->charge = 0;
+            d->energy = 0;
+        }
+        if(ctrlb & LTC2946_ENABLE_CLEARED_ON_READ)
+        {
+            if(read_fault1) d->reg[LTC2946_FAULT1_REG] = 0;
+            if(read_fault2) d->reg[LTC2946_FAULT2_REG] = 0;
+        }
+    }
+
+    Bits(1);    //STOP
+    return(0);
+}
+
+uint32_t LTC2946_SimBus::Transactions(){return(transactions);}
+uint32_t LTC2946_SimBus::BytesWritten(){return(bytes_written);}
+uint32_t LTC2946_SimBus::BytesRead(){return(bytes_read);}
+uint64_t LTC2946_SimBus::BusTime(){return(bus_time);}
+
+void LTC2946_SimBus::ResetCounters()
+{
+    transactions = 0;
+    bytes_written = 0;
+    bytes_read = 0;
+    bus_time = 0;
+}
+
+LTC2946_SimBus::Device *LTC2946_SimBus::Find(uint8_t address)
+{
+    for(uint8_t i = 0; i < device_count; i++)
+    {
+        if(devices[i].address == address) return(&devices[i]);
+    }
+    return(0);
+}
+
+void LTC2946_SimBus::PowerOn(Device &d)
+{
+    //Power-on values from the register map: MIN registers and MAX thresholds at full scale so nothing alerts
+    for(uint8_t i = 0; i < LTC2946_Map::REGISTER_COUNT; i++)
+    {
+        const LTC2946_Register &r = LTC2946_Map::REGISTERS[i];
+        sim_store(&d.reg[r.address], r.width, r.reset);
+    }
+
+    d.alert = false;
+    d.charge = 0;
+    d.energy = 0;
+    d.converting = CONVERT_NONE;
+    d.snapshot = false;
+    d.step = 0;
+    UpdateTimeBase(d);
+    StartConversion(d);
+}
+
+void LTC2946_SimBus::Run(uint64_t until)
+{
+    //! Process conversion ends and time counter ticks of all devices in time order
+    for(;;)
+    {
+        Device *next = 0;
+        uint64_t when = SIM_NONE;
+        bool tick = false;
+
+        for(uint8_t i = 0; i < device_count; i++)
+        {
+            Device &d = devices[i];
+            if(d.converting != CONVERT_NONE && d.conversion_end < when)
+            {
+                next = &d;
+                when = d.conversion_end;
+                tick = false;
+            }
+            uint64_t tick_at = d.tick_epoch + (uint64_t)((double)(d.ticks + 1)*d.tick_ns);
+            if(tick_at < when)
+            {
+                next = &d;
+                when = tick_at;
+                tick = true;
+            }
+        }
+
+        if(next == 0 || when > until) break;
+
+        now = when;
+        if(tick) Tick(*next);
+        else Complete(*next);
+    }
+
+    now = until;
+}
+
+void LTC2946_SimBus::Bits(uint32_t bits)
+{
+    if(bus_hz == 0) return;
+
+    uint64_t ns = (uint64_t)bits*1000000000ULL/bus_hz;
+    bus_time += ns;
+    Run(now + ns);
+}
+
+void LTC2946_SimBus::StartConversion(Device &d)
+{
+    uint8_t config = d.reg[LTC2946_CTRLA_REG] & ~LTC2946_CTRLA_CHANNEL_CONFIG_MASK;
+
+    d.snapshot = false;
+    if((d.reg[LTC2946_CTRLB_REG] & LTC2946_ENABLE_SHUTDOWN) || config == LTC2946_CHANNEL_CONFIG_SNAPSHOT)
+    {
+        d.converting = CONVERT_NONE;
+        return;
+    }
+
+    //Channel at this step of the sequence (see model assumptions in the header)
+    uint8_t channel = CONVERT_SENSE;
+    switch(config)
+    {
+        case LTC2946_CHANNEL_CONFIG_V_C_3:
+        case LTC2946_CHANNEL_CONFIG_V_C:
+            channel = (d.step % 2 == 0) ? CONVERT_VIN : CONVERT_SENSE;
+            break;
+        case LTC2946_CHANNEL_CONFIG_V_C_2:
+            channel = (d.step == 0) ? CONVERT_VIN : CONVERT_SENSE;
+            break;
+        case LTC2946_CHANNEL_CONFIG_V_C_1:
+            channel = (d.step % 128 == 0) ? CONVERT_VIN : CONVERT_SENSE;
+            break;
+        case LTC2946_CHANNEL_CONFIG_A_V_C_3:
+            channel = (d.step % 3 == 0) ? CONVERT_ADIN : (d.step % 3 == 1) ? CONVERT_VIN : CONVERT_SENSE;
+            break;
+        case LTC2946_CHANNEL_CONFIG_A_V_C_2:
+            channel = (d.step % 32 == 0) ? CONVERT_ADIN : (d.step % 32 == 1) ? CONVERT_VIN : CONVERT_SENSE;
+            break;
+        case LTC2946_CHANNEL_CONFIG_A_V_C_1:
+            channel = (d.step % 256 == 0) ? CONVERT_ADIN : (d.step % 256 == 1) ? CONVERT_VIN : CONVERT_SENSE;
+            break;
+    }
+
+    d.converting = channel;
+    d.conversion_end = now + ((channel == CONVERT_SENSE) ? sense_time : voltage_time);
+}
+
+void LTC2946_SimBus::Complete(Device &d)
+{
+    uint8_t ctrla = d.reg[LTC2946_CTRLA_REG];
+
+    //! 1) Result of the finished conversion
+    if(d.converting == CONVERT_SENSE)
+    {
+        Measure(d, LTC2946_DELTA_SENSE_MSB_REG, 2, d.sense, LTC2946_FAULT1_MAX_I_SENSE, LTC2946_FAULT1_MIN_I_SENSE);
+        if(!d.snapshot)
+        {
+            //Power multiplies each new delta sense result with the VIN register
+            uint32_t vin = sim_load(&d.reg[LTC2946_VIN_MSB_REG], 2) >> 4;
+            Measure(d, LTC2946_POWER_MSB2_REG, 3, vin*d.sense, LTC2946_FAULT1_MAX_POWER, LTC2946_FAULT1_MIN_POWER);
+        }
+    }
+    else if(d.converting == CONVERT_VIN)
+    {
+        uint8_t source = ctrla & ~LTC2946_CTRLA_VOLTAGE_SEL_MASK;
+        uint16_t code = (source == LTC2946_VDD) ? d.vdd : (source == LTC2946_ADIN) ? d.adin : d.sense_plus;
+        Measure(d, LTC2946_VIN_MSB_REG, 2, code, LTC2946_FAULT1_MAX_VIN, LTC2946_FAULT1_MIN_VIN);
+    }
+    else if(d.converting == CONVERT_ADIN)
+    {
+        Measure(d, LTC2946_ADIN_MSB_REG, 2, d.adin, LTC2946_FAULT1_MAX_ADIN, LTC2946_FAULT1_MIN_ADIN);
+    }
+
+    //! 2) Every finished conversion latches ADC done
+    Latch(d, LTC2946_FAULT2_REG, LTC2946_FAULT2_ADC_DONE);
+
+    //! 3) Snapshot ends, continuous modes move to the next channel
+    if(d.snapshot)
+    {
+        d.converting = CONVERT_NONE;
+        d.snapshot = false;
+        return;
+    }
+
+    uint8_t config = ctrla & ~LTC2946_CTRLA_CHANNEL_CONFIG_MASK;
+    if(config == LTC2946_CHANNEL_CONFIG_V_C_2) d.step = 1;
+    else d.step = (uint16_t)((d.step + 1) % 768);   //768 is a multiple of every sequence length
+    StartConversion(d);
+}
+
+void LTC2946_SimBus::Measure(Device &d, uint8_t value_reg, uint8_t bytes, uint32_t code, uint8_t over, uint8_t under)
+// Store a result and update its MAX/MIN, STATUS1 and FAULT1. Registers follow as value, MAX, MIN,
+// MAX threshold, MIN threshold, each bytes long. 12-bit values are left justified in 2 bytes.
+{
+    uint8_t shift = (bytes == 2) ? 4 : 0;
+    uint8_t *r = &d.reg[value_reg];
+
+    sim_store(r, bytes, code << shift);
+    if(code > sim_load(r + bytes, bytes) >> shift) sim_store(r + bytes, bytes, code << shift);
+    if(code < sim_load(r + 2*bytes, bytes) >> shift) sim_store(r + 2*bytes, bytes, code << shift);
+
+    uint8_t status = 0;
+    if(code > sim_load(r + 3*bytes, bytes) >> shift) status |= over;
+    if(code < sim_load(r + 4*bytes, bytes) >> shift) status |= under;
+
+    d.reg[LTC2946_STATUS1_REG] = (d.reg[LTC2946_STATUS1_REG] & ~(over | under)) | status;
+    if(status) Latch(d, LTC2946_FAULT1_REG, status);
+}
+
+void LTC2946_SimBus::Latch(Device &d, uint8_t fault_reg, uint8_t bits)
+{
+    uint8_t enabled = d.reg[(fault_reg == LTC2946_FAULT1_REG) ? LTC2946_ALERT1_REG : LTC2946_ALERT2_REG];
+    uint8_t fresh = bits & ~d.reg[fault_reg];
+
+    d.reg[fault_reg] |= bits;
+    if(fresh & enabled) d.alert = true;
+}
+
+void LTC2946_SimBus::Tick(Device &d)
+{
+    d.ticks++;
+    if(!Accumulating(d)) return;
+
+    uint32_t time = sim_load(&d.reg[LTC2946_TIME_COUNTER_MSB3_REG], 4) + 1;
+    if(time == 0) Latch(d, LTC2946_FAULT2_REG, LTC2946_FAULT2_COUNTER_OVERFLOW);
+
+    //16 fraction bits: charge adds delta sense/16, energy adds power/65536 per tick
+    d.charge += (uint64_t)(sim_load(&d.reg[LTC2946_DELTA_SENSE_MSB_REG], 2) >> 4) << 12;
+    d.energy += sim_load(&d.reg[LTC2946_POWER_MSB2_REG], 3);
+    if(d.charge >> 48)
+    {
+        d.charge &= 0xFFFFFFFFFFFFULL;
+        Latch(d, LTC2946_FAULT2_REG, LTC2946_FAULT2_CHARGE_OVERFLOW);
+    }
+    if(d.energy >> 48)
+    {
+        d.energy &= 0xFFFFFFFFFFFFULL;
+        Latch(d, LTC2946_FAULT2_REG, LTC2946_FAULT2_ENERGY_OVERFLOW);
+    }
+
+    sim_store(&d.reg[LTC2946_TIME_COUNTER_MSB3_REG], 4, time);
+    StoreAccumulators(d);
+}
+
+bool LTC2946_SimBus::Accumulating(Device &d)
+{
+    uint8_t ctrlb = d.reg[LTC2946_CTRLB_REG];
+
+    if(ctrlb & LTC2946_ENABLE_SHUTDOWN) return(false);
+    switch(ctrlb & ~LTC2946_CTRLB_ACC_MASK)
+    {
+        case LTC2946_ENABLE_ACC: return(true);
+        case LTC2946_ACC_PIN_CONTROL: return(d.acc_pin);
+        default: return(false);
+    }
+}
+
+uint8_t LTC2946_SimBus::Read(Device &d, uint8_t reg)
+{
+    if(reg >= LTC2946_REGISTER_COUNT) return(0);
+    if(reg == LTC2946_STATUS2_REG)
+    {
+        return(d.reg[reg] | ((d.converting != CONVERT_NONE) ? LTC2946_STATUS2_ADC_BUSY : 0));
+    }
+    return(d.reg[reg]);
+}
+
+void LTC2946_SimBus::Write(Device &d, uint8_t reg, uint8_t value)
+{
+    if(reg >= LTC2946_REGISTER_COUNT) return;
+
+    switch(LTC2946_Map::Access(reg))
+    {
+        case LTC2946_ACCESS_NONE:
+        case LTC2946_ACCESS_R:
+            return;
+
+        //Fault bits can only be cleared; ALERT is released once no enabled fault is left
+        case LTC2946_ACCESS_RC:
+            d.reg[reg] &= value;
+            if((d.reg[LTC2946_FAULT1_REG] & d.reg[LTC2946_ALERT1_REG]) == 0 &&
+               (d.reg[LTC2946_FAULT2_REG] & d.reg[LTC2946_ALERT2_REG]) == 0) d.alert = false;
+            return;
+
+        default:
+            d.reg[reg] = value;
+            return;
+    }
+}
+
+void LTC2946_SimBus::AfterWrite(Device &d, bool ctrla, bool ctrlb, bool accumulators, bool clock)
+{
+    if(accumulators) SyncAccumulators(d);
+    if(clock) UpdateTimeBase(d);
+
+    if(ctrlb)
+    {
+        uint8_t reset = d.reg[LTC2946_CTRLB_REG] & ~LTC2946_CTRLB_RESET_MASK;
+        if(reset == LTC2946_RESET_ALL)
+        {
+            PowerOn(d);
+            return;
+        }
+        if(reset == LTC2946_RESET_ACC)
+        {
+            memset(&d.reg[LTC2946_TIME_COUNTER_MSB3_REG], 0, LTC2946_ENERGY_LSB_REG - LTC2946_TIME_COUNTER_MSB3_REG + 1);
+            d.charge = 0;
+            d.energy = 0;
+            d.reg[LTC2946_CTRLB_REG] &= LTC2946_CTRLB_RESET_MASK;   //Reset command bits clear themselves
+        }
+
+        //Shutdown stops the ADC, leaving shutdown restarts the sequence
+        bool shutdown = (d.reg[LTC2946_CTRLB_REG] & LTC2946_ENABLE_SHUTDOWN) != 0;
+        if(shutdown && !d.snapshot) d.converting = CONVERT_NONE;
+        if(!shutdown && d.converting == CONVERT_NONE && !ctrla)
+        {
+            d.step = 0;
+            StartConversion(d);
+        }
+    }
+
+    if(ctrla)
+    {
+        uint8_t ctrla_value = d.reg[LTC2946_CTRLA_REG];
+        if((ctrla_value & ~LTC2946_CTRLA_CHANNEL_CONFIG_MASK) == LTC2946_CHANNEL_CONFIG_SNAPSHOT)
+        {
+            //Single conversion of the VOLTAGE_SEL channel
+            uint8_t source = ctrla_value & ~LTC2946_CTRLA_VOLTAGE_SEL_MASK;
+            d.converting = (source == LTC2946_DELTA_SENSE) ? CONVERT_SENSE : (source == LTC2946_ADIN) ? CONVERT_ADIN : CONVERT_VIN;
+            d.snapshot = true;
+            d.conversion_end = now + ((d.converting == CONVERT_SENSE) ? sense_time : voltage_time);
+        }
+        else
+        {
+            d.step = 0;
+            StartConversion(d);
+        }
+    }
+}
+
+void LTC2946_SimBus::UpdateTimeBase(Device &d)
+{
+    uint8_t clk_div = LTC2946_Map::CLK_DIV_DIVIDER.Extract(d.reg[LTC2946_CLK_DIV_REG]);
+    double hz = (d.ext_clk_hz != 0 && clk_div != 0) ? (double)d.ext_clk_hz/clk_div : (double)LTC2946_INTERNAL_CLK_HZ;
+
+    d.tick_ns = LTC2946_TIME_COUNTER_TICKS*1e9/hz;
+    d.tick_epoch = now;
+    d.ticks = 0;
+}
+
+void LTC2946_SimBus::SyncAccumulators(Device &d)
+{
+    d.charge = (uint64_t)sim_load(&d.reg[LTC2946_CHARGE_MSB3_REG], 4) << 16;
+    d.energy = (uint64_t)sim_load(&d.reg[LTC2946_ENERGY_MSB3_REG], 4) << 16;
+}
+
+void LTC2946_SimBus::StoreAccumulators(Device &d)
+{
+    sim_store(&d.reg[LTC2946_CHARGE_MSB3_REG], 4, (uint32_t)(d.charge >> 16));
+    sim_store(&d.reg[LTC2946_ENERGY_MSB3_REG], 4, (uint32_t)(d.energy >> 16));
+}
@@ -0,0 +1,153 @@
+/*!
+LTC2946 Simulated Bus
+
+Behavioural model of LTC2946s on an I2C bus, driven by a simulated clock, for running the driver
+and measuring transactions, bus time and latency without hardware. Unlike LTC2946_FakeBus the
+registers behave like the chip's:
+
+- Auto-incrementing register pointer. Writes to read-only registers (STATUS, results) are ignored,
+  writes to FAULT registers can only clear bits.
+- ADC sequence from CTRLA channel configuration. Result, MIN/MAX, STATUS1/FAULT1, FAULT2 ADC done
+  and the alert pin are updated when each conversion completes; power (VIN code * delta sense code)
+  with each delta sense result.
+- Time counter, charge and energy accumulators advance every 4101 time base clocks (internal
+  250kHz, or external clock / CLK_DIV) by 1, delta sense/16 and power/65536. Accumulation follows
+  CTRLB (enabled, disabled or gated by the ACC pin) and wraps with FAULT2 overflow flags.
+- CTRLB shutdown, reset (accumulators or all registers), auto-reset and cleared-on-read.
+- Snapshot mode: CTRLA channel configuration 7 starts one conversion of the VOLTAGE_SEL channel,
+  STATUS2 busy is set until it completes.
+- Mass write address (LTC2946_I2C_MASS_WRITE) writes every device; alert response address
+  (LTC2946_I2C_ALERT_RESPONSE) returns the lowest alerting device's address and releases its alert.
+- With a bus clock set, every byte on the bus advances the simulated clock by 9 bit times, so
+  conversions can complete between transactions or in the middle of a burst.
+
+Model assumptions, where the register description leaves timing open:
+    Delta sense conversion 16.4ms (one time counter tick), VIN/ADIN conversion 2.2ms, see
+    SetConversionTimes. Channel configurations: 0 and 6 alternate VIN and delta sense,
+    1 converts VIN once then delta sense, 2 VIN 1/128, 3 ADIN/VIN/delta sense in turn,
+    4 ADIN and VIN 1/32 each, 5 ADIN and VIN 1/256 each, remaining conversions delta sense.
+    Auto-reset clears the accumulators after a read transaction that included any of them;
+    cleared-on-read clears FAULT1/FAULT2 after a read transaction that included them.
+
+Addresses are 7-bit, as used by the LTC2946 class (0x67..0x6F). Inputs are set as the 12-bit codes
+the ADC would produce:
+    LTC2946_SimBus bus(400000);
+    bus.AddDevice(0x6F);
+    bus.SetInputs(0x6F, 1000, 2000, 2000, 500);     //delta sense, VDD, SENSE+, ADIN codes
+    LTC2946 monitor(bus, 0x6F);
+    bus.Advance(100000000);                         //100ms of simulated time
+*/
+
+#ifndef LTC2946_SIMBUS_H
+#define LTC2946_SIMBUS_H
+
+#include <stdint.h>
+#include "LTC2946.h"
+#include "LTC2946_Bus.h"
+
+#define LTC2946_SIMBUS_MAX_DEVICES      9                               //!< One per LTC2946 address
+#define LTC2946_SIM_MASS_WRITE          (LTC2946_I2C_MASS_WRITE >> 1)    //!< 7-bit mass write address
+#define LTC2946_SIM_ALERT_RESPONSE      (LTC2946_I2C_ALERT_RESPONSE >> 1)//!< 7-bit alert response address
+
+class LTC2946_SimBus : public LTC2946_Bus {
+public:
+    LTC2946_SimBus(uint32_t bus_hz = 0 //! <I2C clock for bus time, 0=transactions take no simulated time>
+                   );
+
+    //! Add an LTC2946 at address (7-bit) in its power-on state, converting from the current time.
+    //! @return false if full or already present
+    bool AddDevice(uint8_t address);
+
+    //! ADC input of a device, as 12-bit codes. Used from the next conversion on.
+    bool SetInputs(uint8_t address, uint16_t sense_code, uint16_t vdd_code, uint16_t sense_plus_code, uint16_t adin_code);
+    bool SetExternalClock(uint8_t address, uint32_t clk_hz); //! <Clock on CLKIN, 0=none. Used as time base when CLK_DIV is non-zero>
+    bool SetAccPin(uint8_t address, bool high); //! <Level of the ACC (GPIO2) input>
+    bool AlertPin(uint8_t address); //! <True while the device pulls ALERT low>
+
+    //! Register value as the bus would read it (no side effects). 0 if no device.
+    uint8_t Register(uint8_t address, uint8_t reg);
+
+    void SetBusClock(uint32_t bus_hz); //! <0=transactions take no simulated time>
+    int8_t Configure(const LTC2946_BusConfig &config); //! <Sets the bus clock, the rest does not apply>
+    uint32_t ClockHz();
+    void SetConversionTimes(uint32_t sense_ns, uint32_t voltage_ns); //! <Duration of delta sense and VIN/ADIN conversions>
+
+    void Advance(uint64_t ns); //! <Run the simulated clock>
+    uint64_t Now(); //! <Simulated time in ns>
+
+    int8_t Transfer(uint8_t address,
+                    const uint8_t *write_data, uint8_t write_length,
+                    uint8_t *read_data, uint8_t read_length);
+
+    //! Traffic counters, for measuring transactions, bytes and bus time per sample
+    uint32_t Transactions();
+    uint32_t BytesWritten();
+    uint32_t BytesRead();
+    uint64_t BusTime(); //! <ns the bus was busy>
+    void ResetCounters();
+
+private:
+    enum Conversion
+    {
+        CONVERT_NONE = 0,
+        CONVERT_VIN = 1,
+        CONVERT_SENSE = 2,
+        CONVERT_ADIN = 3
+    };
+
+    struct Device
+    {
+        uint8_t address;
+        uint8_t pointer;
+        uint8_t reg[LTC2946_REGISTER_COUNT];
+        uint16_t sense;             //ADC inputs, codes
+        uint16_t vdd;
+        uint16_t sense_plus;
+        uint16_t adin;
+        uint32_t ext_clk_hz;
+        bool acc_pin;
+        bool alert;
+
+        uint8_t converting;         //Conversion in progress
+        bool snapshot;              //Conversion in progress is a snapshot
+        uint64_t conversion_end;    //ns
+        uint16_t step;              //Position in the channel sequence
+
+        uint64_t tick_epoch;        //ns of tick 0 of the current time base
+        uint64_t ticks;             //ticks since tick_epoch
+        double tick_ns;             //time counter period
+        uint64_t charge;            //accumulators, 16 fraction bits
+        uint64_t energy;
+    };
+
+    Device *Find(uint8_t address);
+    void PowerOn(Device &d);
+    void Run(uint64_t until);                        //process events up to until
+    void Bits(uint32_t bits);                        //advance by bus time
+    void StartConversion(Device &d);
+    void Complete(Device &d);
+    void Tick(Device &d);
+    void Measure(Device &d, uint8_t value_reg, uint8_t bytes, uint32_t code, uint8_t over, uint8_t under);
+    void Latch(Device &d, uint8_t fault_reg, uint8_t bits);
+    uint8_t Read(Device &d, uint8_t reg);
+    void Write(Device &d, uint8_t reg, uint8_t value);
+    void AfterWrite(Device &d, bool ctrla, bool ctrlb, bool accumulators, bool clock);
+    void UpdateTimeBase(Device &d);
+    void SyncAccumulators(Device &d);                //registers -> accumulators after a write
+    void StoreAccumulators(Device &d);               //accumulators -> registers
+    bool Accumulating(Device &d);
+
+    Device devices[LTC2946_SIMBUS_MAX_DEVICES];
+    uint8_t device_count = 0;
+    uint64_t now = 0;
+    uint32_t bus_hz;
+    uint32_t sense_time = 16404000;
+    uint32_t voltage_time = 2200000;
+
+    uint32_t transactions = 0;
+    uint32_t bytes_written = 0;
+    uint32_t bytes_read = 0;
+    uint64_t bus_time = 0;
+};
+
+#endif  // LTC2946_SIMBUS_H
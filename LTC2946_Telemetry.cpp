@@ -0,0 +1,375 @@
+/*!
+LTC2946 Telemetry
+
+Frame codec and server. See LTC2946_Telemetry.h.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "LTC2946_Telemetry.h"
+
+static void put16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t value)
+{
+    put16(p, (uint16_t)value);
+    put16(p + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get16(const uint8_t *p){return((uint16_t)(p[0] | (p[1] << 8)));}
+static uint32_t get32(const uint8_t *p){return(get16(p) | ((uint32_t)get16(p + 2) << 16));}
+
+uint16_t LTC2946_telemetry_crc(const uint8_t *data, uint16_t length, uint16_t crc)
+// Bitwise; a few frames per millisecond do not justify a 512 byte table on the Teensy.
+{
+    while(length--)
+    {
+        crc ^= (uint16_t)(*data++) << 8;
+        for(uint8_t i = 0; i < 8; i++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return(crc);
+}
+
+uint16_t LTC2946_telemetry_frame(uint8_t type, uint8_t sequence, const uint8_t *payload, uint16_t length, uint8_t *out)
+// payload may already be in place at out + LTC2946_TELEMETRY_HEADER.
+{
+    memmove(out + LTC2946_TELEMETRY_HEADER, payload, length);
+    out[0] = LTC2946_TELEMETRY_SYNC;
+    out[1] = type;
+    out[2] = sequence;
+    put16(out + 3, length);
+    put16(out + LTC2946_TELEMETRY_HEADER + length, LTC2946_telemetry_crc(out + 1, LTC2946_TELEMETRY_HEADER - 1 + length));
+    return(length + LTC2946_TELEMETRY_OVERHEAD);
+}
+
+bool LTC2946_FrameParser::Push(uint8_t byte)
+{
+    //! The bytes kept after the last good frame move down behind the partial frame, then this one
+    uint16_t waiting = end - at;
+    memmove(frame + have, frame + at, waiting);
+    at = have;
+    end = have + waiting;
+    frame[end++] = byte;
+    return(Run());
+}
+
+bool LTC2946_FrameParser::Next(){return(Run());}
+
+bool LTC2946_FrameParser::Run()
+{
+    while(at < end)
+    {
+        uint8_t byte = frame[at++];
+        if(have == 0 && byte != LTC2946_TELEMETRY_SYNC) continue;
+        frame[have++] = byte;
+        if(have < need) continue;
+
+        //! 1) Header complete: now the length is known
+        if(have == LTC2946_TELEMETRY_HEADER)
+        {
+            uint16_t length = get16(frame + 3);
+            if(length <= LTC2946_TELEMETRY_MAX_PAYLOAD)
+            {
+                need = LTC2946_TELEMETRY_HEADER + length + 2;
+                continue;
+            }
+        }
+        //! 2) Frame complete: check it. A good one stops here, the bytes after it wait for Next or Push
+        else
+        {
+            uint16_t length = have - LTC2946_TELEMETRY_OVERHEAD;
+            if(LTC2946_telemetry_crc(frame + 1, LTC2946_TELEMETRY_HEADER - 1 + length) == get16(frame + LTC2946_TELEMETRY_HEADER + length))
+            {
+                have = 0;
+                need = LTC2946_TELEMETRY_HEADER;
+                return(true);
+            }
+        }
+        Resync();
+    }
+    return(false);
+}
+
+void LTC2946_FrameParser::Resync()
+// The sync byte may have been a data byte: the real frame can start anywhere in what was taken
+// for this one, so the bytes after it go back in front of the ones still waiting. Run only writes
+// below the byte it reads, so this works in place.
+{
+    uint16_t waiting = end - at;
+    memmove(frame + have, frame + at, waiting);
+    at = 1;
+    end = have + waiting;
+    have = 0;
+    need = LTC2946_TELEMETRY_HEADER;
+    bad_frames++;
+}
+
+bool LTC2946_FrameParser::Expire()
+{
+    if(have > 0) Resync();
+    return(Run());
+}
+
+bool LTC2946_FrameParser::Partial(){return(have > 0 || at < end);}
+uint8_t LTC2946_FrameParser::Type(){return(frame[1]);}
+uint8_t LTC2946_FrameParser::Sequence(){return(frame[2]);}
+const uint8_t *LTC2946_FrameParser::Payload(){return(frame + LTC2946_TELEMETRY_HEADER);}
+uint16_t LTC2946_FrameParser::Length(){return(get16(frame + 3));}
+uint32_t LTC2946_FrameParser::BadFrames(){return(bad_frames);}
+
+LTC2946_TelemetryServer::LTC2946_TelemetryServer(LTC2946_Link &link, uint32_t flush_us) //!constructor
+    : link(link), flush_us(flush_us)
+{
+}
+
+int8_t LTC2946_TelemetryServer::Add(LTC2946 &device, uint32_t bus_hz, uint32_t overhead_ns)
+{
+    if(count >= LTC2946_TELEMETRY_MAX_DEVICES) return(-1);
+
+    Slot &s = slots[count];
+    s.device = &device;
+    s.bus_hz = bus_hz;
+    s.overhead_ns = overhead_ns;
+    s.period_us = 0;
+    s.next_poll = 0;
+    return((int8_t)count++);
+}
+
+int8_t LTC2946_TelemetryServer::Update(uint32_t now_us)
+{
+    if(!started)
+    {
+        start = now_us;
+        started = true;
+    }
+    now = now_us;
+    stats.uptime_us = now - start;
+
+    //! 1) Commands
+    uint8_t buffer[64];
+    for(;;)
+    {
+        int16_t n = link.Read(buffer, sizeof(buffer));
+        if(n < 0) return(1);
+        if(n == 0) break;
+        last_byte = now;
+        for(int16_t i = 0; i < n; i++) Receive(parser.Push(buffer[i]));
+    }
+    if(parser.Partial() && now - last_byte >= LTC2946_TELEMETRY_GAP_US) Receive(parser.Expire());
+
+    //! 2) Devices that are due. One that fell a whole period behind skips ahead instead of catching up
+    for(uint8_t i = 0; i < count; i++)
+    {
+        Slot &s = slots[i];
+        if(s.period_us == 0 || s.plan.Count() == 0 || (int32_t)(now - s.next_poll) < 0) continue;
+
+        Poll(i);
+        s.next_poll += s.period_us;
+        if((int32_t)(now - s.next_poll) >= 0)
+        {
+            stats.late++;
+            s.next_poll = now + s.period_us;
+        }
+    }
+
+    //! 3) Samples old enough to send
+    if(samples_records > 0 && now - samples_oldest >= flush_us) Flush();
+    return(0);
+}
+
+void LTC2946_TelemetryServer::Receive(bool good)
+// Handle the frame Push or Expire found, then the ones the bytes kept after it complete
+{
+    for(;;)
+    {
+        stats.bad_frames += parser.BadFrames() - parser_bad;
+        parser_bad = parser.BadFrames();
+        if(!good) return;
+        Handle(parser.Type(), parser.Sequence(), parser.Payload(), parser.Length());
+        good = parser.Next();
+    }
+}
+
+void LTC2946_TelemetryServer::Flush()
+{
+    if(samples_records == 0) return;
+
+    uint16_t length = LTC2946_telemetry_frame(LTC2946_TELEMETRY_SAMPLES, samples_sequence++,
+                                              samples + LTC2946_TELEMETRY_HEADER, samples_length, samples);
+    if(link.Writable(length))
+    {
+        Send(samples, length);
+        stats.samples += samples_records;
+    }
+    else
+    {
+        stats.dropped += samples_records;      //the sequence gap tells the host
+    }
+    samples_length = 0;
+    samples_records = 0;
+}
+
+const LTC2946_TelemetryStats &LTC2946_TelemetryServer::Stats(){return(stats);}
+
+void LTC2946_TelemetryServer::Poll(uint8_t index)
+{
+    Slot &s = slots[index];
+    uint16_t record = LTC2946_TELEMETRY_RECORD + s.plan.Bytes();
+
+    if(samples_length + record > LTC2946_TELEMETRY_MAX_PAYLOAD) Flush();
+
+    uint8_t image[LTC2946_REGISTER_COUNT];
+    int8_t ack = s.plan.Read(*s.device, image);
+    if(ack != 0) stats.bus_errors++;
+
+    //! Record: device, ack, time, then the bytes of each burst in plan order
+    uint8_t *p = samples + LTC2946_TELEMETRY_HEADER + samples_length;
+    p[0] = index;
+    p[1] = (uint8_t)ack;
+    put32(p + 2, now);
+    p += LTC2946_TELEMETRY_RECORD;
+    for(uint8_t i = 0; i < s.plan.Count(); i++)
+    {
+        LTC2946_Burst b = s.plan.Burst(i);
+        memcpy(p, image + b.reg, b.length);
+        p += b.length;
+    }
+
+    if(samples_records == 0) samples_oldest = now;
+    samples_records++;
+    samples_length += record;
+}
+
+void LTC2946_TelemetryServer::Handle(uint8_t type, uint8_t sequence, const uint8_t *payload, uint16_t length)
+{
+    uint8_t *out = response + LTC2946_TELEMETRY_HEADER;     //responses are built in place
+    stats.commands++;
+
+    switch(type)
+    {
+    case LTC2946_TELEMETRY_PING:
+        out[0] = LTC2946_TELEMETRY_VERSION;
+        out[1] = count;
+        put16(out + 2, LTC2946_TELEMETRY_MAX_PAYLOAD);
+        put32(out + 4, now);
+        Respond(type, sequence, out, 8);
+        break;
+
+    case LTC2946_TELEMETRY_SUBSCRIBE:
+    {
+        if(length < 9) return(Error(type, sequence, LTC2946_TELEMETRY_E_LENGTH));
+        if(payload[0] >= count) return(Error(type, sequence, LTC2946_TELEMETRY_E_DEVICE));
+
+        Slot &s = slots[payload[0]];
+        uint64_t quantities = get32(payload + 1) | ((uint64_t)get32(payload + 5) << 32);
+        s.plan = LTC2946_Plan(quantities, s.bus_hz, s.overhead_ns);
+        s.next_poll = now;
+
+        out[0] = payload[0];
+        put32(out + 1, (uint32_t)s.plan.Quantities());
+        put32(out + 5, (uint32_t)(s.plan.Quantities() >> 32));
+        out[9] = (uint8_t)s.plan.Bytes();
+        out[10] = s.plan.Count();
+        for(uint8_t i = 0; i < s.plan.Count(); i++)
+        {
+            out[11 + 2*i] = s.plan.Burst(i).reg;
+            out[12 + 2*i] = s.plan.Burst(i).length;
+        }
+        Respond(type, sequence, out, 11 + 2*s.plan.Count());
+        break;
+    }
+
+    case LTC2946_TELEMETRY_RATE:
+    {
+        if(length < 5) return(Error(type, sequence, LTC2946_TELEMETRY_E_LENGTH));
+        if(payload[0] >= count) return(Error(type, sequence, LTC2946_TELEMETRY_E_DEVICE));
+
+        Slot &s = slots[payload[0]];
+        s.period_us = get32(payload + 1);
+        s.next_poll = now;
+
+        out[0] = payload[0];
+        put32(out + 1, s.period_us);
+        Respond(type, sequence, out, 5);
+        break;
+    }
+
+    case LTC2946_TELEMETRY_READ:
+    {
+        //! 1) Check the whole batch before reading anything
+        if(length < 1 || length < 1 + 3*payload[0]) return(Error(type, sequence, LTC2946_TELEMETRY_E_LENGTH));
+        uint8_t reads = payload[0];
+        uint16_t size = 1;
+        for(uint8_t i = 0; i < reads; i++)
+        {
+            const uint8_t *r = payload + 1 + 3*i;
+            if(r[0] >= count) return(Error(type, sequence, LTC2946_TELEMETRY_E_DEVICE));
+            size += 1 + r[2];
+        }
+        if(size > LTC2946_TELEMETRY_MAX_PAYLOAD) return(Error(type, sequence, LTC2946_TELEMETRY_E_LENGTH));
+
+        //! 2) Read. The request is in the parser's buffer, the response in ours
+        out[0] = reads;
+        uint8_t *p = out + 1;
+        for(uint8_t i = 0; i < reads; i++)
+        {
+            const uint8_t *r = payload + 1 + 3*i;
+            int8_t ack = slots[r[0]].device->ReadRegisters(r[1], p + 1, r[2]);
+            if(ack != 0) stats.bus_errors++;
+            p[0] = (uint8_t)ack;
+            p += 1 + r[2];
+        }
+        Respond(type, sequence, out, size);
+        break;
+    }
+
+    case LTC2946_TELEMETRY_STATS:
+    {
+        Flush();                                            //count what Respond would send
+        const uint32_t values[] = {stats.uptime_us, stats.commands, stats.bad_frames, stats.errors, stats.frames,
+                                   stats.bytes, stats.samples, stats.dropped, stats.late, stats.bus_errors};
+        for(uint8_t i = 0; i < LTC2946_TELEMETRY_STATS_SIZE/4; i++) put32(out + 4*i, values[i]);
+        if(length > 0 && payload[0] != 0)
+        {
+            uint32_t uptime = stats.uptime_us;
+            memset(&stats, 0, sizeof(stats));
+            stats.uptime_us = uptime;
+        }
+        Respond(type, sequence, out, LTC2946_TELEMETRY_STATS_SIZE);
+        break;
+    }
+
+    default:
+        Error(type, sequence, LTC2946_TELEMETRY_E_UNKNOWN);
+        break;
+    }
+}
+
+void LTC2946_TelemetryServer::Respond(uint8_t type, uint8_t sequence, const uint8_t *payload, uint16_t length)
+{
+    //Records read before this command go out first, with the layout they were read with
+    Flush();
+    if(type != LTC2946_TELEMETRY_ERROR) type |= LTC2946_TELEMETRY_RESPONSE;
+    Send(response, LTC2946_telemetry_frame(type, sequence, payload, length, response));
+}
+
+void LTC2946_TelemetryServer::Error(uint8_t type, uint8_t sequence, uint8_t error)
+{
+    uint8_t *out = response + LTC2946_TELEMETRY_HEADER;
+
+    stats.errors++;
+    out[0] = type;
+    out[1] = error;
+    Respond(LTC2946_TELEMETRY_ERROR, sequence, out, 2);
+}
+
+void LTC2946_TelemetryServer::Send(const uint8_t *frame, uint16_t length)
+{
+    link.Write(frame, length);
+    stats.frames++;
+    stats.bytes += length;
+}
@@ -0,0 +1,196 @@
+/*!
+LTC2946 Telemetry
+
+Binary command/response protocol with a multiplexed sample stream, for a Teensy serving its LTC2946s
+to a host over USB serial (extras/telemetry has the host client). Instead of printing text, the
+sketch answers commands and streams the registers each device is subscribed to, many samples per
+frame, at whatever rate USB full speed takes.
+
+Frame (little endian):
+    sync        uint8       0xA5
+    type        uint8       LTC2946_TELEMETRY_*
+    sequence    uint8       command: chosen by the host, echoed in the response; samples: stream counter
+    length      uint16      payload bytes, at most LTC2946_TELEMETRY_MAX_PAYLOAD
+    payload     length
+    crc         uint16      CRC-16/CCITT (0x1021, initial 0xFFFF) of type .. payload
+A bad CRC or length drops the frame; the receiver resynchronizes on the next sync byte. A partial
+frame followed by LTC2946_TELEMETRY_GAP_US of silence is dropped the same way, so a stray sync byte
+with a large length cannot hold back the commands behind it.
+
+| Command     | Request payload                           | Response payload                                   |
+| :---------- | :---------------------------------------- | :------------------------------------------------- |
+| PING        |                                           | version u8, devices u8, max payload u16, time_us u32 |
+| SUBSCRIBE   | device u8, quantities u64 (0 = none)      | device u8, quantities u64, record bytes u8, bursts u8, (reg u8, length u8) per burst |
+| RATE        | device u8, period_us u32 (0 = stop)       | device u8, period_us u32                           |
+| READ        | count u8, (device u8, reg u8, length u8)  | count u8, (ack i8, length bytes) per read          |
+| STATS       | clear u8                                  | LTC2946_TelemetryStats, u32 each, in order         |
+The response type is the command | LTC2946_TELEMETRY_RESPONSE. A command that fails gets an ERROR
+frame instead: command u8, error u8 (LTC2946_TELEMETRY_E_*).
+
+Quantities are LTC2946_Plan bits; each subscription is read with its plan, and the SUBSCRIBE response
+tells the host the bursts, in the order their bytes appear in a sample record. Samples arrive in
+SAMPLES frames, records back to back:
+    device u8, ack i8, time_us u32, the subscription's record bytes
+A frame goes out when it is full or its oldest record is flush_us old. If the link cannot take it
+without blocking the frame is dropped and counted, so a slow host never stalls the polling. Pending
+records are flushed before any response, so the host always decodes them with the layout they were
+read with.
+
+    LTC2946_StreamLink link(Serial);
+    LTC2946_TelemetryServer server(link);
+    server.Add(rail_12v);
+    server.Add(rail_5v);
+    void loop(){ server.Update(micros()); }
+*/
+
+#ifndef LTC2946_TELEMETRY_H
+#define LTC2946_TELEMETRY_H
+
+#include <stdint.h>
+#include "LTC2946.h"
+#include "LTC2946_Link.h"
+#include "LTC2946_Plan.h"
+
+#define LTC2946_TELEMETRY_VERSION       1
+#define LTC2946_TELEMETRY_SYNC          0xA5
+#define LTC2946_TELEMETRY_HEADER        5       //!< sync, type, sequence, length
+#define LTC2946_TELEMETRY_OVERHEAD      7       //!< header and CRC
+#define LTC2946_TELEMETRY_MAX_PAYLOAD   512
+#define LTC2946_TELEMETRY_MAX_DEVICES   8
+#define LTC2946_TELEMETRY_RECORD        6       //!< Sample record bytes before the register bytes
+#define LTC2946_TELEMETRY_FLUSH_US      10000   //!< Default age of the oldest record that sends a SAMPLES frame
+#define LTC2946_TELEMETRY_GAP_US        20000   //!< Silence that drops a partial command frame
+
+//! Frame types
+#define LTC2946_TELEMETRY_PING          0x01
+#define LTC2946_TELEMETRY_SUBSCRIBE     0x02
+#define LTC2946_TELEMETRY_RATE          0x03
+#define LTC2946_TELEMETRY_READ          0x04
+#define LTC2946_TELEMETRY_STATS         0x05
+#define LTC2946_TELEMETRY_SAMPLES       0x40
+#define LTC2946_TELEMETRY_RESPONSE      0x80    //!< OR'd into the command type
+#define LTC2946_TELEMETRY_ERROR         0xFF
+
+//! Errors
+#define LTC2946_TELEMETRY_E_UNKNOWN     1       //!< Unknown command
+#define LTC2946_TELEMETRY_E_LENGTH      2       //!< Payload too short, or the response would not fit a frame
+#define LTC2946_TELEMETRY_E_DEVICE      3       //!< No such device
+#define LTC2946_TELEMETRY_E_TIMEOUT     4       //!< Client: no response
+#define LTC2946_TELEMETRY_E_LINK        5       //!< Client: the link failed
+
+//! Server counters, the STATS response
+struct LTC2946_TelemetryStats
+{
+    uint32_t uptime_us;         //!< Time since the first Update
+    uint32_t commands;          //!< Frames received and handled
+    uint32_t bad_frames;        //!< Frames dropped for CRC or length
+    uint32_t errors;            //!< ERROR responses sent
+    uint32_t frames;            //!< Frames sent
+    uint32_t bytes;             //!< Bytes sent
+    uint32_t samples;           //!< Sample records sent
+    uint32_t dropped;           //!< Sample records dropped, link full
+    uint32_t late;              //!< Polls more than a period late, skipped
+    uint32_t bus_errors;        //!< Polls and reads not acknowledged
+};
+
+#define LTC2946_TELEMETRY_STATS_SIZE    40      //!< LTC2946_TelemetryStats on the wire
+
+//! CRC-16/CCITT of length bytes, continuing from crc
+uint16_t LTC2946_telemetry_crc(const uint8_t *data, uint16_t length, uint16_t crc = 0xFFFF);
+
+//! Frame payload (at most LTC2946_TELEMETRY_MAX_PAYLOAD bytes) into out, which holds
+//! length + LTC2946_TELEMETRY_OVERHEAD. @return frame bytes
+uint16_t LTC2946_telemetry_frame(uint8_t type, uint8_t sequence, const uint8_t *payload, uint16_t length, uint8_t *out);
+
+//! Splits a byte stream into frames
+class LTC2946_FrameParser {
+public:
+    //! Take one byte. @return true when it completes a good frame, valid until the next Push, Next
+    //! or Expire. Bytes taken after that frame (when a bad one was replayed) are kept, call Next
+    //! until it returns false
+    bool Push(uint8_t byte);
+
+    //! Go on with the bytes kept after the last good frame. @return true when they complete another
+    bool Next();
+
+    //! Drop the partial frame, if any, as bad. @return true if a good frame was found in its bytes
+    bool Expire();
+    bool Partial(); //! <Part of a frame has been taken, or bytes are kept>
+
+    uint8_t Type();
+    uint8_t Sequence();
+    const uint8_t *Payload();
+    uint16_t Length();
+    uint32_t BadFrames(); //! <Frames dropped for CRC or length>
+
+private:
+    bool Run();     //parse the kept bytes up to the next good frame
+    void Resync();  //restart at the next sync byte after a bad frame
+
+    uint8_t frame[LTC2946_TELEMETRY_MAX_PAYLOAD + LTC2946_TELEMETRY_OVERHEAD];
+    uint16_t have = 0;                      //bytes of the frame being parsed, from frame[0]
+    uint16_t at = 0;                        //kept bytes not parsed yet: frame[at] to frame[end - 1]
+    uint16_t end = 0;
+    uint16_t need = LTC2946_TELEMETRY_HEADER;
+    uint32_t bad_frames = 0;
+};
+
+class LTC2946_TelemetryServer {
+public:
+    LTC2946_TelemetryServer(LTC2946_Link &link, //! <Link to the host>
+                            uint32_t flush_us = LTC2946_TELEMETRY_FLUSH_US //! <Age of the oldest record that sends a SAMPLES frame>
+                            );
+
+    //! Serve a device as the next index. bus_hz and overhead_ns go to its plans (LTC2946_Plan).
+    //! @return index of the device, -1 if full
+    int8_t Add(LTC2946 &device, uint32_t bus_hz = LTC2946_BUS_DEFAULT_HZ, uint32_t overhead_ns = 0);
+
+    //! Handle the commands that have arrived, poll the devices that are due and send the samples
+    //! that are ready. Call as often as possible. @return 0, or 1 if the link failed
+    int8_t Update(uint32_t now_us);
+
+    //! Send the pending samples now
+    void Flush();
+
+    const LTC2946_TelemetryStats &Stats();
+
+private:
+    struct Slot
+    {
+        LTC2946 *device;
+        LTC2946_Plan plan = LTC2946_Plan(0);
+        uint32_t bus_hz;
+        uint32_t overhead_ns;
+        uint32_t period_us;
+        uint32_t next_poll;
+    };
+
+    void Receive(bool good);
+    void Handle(uint8_t type, uint8_t sequence, const uint8_t *payload, uint16_t length);
+    void Respond(uint8_t type, uint8_t sequence, const uint8_t *payload, uint16_t length);
+    void Error(uint8_t type, uint8_t sequence, uint8_t error);
+    void Poll(uint8_t index);
+    void Send(const uint8_t *frame, uint16_t length);
+
+    LTC2946_Link &link;
+    LTC2946_FrameParser parser;
+    uint32_t parser_bad = 0;                //parser.BadFrames() already in stats
+    Slot slots[LTC2946_TELEMETRY_MAX_DEVICES];
+    uint8_t count = 0;
+    uint32_t flush_us;
+    uint32_t now = 0;
+    uint32_t start = 0;
+    uint32_t last_byte = 0;
+    bool started = false;
+
+    uint8_t response[LTC2946_TELEMETRY_MAX_PAYLOAD + LTC2946_TELEMETRY_OVERHEAD];
+    uint8_t samples[LTC2946_TELEMETRY_MAX_PAYLOAD + LTC2946_TELEMETRY_OVERHEAD];
+    uint16_t samples_length = 0;            //payload bytes in samples
+    uint16_t samples_records = 0;
+    uint32_t samples_oldest = 0;
+    uint8_t samples_sequence = 0;
+
+    LTC2946_TelemetryStats stats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+};
+
+#endif  // LTC2946_TELEMETRY_H
@@ -0,0 +1,26 @@
+#include "LTC2946.h"
+#include "LTC2946_Telemetry.h"
+#include <i2c_t3.h>
+
+
+LTC2946 LTC2946_A(0,0x6F); //Constructor. Format: LTC2946 <name>(I2C wire number,I2C address of LTC2946)
+LTC2946 LTC2946_B(0,0x6A);
+
+LTC2946_StreamLink link(Serial); //USB serial, full speed whatever the baud rate
+LTC2946_TelemetryServer server(link); //Answers extras/telemetry's client instead of printing text
+
+void setup() {
+  Serial.begin(115200);             //! Initialize the serial port to the PC
+
+  LTC2946_A.Setup(); //Initialize appropriate wire object
+  LTC2946_A.SetContinuous();
+  LTC2946_B.Setup();
+  LTC2946_B.SetContinuous();
+
+  server.Add(LTC2946_A); //Device 0
+  server.Add(LTC2946_B); //Device 1. The host subscribes and sets rates
+}
+
+void loop() {
+  server.Update(micros());
+}
@@ -0,0 +1,140 @@
+/*!
+LTC2946 Unpack
+
+Endian-safe register decoding. See LTC2946_Unpack.h.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "LTC2946.h"
+#include "LTC2946_Unpack.h"
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define LTC2946_UNPACK_SSSE3
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LTC2946_UNPACK_NEON
+#endif
+
+#if defined(LTC2946_UNPACK_SSSE3)
+//4 bytes as they lie in memory (x86 is little endian), for the byte shuffles
+static inline int LTC2946_unpack_load(const uint8_t *bytes)
+{
+    int word;
+    memcpy(&word, bytes, sizeof(word));
+    return(word);
+}
+
+//Current code in word 0, VIN in word 1 and ADIN in word 2, still left justified, from the block's
+//POWER_MSB2 byte. The 16 bytes from DELTA_SENSE_MSB reach VIN_LSB but not ADIN
+static inline __m128i LTC2946_unpack_lanes(const uint8_t *block)
+{
+    const __m128i pick = _mm_set_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                      LTC2946_VIN_MSB_REG - LTC2946_DELTA_SENSE_MSB_REG, LTC2946_VIN_LSB_REG - LTC2946_DELTA_SENSE_MSB_REG, 0, 1);
+    __m128i words = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(block + LTC2946_DELTA_SENSE_MSB_REG - LTC2946_POWER_MSB2_REG)), pick);
+    return(_mm_insert_epi16(words, LTC2946_unpack_16(block + LTC2946_ADIN_MSB_REG - LTC2946_POWER_MSB2_REG), 2));
+}
+#endif
+
+void LTC2946_unpack_blocks(const uint8_t *blocks, size_t block_count, size_t stride,
+                           uint8_t first_reg, uint8_t block_length, const LTC2946_CodeColumns *columns)
+{
+    //! 1) Offsets of each channel inside a block, or -1 if not covered
+    int power = (LTC2946_POWER_MSB2_REG >= first_reg && LTC2946_POWER_LSB_REG < first_reg + block_length) ? LTC2946_POWER_MSB2_REG - first_reg : -1;
+    int current = (LTC2946_DELTA_SENSE_MSB_REG >= first_reg && LTC2946_DELTA_SENSE_LSB_REG < first_reg + block_length) ? LTC2946_DELTA_SENSE_MSB_REG - first_reg : -1;
+    int vin = (LTC2946_VIN_MSB_REG >= first_reg && LTC2946_VIN_LSB_REG < first_reg + block_length) ? LTC2946_VIN_MSB_REG - first_reg : -1;
+    int adin = (LTC2946_ADIN_MSB_REG >= first_reg && LTC2946_ADIN_LSB_REG_REG < first_reg + block_length) ? LTC2946_ADIN_MSB_REG - first_reg : -1;
+
+    if(columns->power == 0) power = -1;
+    if(columns->current == 0) current = -1;
+    if(columns->vin == 0) vin = -1;
+    if(columns->adin == 0) adin = -1;
+
+    //! 2) Common case, all four channels in one pass over the blocks. Each block is addressed from
+    //! its POWER_MSB2 byte, so the other channels sit at constant offsets
+    if(power >= 0 && current >= 0 && vin >= 0 && adin >= 0)
+    {
+        const uint8_t *first = blocks + power;
+        uint32_t *power_column = columns->power;
+        uint16_t *current_column = columns->current;
+        uint16_t *vin_column = columns->vin;
+        uint16_t *adin_column = columns->adin;
+        size_t b = 0;
+
+#if defined(LTC2946_UNPACK_SSSE3)
+        //Four blocks at a time: the 16 bytes from DELTA_SENSE_MSB hold the current and VIN codes,
+        //ADIN goes in beside them, then the 4x3 codes are transposed into the columns
+        const __m128i swap_24 = _mm_set_epi8(-1, 12, 13, 14, -1, 8, 9, 10, -1, 4, 5, 6, -1, 0, 1, 2);
+        for(; b + 4 <= block_count; b += 4)
+        {
+            const uint8_t *block = first + b*stride;
+            __m128i pair01 = _mm_unpacklo_epi16(LTC2946_unpack_lanes(block), LTC2946_unpack_lanes(block + stride));
+            __m128i pair23 = _mm_unpacklo_epi16(LTC2946_unpack_lanes(block + 2*stride), LTC2946_unpack_lanes(block + 3*stride));
+            __m128i current_vin = _mm_srli_epi16(_mm_unpacklo_epi32(pair01, pair23), 4);
+            __m128i adin_codes = _mm_srli_epi16(_mm_unpackhi_epi32(pair01, pair23), 4);
+            _mm_storel_epi64((__m128i *)(current_column + b), current_vin);
+            _mm_storel_epi64((__m128i *)(vin_column + b), _mm_unpackhi_epi64(current_vin, current_vin));
+            _mm_storel_epi64((__m128i *)(adin_column + b), adin_codes);
+            __m128i power_bytes = _mm_set_epi32(LTC2946_unpack_load(block + 3*stride), LTC2946_unpack_load(block + 2*stride),
+                                                LTC2946_unpack_load(block + stride), LTC2946_unpack_load(block));
+            _mm_storeu_si128((__m128i *)(power_column + b), _mm_shuffle_epi8(power_bytes, swap_24));
+        }
+#endif
+
+        for(; b < block_count; b++)
+        {
+            const uint8_t *block = first + b*stride;
+            power_column[b] = LTC2946_unpack_24(block);
+            current_column[b] = LTC2946_unpack_12(block + LTC2946_DELTA_SENSE_MSB_REG - LTC2946_POWER_MSB2_REG);
+            vin_column[b] = LTC2946_unpack_12(block + LTC2946_VIN_MSB_REG - LTC2946_POWER_MSB2_REG);
+            adin_column[b] = LTC2946_unpack_12(block + LTC2946_ADIN_MSB_REG - LTC2946_POWER_MSB2_REG);
+        }
+        return;
+    }
+
+    //! 3) Otherwise one pass per requested channel
+    for(size_t b = 0; power >= 0 && b < block_count; b++) columns->power[b] = LTC2946_unpack_24(blocks + b*stride + power);
+    for(size_t b = 0; current >= 0 && b < block_count; b++) columns->current[b] = LTC2946_unpack_12(blocks + b*stride + current);
+    for(size_t b = 0; vin >= 0 && b < block_count; b++) columns->vin[b] = LTC2946_unpack_12(blocks + b*stride + vin);
+    for(size_t b = 0; adin >= 0 && b < block_count; b++) columns->adin[b] = LTC2946_unpack_12(blocks + b*stride + adin);
+}
+
+void LTC2946_unpack_12_array(const uint8_t *bytes, uint16_t *codes, size_t count)
+{
+    size_t i = 0;
+
+#if defined(LTC2946_UNPACK_SSSE3)
+    //Swap each byte pair to host order, then drop the 4 unused LSBs
+    const __m128i swap = _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+    for(; i + 8 <= count; i += 8)
+    {
+        __m128i words = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(bytes + 2*i)), swap);
+        _mm_storeu_si128((__m128i *)(codes + i), _mm_srli_epi16(words, 4));
+    }
+#elif defined(LTC2946_UNPACK_NEON)
+    for(; i + 8 <= count; i += 8)
+    {
+        uint8x16_t raw = vld1q_u8(bytes + 2*i);
+        uint16x8_t words = vreinterpretq_u16_u8(vrev16q_u8(raw));
+        vst1q_u16(codes + i, vshrq_n_u16(words, 4));
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        codes[i] = LTC2946_unpack_12(bytes + 2*i);
+    }
+}
+
+const char *LTC2946_unpack_isa()
+{
+#if defined(LTC2946_UNPACK_SSSE3)
+    return("ssse3");
+#elif defined(LTC2946_UNPACK_NEON)
+    return("neon");
+#else
+    return("scalar");
+#endif
+}
@@ -0,0 +1,65 @@
+/*!
+LTC2946 Unpack
+
+Endian-safe decoding of LTC2946 register bytes. Registers are sent MSB first; codes are assembled
+with shifts so the result does not depend on the byte order of the host.
+
+| Register width | Code                                     |
+| :------------- | :--------------------------------------- |
+| 12-bit         | (MSB << 4) | (LSB >> 4), left justified   |
+| 16-bit         | (MSB << 8) | LSB                          |
+| 24-bit         | (MSB2 << 16) | (MSB1 << 8) | LSB          |
+| 32-bit         | (MSB3 << 24) | ... | LSB                  |
+
+LTC2946_unpack_blocks decodes many register blocks (e.g. one ReadAll burst per device) into
+column arrays, four blocks at a time with SSSE3; LTC2946_unpack_12_array decodes runs of consecutive
+12-bit registers using SSSE3 or NEON byte shuffles where available.
+*/
+
+#ifndef LTC2946_UNPACK_H
+#define LTC2946_UNPACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+static inline uint16_t LTC2946_unpack_12(const uint8_t *bytes)
+{
+    return((uint16_t)((((uint16_t)bytes[0] << 8) | bytes[1]) >> 4));     //as a 16-bit swap, which compilers recognize
+}
+
+static inline uint16_t LTC2946_unpack_16(const uint8_t *bytes)
+{
+    return((uint16_t)(((uint16_t)bytes[0] << 8) | bytes[1]));
+}
+
+static inline uint32_t LTC2946_unpack_24(const uint8_t *bytes)
+{
+    return(((uint32_t)LTC2946_unpack_16(bytes) << 8) | bytes[2]);
+}
+
+static inline uint32_t LTC2946_unpack_32(const uint8_t *bytes)
+{
+    return(((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3]);
+}
+
+//! Destination columns for LTC2946_unpack_blocks. Set a pointer to 0 to skip the channel.
+struct LTC2946_CodeColumns
+{
+    uint32_t *power;        //!< POWER_MSB2 (0x05), 24-bit
+    uint16_t *current;      //!< DELTA_SENSE_MSB (0x14), 12-bit
+    uint16_t *vin;          //!< VIN_MSB (0x1E), 12-bit
+    uint16_t *adin;         //!< ADIN_MSB (0x28), 12-bit
+};
+
+//! Decode block_count register blocks, each holding registers first_reg..first_reg+block_length-1,
+//! placed stride bytes apart in blocks. Channels whose registers fall outside the block are skipped.
+void LTC2946_unpack_blocks(const uint8_t *blocks, size_t block_count, size_t stride,
+                           uint8_t first_reg, uint8_t block_length, const LTC2946_CodeColumns *columns);
+
+//! Decode count consecutive 12-bit registers (2 bytes each, MSB first) into codes.
+void LTC2946_unpack_12_array(const uint8_t *bytes, uint16_t *codes, size_t count);
+
+//! Name of the instruction set used by LTC2946_unpack_12_array ("ssse3", "neon" or "scalar")
+const char *LTC2946_unpack_isa();
+
+#endif  // LTC2946_UNPACK_H
@@ -0,0 +1,130 @@
+/*!
+ltc2946_accgroup_sim: integration window alignment across LTC2946s on LTC2946_SimBus
+
+Three simulated LTC2946s on a 100kHz bus carry the same load and share one time base (a common
+CLKIN), so their time counters tick together. 500 integration windows of 0.5-1.5 s are measured
+three ways:
+    per device  LTC2946::ResetAccumulators, then SetAccumulation enable/disable on each device in turn
+    mass write  LTC2946_AccGroup without a gate: reset, start and stop by mass write
+    gate        LTC2946_AccGroup driving the ACC pins
+After each window the time counter of every device is read. Windows where the devices disagree are
+windows whose rails were not integrated over the same interval. (Devices on independent oscillators
+also differ by up to one tick from the phase of their time bases, whichever way they are started.)
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_accgroup_sim.cpp ../../LTC2946_AccGroup.cpp ../../LTC2946_SimBus.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_accgroup_sim
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "LTC2946_AccGroup.h"
+#include "LTC2946_SimBus.h"
+
+#define BUS_HZ          100000
+#define DEVICES         3
+#define WINDOWS         500
+
+static const uint8_t address[DEVICES] = {0x67, 0x6A, 0x6F};
+static LTC2946_SimBus *sim = 0;
+
+static void gate(bool level)
+{
+    for(uint8_t i = 0; i < DEVICES; i++) sim->SetAccPin(address[i], level);
+}
+
+enum Method
+{
+    PER_DEVICE = 0,
+    MASS_WRITE = 1,
+    GATE = 2
+};
+
+static int run(Method method, const char *name)
+{
+    LTC2946_SimBus bus(BUS_HZ);
+    sim = &bus;
+
+    for(uint8_t i = 0; i < DEVICES; i++)
+    {
+        bus.AddDevice(address[i]);
+        bus.SetInputs(address[i], 1000, 1800, 2000, 500);
+    }
+
+    LTC2946 monitor_0(bus, address[0]), monitor_1(bus, address[1]), monitor_2(bus, address[2]);
+    LTC2946 *monitors[DEVICES] = {&monitor_0, &monitor_1, &monitor_2};
+    LTC2946_AccGroup group(bus);
+    for(uint8_t i = 0; i < DEVICES; i++)
+    {
+        monitors[i]->Setup();
+        monitors[i]->SetContinuous();
+        group.Add(*monitors[i]);
+    }
+    if(method == GATE) group.SetGate(gate);
+    if(method == PER_DEVICE)
+    {
+        for(uint8_t i = 0; i < DEVICES; i++) monitors[i]->SetAccumulation(LTC2946_DISABLE_ACC);
+    }
+    else
+    {
+        group.Setup();
+    }
+
+    uint32_t seed = 3, misaligned = 0, worst = 0, transactions = 0;
+    for(int w = 0; w < WINDOWS; w++)
+    {
+        //! 1) Reset and start
+        bus.ResetCounters();
+        if(method == PER_DEVICE)
+        {
+            for(uint8_t i = 0; i < DEVICES; i++) monitors[i]->ResetAccumulators();
+            for(uint8_t i = 0; i < DEVICES; i++) monitors[i]->SetAccumulation(LTC2946_ENABLE_ACC);
+        }
+        else
+        {
+            group.Reset();
+            group.Start();
+        }
+        transactions += bus.Transactions();
+
+        seed = seed*1664525 + 1013904223;
+        bus.Advance(500000000ULL + (seed >> 8) % 1000000000ULL);
+
+        //! 2) Stop
+        bus.ResetCounters();
+        if(method == PER_DEVICE)
+        {
+            for(uint8_t i = 0; i < DEVICES; i++) monitors[i]->SetAccumulation(LTC2946_DISABLE_ACC);
+        }
+        else
+        {
+            group.Stop();
+        }
+        transactions += bus.Transactions();
+
+        //! 3) Compare the time counters
+        uint32_t low = 0xFFFFFFFF, high = 0;
+        for(uint8_t i = 0; i < DEVICES; i++)
+        {
+            uint8_t block[4];
+            monitors[i]->ReadRegisters(LTC2946_TIME_COUNTER_MSB3_REG, block, 4);
+            uint32_t ticks = ((uint32_t)block[0] << 24) | ((uint32_t)block[1] << 16) | ((uint32_t)block[2] << 8) | block[3];
+            if(ticks < low) low = ticks;
+            if(ticks > high) high = ticks;
+        }
+        if(high != low) misaligned++;
+        if(high - low > worst) worst = high - low;
+        bus.Advance(20000000);
+    }
+
+    printf("%-12s %4u/%u windows misaligned, worst %u ticks, %.1f transactions per window\n",
+           name, misaligned, WINDOWS, worst, (double)transactions/WINDOWS);
+    return(misaligned);
+}
+
+int main()
+{
+    run(PER_DEVICE, "per device");
+    int mass = run(MASS_WRITE, "mass write");
+    int gated = run(GATE, "gate");
+    return((mass || gated) ? 1 : 0);
+}
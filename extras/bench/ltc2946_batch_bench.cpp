@@ -0,0 +1,155 @@
+/*!
+ltc2946_batch_bench: column scans of LTC2946_SampleBatch against an array of sample structs
+
+Fills both layouts with the same synthetic samples, checks that each scan gives identical results,
+then times scans that touch one or two quantities (the common case for filters and statistics).
+Also checks that AppendBlocks, fed the ReadAll bursts of the samples, fills the same columns.
+
+Build (from this directory):
+    g++ -O2 -march=native -I../.. ltc2946_batch_bench.cpp ../../LTC2946_Batch.cpp ../../LTC2946.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp ../../LTC2946_Unpack.cpp -o ltc2946_batch_bench
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include <string.h>
+#include "LTC2946_Batch.h"
+
+#define BENCH_SAMPLES   (4u*1024*1024)
+#define BENCH_REPEAT    16
+#define BENCH_BURSTS    1001    //!< Samples also sent through AppendBlocks, not a multiple of 4
+
+//ReadAll burst, POWER_MSB2 through ADIN_LSB
+#define BURST_LENGTH    (LTC2946_ADIN_LSB_REG_REG - LTC2946_POWER_MSB2_REG + 1)
+
+//Array-of-structs layout, as a caller would naturally write it
+struct Sample
+{
+    uint32_t time;
+    uint16_t vin;
+    uint16_t current;
+    uint32_t power;
+    uint16_t adin;
+    uint8_t status;
+};
+
+struct ScanResult
+{
+    uint64_t power_sum;
+    uint16_t current_max;
+    uint32_t errors;
+    uint32_t over;          //samples with VIN above a limit while drawing current
+};
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+static ScanResult scan_aos(const std::vector<Sample> &s)
+{
+    ScanResult r = {0, 0, 0, 0};
+    size_t n = s.size();
+    for(size_t i = 0; i < n; i++) r.power_sum += s[i].power;
+    for(size_t i = 0; i < n; i++) if(s[i].current > r.current_max) r.current_max = s[i].current;
+    for(size_t i = 0; i < n; i++) r.errors += s[i].status & LTC2946_SAMPLE_I2C_ERROR;
+    for(size_t i = 0; i < n; i++) r.over += (s[i].vin > 500) & (s[i].current > 1000);
+    return(r);
+}
+
+static ScanResult scan_soa(LTC2946_SampleBatch &b)
+{
+    ScanResult r = {0, 0, 0, 0};
+    size_t n = b.Count();
+    const uint32_t *power = b.Power();
+    const uint16_t *current = b.Current();
+    const uint16_t *vin = b.VIN();
+    const uint8_t *status = b.Status();
+    for(size_t i = 0; i < n; i++) r.power_sum += power[i];
+    for(size_t i = 0; i < n; i++) if(current[i] > r.current_max) r.current_max = current[i];
+    for(size_t i = 0; i < n; i++) r.errors += status[i] & LTC2946_SAMPLE_I2C_ERROR;
+    for(size_t i = 0; i < n; i++) r.over += (vin[i] > 500) & (current[i] > 1000);
+    return(r);
+}
+
+int main()
+{
+    size_t arena_bytes = LTC2946_SampleBatch::ArenaBytes(BENCH_SAMPLES);
+    void *memory = malloc(arena_bytes);
+    LTC2946_Arena arena(memory, arena_bytes);
+    LTC2946_SampleBatch batch(arena, BENCH_SAMPLES);
+    std::vector<Sample> aos;
+    uint32_t seed = 1;
+
+    if(!batch.Valid())
+    {
+        fprintf(stderr, "arena too small\n");
+        return(1);
+    }
+    aos.reserve(BENCH_SAMPLES);
+
+    for(uint32_t i = 0; i < BENCH_SAMPLES; i++)
+    {
+        seed = seed*1664525 + 1013904223;
+        uint16_t vin = (uint16_t)(480 + ((seed >> 8) & 31));
+        uint16_t current = (uint16_t)((seed >> 16) & 0xFFF);
+        uint8_t status = ((seed >> 4) & 0x3FF) == 0 ? LTC2946_SAMPLE_I2C_ERROR : 0;
+        Sample s = {i*100, vin, current, (uint32_t)vin*current, 1500, status};
+        aos.push_back(s);
+        batch.Append(s.time, s.vin, s.current, s.power, s.adin, s.status);
+    }
+
+    printf("%u samples: struct %u bytes, columns %u bytes/sample, arena %.1f MiB\n",
+           BENCH_SAMPLES, (unsigned)sizeof(Sample), 15u, arena.Used()/1048576.0);
+
+    //The same samples as ReadAll bursts, registers MSB first and 12-bit codes left justified
+    std::vector<uint8_t> bursts((size_t)BENCH_BURSTS*BURST_LENGTH, 0);
+    std::vector<uint32_t> times(BENCH_BURSTS);
+    for(uint32_t i = 0; i < BENCH_BURSTS; i++)
+    {
+        uint8_t *burst = &bursts[(size_t)i*BURST_LENGTH];
+        const uint16_t codes[3] = {aos[i].current, aos[i].vin, aos[i].adin};
+        const uint8_t regs[3] = {LTC2946_DELTA_SENSE_MSB_REG, LTC2946_VIN_MSB_REG, LTC2946_ADIN_MSB_REG};
+        burst[0] = (uint8_t)(aos[i].power >> 16);
+        burst[1] = (uint8_t)(aos[i].power >> 8);
+        burst[2] = (uint8_t)aos[i].power;
+        for(uint8_t c = 0; c < 3; c++)
+        {
+            burst[regs[c] - LTC2946_POWER_MSB2_REG] = (uint8_t)(codes[c] >> 4);
+            burst[regs[c] - LTC2946_POWER_MSB2_REG + 1] = (uint8_t)(codes[c] << 4);
+        }
+        times[i] = aos[i].time;
+    }
+    size_t burst_arena_bytes = LTC2946_SampleBatch::ArenaBytes(BENCH_BURSTS);
+    void *burst_memory = malloc(burst_arena_bytes);
+    LTC2946_Arena burst_arena(burst_memory, burst_arena_bytes);
+    LTC2946_SampleBatch decoded(burst_arena, BENCH_BURSTS);
+    bool appended = decoded.AppendBlocks(bursts.data(), BENCH_BURSTS, BURST_LENGTH, LTC2946_POWER_MSB2_REG, BURST_LENGTH, times.data()) == BENCH_BURSTS &&
+                    memcmp(decoded.Time(), batch.Time(), BENCH_BURSTS*sizeof(uint32_t)) == 0 &&
+                    memcmp(decoded.VIN(), batch.VIN(), BENCH_BURSTS*sizeof(uint16_t)) == 0 &&
+                    memcmp(decoded.Current(), batch.Current(), BENCH_BURSTS*sizeof(uint16_t)) == 0 &&
+                    memcmp(decoded.Power(), batch.Power(), BENCH_BURSTS*sizeof(uint32_t)) == 0 &&
+                    memcmp(decoded.ADIN(), batch.ADIN(), BENCH_BURSTS*sizeof(uint16_t)) == 0 &&
+                    decoded.AppendBlocks(bursts.data(), 1, BURST_LENGTH, LTC2946_POWER_MSB2_REG, BURST_LENGTH, times.data()) == 0;
+    printf("AppendBlocks of %u bursts: %s\n", BENCH_BURSTS, appended ? "same columns" : "MISMATCH");
+    free(burst_memory);
+
+    ScanResult a = {0, 0, 0, 0}, b = {0, 0, 0, 0};
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int r = 0; r < BENCH_REPEAT; r++) a = scan_aos(aos);
+    double t_aos = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for(int r = 0; r < BENCH_REPEAT; r++) b = scan_soa(batch);
+    double t_soa = seconds_since(start);
+
+    bool same = a.power_sum == b.power_sum && a.current_max == b.current_max && a.errors == b.errors && a.over == b.over;
+    printf("results: %s (errors %u, over %u)\n", same ? "identical" : "MISMATCH", b.errors, b.over);
+    printf("array of structs: %7.1f M samples/s\n", (double)BENCH_SAMPLES*BENCH_REPEAT/t_aos*1e-6);
+    printf("columns:          %7.1f M samples/s (%.2fx)\n", (double)BENCH_SAMPLES*BENCH_REPEAT/t_soa*1e-6, t_aos/t_soa);
+
+    free(memory);
+    return(same && appended ? 0 : 1);
+}
@@ -0,0 +1,132 @@
+/*!
+ltc2946_bidirectional_sim: bidirectional decode over the whole code space on LTC2946_SimBus
+
+Every delta sense code 0..4095 is converted by the simulator, with VIN (SENSE+) and ADIN codes
+running through their whole range alongside, and read back raw in bidirectional mode around the
+default zero code. Checks:
+    current     ReadCurrent() and ReadAll() give delta sense - 2048
+    power       ReadPower() and ReadAll() give power - 2048 * VIN, ReadPower() in one transaction
+    convert     with constants set, the same signed codes times the constant plus the offset
+    min/max     ReadMinMax() after the sweep: the extremes of every channel in one transaction,
+                current signed, power the chip's unsigned products
+    unipolar    with bidirectional off, RAW codes unchanged and ReadPower() one 3 byte read
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_bidirectional_sim.cpp ../../LTC2946_SimBus.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_bidirectional_sim
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "LTC2946_SimBus.h"
+
+#define ADDRESS         0x6F
+#define CODES           4096
+#define STEP_NS         1000000     //!< One ADIN, VIN and delta sense conversion each
+#define ZERO            LTC2946_CURRENT_ZERO_CODE
+
+#define CURRENT_CONST   0.00119677419f
+#define CURRENT_OFFSET  0.004f
+#define POWER_CONST     0.00003171126055f
+#define POWER_OFFSET    -0.25f
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-64s %s\n", what, ok ? "ok" : "FAIL");
+    if(!ok) failures++;
+}
+
+//! VIN and ADIN codes for a delta sense code: odd multipliers, so both also cover every code
+static uint16_t vin_for(uint32_t code) { return((uint16_t)((code*1237 + 5) % CODES)); }
+static uint16_t adin_for(uint32_t code) { return((uint16_t)((code*2731 + 11) % CODES)); }
+
+int main()
+{
+    LTC2946_SimBus bus;
+    bus.AddDevice(ADDRESS);
+    bus.SetConversionTimes(STEP_NS/4, STEP_NS/4);
+    LTC2946 monitor(bus, ADDRESS);
+    monitor.SetContinuous();
+
+    //ADIN, VIN and delta sense in turn, so ADIN is converted too
+    const uint8_t ctrla[2] = {LTC2946_CTRLA_REG, LTC2946_CHANNEL_CONFIG_A_V_C_3|LTC2946_SENSE_PLUS|LTC2946_OFFSET_CAL_EVERY|LTC2946_ADIN_GND};
+    bus.Transfer(ADDRESS, ctrla, sizeof(ctrla), 0, 0);
+    monitor.EnableConversion(false);
+    monitor.EnableBidirectional(true);
+
+    //! 1) Sweep the delta sense code space
+    bool current_ok = true, power_ok = true, all_ok = true, one_read = true;
+    int32_t power_max = 0;
+    for(uint32_t code = 0; code < CODES; code++)
+    {
+        uint16_t vin = vin_for(code);
+        bus.SetInputs(ADDRESS, (uint16_t)code, 0, vin, adin_for(code));
+        bus.Advance(STEP_NS);
+
+        int32_t current = (int32_t)code - ZERO;
+        int32_t power = (int32_t)(vin*code) - ZERO*(int32_t)vin;
+        if((int32_t)(vin*code) > power_max) power_max = (int32_t)(vin*code);
+
+        current_ok &= monitor.ReadCurrent() == (float)current;
+        bus.ResetCounters();
+        power_ok &= monitor.ReadPower() == (float)power;
+        one_read &= bus.Transactions() == 1;
+
+        float v, i, p, a;
+        monitor.ReadAll(&v, &i, &p, &a);
+        all_ok &= v == vin && i == current && p == power && a == adin_for(code);
+    }
+    check(current_ok, "ReadCurrent: every delta sense code minus 2048");
+    check(power_ok, "ReadPower: every power code minus 2048 * VIN");
+    check(one_read, "ReadPower: power and VIN in one transaction");
+    check(all_ok, "ReadAll agrees on every code");
+
+    //! 2) MIN/MAX of the sweep
+    LTC2946_MinMax stats;
+    bus.ResetCounters();
+    int8_t ack = monitor.ReadMinMax(&stats);
+    printf("    current %g..%g  power %g..%g  VIN %g..%g  ADIN %g..%g\n", stats.current_min, stats.current_max,
+           stats.power_min, stats.power_max, stats.vin_min, stats.vin_max, stats.adin_min, stats.adin_max);
+    check(ack == 0 && bus.Transactions() == 1 &&
+          stats.current_min == -ZERO && stats.current_max == CODES - 1 - ZERO &&
+          stats.vin_min == 0 && stats.vin_max == CODES - 1 && stats.adin_min == 0 && stats.adin_max == CODES - 1,
+          "ReadMinMax: signed current, VIN and ADIN extremes in one read");
+    check(stats.power_min == 0 && stats.power_max == (float)power_max, "ReadMinMax: power extremes unsigned, as the chip keeps them");
+
+    //! 3) Converted values use the same signed codes
+    monitor.EnableConversion(true);
+    monitor.SetAmperageConst(CURRENT_CONST, CURRENT_OFFSET);
+    monitor.SetPowerConst(POWER_CONST, POWER_OFFSET);
+    bool convert_ok = true;
+    for(uint32_t code = 0; code < CODES; code += 97)
+    {
+        uint16_t vin = vin_for(code);
+        bus.SetInputs(ADDRESS, (uint16_t)code, 0, vin, adin_for(code));
+        bus.Advance(STEP_NS);
+        convert_ok &= monitor.ReadCurrent() == (float)((int32_t)code - ZERO)*CURRENT_CONST + CURRENT_OFFSET;
+        convert_ok &= monitor.ReadPower() == (float)((int32_t)(vin*code) - ZERO*(int32_t)vin)*POWER_CONST + POWER_OFFSET;
+    }
+    check(convert_ok, "conversion applied to the signed codes");
+
+    //! 4) Unipolar
+    monitor.EnableConversion(false);
+    monitor.EnableBidirectional(false);
+    bool unipolar_ok = true;
+    for(uint32_t code = 0; code < CODES; code += 13)
+    {
+        uint16_t vin = vin_for(code);
+        bus.SetInputs(ADDRESS, (uint16_t)code, 0, vin, adin_for(code));
+        bus.Advance(STEP_NS);
+        unipolar_ok &= monitor.ReadCurrent() == (float)code;
+        bus.ResetCounters();
+        unipolar_ok &= monitor.ReadPower() == (float)(vin*code);
+        unipolar_ok &= bus.Transactions() == 1 && bus.BytesRead() == 3;
+    }
+    check(unipolar_ok, "bidirectional off: RAW codes, ReadPower reads 3 bytes");
+
+    check(monitor.ErrorCheck(), "no bus errors");
+
+    printf("%s, %d failures\n", failures ? "FAIL" : "PASS", failures);
+    return(failures ? 1 : 0);
+}
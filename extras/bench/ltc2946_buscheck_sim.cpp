@@ -0,0 +1,108 @@
+/*!
+ltc2946_buscheck_sim: bus clock against throughput, and LTC2946_check_bus, on LTC2946_SimBus
+
+The simulated bus is configured through LTC2946_Bus::Configure at standard mode (100kHz, the library
+default), fast mode (400kHz, the LTC2946's limit) and 1MHz (beyond the LTC2946, for the model
+only). For each clock:
+    check       LTC2946_check_bus, 1000 transfers timed on the simulated clock: achieved rate, errors
+    ReadAll     ReadAllCodes (one 37 byte burst): modeled time and samples per second
+    Plan        LTC2946_Plan for VIN, current, power and status: modeled and simulated time
+    Energy      the 12 byte accumulator burst
+A check against an address with no device shows the error path, and the clock is configured once
+more through an LTC2946_RecordBus and an LTC2946_BusPort wrapped around the simulator. Fails if the
+achieved rate is off the configured clock, a check reports errors, the missing device is not
+reported, or Configure and ClockHz do not reach the simulator through a wrapper.
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_buscheck_sim.cpp ../../LTC2946_Plan.cpp ../../LTC2946_Record.cpp ../../LTC2946_SharedBus.cpp ../../LTC2946_SimBus.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_buscheck_sim
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "LTC2946_Plan.h"
+#include "LTC2946_SimBus.h"
+#include "LTC2946_Record.h"
+#include "LTC2946_SharedBus.h"
+
+#define ADDRESS         0x6F
+#define MISSING         0x6A
+#define TRANSFERS       1000
+
+static LTC2946_SimBus *sim = 0;
+
+static uint32_t sim_us()
+{
+    return((uint32_t)(sim->Now()/1000));
+}
+
+//! Simulated time of one call, in us
+template <typename F>
+static double timed(F call)
+{
+    uint64_t start = sim->Now();
+    call();
+    return((sim->Now() - start)/1000.0);
+}
+
+int main()
+{
+    static const uint32_t rates[] = {100000, 400000, 1000000};
+    int failures = 0;
+
+    printf("%-8s %12s %8s %10s %10s %12s %10s %10s\n", "clock", "achieved Hz", "errors", "check us",
+           "ReadAll us", "ReadAll/s", "plan us", "energy us");
+    for(uint32_t rate : rates)
+    {
+        LTC2946_SimBus bus;
+        sim = &bus;
+        bus.AddDevice(ADDRESS);
+        bus.Configure(LTC2946_bus_config(rate));
+
+        LTC2946 monitor(bus, ADDRESS);
+        monitor.Setup();
+        monitor.SetContinuous();
+
+        LTC2946_BusCheck check;
+        LTC2946_check_bus(bus, ADDRESS, TRANSFERS, &check, sim_us);
+
+        uint16_t vin, current, adin;
+        uint32_t power;
+        double read_all = timed([&](){ monitor.ReadAllCodes(&vin, &current, &power, &adin); });
+
+        LTC2946_Plan plan(LTC2946_PLAN_VIN | LTC2946_PLAN_CURRENT | LTC2946_PLAN_POWER | LTC2946_PLAN_STATUS, bus.ClockHz());
+        uint8_t image[LTC2946_REGISTER_COUNT];
+        double planned = timed([&](){ plan.Read(monitor, image); });
+
+        uint32_t time, charge, energy;
+        double accumulators = timed([&](){ monitor.ReadAccumulators(&time, &charge, &energy); });
+
+        printf("%-8u %12u %8u %10u %10.1f %12.0f %10.1f %10.1f\n", rate, check.achieved_hz, check.errors,
+               check.transfer_us, read_all, 1e6/read_all, planned, accumulators);
+
+        //Plan's model and the simulator count the same bits
+        bool off = check.achieved_hz < rate*0.99 || check.achieved_hz > rate*1.01 ||
+                   planned < plan.Nanoseconds()/1000.0*0.99 || planned > plan.Nanoseconds()/1000.0*1.01;
+        if(check.errors != 0 || off) failures++;
+
+        LTC2946_BusCheck missing;
+        if(LTC2946_check_bus(bus, MISSING, 10, &missing, sim_us) == 0 || missing.error_rate != 1.0f) failures++;
+        if(rate == rates[0]) printf("missing device: %u/%u errors, error rate %.2f\n", missing.errors, missing.transfers, missing.error_rate);
+    }
+
+    //Wrappers pass the clock through to the bus they wrap
+    LTC2946_SimBus bus;
+    uint8_t trace[256];
+    LTC2946_RecordBus recorder(bus, trace, sizeof(trace));
+    int8_t ack = recorder.Configure(LTC2946_bus_config(rates[0]));
+    printf("through LTC2946_RecordBus: Configure %d, ClockHz %u (simulator %u)\n", ack, recorder.ClockHz(), bus.ClockHz());
+    if(ack != 0 || bus.ClockHz() != rates[0] || recorder.ClockHz() != rates[0]) failures++;
+
+    LTC2946_SharedBus shared(bus);
+    LTC2946_BusPort port(shared, LTC2946_PRIORITY_CONFIG);
+    ack = port.Configure(LTC2946_bus_config(rates[1]));
+    printf("through LTC2946_BusPort: Configure %d, ClockHz %u (simulator %u)\n", ack, port.ClockHz(), bus.ClockHz());
+    if(ack != 0 || bus.ClockHz() != rates[1] || port.ClockHz() != rates[1]) failures++;
+
+    printf("%s, %d failures\n", failures ? "FAIL" : "PASS", failures);
+    return(failures ? 1 : 0);
+}
@@ -0,0 +1,221 @@
+/*!
+ltc2946_calibration_sim: LTC2946_Calibration against points from a known line plus noise
+
+For every channel, reference values are generated from a known gain and offset over the channel's
+whole code range (12-bit VIN, CURRENT and ADIN, 24-bit POWER), with Gaussian noise of 0.1% of full
+scale. Checks:
+    fit         gain and offset within a few standard errors of the true ones, ADIN also through zero
+    rms         the fitted RMS residual no larger than the noise RMS and close to it
+    clustered   POWER codes all within 200 of 16M: gain and RMS residual match a centered long double fit
+    max         max_residual equal to the largest residual of the stored points, computed here
+    parse       every point sent as a "<V|I|P|A>,<raw>,<reference>" line gives the same profile text
+                as AddPoint; malformed lines and negative codes are refused
+    profile     the constants and offsets read back from FormatProfile() equal the fitted floats
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_calibration_sim.cpp ../../LTC2946_Calibration.cpp -o ltc2946_calibration_sim
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "LTC2946_Calibration.h"
+
+#define POINTS          200
+#define NOISE           0.001   //!< Noise sigma as a fraction of full scale
+
+//! A channel's true line and code range
+struct Truth
+{
+    LTC2946_Calibration::Channel channel;
+    char letter;
+    const char *name;
+    uint32_t max_code;
+    double gain;
+    double offset;
+};
+
+static const Truth truths[LTC2946_Calibration::CHANNEL_COUNT] = {
+    {LTC2946_Calibration::VIN,     'V', "VIN",     0xFFF,    0.0250,    0.012},
+    {LTC2946_Calibration::CURRENT, 'I', "CURRENT", 0xFFF,    0.0012,   -0.0035},
+    {LTC2946_Calibration::POWER,   'P', "POWER",   0xFFFFFF, 0.0000298, 0.041},
+    {LTC2946_Calibration::ADIN,    'A', "ADIN",    0xFFF,    0.0005,    0},
+};
+
+static uint32_t seed = 11;
+
+static double uniform()
+{
+    seed = seed*1664525 + 1013904223;
+    return(((seed >> 8) + 0.5)/16777216.0);
+}
+
+static double gaussian()
+{
+    return(sqrt(-2*log(uniform()))*cos(2*M_PI*uniform()));
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-64s %s\n", what, ok ? "ok" : "FAIL");
+    if(!ok) failures++;
+}
+
+int main()
+{
+    LTC2946_Calibration direct, parsed;
+    uint32_t raws[LTC2946_Calibration::CHANNEL_COUNT][POINTS];
+    float references[LTC2946_Calibration::CHANNEL_COUNT][POINTS];
+    bool parse_ok = true;
+    char line[64];
+
+    //! 1) Points: AddPoint on one calibration, the same points as text lines on the other
+    for(uint8_t c = 0; c < LTC2946_Calibration::CHANNEL_COUNT; c++)
+    {
+        const Truth &t = truths[c];
+        double full_scale = t.max_code*t.gain;
+        for(uint32_t i = 0; i < POINTS; i++)
+        {
+            raws[c][i] = (uint32_t)(uniform()*t.max_code);
+            references[c][i] = (float)(raws[c][i]*t.gain + t.offset + gaussian()*NOISE*full_scale);
+            direct.AddPoint(t.channel, raws[c][i], references[c][i]);
+
+            snprintf(line, sizeof(line), "%c,%lu,%.9g", i & 1 ? t.letter : t.letter + 'a' - 'A',
+                     (unsigned long)raws[c][i], (double)references[c][i]);
+            parse_ok &= parsed.ParseLine(line);
+        }
+    }
+    parse_ok &= parsed.ParseLine("  P , 12 , 1.5") && parsed.Points(LTC2946_Calibration::POWER) == POINTS + 1;
+    parsed.Clear(LTC2946_Calibration::POWER);
+    for(uint32_t i = 0; i < POINTS; i++) parsed.AddPoint(LTC2946_Calibration::POWER, raws[2][i], references[2][i]);
+    check(parse_ok, "every point line parsed, whitespace and lowercase accepted");
+    check(!parsed.ParseLine("X,12,1.0") && !parsed.ParseLine("V,,1.0") && !parsed.ParseLine("V,12") &&
+          !parsed.ParseLine("V 12 1.0") && !parsed.ParseLine("") && !parsed.ParseLine("V,-5,1.0") &&
+          !parsed.ParseLine("V, -5,1.0"), "malformed lines and negative codes refused");
+
+    //! 2) Fit each channel against its truth
+    bool fit_ok = true, rms_ok = true, max_ok = true, origin_ok = true;
+    LTC2946_CalFit fits[LTC2946_Calibration::CHANNEL_COUNT];
+    for(uint8_t c = 0; c < LTC2946_Calibration::CHANNEL_COUNT; c++)
+    {
+        const Truth &t = truths[c];
+        LTC2946_CalFit &f = fits[c];
+        double sigma = NOISE*t.max_code*t.gain;
+        if(!direct.Fit(t.channel, &f))
+        {
+            fit_ok = false;
+            continue;
+        }
+
+        //Standard errors of a least-squares line with this noise and these codes
+        double mean = 0, sxx = 0, noise_sse = 0;
+        for(uint32_t i = 0; i < POINTS; i++) mean += raws[c][i];
+        mean /= POINTS;
+        for(uint32_t i = 0; i < POINTS; i++)
+        {
+            double error = references[c][i] - (raws[c][i]*t.gain + t.offset);
+            sxx += (raws[c][i] - mean)*(raws[c][i] - mean);
+            noise_sse += error*error;
+        }
+        double gain_se = sigma/sqrt(sxx);
+        double offset_se = sigma*sqrt(1.0/POINTS + mean*mean/sxx);
+        double noise_rms = sqrt(noise_sse/POINTS);
+
+        //Largest residual of the stored points, recomputed the way Residual() does
+        float max_residual = 0;
+        for(uint32_t i = 0; i < POINTS && i < LTC2946_CAL_POINTS; i++)
+        {
+            float residual = fabsf((float)raws[c][i]*f.gain + f.offset - references[c][i]);
+            if(residual > max_residual) max_residual = residual;
+        }
+
+        printf("    %-8s gain %.7g (true %.7g, %+.2f se)  offset %+.6f (true %+.6f, %+.2f se)  rms %.4g/%.4g  max %.4g\n",
+               t.name, (double)f.gain, t.gain, (f.gain - t.gain)/gain_se, (double)f.offset, t.offset,
+               (f.offset - t.offset)/offset_se, (double)f.rms_residual, noise_rms, (double)f.max_residual);
+
+        fit_ok &= f.points == POINTS && fabs(f.gain - t.gain) < 4*gain_se && fabs(f.offset - t.offset) < 4*offset_se;
+        rms_ok &= f.rms_residual <= noise_rms*1.0001 && f.rms_residual > noise_rms*0.95;
+        max_ok &= f.max_residual == max_residual && f.max_residual > f.rms_residual;
+    }
+
+    LTC2946_CalFit origin;
+    origin_ok = direct.Fit(LTC2946_Calibration::ADIN, &origin, false) && origin.offset == 0 &&
+                fabs(origin.gain - truths[3].gain) < truths[3].gain*NOISE;
+    direct.Fit(LTC2946_Calibration::ADIN, &fits[3]);
+
+    check(fit_ok, "gain and offset within 4 standard errors (24-bit POWER too)");
+    check(rms_ok, "RMS residual at the noise RMS, never above it");
+    check(max_ok, "max_residual from Fit() is the largest stored residual");
+    check(origin_ok, "fit through zero recovers the ADIN gain");
+
+    //Power codes clustered near full scale: uncentered sums cancel to a few digits here
+    LTC2946_Calibration clustered;
+    long double mean_x = 0, mean_y = 0, sxx = 0, sxy = 0, syy = 0;
+    for(uint32_t i = 0; i < POINTS; i++)
+    {
+        uint32_t raw = 16000000 + i;
+        float reference = (float)(raw*1.5e-6 + 0.25 + ((i*7919) % 13)*1e-6);
+        clustered.AddPoint(LTC2946_Calibration::POWER, raw, reference);
+        mean_x += raw;
+        mean_y += reference;
+    }
+    mean_x /= POINTS;
+    mean_y /= POINTS;
+    for(uint32_t i = 0; i < POINTS; i++)
+    {
+        long double dx = 16000000 + i - mean_x, dy = (float)((16000000 + i)*1.5e-6 + 0.25 + ((i*7919) % 13)*1e-6) - mean_y;
+        sxx += dx*dx;
+        sxy += dx*dy;
+        syy += dy*dy;
+    }
+    long double exact_gain = sxy/sxx, exact_rms = sqrtl((syy - sxy*sxy/sxx)/POINTS);
+    LTC2946_CalFit close;
+    bool clustered_ok = clustered.Fit(LTC2946_Calibration::POWER, &close) && fabsl(close.gain - exact_gain) < exact_gain*1e-6 &&
+                        fabsl(close.rms_residual - exact_rms) < exact_rms*1e-3;
+    printf("    clustered POWER gain %.7g (exact %.7Lg)  rms %.4g (exact %.4Lg)\n", (double)close.gain, exact_gain,
+           (double)close.rms_residual, exact_rms);
+    check(clustered_ok, "clustered 24-bit codes fit like centered long double");
+
+    //! 3) Residual() raises max_residual past the stored points
+    float outlier = (float)(2048*truths[0].gain + truths[0].offset + 1.0);
+    direct.Residual(LTC2946_Calibration::VIN, 2048, outlier);
+    LTC2946_CalFit refit;
+    direct.Fit(LTC2946_Calibration::VIN, &refit);
+    check(direct.Residual(LTC2946_Calibration::VIN, 2048, outlier) < -0.99 && refit.max_residual == fits[0].max_residual,
+          "Residual() of a new point, Fit() starts max_residual over");
+
+    //! 4) Profiles: text from parsed lines equals text from AddPoint, and reads back exactly
+    char profile[512], parsed_profile[512];
+    LTC2946_CalFit unused;
+    for(uint8_t c = 0; c < LTC2946_Calibration::CHANNEL_COUNT; c++) parsed.Fit(truths[c].channel, &unused);
+    size_t length = direct.FormatProfile(profile, sizeof(profile));
+    parsed.FormatProfile(parsed_profile, sizeof(parsed_profile));
+    printf("%s", profile);
+    check(strcmp(profile, parsed_profile) == 0, "profile from parsed lines equals profile from AddPoint");
+
+    bool readback_ok = length == strlen(profile);
+    const char *p = profile;
+    for(uint8_t c = 0; c < LTC2946_Calibration::CHANNEL_COUNT; c++)
+    {
+        char name[16], name_offset[16];
+        float gain, offset, rms;
+        unsigned long points;
+        int used = 0;
+        readback_ok &= sscanf(p, "%15[A-Z]_CONST=%g %15[A-Z]_OFFSET=%g RMS=%g N=%lu\n%n",
+                              name, &gain, name_offset, &offset, &rms, &points, &used) == 6;
+        readback_ok &= strcmp(name, truths[c].name) == 0 && strcmp(name_offset, truths[c].name) == 0 &&
+                       gain == fits[c].gain && offset == fits[c].offset && points == POINTS;
+        p += used;
+    }
+    check(readback_ok && *p == 0, "constants and offsets read back from the profile exactly");
+
+    char small[40];
+    size_t truncated = direct.FormatProfile(small, sizeof(small));
+    check(truncated == sizeof(small) - 1 && strlen(small) == truncated, "profile truncated to the buffer");
+
+    printf("%s, %d failures\n", failures ? "FAIL" : "PASS", failures);
+    return(failures ? 1 : 0);
+}
@@ -0,0 +1,102 @@
+/*!
+ltc2946_capture_sim: LTC2946_Capture on synthetic fault events
+
+An LTC2946_FakeBus device is sampled every 100us for 20 seconds. Overcurrent pulses of random
+length are injected every 1-3 seconds; samples above the fault level latch FAULT1 MAX_I_SENSE, as
+the chip does with its threshold registers. After each capture is checked, the engine is re-armed.
+Every capture must hold the full pre-trigger history, the trigger sample (the first sample of the
+pulse) and the full post-trigger window. It must also contain the pulse peak.
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_capture_sim.cpp ../../LTC2946_Capture.cpp ../../LTC2946_Batch.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_FakeBus.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_capture_sim
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "LTC2946_Capture.h"
+#include "LTC2946_FakeBus.h"
+
+#define ADDRESS         0x6F
+#define STEP_US         100
+#define DURATION_US     20000000UL
+#define PRE             500
+#define POST            1000
+#define BASE_CODE       700
+#define PULSE_CODE      3200
+#define FAULT_CODE      3000
+
+int main()
+{
+    static uint8_t memory[32768];
+    LTC2946_Arena arena(memory, sizeof(memory));
+    LTC2946_Capture capture(arena, PRE, POST);
+    LTC2946_FakeBus bus;
+    LTC2946 device(bus, ADDRESS);
+    uint32_t seed = 1;
+    uint32_t next_pulse = 1500000, pulse_end = 0, pulse_start = 0;
+    uint16_t pulse_peak = 0;
+    int events = 0, captures = 0, bad = 0;
+
+    if(!capture.Valid())
+    {
+        fprintf(stderr, "arena too small\n");
+        return(1);
+    }
+
+    bus.AddDevice(ADDRESS);
+    bus.SetRegister(ADDRESS, LTC2946_VIN_MSB_REG, 0x1E, 0x30);
+    capture.SetFaultMask(LTC2946_FAULT1_MAX_I_SENSE);
+    capture.SetSlope(LTC2946_Capture::CURRENT, 1000);
+    capture.Arm();
+
+    printf("capture   cause  trigger us  late us  samples  pre  post  peak\n");
+
+    for(uint32_t t = 0; t < DURATION_US; t += STEP_US)
+    {
+        //! 1) Synthetic rail: noise around BASE_CODE, pulses of 0.5-5ms
+        seed = seed*1664525 + 1013904223;
+        uint16_t code = BASE_CODE + ((seed >> 20) & 7);
+        if(t >= next_pulse)
+        {
+            pulse_start = t;
+            pulse_end = t + 500 + (seed >> 8) % 4500;
+            pulse_peak = 0;
+            next_pulse = t + 1000000 + (seed >> 4) % 2000000;
+            events++;
+        }
+        if(t < pulse_end)
+        {
+            code = PULSE_CODE + ((seed >> 12) & 255);
+            if(code > pulse_peak) pulse_peak = code;
+        }
+        bus.SetRegister(ADDRESS, LTC2946_DELTA_SENSE_MSB_REG, (uint8_t)(code >> 4), (uint8_t)(code << 4));
+        if(code >= FAULT_CODE) bus.Registers(ADDRESS)[LTC2946_FAULT1_REG] |= LTC2946_FAULT1_MAX_I_SENSE;
+
+        //! 2) Sample, check and re-arm finished captures
+        if(capture.Poll(device, t) == LTC2946_Capture::DONE)
+        {
+            LTC2946_CaptureSample s, trigger;
+            uint16_t peak = 0;
+            for(uint16_t i = 0; i < capture.Count(); i++)
+            {
+                capture.Get(i, &s);
+                if(s.current > peak) peak = s.current;
+            }
+            capture.Get(capture.TriggerIndex(), &trigger);
+
+            bool ok = capture.Count() == PRE + 1 + POST && capture.TriggerIndex() == PRE &&
+                      trigger.time == pulse_start && peak == pulse_peak;
+            if(!ok) bad++;
+            captures++;
+
+            printf("%7d  %6u  %10u  %7u  %7u  %3u  %4u  %4u%s\n", captures, capture.GetCause(), trigger.time,
+                   trigger.time - pulse_start, capture.Count(), capture.TriggerIndex(),
+                   capture.Count() - capture.TriggerIndex() - 1, peak, ok ? "" : "  WRONG");
+            capture.Arm();
+        }
+    }
+
+    printf("%d events, %d captures, %d wrong\n", events, captures, bad);
+    return((bad == 0 && captures == events) ? 0 : 1);
+}
@@ -0,0 +1,287 @@
+/*!
+ltc2946_coherent_sim: coherence of separate reads, a plain burst and LTC2946_Coherent
+
+A simulated LTC2946 updates its result registers on a schedule while the bus is in use: every
+transferred byte advances simulated time by 9 bit times, so a conversion can land between two
+transactions or in the middle of a burst. Delta sense and power are updated together every
+CYCLE_US; VIN half a cycle later. Current jumps on every conversion, VIN wanders by a code or two
+and every VIN_STEP_EVERY conversions steps by VIN_STEP codes, which leaves power (made with the VIN
+before) off by far more than the tolerance until the next delta sense conversion. Every conversion
+latches FAULT2 ADC done, which a write of 0 clears.
+
+Three readers poll at random intervals for 120 simulated seconds:
+    separate    ReadVIN, ReadCurrent, ReadPower codes (three transactions)
+    burst       ReadAllCodes (one transaction, no checking)
+    coherent    LTC2946_Coherent
+and are scored on samples whose power code is not the product of their VIN and delta sense codes
+(within one LSB of either), repeats (delivered as new data with no conversion since the previous
+one), and bus bytes per new sample. LTC2946_Coherent must flag the samples after a VIN step as VIN
+only, in two bursts or fewer on average, never as incoherent. Then LTC2946_Coherent runs on a steady rail, whose conversions
+repeat the same codes: every one must still come out as new, none flagged stale, until the ADC
+stops and the samples turn stale.
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_coherent_sim.cpp ../../LTC2946_Coherent.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_coherent_sim
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "LTC2946_Coherent.h"
+
+#define BUS_HZ          100000
+#define CYCLE_US        16400               //delta sense/power update period
+#define DURATION_US     120000000ULL
+#define STEADY_US       10000000ULL
+#define STALE_US        200000              //LTC2946_Coherent default
+#define VIN_STEP        200                 //codes, 5V
+#define VIN_STEP_EVERY  40                  //VIN conversions
+
+//! One LTC2946 with time driven result registers
+class ScheduledBus : public LTC2946_Bus {
+public:
+    uint64_t now_ns = 0;
+    uint64_t bytes = 0;
+    uint32_t conversions = 0;
+    bool steady = false;                            //conversions repeat the same codes
+    bool stopped = false;                           //ADC not converting
+
+    ScheduledBus()
+    {
+        memset(reg, 0, sizeof(reg));
+        Convert(true);
+    }
+
+    int8_t Transfer(uint8_t, const uint8_t *write_data, uint8_t write_length, uint8_t *read_data, uint8_t read_length)
+    {
+        Advance(3);                                 //start, address, stop
+        if(write_length > 0)
+        {
+            pointer = write_data[0];
+            Advance(9*write_length);
+        }
+        for(uint8_t i = 1; i < write_length; i++)
+        {
+            //Only FAULT2 is written here: bits written 0 are cleared
+            if(pointer == LTC2946_FAULT2_REG) reg[pointer] &= write_data[i];
+            pointer++;
+        }
+        if(read_length > 0) Advance(12);            //repeated start and address
+        for(uint8_t i = 0; i < read_length; i++)
+        {
+            read_data[i] = reg[pointer++];          //byte is latched, then clocked out
+            Advance(9);
+        }
+        bytes += write_length + read_length + 1;
+        return(0);
+    }
+
+    //! Let the rail run with the bus idle
+    void Idle(uint64_t ns)
+    {
+        now_ns += ns;
+        Update();
+    }
+
+private:
+    void Advance(uint32_t bits)
+    {
+        now_ns += (uint64_t)bits*1000000000ULL/BUS_HZ;
+        Update();
+    }
+
+    void Update()
+    {
+        while(now_ns >= next_current || now_ns >= next_vin)
+        {
+            seed = seed*1664525 + 1013904223;
+            if(steady) seed = 2 << 16;              //VIN +0, current 702
+            if(stopped)
+            {
+                next_current = next_vin = ~0ULL;
+                break;
+            }
+            if(next_vin <= next_current)
+            {
+                //Supply wanders by a code or two, and steps up and down now and then
+                vin = (uint16_t)(vin + ((seed >> 16) % 5) - 2);
+                if(!steady && ++vin_conversions % VIN_STEP_EVERY == 0)
+                {
+                    vin = (uint16_t)((vin_conversions/VIN_STEP_EVERY) % 2 ? vin + VIN_STEP : vin - VIN_STEP);
+                }
+                next_vin += CYCLE_US*1000ULL;
+                Convert(false);
+            }
+            else
+            {
+                //Busy load, new current every conversion
+                current = (uint16_t)(700 + ((seed >> 16) & 255));
+                next_current += CYCLE_US*1000ULL;
+                Convert(true);
+            }
+        }
+    }
+
+    void Convert(bool new_current)
+    {
+        //Power is the product of each new delta sense and the VIN code at that time
+        if(new_current)
+        {
+            uint32_t power = (uint32_t)vin*current;
+            reg[LTC2946_POWER_MSB2_REG] = (uint8_t)(power >> 16);
+            reg[LTC2946_POWER_MSB1_REG] = (uint8_t)(power >> 8);
+            reg[LTC2946_POWER_LSB_REG] = (uint8_t)power;
+            reg[LTC2946_DELTA_SENSE_MSB_REG] = (uint8_t)(current >> 4);
+            reg[LTC2946_DELTA_SENSE_LSB_REG] = (uint8_t)(current << 4);
+        }
+        reg[LTC2946_VIN_MSB_REG] = (uint8_t)(vin >> 4);
+        reg[LTC2946_VIN_LSB_REG] = (uint8_t)(vin << 4);
+        reg[LTC2946_FAULT2_REG] |= LTC2946_FAULT2_ADC_DONE;
+        conversions++;
+    }
+
+    uint8_t reg[256];
+    uint8_t pointer = 0;
+    uint16_t vin = 1200;
+    uint16_t current = 700;
+    uint32_t vin_conversions = 0;
+    uint64_t next_current = 0;
+    uint64_t next_vin = CYCLE_US*500ULL;
+    uint32_t seed = 1;
+};
+
+//Power code not the product of the VIN and delta sense codes read with it, allowing one LSB of either
+static bool incoherent(uint16_t vin, uint16_t current, uint32_t power)
+{
+    uint32_t product = (uint32_t)vin*current;
+    return((product > power ? product - power : power - product) > (uint32_t)vin + current);
+}
+
+struct Score
+{
+    uint32_t samples;       //samples delivered as new data
+    uint32_t incoherent;
+    uint32_t repeats;       //delivered as new with no conversion since the previous one
+    uint64_t bytes;
+    uint32_t vin_only;      //LTC2946_Coherent: flagged VIN only
+    uint32_t vin_only_bursts;   //bursts those took
+};
+
+static void report(const char *name, const Score &s)
+{
+    printf("%-9s %8u  %10u (%5.2f%%)  %8u  %8.1f\n", name, s.samples, s.incoherent, 100.0*s.incoherent/s.samples,
+           s.repeats, (double)s.bytes/s.samples);
+}
+
+int main()
+{
+    Score score[3];
+
+    for(int reader = 0; reader < 3; reader++)
+    {
+        ScheduledBus bus;
+        LTC2946 device(bus, 0x6F);
+        LTC2946_Coherent coherent(device);
+        uint32_t seed = 7;
+        uint32_t last_conversions = ~0u;
+        Score &s = score[reader];
+        memset(&s, 0, sizeof(s));
+
+        while(bus.now_ns < DURATION_US*1000ULL)
+        {
+            uint16_t vin, current, adin;
+            uint32_t power;
+
+            if(reader == 0)
+            {
+                uint16_t v, c;
+                uint32_t p;
+                uint8_t reg;
+                //Codes as ReadVIN, ReadCurrent and ReadPower fetch them, one transaction each
+                uint8_t b[3];
+                reg = LTC2946_VIN_MSB_REG;
+                bus.Transfer(0x6F, &reg, 1, b, 2);
+                v = (uint16_t)((b[0] << 4) | (b[1] >> 4));
+                reg = LTC2946_DELTA_SENSE_MSB_REG;
+                bus.Transfer(0x6F, &reg, 1, b, 2);
+                c = (uint16_t)((b[0] << 4) | (b[1] >> 4));
+                reg = LTC2946_POWER_MSB2_REG;
+                bus.Transfer(0x6F, &reg, 1, b, 3);
+                p = ((uint32_t)b[0] << 16) | ((uint32_t)b[1] << 8) | b[2];
+                vin = v; current = c; power = p;
+            }
+            else if(reader == 1)
+            {
+                device.ReadAllCodes(&vin, &current, &power, &adin);
+            }
+            else
+            {
+                LTC2946_CoherentSample sample;
+                uint8_t flags = coherent.Read((uint32_t)(bus.now_ns/1000), &sample);
+                vin = sample.vin; current = sample.current; power = sample.power;
+                //Consumer skips what the reader flags as not new, and power that lags VIN
+                if(flags & LTC2946_SAMPLE_VIN_ONLY)
+                {
+                    s.vin_only++;
+                    s.vin_only_bursts += sample.attempts;
+                }
+                if(flags & (LTC2946_SAMPLE_DUPLICATE | LTC2946_SAMPLE_STALE | LTC2946_SAMPLE_VIN_ONLY))
+                {
+                    seed = seed*1664525 + 1013904223;
+                    bus.Idle(1000000ULL + (seed >> 8) % 8000000ULL);
+                    continue;
+                }
+            }
+
+            s.samples++;
+            if(incoherent(vin, current, power)) s.incoherent++;
+            if(bus.conversions == last_conversions) s.repeats++;
+            last_conversions = bus.conversions;
+
+            //Poll every 1-9ms, faster than the conversions, so some reads see no new data
+            seed = seed*1664525 + 1013904223;
+            bus.Idle(1000000ULL + (seed >> 8) % 8000000ULL);
+        }
+        s.bytes = bus.bytes;
+    }
+
+    printf("%ds at %dkHz, conversion every %.1fms\n", (int)(DURATION_US/1000000), BUS_HZ/1000, CYCLE_US/1000.0);
+    printf("reader     samples  incoherent           repeats  bytes/sample\n");
+    report("separate", score[0]);
+    report("burst", score[1]);
+    report("coherent", score[2]);
+    printf("coherent: %u samples flagged VIN only, %.2f bursts each\n", score[2].vin_only, (double)score[2].vin_only_bursts/score[2].vin_only);
+    bool ok = score[2].incoherent == 0 && score[2].repeats == 0 && score[2].vin_only > 0 && score[2].vin_only_bursts <= 2*score[2].vin_only;
+
+    //! Steady rail: identical codes from every conversion are new samples, not duplicates
+    ScheduledBus bus;
+    bus.steady = true;
+    LTC2946 device(bus, 0x6F);
+    LTC2946_Coherent coherent(device);
+    LTC2946_CoherentSample sample;
+    uint32_t delivered = 0, stale = 0, first = bus.conversions;
+    while(bus.now_ns < STEADY_US*1000ULL)
+    {
+        uint8_t flags = coherent.Read((uint32_t)(bus.now_ns/1000), &sample);
+        if(flags == 0) delivered++;
+        if(flags & LTC2946_SAMPLE_STALE) stale++;
+        bus.Idle(1000000ULL);
+    }
+    uint32_t converted = bus.conversions - first;
+
+    //ADC stops: duplicates, then stale once the stale time has passed
+    bus.stopped = true;
+    bus.Idle(1000000ULL);
+    coherent.Read((uint32_t)(bus.now_ns/1000), &sample);
+    uint8_t soon = coherent.Read((uint32_t)(bus.now_ns/1000), &sample);
+    bus.Idle(STALE_US*1000ULL);
+    uint8_t later = coherent.Read((uint32_t)(bus.now_ns/1000), &sample);
+
+    printf("steady rail: %u conversions, %u new samples, %u stale; stopped: 0x%02X, after %dms 0x%02X\n", converted,
+           delivered, stale, soon, STALE_US/1000, later);
+    ok &= stale == 0 && delivered + 2 >= converted && delivered <= converted + 1 &&
+          soon == LTC2946_SAMPLE_DUPLICATE && later == (LTC2946_SAMPLE_DUPLICATE | LTC2946_SAMPLE_STALE);
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return(ok ? 0 : 1);
+}
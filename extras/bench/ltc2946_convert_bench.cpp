@@ -0,0 +1,105 @@
+/*!
+ltc2946_convert_bench: LTC2946_Convert batch kernels against the scalar path
+
+Checks every 12-bit code (with and without a bidirectional zero code) and random 24-bit and signed
+codes for bit-exact agreement with the scalar reference, then times both on large arrays.
+
+Build (from this directory), native instruction set:
+    g++ -O2 -march=native -ffp-contract=off -I../.. ltc2946_convert_bench.cpp ../../LTC2946_Convert.cpp -o ltc2946_convert_bench
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "LTC2946_Convert.h"
+
+#define BENCH_SAMPLES   (16u*1024*1024)
+#define BENCH_REPEAT    8
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+static bool same(const std::vector<float> &a, const std::vector<float> &b)
+{
+    return(memcmp(a.data(), b.data(), a.size()*sizeof(float)) == 0);
+}
+
+int main()
+{
+    bool exact = true;
+    uint32_t seed = 1;
+
+    printf("instruction set: %s\n", LTC2946_convert_isa());
+
+    //! 1) Bit exactness over the whole 12-bit code space, odd length to exercise the scalar tail
+    std::vector<uint16_t> all12(4096 + 3);
+    for(size_t i = 0; i < all12.size(); i++) all12[i] = (uint16_t)(i & 0xFFF);
+    std::vector<float> fast(all12.size()), reference(all12.size());
+
+    LTC2946_convert_12_bits(all12.data(), fast.data(), all12.size(), 0.02485474f, 0.013f);
+    LTC2946_convert_12_bits_scalar(all12.data(), reference.data(), all12.size(), 0.02485474f, 0.013f);
+    exact = exact && same(fast, reference);
+
+    LTC2946_convert_12_bits(all12.data(), fast.data(), all12.size(), 0.00119677419f, -0.002f, 2048);
+    LTC2946_convert_12_bits_scalar(all12.data(), reference.data(), all12.size(), 0.00119677419f, -0.002f, 2048);
+    exact = exact && same(fast, reference);
+
+    std::vector<uint32_t> codes24(100003);
+    std::vector<int32_t> signed24(codes24.size());
+    for(size_t i = 0; i < codes24.size(); i++)
+    {
+        seed = seed*1664525 + 1013904223;
+        codes24[i] = seed >> 8;
+        signed24[i] = (int32_t)(seed >> 8) - 0x800000;
+    }
+    fast.resize(codes24.size());
+    reference.resize(codes24.size());
+
+    LTC2946_convert_24_bits(codes24.data(), fast.data(), codes24.size(), 0.00003171126055f, 0);
+    LTC2946_convert_24_bits_scalar(codes24.data(), reference.data(), codes24.size(), 0.00003171126055f, 0);
+    exact = exact && same(fast, reference);
+
+    LTC2946_convert_signed(signed24.data(), fast.data(), signed24.size(), 0.00003171126055f, 0.5f);
+    LTC2946_convert_signed_scalar(signed24.data(), reference.data(), signed24.size(), 0.00003171126055f, 0.5f);
+    exact = exact && same(fast, reference);
+
+    printf("bit exact against scalar: %s\n", exact ? "yes" : "NO");
+
+    //! 2) Throughput
+    std::vector<uint16_t> codes12(BENCH_SAMPLES);
+    for(size_t i = 0; i < codes12.size(); i++) codes12[i] = (uint16_t)((i*2654435761u) >> 20);
+    codes24.resize(BENCH_SAMPLES);
+    for(size_t i = 0; i < codes24.size(); i++) codes24[i] = (uint32_t)((i*2654435761u) >> 8);
+    std::vector<float> out(BENCH_SAMPLES);
+
+    double t_scalar12 = 0, t_batch12 = 0, t_scalar24 = 0, t_batch24 = 0;
+    for(int r = 0; r < BENCH_REPEAT; r++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        LTC2946_convert_12_bits_scalar(codes12.data(), out.data(), out.size(), 0.02485474f, 0);
+        t_scalar12 += seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        LTC2946_convert_12_bits(codes12.data(), out.data(), out.size(), 0.02485474f, 0);
+        t_batch12 += seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        LTC2946_convert_24_bits_scalar(codes24.data(), out.data(), out.size(), 0.00003171126055f, 0);
+        t_scalar24 += seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        LTC2946_convert_24_bits(codes24.data(), out.data(), out.size(), 0.00003171126055f, 0);
+        t_batch24 += seconds_since(start);
+    }
+
+    double samples = (double)BENCH_SAMPLES*BENCH_REPEAT;
+    printf("12-bit: scalar %.0f Msamples/s, batch %.0f Msamples/s\n", samples/t_scalar12/1e6, samples/t_batch12/1e6);
+    printf("24-bit: scalar %.0f Msamples/s, batch %.0f Msamples/s\n", samples/t_scalar24/1e6, samples/t_batch24/1e6);
+
+    return(exact ? 0 : 1);
+}
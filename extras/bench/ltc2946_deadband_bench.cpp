@@ -0,0 +1,115 @@
+/*!
+ltc2946_deadband_bench: traffic reduction and fidelity of LTC2946_Deadband on synthetic rails
+
+Generates one hour of 100 Hz RAW samples for a quiet 12V rail: a few codes of noise, slow drift,
+load steps and short current spikes. For several deadbands it reports how many samples were sent,
+the largest error of a hold-last-report reconstruction, and how many spikes were reported within the
+deadband of their peak.
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_deadband_bench.cpp ../../LTC2946_Deadband.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_deadband_bench
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include "LTC2946_Deadband.h"
+
+#define RATE_HZ         100
+#define SAMPLES         (3600u*RATE_HZ)
+#define MAX_SILENCE_MS  1000
+
+struct Codes
+{
+    uint16_t vin;
+    uint16_t current;
+    uint32_t power;
+    uint16_t adin;
+    bool spike_peak;    //last sample of a spike, largest current
+};
+
+static std::vector<Codes> generate(uint32_t *spikes)
+{
+    std::vector<Codes> trace(SAMPLES);
+    uint32_t seed = 1;
+    double load = 600;
+    int spike_left = 0;
+    *spikes = 0;
+
+    for(uint32_t i = 0; i < SAMPLES; i++)
+    {
+        seed = seed*1664525 + 1013904223;
+        int noise = (int)((seed >> 12) & 3) - 1;
+
+        //Load step every ~5 minutes, 10-50ms spike every ~30 seconds
+        if(((seed >> 4) & 0x7FFF) < 1) load = 400 + ((seed >> 16) & 511);
+        if(spike_left == 0 && ((seed >> 8) & 0xFFF) < 1)
+        {
+            spike_left = 1 + (int)((seed >> 20) & 3);
+            (*spikes)++;
+        }
+
+        double current = load + 20*sin(i*2*M_PI/(600.0*RATE_HZ)) + noise;
+        trace[i].spike_peak = false;
+        if(spike_left > 0)
+        {
+            current += 1500;
+            spike_left--;
+            trace[i].spike_peak = (spike_left == 0);
+        }
+
+        trace[i].vin = (uint16_t)(483 + ((seed >> 24) & 1) - (int)(current/2000));
+        trace[i].current = (uint16_t)current;
+        trace[i].power = (uint32_t)trace[i].vin*trace[i].current;
+        trace[i].adin = (uint16_t)(1500 + ((seed >> 28) & 1));
+    }
+
+    return(trace);
+}
+
+int main()
+{
+    uint32_t spikes;
+    std::vector<Codes> trace = generate(&spikes);
+    const uint32_t deadbands[] = {0, 2, 4, 8, 16, 32};
+
+    printf("%u samples at %d Hz, %u spikes, max silence %d ms\n", SAMPLES, RATE_HZ, spikes, MAX_SILENCE_MS);
+    printf("deadband  reported  reduction  max |err| cur  max |err| pwr  spikes seen\n");
+
+    for(size_t d = 0; d < sizeof(deadbands)/sizeof(deadbands[0]); d++)
+    {
+        LTC2946_Deadband filter(MAX_SILENCE_MS);
+        uint32_t db = deadbands[d];
+        uint32_t power_db = db*483;         //Same relative band on power (VIN code * delta sense code)
+        uint32_t err_current = 0, err_power = 0, spikes_seen = 0;
+
+        filter.SetDeadband(LTC2946_Deadband::VIN, db);
+        filter.SetDeadband(LTC2946_Deadband::CURRENT, db);
+        filter.SetDeadband(LTC2946_Deadband::POWER, power_db);
+        filter.SetDeadband(LTC2946_Deadband::ADIN, db);
+
+        for(uint32_t i = 0; i < SAMPLES; i++)
+        {
+            const Codes &c = trace[i];
+            filter.Update(i*(1000/RATE_HZ), c.vin, c.current, c.power, c.adin);
+
+            //Receiver holds the last report
+            uint32_t held_current = filter.Code(LTC2946_Deadband::CURRENT);
+            uint32_t held_power = filter.Code(LTC2946_Deadband::POWER);
+            uint32_t e = (uint32_t)abs((int32_t)held_current - (int32_t)c.current);
+            if(e > err_current) err_current = e;
+            e = (uint32_t)labs((long)held_power - (long)c.power);
+            if(e > err_power) err_power = e;
+            if(c.spike_peak && held_current + db >= c.current) spikes_seen++;
+        }
+
+        printf("%8u  %8u  %8.1fx  %13u  %13u  %6u/%u\n", db, filter.Reported(),
+               (double)filter.Seen()/filter.Reported(), err_current, err_power, spikes_seen, spikes);
+
+        if(err_current > db || err_power > power_db || spikes_seen != spikes) return(1);
+    }
+
+    return(0);
+}
@@ -0,0 +1,175 @@
+/*!
+ltc2946_dutycycle_sim: LTC2946_DutyCycle state machine on LTC2946_SimBus with a synthetic ms clock
+
+Update() is called every simulated millisecond while the simulator advances with it. The input
+changes every period, so a sample taken before a fresh conversion would show the old value. Checks:
+    states      IDLE before Start, SHUTDOWN after it, SHUTDOWN -> WAKING at each period, back to
+                SHUTDOWN with the sample
+    CTRLB       one shutdown write at Start, one wake and one shutdown write per sample, the
+                simulated device converting only while awake
+    settle      every sample read exactly wake_ms (40) after the wake, with this period's input
+    catch-up    after Update() is not called for 2.5 periods: one sample at once, no burst of
+                missed ones, then a period between wakes again
+    wrap        the clock starts 1.5 periods before millis() wraps; periods stay exact across it
+    NACK        a read not acknowledged gives no sample and bumps Errors(), not Samples()
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_dutycycle_sim.cpp ../../LTC2946_DutyCycle.cpp ../../LTC2946_SimBus.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_dutycycle_sim
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "LTC2946_DutyCycle.h"
+#include "LTC2946_SimBus.h"
+
+#define ADDRESS         0x6F
+#define PERIOD_MS       500
+#define WAKE_MS         40
+#define SAMPLES         40
+#define GAP_AT          20      //!< Sample after which Update() stops being called
+#define GAP_MS          1250    //!< 2.5 periods
+
+//! LTC2946_SimBus plus a log of the CTRLB writes
+class CtrlbBus : public LTC2946_Bus {
+public:
+    LTC2946_SimBus sim;
+    uint32_t shutdown_writes = 0;
+    uint32_t wake_writes = 0;
+    bool nack_reads = false;        //!< Reads not acknowledged
+
+    int8_t Transfer(uint8_t address, const uint8_t *write_data, uint8_t write_length,
+                    uint8_t *read_data, uint8_t read_length)
+    {
+        if(nack_reads && read_length > 0) return(1);
+        if(write_length >= 2 && write_data[0] == LTC2946_CTRLB_REG)
+        {
+            if(write_data[1] & LTC2946_ENABLE_SHUTDOWN) shutdown_writes++;
+            else wake_writes++;
+        }
+        return(sim.Transfer(address, write_data, write_length, read_data, read_length));
+    }
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-64s %s\n", what, ok ? "ok" : "FAIL");
+    if(!ok) failures++;
+}
+
+int main()
+{
+    CtrlbBus bus;
+    bus.sim.AddDevice(ADDRESS);
+    LTC2946 monitor(bus, ADDRESS);
+    LTC2946_DutyCycle duty(monitor, PERIOD_MS, WAKE_MS);
+
+    //! 1) Start 1.5 periods before the ms clock wraps
+    uint32_t now = 0xFFFFFFFFu - PERIOD_MS*3/2;
+    uint16_t input = 1000;
+    bus.sim.SetInputs(ADDRESS, 100, input, input, 0);
+
+    check(duty.GetState() == LTC2946_DutyCycle::IDLE && bus.shutdown_writes == 0, "IDLE before Start, device untouched");
+    duty.Start(now);
+    check(duty.GetState() == LTC2946_DutyCycle::SHUTDOWN && bus.shutdown_writes == 1 &&
+          (bus.sim.Register(ADDRESS, LTC2946_CTRLB_REG) & LTC2946_ENABLE_SHUTDOWN), "Start: SHUTDOWN, CTRLB shutdown written");
+
+    //! 2) Run
+    uint32_t wakes[SAMPLES], reads[SAMPLES];
+    uint32_t wake_count = 0, read_count = 0;
+    bool states_ok = true, settle_ok = true, fresh_ok = true, converting_ok = true, wrapped = false;
+    LTC2946_DutyCycle::State last = duty.GetState();
+
+    while(read_count < SAMPLES)
+    {
+        //Update() not called for a while after GAP_AT samples (long blocking code in loop)
+        uint32_t step = (read_count == GAP_AT && last == LTC2946_DutyCycle::SHUTDOWN && reads[GAP_AT - 1] + 1 == now) ? GAP_MS : 1;
+        uint32_t before = now;
+        now += step;
+        bus.sim.Advance((uint64_t)step*1000000);
+        wrapped |= now < before;
+
+        bool sampled = duty.Update(now);
+        LTC2946_DutyCycle::State state = duty.GetState();
+        bool shutdown = (bus.sim.Register(ADDRESS, LTC2946_CTRLB_REG) & LTC2946_ENABLE_SHUTDOWN) != 0;
+
+        //! States and the device's shutdown bit move together
+        if(state != last)
+        {
+            if(last == LTC2946_DutyCycle::SHUTDOWN && state == LTC2946_DutyCycle::WAKING)
+            {
+                if(wake_count < SAMPLES) wakes[wake_count] = now;
+                wake_count++;
+            }
+            else if(!(last == LTC2946_DutyCycle::WAKING && state == LTC2946_DutyCycle::SHUTDOWN && sampled))
+            {
+                states_ok = false;
+            }
+        }
+        converting_ok &= shutdown == (state == LTC2946_DutyCycle::SHUTDOWN);
+        last = state;
+
+        if(sampled)
+        {
+            reads[read_count] = now;
+            settle_ok &= now - wakes[read_count] == WAKE_MS;
+            fresh_ok &= duty.VIN() == input;
+            read_count++;
+
+            //Next period gets a different input
+            input = (uint16_t)(1000 + 37*read_count);
+            bus.sim.SetInputs(ADDRESS, 100, input, input, 0);
+        }
+    }
+
+    //! 3) Timing
+    bool periods_ok = true, catch_up_ok = true;
+    for(uint32_t i = 1; i < SAMPLES; i++)
+    {
+        uint32_t spacing = wakes[i] - wakes[i - 1];
+        if(i == GAP_AT)
+        {
+            //The late wake comes on the first Update after the gap, then one period from there
+            catch_up_ok &= wakes[i] == reads[GAP_AT - 1] + 1 + GAP_MS && wakes[i + 1] - wakes[i] == PERIOD_MS;
+        }
+        else if(i != GAP_AT + 1)
+        {
+            //The schedule is anchored at Start, whose first wake is only seen by the Update 1 ms later
+            periods_ok &= spacing == (i == 1 ? PERIOD_MS - 1 : PERIOD_MS);
+        }
+    }
+    printf("    wakes %u, samples %u, CTRLB writes: %u shutdown, %u wake\n", wake_count, read_count,
+           bus.shutdown_writes, bus.wake_writes);
+    printf("    gap: last sample at %u, next wake at %u (+%u ms), then +%u ms\n", reads[GAP_AT - 1], wakes[GAP_AT],
+           wakes[GAP_AT] - reads[GAP_AT - 1], wakes[GAP_AT + 1] - wakes[GAP_AT]);
+
+    check(states_ok, "only SHUTDOWN -> WAKING -> SHUTDOWN (with a sample)");
+    check(converting_ok, "device shut down exactly while SHUTDOWN");
+    check(bus.shutdown_writes == 1 + SAMPLES && bus.wake_writes == SAMPLES, "one wake and one shutdown CTRLB write per sample");
+    check(settle_ok, "every sample read 40 ms after its wake");
+    check(fresh_ok, "every sample from a conversion after the wake");
+    check(catch_up_ok && wake_count == SAMPLES, "missed periods: one late sample, no burst, then a period");
+    check(periods_ok, "wakes one period apart");
+    check(wrapped, "periods exact across the millis() wrap");
+
+    //! 4) A read not acknowledged: no sample, the last one kept, counted; the next period samples again
+    float kept = duty.VIN();
+    bool nack_sampled = false;
+    bus.nack_reads = true;
+    while(duty.GetState() != LTC2946_DutyCycle::WAKING){ now++; bus.sim.Advance(1000000); nack_sampled |= duty.Update(now); }
+    while(duty.GetState() != LTC2946_DutyCycle::SHUTDOWN){ now++; bus.sim.Advance(1000000); nack_sampled |= duty.Update(now); }
+    bus.nack_reads = false;
+    bool resampled = false;
+    for(uint32_t t = 0; t < PERIOD_MS && !resampled; t++){ now++; bus.sim.Advance(1000000); resampled = duty.Update(now); }
+    check(!nack_sampled && duty.Errors() == 1 && duty.Samples() == SAMPLES + 1 && resampled && kept != input,
+          "NACKed read: no sample, Errors() counts it, next period samples");
+
+    //! 5) Stop leaves the device converting
+    duty.Stop();
+    check(duty.GetState() == LTC2946_DutyCycle::IDLE &&
+          !(bus.sim.Register(ADDRESS, LTC2946_CTRLB_REG) & LTC2946_ENABLE_SHUTDOWN), "Stop: IDLE, device awake");
+
+    printf("%s, %d failures\n", failures ? "FAIL" : "PASS", failures);
+    return(failures ? 1 : 0);
+}
@@ -0,0 +1,159 @@
+/*!
+ltc2946_energy_sim: LTC2946_Energy against integrated ReadPower() samples on LTC2946_SimBus
+
+A simulated rail runs a known load profile for 300 s: the delta sense code steps to a new level
+every 0.2-3 s, with occasional 50 ms spikes near full scale, VIN sags with load. The exact energy
+is the integral of VIN code * delta sense code over time. Three accountants run side by side:
+    meter 1 Hz      LTC2946_Energy, one 12 byte accumulator burst per second
+    power 1 Hz      ReadPower() * elapsed time, once per second
+    power 100 Hz    ReadPower() * elapsed time, every 10 ms
+The accumulators are preloaded close to 2^32 so time, charge and energy all wrap during the run,
+the application resets them at 200 s (and tells the meter), and another task resets them at 250 s
+without telling it. Reported: error against the exact energy, an hour-style window from marks,
+and bus transactions and bytes each accountant used.
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_energy_sim.cpp ../../LTC2946_Energy.cpp ../../LTC2946_SimBus.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_energy_sim
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include "LTC2946_Energy.h"
+#include "LTC2946_SimBus.h"
+
+#define ADDRESS         0x6F
+#define BUS_HZ          400000
+#define DURATION_MS     300000
+#define WINDOW_START_MS 60000
+#define WINDOW_END_MS   120000
+#define RESET_TOLD_MS   200000
+#define RESET_UNTOLD_MS 250000
+
+//! Bus traffic of one accountant
+struct Traffic
+{
+    uint32_t transactions = 0;
+    uint32_t bytes = 0;
+};
+
+static void write_reg(LTC2946_SimBus &bus, uint8_t reg, const uint8_t *data, uint8_t length)
+{
+    uint8_t buffer[16];
+    buffer[0] = reg;
+    for(uint8_t i = 0; i < length; i++) buffer[i + 1] = data[i];
+    bus.Transfer(ADDRESS, buffer, length + 1, 0, 0);
+}
+
+static void reset_accumulators(LTC2946_SimBus &bus)
+{
+    uint8_t ctrlb = LTC2946_RESET_ACC;
+    write_reg(bus, LTC2946_CTRLB_REG, &ctrlb, 1);
+}
+
+//! Run a call and charge its bus traffic to an accountant
+template <typename F>
+static void metered(LTC2946_SimBus &bus, Traffic &traffic, F call)
+{
+    uint32_t transactions = bus.Transactions(), bytes = bus.BytesWritten() + bus.BytesRead();
+    call();
+    traffic.transactions += bus.Transactions() - transactions;
+    traffic.bytes += bus.BytesWritten() + bus.BytesRead() - bytes;
+}
+
+static void report(const char *name, double joules, double exact, const Traffic &traffic)
+{
+    printf("  %-14s %10.3f J  error %+7.3f%%  %7u transactions %8u bytes\n", name, joules,
+           (joules - exact)/exact*100, traffic.transactions, traffic.bytes);
+}
+
+int main()
+{
+    LTC2946_SimBus bus(BUS_HZ);
+    bus.AddDevice(ADDRESS);
+
+    LTC2946 monitor(bus, ADDRESS);
+    monitor.Setup();
+    monitor.SetClock(false);
+    monitor.EnableConversion(false);            //ReadPower returns the RAW power code
+    monitor.SetContinuous();
+
+    //Watts per power code, from the same LSBs the meter uses
+    double power_lsb = monitor.GetEnergyLSB()/(65536.0*monitor.GetTimeLSB());
+
+    //! 1) Accumulators close to wrapping
+    const uint8_t preload[LTC2946_ACCUMULATOR_BYTES] = {0xFF, 0xFF, 0xFF, 0x00,     //time, 256 ticks to wrap
+                                                        0xFF, 0xFF, 0x00, 0x00,     //charge
+                                                        0xFF, 0xFF, 0x00, 0x00};    //energy
+    write_reg(bus, LTC2946_TIME_COUNTER_MSB3_REG, preload, sizeof(preload));
+
+    LTC2946_Energy meter(monitor);
+    LTC2946_EnergyMark window_start, window_end;
+    Traffic meter_traffic, slow_traffic, fast_traffic;
+    double slow_codes = 0, fast_codes = 0;      //power code * seconds
+    double exact_codes = 0, window_codes = 0;
+    uint32_t slow_power = 0, fast_power = 0;
+    uint32_t seed = 1;
+    uint32_t level = 1000, spike_end = 0, next_step = 0;
+
+    metered(bus, meter_traffic, [&](){ meter.Update(0); });
+    for(uint32_t t = 0; t < DURATION_MS; t++)
+    {
+        //! 2) Load profile, 1 ms resolution
+        if(t >= next_step)
+        {
+            seed = seed*1664525 + 1013904223;
+            level = 200 + (seed >> 8) % 2800;
+            next_step = t + 200 + (seed >> 4) % 2800;
+            if(((seed >> 24) & 7) == 0) spike_end = t + 50;
+        }
+        uint16_t sense = (uint16_t)((t < spike_end) ? 4000 : level);
+        uint16_t vin = (uint16_t)(2100 - sense/16);
+        bus.SetInputs(ADDRESS, sense, 1800, vin, 500);
+
+        //! 3) Accountants, each at its own rate
+        if(t % 10 == 0)
+        {
+            fast_codes += fast_power*0.010;
+            metered(bus, fast_traffic, [&](){ fast_power = (uint32_t)monitor.ReadPower(); });
+        }
+        if(t % 1000 == 0 && t > 0)
+        {
+            slow_codes += slow_power*1.0;
+            metered(bus, slow_traffic, [&](){ slow_power = (uint32_t)monitor.ReadPower(); });
+            metered(bus, meter_traffic, [&](){ meter.Update(t); });
+        }
+        if(t == WINDOW_START_MS) meter.Mark(&window_start);
+        if(t == WINDOW_END_MS) meter.Mark(&window_end);
+
+        //! 4) Resets: one the meter is told about, one it has to notice
+        if(t == RESET_TOLD_MS)
+        {
+            reset_accumulators(bus);
+            meter.AccumulatorsReset();
+        }
+        if(t == RESET_UNTOLD_MS + 500) reset_accumulators(bus);
+
+        bus.Advance((uint64_t)(t + 1)*1000000 - bus.Now());  //Bus time above is part of this ms
+        exact_codes += (double)vin*sense*0.001;
+        if(t >= WINDOW_START_MS && t < WINDOW_END_MS) window_codes += (double)vin*sense*0.001;
+    }
+    metered(bus, meter_traffic, [&](){ meter.Update(DURATION_MS); });
+
+    double exact = exact_codes*power_lsb;
+    printf("exact %.3f J over %d s, average %.3f W\n", exact, DURATION_MS/1000, exact/(DURATION_MS/1000));
+    report("meter 1 Hz", meter.Energy(), exact, meter_traffic);
+    report("power 1 Hz", slow_codes*power_lsb, exact, slow_traffic);
+    report("power 100 Hz", fast_codes*power_lsb, exact, fast_traffic);
+
+    double window = window_codes*power_lsb;
+    double window_meter = meter.Energy(window_start) - meter.Energy(window_end);
+    printf("window %d-%d s: meter %.3f J, exact %.3f J, error %+.3f%%\n", WINDOW_START_MS/1000, WINDOW_END_MS/1000,
+           window_meter, window, (window_meter - window)/window*100);
+    printf("seconds %.3f, wraps %u, resets %u (1 told, 1 detected)\n", meter.Seconds(), meter.Wraps(), meter.Resets());
+
+    bool ok = meter.Wraps() == 1 && meter.Resets() == 2 &&
+              fabs(meter.Energy() - exact)/exact < 0.01 && fabs(window_meter - window)/window < 0.005;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return(ok ? 0 : 1);
+}
@@ -0,0 +1,137 @@
+/*!
+ltc2946_interval_sim: interval accumulation with auto-reset and cleared-on-read on LTC2946_SimBus
+
+A simulated rail is read in 300 intervals of 0.5-1.5 s, the load changing every interval. Each
+interval should give the time, energy and overflow flags of that interval alone. Two ways:
+    read, reset     ReadAccumulators (on to FAULT2), ResetAccumulators, FAULT2 cleared by a write
+    interval mode   SetAutoReset + SetClearedOnRead, then ReadAccumulators (on to FAULT2) only
+The energy register is preloaded 256 codes from overflow before the first interval, so exactly one
+interval should report the energy overflow flag. Checked: ticks counted against elapsed time, energy
+against the exact integral, the overflow flag count, and bus transactions and time per interval.
+Ticks that land while an interval is being read out (or, for read, reset, before the reset write)
+are lost to the reset, so the fewer bus transactions per interval, the fewer ticks are lost.
+A third run reads the interval mode through LTC2946_Energy, which must take each reading as a whole
+interval (no overflow flags there, the meter's burst stops at the energy register).
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_interval_sim.cpp ../../LTC2946_Energy.cpp ../../LTC2946_SimBus.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_interval_sim
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include "LTC2946_Energy.h"
+#include "LTC2946_SimBus.h"
+
+#define ADDRESS         0x6F
+#define BUS_HZ          100000
+#define INTERVALS       300
+#define ENERGY_PRELOAD  0xFFFFFF00
+
+enum Method
+{
+    READ_RESET = 0,
+    INTERVAL_MODE = 1,
+    INTERVAL_METER = 2
+};
+
+//! @return ticks lost, -1 if the interval semantics failed
+static int run(Method method, const char *name)
+{
+    LTC2946_SimBus bus(BUS_HZ);
+    bus.AddDevice(ADDRESS);
+
+    LTC2946 monitor(bus, ADDRESS);
+    monitor.Setup();
+    monitor.SetClock(false);
+    monitor.EnableConversion(false);
+    monitor.SetContinuous();
+    if(method != READ_RESET)
+    {
+        monitor.SetAutoReset(true);
+        monitor.SetClearedOnRead(true);
+    }
+    double power_lsb = monitor.GetEnergyLSB()/(65536.0*monitor.GetTimeLSB());
+
+    LTC2946_Energy meter(monitor);
+    uint32_t time, charge, energy;
+    uint8_t fault2 = 0;
+
+    //! 1) Start of the first interval: accumulators and FAULT2 cleared, energy close to overflow
+    monitor.ResetAccumulators();
+    uint8_t preload[5] = {LTC2946_ENERGY_MSB3_REG, 0xFF, 0xFF, 0xFF, 0x00};
+    uint8_t clear[2] = {LTC2946_FAULT2_REG, 0x00};
+    bus.Transfer(ADDRESS, preload, sizeof(preload), 0, 0);
+    bus.Transfer(ADDRESS, clear, sizeof(clear), 0, 0);
+    bus.ResetCounters();
+
+    uint32_t seed = 7, overflows = 0;
+    uint64_t ticks_total = 0, energy_total = 0, elapsed_ns = 0;
+    double exact_codes = 0, worst_interval = 0;
+    for(int i = 0; i < INTERVALS; i++)
+    {
+        //! 2) One interval at a constant load
+        seed = seed*1664525 + 1013904223;
+        uint16_t sense = (uint16_t)(200 + (seed >> 8) % 2800);
+        uint16_t vin = (uint16_t)(2100 - sense/16);
+        bus.SetInputs(ADDRESS, sense, 1800, vin, 500);
+        uint64_t interval_ns = 500000000ULL + (seed >> 4) % 1000000000ULL;
+        uint64_t interval_start = bus.Now();
+        bus.Advance(interval_ns);
+
+        //! 3) Interval reading
+        if(method == INTERVAL_METER)
+        {
+            if(i == 0) meter.Update(0);    //Baseline: the preloaded count is not part of any interval
+            else meter.Update((uint32_t)(bus.Now()/1000000));
+            time = (uint32_t)(meter.TimeCode() - ticks_total);
+            energy = (uint32_t)(meter.EnergyCode() - energy_total);
+        }
+        else
+        {
+            monitor.ReadAccumulators(&time, &charge, &energy, &fault2);
+            if(i == 0) energy -= ENERGY_PRELOAD;
+        }
+        if(method == READ_RESET)
+        {
+            monitor.ResetAccumulators();
+            bus.Transfer(ADDRESS, clear, sizeof(clear), 0, 0);
+        }
+        if(method == INTERVAL_METER && i == 0) continue;
+
+        if(fault2 & LTC2946_FAULT2_ENERGY_OVERFLOW) overflows++;
+        ticks_total += time;
+        energy_total += energy;
+
+        //Exact for the time this reading covers, reading to reading
+        elapsed_ns += bus.Now() - interval_start;
+        double seconds = (bus.Now() - interval_start)*1e-9;
+        exact_codes += (double)vin*sense*seconds;
+        double error = fabs(energy - (double)vin*sense*seconds/65536/monitor.GetTimeLSB());
+        if(error > worst_interval) worst_interval = error;
+    }
+
+    double elapsed = elapsed_ns*1e-9;
+    double counted = ticks_total*monitor.GetTimeLSB();
+    double exact = exact_codes*power_lsb;
+    double measured = energy_total*monitor.GetEnergyLSB();
+    printf("%-14s time %.3f of %.3f s (%.0f ticks lost)  energy %+.3f%%  worst interval %.0f codes  overflow flags %u  "
+           "%.1f transactions %.0f us bus per interval\n",
+           name, counted, elapsed, (elapsed - counted)/monitor.GetTimeLSB(), (measured - exact)/exact*100, worst_interval,
+           overflows, (double)bus.Transactions()/INTERVALS, bus.BusTime()/1000.0/INTERVALS);
+
+    bool ok = fabs(counted - elapsed)/elapsed < 0.005 && fabs(measured - exact)/exact < 0.002;
+    if(method == INTERVAL_METER) ok = ok && meter.Resets() == 0 && meter.Wraps() == 0;
+    else ok = ok && overflows == 1;
+    return(ok ? (int)lround((elapsed - counted)/monitor.GetTimeLSB()) : -1);
+}
+
+int main()
+{
+    int read_reset = run(READ_RESET, "read, reset");
+    int interval = run(INTERVAL_MODE, "interval mode");
+    int interval_meter = run(INTERVAL_METER, "interval meter");
+    bool ok = read_reset >= 0 && interval >= 0 && interval_meter >= 0 && interval < read_reset;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return(ok ? 0 : 1);
+}
@@ -0,0 +1,168 @@
+/*!
+ltc2946_plan_bench: LTC2946_Plan against per-quantity reads and one covering burst on LTC2946_FakeBus
+
+For each request set and bus setting three ways of reading it:
+    per quantity    one ReadRegisters per requested register (the ReadVIN/ReadPower style)
+    one span        one burst from the first to the last requested register
+    plan            LTC2946_Plan
+Transactions and bytes are counted by the fake bus; time is modeled per transaction as
+LTC2946_Plan::TransactionNs. The fake register file is filled with random bytes and every requested
+register read by the plan is checked against it. A bus clock of 0 (ClockHz() of a bus that does not
+know its clock) must plan as the default clock. Fails if a plan is slower than either other way
+(one span only counts where it keeps out of FAULT1/FAULT2) or reads wrong bytes.
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_plan_bench.cpp ../../LTC2946_Plan.cpp ../../LTC2946_FakeBus.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_plan_bench
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "LTC2946_Plan.h"
+#include "LTC2946_FakeBus.h"
+
+#define ADDRESS         0x6F
+
+struct Request
+{
+    const char *name;
+    uint64_t quantities;
+};
+
+struct BusSetting
+{
+    const char *name;
+    uint32_t bus_hz;
+    uint32_t overhead_ns;
+    uint8_t max_length;
+};
+
+static const Request requests[] = {
+    {"power+VIN",           LTC2946_PLAN_POWER | LTC2946_PLAN_VIN},
+    {"current+charge",      LTC2946_PLAN_CURRENT | LTC2946_PLAN_CHARGE},
+    {"measurements",        LTC2946_PLAN_MEASUREMENTS},
+    {"status+power",        LTC2946_PLAN_STATUS | LTC2946_PLAN_POWER},
+    {"VIN+energy+FAULT2",   LTC2946_PLAN_VIN | LTC2946_PLAN_ENERGY | LTC2946_plan_quantity(LTC2946_Map::FAULT2)},
+    {"everything",          LTC2946_PLAN_MEASUREMENTS | LTC2946_PLAN_ACCUMULATORS | LTC2946_PLAN_STATUS},
+};
+
+static const BusSetting settings[] = {
+    {"100kHz",              100000,  0,     LTC2946_REGISTER_COUNT},
+    {"400kHz",              400000,  0,     LTC2946_REGISTER_COUNT},
+    {"1MHz",                1000000, 0,     LTC2946_REGISTER_COUNT},
+    {"400kHz +5us",         400000,  5000,  LTC2946_REGISTER_COUNT},
+    {"400kHz +80us linux",  400000,  80000, LTC2946_REGISTER_COUNT},
+    {"1MHz +80us linux",    1000000, 80000, LTC2946_REGISTER_COUNT},
+    {"400kHz 32B wire",     400000,  5000,  32},
+    {"unknown clock (0)",   0,       0,     LTC2946_REGISTER_COUNT},
+};
+
+struct Result
+{
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t ns;
+};
+
+static void print(const Result &r, bool valid = true)
+{
+    printf(valid ? "  %2u %3u %7.1f" : "  (%u %3u %7.1f)", r.transactions, r.bytes, r.ns/1000.0);
+}
+
+int main()
+{
+    LTC2946_FakeBus bus;
+    bus.AddDevice(ADDRESS);
+    LTC2946 monitor(bus, ADDRESS);
+    monitor.Setup();
+
+    uint32_t seed = 11;
+    uint8_t *registers = bus.Registers(ADDRESS);
+    for(uint8_t i = 0; i < LTC2946_REGISTER_COUNT; i++)
+    {
+        seed = seed*1664525 + 1013904223;
+        registers[i] = (uint8_t)(seed >> 24);
+    }
+
+    printf("transactions, bytes, modeled us; (one span) reads FAULT1/FAULT2 unasked or is too long for the bus\n");
+    printf("%-19s %-18s  %-15s  %-15s  %-15s  %s\n", "bus", "request", "per quantity", "one span", "plan", "bursts");
+    int failures = 0;
+    for(const BusSetting &s : settings)
+    {
+        for(const Request &q : requests)
+        {
+            printf("%-19s %-18s", s.name, q.name);
+            uint8_t image[LTC2946_REGISTER_COUNT];
+            uint8_t buffer[LTC2946_REGISTER_COUNT];
+            Result each = {0, 0, 0}, span = {0, 0, 0}, planned = {0, 0, 0};
+
+            //! 1) One transaction per register
+            uint8_t first = 0xFF, last = 0;
+            bus.ResetCounters();
+            for(uint8_t i = 0; i < LTC2946_Map::REGISTER_COUNT; i++)
+            {
+                if(!(q.quantities & (1ULL << i))) continue;
+                const LTC2946_Register &r = LTC2946_Map::REGISTERS[i];
+                monitor.ReadRegisters(r.address, buffer, r.width);
+                each.ns += LTC2946_Plan::TransactionNs(r.width, s.bus_hz, s.overhead_ns);
+                if(first == 0xFF) first = r.address;
+                last = r.Last();
+            }
+            each.transactions = bus.Transactions();
+            each.bytes = bus.BytesRead();
+
+            //! 2) One burst over all of them, if the bus takes it and it stays out of the latched registers
+            bool span_valid = last - first + 1 <= s.max_length;
+            for(uint8_t a = first; a <= last; a++)
+            {
+                if(LTC2946_Map::Access(a) == LTC2946_ACCESS_RC &&
+                   !(q.quantities & (1ULL << LTC2946_Map::Index(a)))) span_valid = false;
+            }
+            bus.ResetCounters();
+            monitor.ReadRegisters(first, buffer, last - first + 1);
+            span.ns = LTC2946_Plan::TransactionNs(last - first + 1, s.bus_hz, s.overhead_ns);
+            span.transactions = bus.Transactions();
+            span.bytes = bus.BytesRead();
+
+            //! 3) Plan
+            LTC2946_Plan plan(q.quantities, s.bus_hz, s.overhead_ns, s.max_length);
+            memset(image, 0, sizeof(image));
+            bus.ResetCounters();
+            plan.Read(monitor, image);
+            planned.transactions = bus.Transactions();
+            planned.bytes = bus.BytesRead();
+            planned.ns = plan.Nanoseconds();
+
+            print(each);
+            print(span, span_valid);
+            print(planned);
+            printf("  ");
+            for(uint8_t i = 0; i < plan.Count(); i++) printf(" %02X+%u", plan.Burst(i).reg, plan.Burst(i).length);
+
+            //! 4) Checks
+            bool wrong = plan.Quantities() != q.quantities || planned.transactions != plan.Count() || planned.bytes != plan.Bytes();
+            for(uint8_t i = 0; i < LTC2946_Map::REGISTER_COUNT; i++)
+            {
+                if(!(q.quantities & (1ULL << i))) continue;
+                const LTC2946_Register &r = LTC2946_Map::REGISTERS[i];
+                wrong |= memcmp(image + r.address, registers + r.address, r.width) != 0;
+            }
+            bool slower = planned.ns > each.ns || (span_valid && planned.ns > span.ns);
+            if(s.bus_hz == 0)
+            {
+                //ClockHz() of a bus that does not know: planned as at the default clock
+                LTC2946_Plan fallback(q.quantities, LTC2946_BUS_DEFAULT_HZ, s.overhead_ns, s.max_length);
+                wrong |= fallback.Count() != plan.Count() || fallback.Nanoseconds() != plan.Nanoseconds();
+            }
+            if(wrong || slower)
+            {
+                printf("  FAIL%s%s", wrong ? " wrong bytes" : "", slower ? " slower" : "");
+                failures++;
+            }
+            printf("\n");
+        }
+    }
+
+    printf("%s, %d failures\n", failures ? "FAIL" : "PASS", failures);
+    return(failures ? 1 : 0);
+}
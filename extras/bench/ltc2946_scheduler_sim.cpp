@@ -0,0 +1,208 @@
+/*!
+ltc2946_scheduler_sim: LTC2946_Scheduler against fixed-rate polling on a simulated bus
+
+Eight LTC2946s on an LTC2946_FakeBus whose delta sense registers are updated every 100us from
+synthetic rails. Six rails are quiet; two see 200ms load transients (20Hz ringing and a spike
+that sets FAULT1) every few seconds. Both pollers get the same bus budget: fixed-rate polling splits
+it evenly, the scheduler moves it to active rails.
+
+Reported per poller: bus utilization, RMS and peak error of a hold-last-poll reconstruction during
+transients and on quiet rails, and the fraction of transient peaks seen.
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_scheduler_sim.cpp ../../LTC2946_Scheduler.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_FakeBus.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_scheduler_sim
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "LTC2946_Scheduler.h"
+#include "LTC2946_FakeBus.h"
+
+#define DEVICES         8
+#define ACTIVE_FIRST    6           //devices 6 and 7 have transients
+#define STEP_US         100
+#define DURATION_S      60
+#define BUS_HZ          400000
+#define UTILIZATION     0.5f
+#define EVENT_US        200000
+#define MIN_RATE        20          //adaptive poll rate limits, polls per second
+#define MAX_RATE        500
+#define FAULT_CODE      2500        //delta sense code that latches a max I sense fault
+
+struct Rail
+{
+    uint32_t event_start;   //start of the current/next transient
+    uint16_t peak;          //largest code in the current transient
+    bool in_event;
+};
+
+struct Score
+{
+    double event_sq;        //squared error sums
+    double quiet_sq;
+    uint32_t event_steps;
+    uint32_t quiet_steps;
+    uint32_t event_max;
+    uint32_t quiet_max;
+    uint32_t peaks;         //transients whose peak was polled (within 5%)
+    uint32_t events;
+    uint16_t polled_peak[DEVICES];
+    uint32_t polls;
+};
+
+static uint32_t seed = 1;
+static uint32_t next_random()
+{
+    seed = seed*1664525 + 1013904223;
+    return(seed >> 8);
+}
+
+static uint16_t rail_code(uint8_t d, uint32_t t, Rail *rail)
+{
+    int noise = (int)(next_random() & 3) - 1;
+    double code = 800 + 50*d + noise;
+
+    if(d >= ACTIVE_FIRST)
+    {
+        if(!rail->in_event && t >= rail->event_start)
+        {
+            rail->in_event = true;
+            rail->peak = 0;
+        }
+        if(rail->in_event)
+        {
+            double x = (double)(t - rail->event_start)*1e-6;
+            code += 400*sin(2*M_PI*20*x)*exp(-x*10);
+            if(x > 0.050 && x < 0.053) code += 1800;        //3ms spike
+        }
+    }
+    return((uint16_t)code);
+}
+
+static void score_step(Score *sc, uint16_t truth, uint16_t held, Rail *rail)
+{
+    uint32_t err = (uint32_t)abs((int)truth - (int)held);
+    if(rail->in_event)
+    {
+        sc->event_sq += (double)err*err;
+        sc->event_steps++;
+        if(err > sc->event_max) sc->event_max = err;
+    }
+    else
+    {
+        sc->quiet_sq += (double)err*err;
+        sc->quiet_steps++;
+        if(err > sc->quiet_max) sc->quiet_max = err;
+    }
+}
+
+static void run(bool adaptive, Score *sc)
+{
+    LTC2946_FakeBus bus;
+    LTC2946 *dev[DEVICES];
+    Rail rails[DEVICES];
+    uint16_t held[DEVICES];
+    uint32_t next_fixed[DEVICES];
+    LTC2946_Scheduler scheduler(UTILIZATION);
+    float fixed_budget = UTILIZATION/LTC2946_Scheduler::PollTime(BUS_HZ, false);
+
+    *sc = Score();
+    seed = 1;
+    bus.Configure(LTC2946_bus_config(BUS_HZ));      //The scheduler's budget follows ClockHz
+    scheduler.CheckFaults(true);
+    for(uint8_t d = 0; d < DEVICES; d++)
+    {
+        bus.AddDevice(0x67 + d);
+        bus.SetRegister(0x67 + d, LTC2946_VIN_MSB_REG, 0x1E, 0x30);
+        dev[d] = new LTC2946(bus, 0x67 + d);
+        rails[d].event_start = 1000000 + (uint32_t)(next_random() % 3000000);
+        rails[d].in_event = false;
+        rails[d].peak = 0;
+        held[d] = 0;
+        next_fixed[d] = d*(uint32_t)(1e6f/fixed_budget);
+        scheduler.Add(*dev[d], MIN_RATE, MAX_RATE);
+    }
+
+    for(uint32_t t = 0; t < DURATION_S*1000000UL; t += STEP_US)
+    {
+        uint16_t truth[DEVICES];
+
+        //! 1) Advance the rails and the simulated registers
+        for(uint8_t d = 0; d < DEVICES; d++)
+        {
+            truth[d] = rail_code(d, t, &rails[d]);
+            bus.SetRegister(0x67 + d, LTC2946_DELTA_SENSE_MSB_REG, (uint8_t)(truth[d] >> 4), (uint8_t)(truth[d] << 4));
+            if(truth[d] >= FAULT_CODE) bus.Registers(0x67 + d)[LTC2946_FAULT1_REG] |= 0x20;
+            if(rails[d].in_event && truth[d] > rails[d].peak) rails[d].peak = truth[d];
+        }
+
+        //! 2) Poll
+        if(adaptive)
+        {
+            int8_t d = scheduler.Update(t);
+            if(d >= 0)
+            {
+                held[d] = (uint16_t)scheduler.Code(d, LTC2946_Scheduler::CURRENT);
+                sc->polls++;
+            }
+        }
+        else
+        {
+            for(uint8_t d = 0; d < DEVICES; d++)
+            {
+                if(t >= next_fixed[d])
+                {
+                    uint16_t vin, current, adin;
+                    uint32_t power;
+                    dev[d]->ReadAllCodes(&vin, &current, &power, &adin);
+                    held[d] = current;
+                    next_fixed[d] += (uint32_t)(1e6f*DEVICES/fixed_budget);
+                    sc->polls++;
+                    break;
+                }
+            }
+        }
+
+        //! 3) Score the reconstruction, close finished transients
+        for(uint8_t d = 0; d < DEVICES; d++)
+        {
+            score_step(sc, truth[d], held[d], &rails[d]);
+            if(rails[d].in_event && held[d] > sc->polled_peak[d]) sc->polled_peak[d] = held[d];
+            if(rails[d].in_event && t - rails[d].event_start >= EVENT_US)
+            {
+                sc->events++;
+                if(sc->polled_peak[d]*100u >= rails[d].peak*95u) sc->peaks++;
+                sc->polled_peak[d] = 0;
+                rails[d].in_event = false;
+                rails[d].event_start = t + 2000000 + (uint32_t)(next_random() % 3000000);
+            }
+        }
+    }
+
+    for(uint8_t d = 0; d < DEVICES; d++) delete dev[d];
+}
+
+static void report(const char *name, Score *sc, float poll_time)
+{
+    printf("%-9s %6.1f%%  %10.1f  %9u  %10.2f  %9u  %4u/%u\n", name,
+           100.0*sc->polls*poll_time/DURATION_S,
+           sqrt(sc->event_sq/sc->event_steps), sc->event_max,
+           sqrt(sc->quiet_sq/sc->quiet_steps), sc->quiet_max,
+           sc->peaks, sc->events);
+}
+
+int main()
+{
+    Score fixed, adaptive;
+
+    run(false, &fixed);
+    run(true, &adaptive);
+
+    printf("%d devices, %ds, %dkHz bus, budget %.0f%% of the bus\n", DEVICES, DURATION_S, BUS_HZ/1000, UTILIZATION*100);
+    printf("poller    bus use  event rms  event max  quiet rms  quiet max  peaks\n");
+    report("fixed", &fixed, LTC2946_Scheduler::PollTime(BUS_HZ, false));
+    report("adaptive", &adaptive, LTC2946_Scheduler::PollTime(BUS_HZ, true));
+    return(0);
+}
@@ -0,0 +1,340 @@
+/*!
+ltc2946_sharedbus_test: LTC2946_SharedBus under threads, on LTC2946_FakeBus
+
+Several threads share one bus, as a sampling loop, a configuration task and an alert handler would:
+    sample x3   one LTC2946 each (its own address), ReadRegisters of the 37 byte measurement burst
+    config      writes the CLK_DIV divider on every device and reads it back (3 transfers)
+    alert       Submit()s a STATUS1/FAULT1 read at alert priority, waits for done() (polling meanwhile)
+The bus under them counts overlapping transfers: two masters on one wire collide, so an overlapping
+transfer fails and reads 0xFF, as after lost arbitration. Each transfer takes its modeled time at
+400kHz (LTC2946_transaction_ns) so that they do overlap.
+
+The workload runs twice: straight on the bus, which collides, and through LTC2946_SharedBus, which
+must not. Per-priority latency (queue to done, per transfer) shows the alert transactions overtaking
+the queue. Fails if the shared run collides, reads a wrong byte, loses a transaction or sees an
+error, or if alert priority does not beat the others: its mean latency must be below sample and
+config, its p99 below sample, and no alert may wait for more than the transfer already started.
+
+Before that, single threaded: a config transaction that Submit()s itself again from done() (100
+times) is queued, then a blocking Transfer at sample priority runs. The Transfer must run its own
+transaction and return, leaving the resubmissions to Poll, instead of running the queue empty.
+
+Build (from this directory):
+    g++ -O2 -pthread -I../.. ltc2946_sharedbus_test.cpp ../../LTC2946_SharedBus.cpp ../../LTC2946_FakeBus.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_sharedbus_test
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "LTC2946_SharedBus.h"
+#include "LTC2946_FakeBus.h"
+
+#define DEVICES         3
+#define SAMPLES         200     //!< Per sampling thread
+#define CONFIGS         100     //!< Write and read back, per device
+#define ALERTS          150
+#define BUS_HZ          400000
+
+static const uint8_t addresses[DEVICES] = {0x6F, 0x6A, 0x67};
+
+typedef std::chrono::steady_clock Clock;
+
+static double since_us(Clock::time_point start)
+{
+    return(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+}
+
+//! LTC2946_FakeBus as one wire: transfers take bus time, and overlapping ones collide
+class CollisionBus : public LTC2946_Bus {
+public:
+    LTC2946_FakeBus fake;
+    std::atomic<uint32_t> collisions{0};
+    std::atomic<uint32_t> started{0};
+
+    int8_t Begin(){return(fake.Begin());}
+
+    int8_t Transfer(uint8_t address, const uint8_t *write_data, uint8_t write_length,
+                    uint8_t *read_data, uint8_t read_length)
+    {
+        started++;
+        bool collided = inside.fetch_add(1) != 0;
+        std::this_thread::sleep_for(std::chrono::nanoseconds(LTC2946_transaction_ns(write_length, read_length, BUS_HZ)));
+        collided |= inside.load() != 1;
+        inside.fetch_sub(1);
+
+        if(collided)
+        {
+            collisions++;
+            memset(read_data, 0xFF, read_length);
+            return(1);
+        }
+        //The fake register file itself is not shared data on a real bus
+        std::lock_guard<std::mutex> hold(fake_mutex);
+        return(fake.Transfer(address, write_data, write_length, read_data, read_length));
+    }
+
+private:
+    std::atomic<int> inside{0};
+    std::mutex fake_mutex;
+};
+
+//! Results of one run
+struct Run
+{
+    std::atomic<uint32_t> wrong{0};
+    std::atomic<uint32_t> errors{0};
+    std::atomic<uint32_t> alerts_behind{0};     //!< Alerts that waited for more than one other transfer
+    std::mutex latency_mutex;
+    std::vector<double> latency[LTC2946_PRIORITY_LEVELS];
+
+    void Record(uint8_t priority, double us)
+    {
+        std::lock_guard<std::mutex> hold(latency_mutex);
+        latency[priority].push_back(us);
+    }
+};
+
+//! Blocking transfers, timed one by one at the priority of the port under them
+class TimedPort : public LTC2946_Bus {
+public:
+    TimedPort(LTC2946_Bus &bus, uint8_t priority, Run &run) : bus(bus), priority(priority), run(run) {}
+
+    int8_t Begin(){return(bus.Begin());}
+
+    int8_t Transfer(uint8_t address, const uint8_t *write_data, uint8_t write_length,
+                    uint8_t *read_data, uint8_t read_length)
+    {
+        Clock::time_point start = Clock::now();
+        int8_t ack = bus.Transfer(address, write_data, write_length, read_data, read_length);
+        run.Record(priority, since_us(start));
+        return(ack);
+    }
+
+private:
+    LTC2946_Bus &bus;
+    uint8_t priority;
+    Run &run;
+};
+
+//! Alert completion, set by done() on whichever thread ran the queue
+struct AlertDone
+{
+    CollisionBus *wire;
+    std::atomic<bool> done{false};
+    Clock::time_point at;
+    uint32_t started;                           //!< Wire transfers started by then
+};
+
+static uint8_t expected[DEVICES][LTC2946_REGISTER_COUNT];
+
+//! Resubmits its transaction from done() until the count runs out
+struct Resubmit
+{
+    LTC2946_SharedBus *shared;
+    uint32_t left;
+};
+
+static void on_resubmit(LTC2946_Transaction *transaction)
+{
+    Resubmit *again = (Resubmit *)transaction->context;
+    if(again->left > 0)
+    {
+        again->left--;
+        again->shared->Submit(transaction);
+    }
+}
+
+static void on_alert(LTC2946_Transaction *transaction)
+{
+    AlertDone *alert = (AlertDone *)transaction->context;
+    alert->at = Clock::now();
+    alert->started = alert->wire->started.load();
+    alert->done.store(true, std::memory_order_release);
+}
+
+//! Run the workload through the shared bus, or straight on the wire
+static void workload(CollisionBus &wire, LTC2946_SharedBus &shared, bool arbitrated, Run &run)
+{
+    LTC2946_BusPort sampling_port(shared, LTC2946_PRIORITY_SAMPLE);
+    LTC2946_BusPort config_port(shared, LTC2946_PRIORITY_CONFIG);
+    TimedPort sampling_bus(arbitrated ? (LTC2946_Bus &)sampling_port : (LTC2946_Bus &)wire, LTC2946_PRIORITY_SAMPLE, run);
+    TimedPort config_bus(arbitrated ? (LTC2946_Bus &)config_port : (LTC2946_Bus &)wire, LTC2946_PRIORITY_CONFIG, run);
+
+    std::vector<std::thread> threads;
+
+    //! 1) Sampling: one thread per device
+    for(uint8_t d = 0; d < DEVICES; d++)
+    {
+        threads.push_back(std::thread([&, d](){
+            LTC2946 monitor(sampling_bus, addresses[d]);
+            uint8_t burst[LTC2946_Map::Span(LTC2946_Map::POWER, LTC2946_Map::ADIN)];
+            for(int i = 0; i < SAMPLES; i++)
+            {
+                int8_t ack = monitor.ReadRegisters(LTC2946_Map::POWER.address, burst, sizeof(burst));
+                if(ack != 0) run.errors++;
+                else if(memcmp(burst, expected[d] + LTC2946_Map::POWER.address, sizeof(burst)) != 0) run.wrong++;
+            }
+        }));
+    }
+
+    //! 2) Configuration: write and read back on every device
+    threads.push_back(std::thread([&](){
+        for(int i = 0; i < CONFIGS; i++)
+        {
+            for(uint8_t d = 0; d < DEVICES; d++)
+            {
+                LTC2946 monitor(config_bus, addresses[d]);
+                uint8_t value = (uint8_t)(i*DEVICES + d) & LTC2946_Map::CLK_DIV_DIVIDER.Mask(), back = 0;
+                int8_t ack = monitor.WriteField(LTC2946_Map::CLK_DIV_DIVIDER, value);
+                ack |= monitor.ReadField(LTC2946_Map::CLK_DIV_DIVIDER, &back);
+                if(ack != 0) run.errors++;
+                else if(back != value) run.wrong++;
+            }
+        }
+    }));
+
+    //! 3) Alert: non-blocking on the shared bus, a plain transfer without it
+    threads.push_back(std::thread([&](){
+        const uint8_t reg = LTC2946_Map::STATUS1.address;
+        uint8_t status[2];
+        AlertDone completion;
+        completion.wire = &wire;
+        LTC2946_Transaction alert = {addresses[0], &reg, 1, status, sizeof(status), LTC2946_PRIORITY_ALERT, on_alert,
+                                     &completion, LTC2946_TRANSACTION_IDLE, 0, 0};
+        for(int i = 0; i < ALERTS; i++)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            Clock::time_point start = Clock::now();
+            int8_t ack;
+            if(arbitrated)
+            {
+                //alert.state and alert.ack belong to the bus until done() has run; the atomic orders them
+                completion.done = false;
+                uint32_t started = wire.started.load();
+                while(!shared.Submit(&alert)) std::this_thread::yield();
+                while(!completion.done.load(std::memory_order_acquire))
+                {
+                    //Sleep rather than yield: on one core a spinning poller delays the owner's transfer
+                    if(shared.Poll() == 0) std::this_thread::sleep_for(std::chrono::microseconds(20));
+                }
+                ack = alert.ack;
+                run.Record(LTC2946_PRIORITY_ALERT, std::chrono::duration<double, std::micro>(completion.at - start).count());
+
+                //At most the transfer already started (or dequeued) when it was queued, then its own
+                if(completion.started - started > 2) run.alerts_behind++;
+            }
+            else
+            {
+                ack = wire.Transfer(addresses[0], &reg, 1, status, sizeof(status));
+                run.Record(LTC2946_PRIORITY_ALERT, since_us(start));
+            }
+            if(ack != 0) run.errors++;
+            else if(memcmp(status, expected[0] + reg, sizeof(status)) != 0) run.wrong++;
+        }
+    }));
+
+    for(std::thread &t : threads) t.join();
+}
+
+static void report(const char *name, CollisionBus &wire, Run &run, double elapsed_us, uint32_t transfers,
+                   double mean[], double p99[])
+{
+    static const char *priorities[LTC2946_PRIORITY_LEVELS] = {"alert", "sample", "config"};
+
+    printf("%s: %u transfers in %.0f ms (%.0f/s), %u collisions, %u errors, %u wrong\n", name, transfers,
+           elapsed_us/1000, transfers/(elapsed_us/1e6), wire.collisions.load(), run.errors.load(), run.wrong.load());
+    for(uint8_t p = 0; p < LTC2946_PRIORITY_LEVELS; p++)
+    {
+        std::vector<double> &l = run.latency[p];
+        std::sort(l.begin(), l.end());
+        double sum = 0;
+        for(double v : l) sum += v;
+        mean[p] = sum/l.size();
+        p99[p] = l[l.size()*99/100];
+        printf("    %-7s %5zu  mean %7.1f us  p99 %7.1f us\n", priorities[p], l.size(), mean[p], p99[p]);
+    }
+}
+
+int main()
+{
+    const uint32_t transfers = DEVICES*SAMPLES + 3*DEVICES*CONFIGS + ALERTS;
+    double mean[LTC2946_PRIORITY_LEVELS], p99[LTC2946_PRIORITY_LEVELS];
+    int failures = 0;
+
+    //! 1) The same random register file on every run
+    uint32_t seed = 7;
+    for(uint8_t d = 0; d < DEVICES; d++)
+    {
+        for(uint8_t i = 0; i < LTC2946_REGISTER_COUNT; i++)
+        {
+            seed = seed*1664525 + 1013904223;
+            expected[d][i] = (uint8_t)(seed >> 24);
+        }
+    }
+
+    //! 2) A blocking Transfer runs up to its own transaction, not whatever is queued behind it
+    {
+        CollisionBus wire;
+        wire.fake.AddDevice(addresses[0]);
+        LTC2946_SharedBus shared(wire);
+        shared.Begin();
+
+        const uint8_t reg = LTC2946_Map::CLK_DIV.address;
+        uint8_t value[1];
+        Resubmit again = {&shared, 100};
+        LTC2946_Transaction config = {addresses[0], &reg, 1, value, 1, LTC2946_PRIORITY_CONFIG, on_resubmit,
+                                      &again, LTC2946_TRANSACTION_IDLE, 0, 0};
+        shared.Submit(&config);
+        uint8_t sample[1];
+        int8_t ack = shared.Transfer(LTC2946_PRIORITY_SAMPLE, addresses[0], &reg, 1, sample, 1);
+        uint32_t by_transfer = shared.Completed();
+        uint8_t left = shared.Pending();
+        uint16_t by_poll = shared.Poll();
+        printf("blocking Transfer ran %u transaction(s) and left %u, then Poll ran %u\n", by_transfer, left, by_poll);
+        if(ack != 0 || by_transfer != 1 || left != 1 || by_poll != 101 || shared.Pending() != 0) failures++;
+    }
+
+    for(int shared_run = 0; shared_run < 2; shared_run++)
+    {
+        CollisionBus wire;
+        for(uint8_t d = 0; d < DEVICES; d++)
+        {
+            wire.fake.AddDevice(addresses[d]);
+            memcpy(wire.fake.Registers(addresses[d]), expected[d], LTC2946_REGISTER_COUNT);
+        }
+        LTC2946_SharedBus shared(wire);
+        shared.Begin();
+
+        //! 3) Run
+        Run run;
+        Clock::time_point start = Clock::now();
+        workload(wire, shared, shared_run != 0, run);
+        double elapsed = since_us(start);
+
+        //! 4) Report and check
+        if(shared_run)
+        {
+            report("shared bus", wire, run, elapsed, transfers, mean, p99);
+            printf("    %u run by the queue, %u queued behind the owner, %u alerts behind more than one transfer\n",
+                   shared.Completed(), shared.Contended(), run.alerts_behind.load());
+            if(wire.collisions != 0 || run.errors != 0 || run.wrong != 0 ||
+               shared.Completed() != transfers || shared.Pending() != 0) failures++;
+            if(!(mean[LTC2946_PRIORITY_ALERT] < mean[LTC2946_PRIORITY_SAMPLE] &&
+                 mean[LTC2946_PRIORITY_ALERT] < mean[LTC2946_PRIORITY_CONFIG] &&
+                 p99[LTC2946_PRIORITY_ALERT] < p99[LTC2946_PRIORITY_SAMPLE]) || run.alerts_behind != 0) failures++;
+        }
+        else
+        {
+            report("direct", wire, run, elapsed, transfers, mean, p99);
+        }
+    }
+
+    printf("%s, %d failures\n", failures ? "FAIL" : "PASS", failures);
+    return(failures ? 1 : 0);
+}
@@ -0,0 +1,185 @@
+/*!
+ltc2946_simbus_sim: drive the LTC2946 driver against LTC2946_SimBus
+
+Checks the driver and the simulator against each other, then measures what each read costs on a
+400kHz bus:
+    results     continuous conversions reach the result registers, power is VIN * delta sense
+    accumulate  time counter, charge and energy after 10s match the inputs
+    alert       MAX VIN threshold latches FAULT1, pulls ALERT, ARA returns the address, ClearFaults
+    snapshot    snapshot reads return the input, latency is one conversion plus polling
+    mass write  shutdown written to two devices at once stops both ADCs; with no device it is not acknowledged
+    no answer   a read from an address with no device fails and gives zeros, not the bus's 0xFF
+and prints transactions, bytes and bus time per ReadVIN, ReadAll, ReadAllCodes and
+LTC2946_Coherent::Read (after a conversion, and polled back to back, when most reads find none),
+and snapshot latency per channel.
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_simbus_sim.cpp ../../LTC2946_SimBus.cpp ../../LTC2946_Coherent.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_simbus_sim
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "LTC2946_SimBus.h"
+#include "LTC2946_Coherent.h"
+
+#define BUS_HZ          400000
+#define ADDRESS         0x6F
+#define ADDRESS_2       0x6A
+#define ADDRESS_ABSENT  0x67
+
+#define SENSE_CODE      1000
+#define VDD_CODE        1800
+#define SENSE_PLUS_CODE 2000
+#define ADIN_CODE       500
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("  %-56s %s\n", what, ok ? "ok" : "FAIL");
+    if(!ok) failures++;
+}
+
+static uint32_t be32(const uint8_t *b)
+{
+    return(((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3]);
+}
+
+static void write_reg(LTC2946_SimBus &bus, uint8_t address, uint8_t reg, uint8_t value)
+{
+    uint8_t data[2] = {reg, value};
+    bus.Transfer(address, data, 2, 0, 0);
+}
+
+//! Transactions, bytes and bus time of one call
+template <typename F>
+static void cost(LTC2946_SimBus &bus, const char *name, F call)
+{
+    const int calls = 100;
+
+    bus.ResetCounters();
+    for(int i = 0; i < calls; i++) call();
+    printf("  %-28s %5.1f transactions %5.1f bytes %7.1f us\n", name,
+           (double)bus.Transactions()/calls,
+           (double)(bus.BytesWritten() + bus.BytesRead())/calls,
+           bus.BusTime()*1e-3/calls);
+}
+
+int main()
+{
+    LTC2946_SimBus bus(BUS_HZ);
+    bus.AddDevice(ADDRESS);
+    bus.AddDevice(ADDRESS_2);
+    bus.SetInputs(ADDRESS, SENSE_CODE, VDD_CODE, SENSE_PLUS_CODE, ADIN_CODE);
+    bus.SetInputs(ADDRESS_2, SENSE_CODE/2, VDD_CODE, SENSE_PLUS_CODE, ADIN_CODE);
+
+    LTC2946 monitor(bus, ADDRESS);
+    monitor.Setup();
+    monitor.EnableConversion(false);
+    monitor.SetContinuous();
+
+    //! 1) Result registers
+    printf("results\n");
+    bus.Advance(100000000ULL);
+    uint16_t vin, current, adin;
+    uint32_t power;
+    int8_t ack = monitor.ReadAllCodes(&vin, &current, &power, &adin);
+    check(ack == 0, "ReadAllCodes acknowledged");
+    check(vin == SENSE_PLUS_CODE && current == SENSE_CODE, "VIN (SENSE+) and delta sense codes");
+    check(power == (uint32_t)SENSE_PLUS_CODE*SENSE_CODE, "power is VIN * delta sense");
+    uint8_t block[3];
+    monitor.ReadRegisters(LTC2946_MAX_VIN_MSB_REG, block, 2);
+    check((((uint16_t)block[0] << 4) | (block[1] >> 4)) == SENSE_PLUS_CODE, "MAX VIN tracks the result");
+
+    //! 2) Accumulators, from a reset
+    printf("accumulate\n");
+    write_reg(bus, ADDRESS, LTC2946_CTRLB_REG, LTC2946_RESET_ACC);
+    check(bus.Register(ADDRESS, LTC2946_CTRLB_REG) == 0, "reset bits clear themselves");
+    bus.Advance(10000000000ULL);
+    uint8_t acc[12];
+    monitor.ReadRegisters(LTC2946_TIME_COUNTER_MSB3_REG, acc, 12);
+    uint32_t ticks = be32(acc), charge = be32(acc + 4), energy = be32(acc + 8);
+    double expected_ticks = 10.0*LTC2946_INTERNAL_CLK_HZ/LTC2946_TIME_COUNTER_TICKS;
+    printf("  %u ticks, charge %u, energy %u\n", ticks, charge, energy);
+    check(ticks + 1 >= expected_ticks && ticks <= expected_ticks + 1, "time counter ticks every 4101 clocks");
+    check(charge == (uint32_t)(((uint64_t)ticks*SENSE_CODE << 12) >> 16), "charge adds delta sense/16 per tick");
+    check(energy == (uint32_t)(((uint64_t)ticks*SENSE_PLUS_CODE*SENSE_CODE) >> 16), "energy adds power/65536 per tick");
+
+    //! 3) Threshold, FAULT1, ALERT and alert response
+    printf("alert\n");
+    write_reg(bus, ADDRESS, LTC2946_MAX_VIN_THRESHOLD_MSB_REG, (SENSE_PLUS_CODE + 100) >> 4);
+    write_reg(bus, ADDRESS, LTC2946_MAX_VIN_THRESHOLD_LSB_REG, ((SENSE_PLUS_CODE + 100) << 4) & 0xF0);
+    write_reg(bus, ADDRESS, LTC2946_ALERT1_REG, LTC2946_ENABLE_MAX_VIN_ALERT);
+    bus.Advance(50000000ULL);
+    check(!bus.AlertPin(ADDRESS), "no alert below threshold");
+    bus.SetInputs(ADDRESS, SENSE_CODE, VDD_CODE, SENSE_PLUS_CODE + 200, ADIN_CODE);
+    bus.Advance(50000000ULL);
+    uint8_t status1, fault1;
+    monitor.ReadStatus(&status1, &fault1);
+    check((status1 & LTC2946_ENABLE_MAX_VIN_ALERT) && (fault1 & LTC2946_ENABLE_MAX_VIN_ALERT), "STATUS1 and FAULT1 show VIN over MAX");
+    check(bus.AlertPin(ADDRESS) && !bus.AlertPin(ADDRESS_2), "only the faulting device pulls ALERT");
+    uint8_t ara = 0;
+    ack = bus.Transfer(LTC2946_SIM_ALERT_RESPONSE, 0, 0, &ara, 1);
+    check(ack == 0 && ara == (ADDRESS << 1) && !bus.AlertPin(ADDRESS), "ARA returns the address and releases ALERT");
+    ack = bus.Transfer(LTC2946_SIM_ALERT_RESPONSE, 0, 0, &ara, 1);
+    check(ack != 0, "ARA without alert is not acknowledged");
+    bus.SetInputs(ADDRESS, SENSE_CODE, VDD_CODE, SENSE_PLUS_CODE, ADIN_CODE);
+    bus.Advance(50000000ULL);
+    monitor.ClearFaults();
+    monitor.ReadStatus(&status1, &fault1);
+    check(status1 == 0 && fault1 == 0, "ClearFaults once the rail is back in range");
+
+    //! 4) Cost of each read in continuous mode
+    printf("continuous reads at %d Hz\n", BUS_HZ);
+    LTC2946_Coherent coherent(monitor);
+    LTC2946_CoherentSample sample;
+    float v, i, p, a;
+    cost(bus, "ReadVIN", [&](){ monitor.ReadVIN(); });
+    cost(bus, "ReadAll", [&](){ monitor.ReadAll(&v, &i, &p, &a); });
+    cost(bus, "ReadAllCodes", [&](){ monitor.ReadAllCodes(&vin, &current, &power, &adin); });
+    cost(bus, "Coherent::Read, new data", [&](){ bus.Advance(20000000); coherent.Read((uint32_t)(bus.Now()/1000), &sample); });
+    cost(bus, "Coherent::Read, polled", [&](){ coherent.Read((uint32_t)(bus.Now()/1000), &sample); });
+
+    //! 5) Snapshot latency
+    printf("snapshot\n");
+    monitor.SetSnapShot();
+    uint64_t start = bus.Now();
+    float snap_vin = monitor.ReadVIN();
+    double vin_ms = (bus.Now() - start)*1e-6;
+    start = bus.Now();
+    float snap_current = monitor.ReadCurrent();
+    double current_ms = (bus.Now() - start)*1e-6;
+    start = bus.Now();
+    float snap_adin = monitor.ReadADIN();
+    double adin_ms = (bus.Now() - start)*1e-6;
+    printf("  latency VIN %.2f ms, delta sense %.2f ms, ADIN %.2f ms\n", vin_ms, current_ms, adin_ms);
+    check(snap_vin == SENSE_PLUS_CODE && snap_current == SENSE_CODE && snap_adin == ADIN_CODE, "snapshot codes");
+    check(bus.Register(ADDRESS, LTC2946_FAULT2_REG) & LTC2946_FAULT2_ADC_DONE, "FAULT2 ADC done latched");
+    check(vin_ms > 2.2 && vin_ms < 2.2 + 1 && current_ms > 16.4 && current_ms < 16.4 + 1, "latency is conversion time plus one poll");
+    cost(bus, "snapshot ReadAllCodes", [&](){ monitor.ReadAllCodes(&vin, &current, &power, &adin); });
+
+    //! 6) Mass write
+    printf("mass write\n");
+    write_reg(bus, LTC2946_SIM_MASS_WRITE, LTC2946_CTRLB_REG, LTC2946_ENABLE_SHUTDOWN);
+    check(!(bus.Register(ADDRESS, LTC2946_STATUS2_REG) & LTC2946_STATUS2_ADC_BUSY) &&
+          !(bus.Register(ADDRESS_2, LTC2946_STATUS2_REG) & LTC2946_STATUS2_ADC_BUSY), "shutdown reaches both devices");
+    ack = bus.Transfer(LTC2946_SIM_MASS_WRITE, block, 1, block, 1);
+    check(ack != 0, "reads from the mass write address are not acknowledged");
+    write_reg(bus, LTC2946_SIM_MASS_WRITE, LTC2946_CTRLB_REG, 0);
+    check(bus.Register(ADDRESS_2, LTC2946_STATUS2_REG) & LTC2946_STATUS2_ADC_BUSY, "leaving shutdown restarts conversions");
+    LTC2946_SimBus empty(BUS_HZ);
+    uint8_t shutdown[2] = {LTC2946_CTRLB_REG, LTC2946_ENABLE_SHUTDOWN};
+    ack = empty.Transfer(LTC2946_SIM_MASS_WRITE, shutdown, 2, 0, 0);
+    check(ack != 0, "mass write with no device is not acknowledged");
+
+    //! 7) No device at the address
+    printf("no answer\n");
+    LTC2946 absent(bus, ADDRESS_ABSENT);
+    uint8_t image[4] = {0x55, 0x55, 0x55, 0x55};
+    ack = absent.ReadRegisters(LTC2946_DELTA_SENSE_MSB_REG, image, sizeof(image));
+    check(ack != 0 && image[0] == 0 && image[1] == 0 && image[2] == 0 && image[3] == 0, "failed read returns zeros");
+    check(absent.ReadVIN() == 0 && !absent.ErrorCheck(), "ReadVIN of a missing device is 0, error flagged");
+
+    printf("%s, %d failures\n", failures ? "FAIL" : "PASS", failures);
+    return(failures ? 1 : 0);
+}
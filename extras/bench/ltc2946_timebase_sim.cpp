@@ -0,0 +1,119 @@
+/*!
+ltc2946_timebase_sim: time, charge and energy LSBs against the datasheet formulas
+
+For the internal oscillator and several CLKIN frequencies and CLK_DIV values (chosen by SetClock or
+given), the driver's LSBs are compared with the datasheet formulas computed here in double:
+    time        tLSB = 4101 / fTIMEBASE, fTIMEBASE = 250kHz internal or fCLKIN / CLK_DIV
+    charge      qLSB = ΔSENSE LSB / RSENSE * 16 * tLSB
+    energy      eLSB = POWER LSB / RSENSE * 65536 * tLSB
+Also checked: GetTimeLSBRatio is exactly 4101*CLK_DIV/fCLKIN, GetTimeLSB is that ratio rounded once
+to float, CLK_DIV reaches the register, and the simulated device's time counter after 60 s agrees.
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_timebase_sim.cpp ../../LTC2946_SimBus.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_timebase_sim
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include "LTC2946_SimBus.h"
+
+#define ADDRESS         0x6F
+#define RSENSE          0.02                //!< Driver default sense resistor
+#define DELTA_SENSE_LSB (0.1024/4095)       //!< 102.4mV full scale over 4095 codes
+#define VIN_LSB         (102.4/4095)        //!< 102.4V full scale over 4095 codes
+#define RUN_S           60
+
+//! One time base: internal (clk_hz 0), or CLKIN with a CLK_DIV to choose (0) or force
+struct Case
+{
+    const char *name;
+    uint32_t clk_hz;
+    uint8_t clk_div;
+    uint8_t expected_div;
+};
+
+static const Case cases[] = {
+    {"internal 250kHz",            0,        0,  0},
+    {"CLKIN 250kHz",               250000,   0,  1},
+    {"CLKIN 1MHz",                 1000000,  0,  4},
+    {"CLKIN 4MHz",                 4000000,  0,  16},
+    {"CLKIN 4.194304MHz",          4194304,  0,  17},
+    {"CLKIN 10MHz (div capped)",   10000000, 0,  31},
+    {"CLKIN 5MHz, CLK_DIV 20",     5000000,  20, 20},
+    {"CLKIN 3.2MHz, CLK_DIV 7",    3200000,  7,  7},
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-64s %s\n", what, ok ? "ok" : "FAIL");
+    if(!ok) failures++;
+}
+
+//! Relative difference
+static double relative(double value, double expected)
+{
+    return(fabs(value - expected)/fabs(expected));
+}
+
+int main()
+{
+    bool time_ok = true, ratio_ok = true, charge_ok = true, energy_ok = true, register_ok = true, counter_ok = true;
+
+    printf("    %-26s %4s %14s %14s %12s %12s\n", "time base", "div", "tLSB (ms)", "datasheet", "qLSB (uC)", "eLSB (uJ)");
+    for(const Case &c : cases)
+    {
+        LTC2946_SimBus bus;
+        bus.AddDevice(ADDRESS);
+        LTC2946 monitor(bus, ADDRESS);
+        bool external = c.clk_hz != 0;
+        if(external)
+        {
+            bus.SetExternalClock(ADDRESS, c.clk_hz);
+            monitor.SetClock(true, c.clk_hz, c.clk_div);
+        }
+        else
+        {
+            monitor.SetClock(false);
+        }
+
+        //! 1) Datasheet formulas
+        double timebase_hz = external ? (double)c.clk_hz/c.expected_div : 250000.0;
+        double t_lsb = 4101/timebase_hz;
+        double q_lsb = DELTA_SENSE_LSB/RSENSE*16*t_lsb;
+        double e_lsb = DELTA_SENSE_LSB*VIN_LSB/RSENSE*65536*t_lsb;
+
+        //! 2) Driver
+        uint32_t numerator, denominator;
+        monitor.GetTimeLSBRatio(&numerator, &denominator);
+        printf("    %-26s %4u %14.9f %14.9f %12.6f %12.4f\n", c.name, monitor.GetClockDivider(), monitor.GetTimeLSB()*1e3,
+               t_lsb*1e3, monitor.GetChargeLSB()*1e6, monitor.GetEnergyLSB()*1e6);
+
+        ratio_ok &= monitor.GetClockDivider() == c.expected_div &&
+                    (uint64_t)numerator*(external ? c.clk_hz : 250000) == (uint64_t)4101*(external ? c.expected_div : 1)*denominator;
+        time_ok &= monitor.GetTimeLSB() == (float)((double)numerator/denominator) && relative(monitor.GetTimeLSB(), t_lsb) < 1e-7;
+        charge_ok &= relative(monitor.GetChargeLSB(), q_lsb) < 1e-5;
+        energy_ok &= relative(monitor.GetEnergyLSB(), e_lsb) < 1e-5;
+        if(external) register_ok &= LTC2946_Map::CLK_DIV_DIVIDER.Extract(bus.Register(ADDRESS, LTC2946_CLK_DIV_REG)) == c.expected_div;
+
+        //! 3) The device counts at the same rate
+        bus.Advance((uint64_t)RUN_S*1000000000);
+        uint32_t ticks = ((uint32_t)bus.Register(ADDRESS, LTC2946_TIME_COUNTER_MSB3_REG) << 24) |
+                         ((uint32_t)bus.Register(ADDRESS, LTC2946_TIME_COUNTER_MSB2_REG) << 16) |
+                         ((uint32_t)bus.Register(ADDRESS, LTC2946_TIME_COUNTER_MSB1_REG) << 8) |
+                         bus.Register(ADDRESS, LTC2946_TIME_COUNTER_LSB_REG);
+        counter_ok &= fabs(ticks*(double)monitor.GetTimeLSB() - RUN_S) <= monitor.GetTimeLSB();
+    }
+
+    check(ratio_ok, "CLK_DIV chosen or kept, ratio exactly 4101*CLK_DIV/fCLKIN");
+    check(time_ok, "time LSB: the ratio rounded to float, equal to 4101/fTIMEBASE");
+    check(charge_ok, "charge LSB: dSENSE LSB/R * 16 * tLSB");
+    check(energy_ok, "energy LSB: POWER LSB/R * 65536 * tLSB");
+    check(register_ok, "CLK_DIV written to the device");
+    check(counter_ok, "time counter * time LSB = elapsed time (within one LSB)");
+
+    printf("%s, %d failures\n", failures ? "FAIL" : "PASS", failures);
+    return(failures ? 1 : 0);
+}
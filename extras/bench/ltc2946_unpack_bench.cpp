@@ -0,0 +1,165 @@
+/*!
+ltc2946_unpack_bench: LTC2946_Unpack against the byte-wise union decoding it replaced
+
+Checks that the shift based decoders, the block unpacker and the SIMD 12-bit array unpacker agree
+with union assembly (correct on little endian hosts only), then times each on large buffers. Blocks
+are also timed in batches of BENCH_BATCH, which stay in cache as a real acquisition batch does; the
+large buffer is memory bound.
+
+Build (from this directory), native instruction set:
+    g++ -O2 -march=native -I../.. ltc2946_unpack_bench.cpp ../../LTC2946_Unpack.cpp -o ltc2946_unpack_bench
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "LTC2946.h"
+#include "LTC2946_Unpack.h"
+
+#define BENCH_BLOCKS    (1u*1024*1024)
+#define BENCH_WORDS     (16u*1024*1024)
+#define BENCH_REPEAT    8
+#define BENCH_BATCH     4096    //!< ReadAll blocks per batch, 150kB
+#define BENCH_BATCH_REPEAT 64
+
+//ReadAll burst, POWER_MSB2 through ADIN_LSB
+#define BLOCK_FIRST     LTC2946_POWER_MSB2_REG
+#define BLOCK_LENGTH    (LTC2946_ADIN_LSB_REG_REG - LTC2946_POWER_MSB2_REG + 1)
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+//Decoding as previously done in LTC2946_read_12_bits / read_24_bits
+static uint16_t union_12(const uint8_t *bytes)
+{
+    union
+    {
+        uint8_t b[2];
+        uint16_t w;
+    } data;
+
+    data.b[1] = bytes[0];
+    data.b[0] = bytes[1];
+    return(data.w >> 4);
+}
+
+static uint32_t union_24(const uint8_t *bytes)
+{
+    union
+    {
+        int32_t MY_int32;
+        uint8_t MY_byte[4];
+    } data;
+
+    data.MY_byte[3] = 0;
+    data.MY_byte[2] = bytes[0];
+    data.MY_byte[1] = bytes[1];
+    data.MY_byte[0] = bytes[2];
+    return(0x0FFFFFF & data.MY_int32);
+}
+
+static void union_blocks(const uint8_t *blocks, size_t count, uint32_t *power, uint16_t *current, uint16_t *vin, uint16_t *adin)
+{
+    for(size_t b = 0; b < count; b++)
+    {
+        const uint8_t *block = blocks + b*BLOCK_LENGTH;
+        power[b] = union_24(block + LTC2946_POWER_MSB2_REG - BLOCK_FIRST);
+        current[b] = union_12(block + LTC2946_DELTA_SENSE_MSB_REG - BLOCK_FIRST);
+        vin[b] = union_12(block + LTC2946_VIN_MSB_REG - BLOCK_FIRST);
+        adin[b] = union_12(block + LTC2946_ADIN_MSB_REG - BLOCK_FIRST);
+    }
+}
+
+int main()
+{
+    uint32_t seed = 1;
+    bool exact = true;
+
+    printf("instruction set: %s\n", LTC2946_unpack_isa());
+
+    std::vector<uint8_t> blocks((size_t)BENCH_BLOCKS*BLOCK_LENGTH);
+    std::vector<uint8_t> words((size_t)BENCH_WORDS*2);
+    for(size_t i = 0; i < blocks.size(); i++){ seed = seed*1664525 + 1013904223; blocks[i] = (uint8_t)(seed >> 24); }
+    for(size_t i = 0; i < words.size(); i++){ seed = seed*1664525 + 1013904223; words[i] = (uint8_t)(seed >> 24); }
+
+    std::vector<uint32_t> power_u(BENCH_BLOCKS), power_s(BENCH_BLOCKS);
+    std::vector<uint16_t> current_u(BENCH_BLOCKS), current_s(BENCH_BLOCKS);
+    std::vector<uint16_t> vin_u(BENCH_BLOCKS), vin_s(BENCH_BLOCKS);
+    std::vector<uint16_t> adin_u(BENCH_BLOCKS), adin_s(BENCH_BLOCKS);
+    std::vector<uint16_t> codes_u(BENCH_WORDS), codes_s(BENCH_WORDS);
+
+    LTC2946_CodeColumns columns = {power_s.data(), current_s.data(), vin_s.data(), adin_s.data()};
+
+    //! 1) Agreement, odd block and word counts to exercise the scalar tails
+    union_blocks(blocks.data(), BENCH_BLOCKS, power_u.data(), current_u.data(), vin_u.data(), adin_u.data());
+    LTC2946_CodeColumns tail = {&power_s[BENCH_BLOCKS - 3], &current_s[BENCH_BLOCKS - 3], &vin_s[BENCH_BLOCKS - 3], &adin_s[BENCH_BLOCKS - 3]};
+    LTC2946_unpack_blocks(blocks.data(), BENCH_BLOCKS - 3, BLOCK_LENGTH, BLOCK_FIRST, BLOCK_LENGTH, &columns);
+    LTC2946_unpack_blocks(&blocks[(BENCH_BLOCKS - 3)*BLOCK_LENGTH], 3, BLOCK_LENGTH, BLOCK_FIRST, BLOCK_LENGTH, &tail);
+    exact &= power_u == power_s && current_u == current_s && vin_u == vin_s && adin_u == adin_s;
+
+    for(size_t i = 0; i < BENCH_WORDS; i++) codes_u[i] = union_12(&words[2*i]);
+    LTC2946_unpack_12_array(words.data(), codes_s.data(), BENCH_WORDS - 5);
+    codes_s.resize(BENCH_WORDS - 5);
+    codes_u.resize(BENCH_WORDS - 5);
+    exact &= codes_u == codes_s;
+    codes_s.resize(BENCH_WORDS);
+    codes_u.resize(BENCH_WORDS);
+
+    printf("agreement: %s\n", exact ? "exact" : "MISMATCH");
+
+    //! 2) Throughput
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int r = 0; r < BENCH_REPEAT; r++) union_blocks(blocks.data(), BENCH_BLOCKS, power_u.data(), current_u.data(), vin_u.data(), adin_u.data());
+    double t_union_blocks = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for(int r = 0; r < BENCH_REPEAT; r++) LTC2946_unpack_blocks(blocks.data(), BENCH_BLOCKS, BLOCK_LENGTH, BLOCK_FIRST, BLOCK_LENGTH, &columns);
+    double t_blocks = seconds_since(start);
+
+    //Same blocks a batch at a time, each batch decoded many times
+    start = std::chrono::steady_clock::now();
+    for(size_t b = 0; b < BENCH_BLOCKS; b += BENCH_BATCH)
+    {
+        for(int r = 0; r < BENCH_BATCH_REPEAT; r++) union_blocks(&blocks[b*BLOCK_LENGTH], BENCH_BATCH, &power_u[b], &current_u[b], &vin_u[b], &adin_u[b]);
+    }
+    double t_union_batches = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for(size_t b = 0; b < BENCH_BLOCKS; b += BENCH_BATCH)
+    {
+        LTC2946_CodeColumns batch = {&power_s[b], &current_s[b], &vin_s[b], &adin_s[b]};
+        for(int r = 0; r < BENCH_BATCH_REPEAT; r++) LTC2946_unpack_blocks(&blocks[b*BLOCK_LENGTH], BENCH_BATCH, BLOCK_LENGTH, BLOCK_FIRST, BLOCK_LENGTH, &batch);
+    }
+    double t_batches = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for(int r = 0; r < BENCH_REPEAT; r++)
+    {
+        for(size_t i = 0; i < BENCH_WORDS; i++) codes_u[i] = union_12(&words[2*i]);
+    }
+    double t_union_words = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for(int r = 0; r < BENCH_REPEAT; r++) LTC2946_unpack_12_array(words.data(), codes_s.data(), BENCH_WORDS);
+    double t_words = seconds_since(start);
+
+    double blocks_total = (double)BENCH_BLOCKS*BENCH_REPEAT;
+    double batches_total = (double)BENCH_BLOCKS*BENCH_BATCH_REPEAT;
+    double words_total = (double)BENCH_WORDS*BENCH_REPEAT;
+    printf("ReadAll blocks, union:  %7.1f M blocks/s\n", blocks_total/t_union_blocks*1e-6);
+    printf("ReadAll blocks, unpack: %7.1f M blocks/s (%.2fx)\n", blocks_total/t_blocks*1e-6, t_union_blocks/t_blocks);
+    printf("%u-block batches, union:  %7.1f M blocks/s\n", BENCH_BATCH, batches_total/t_union_batches*1e-6);
+    printf("%u-block batches, unpack: %7.1f M blocks/s (%.2fx)\n", BENCH_BATCH, batches_total/t_batches*1e-6, t_union_batches/t_batches);
+    printf("12-bit words, union:    %7.1f M codes/s\n", words_total/t_union_words*1e-6);
+    printf("12-bit words, unpack:   %7.1f M codes/s (%.2fx)\n", words_total/t_words*1e-6, t_union_words/t_words);
+
+    //Keep results observable
+    volatile uint32_t sink = power_s[BENCH_BLOCKS/2] + codes_s[BENCH_WORDS/2] + codes_u[BENCH_WORDS/3] + power_u[1];
+    (void)sink;
+
+    return(exact ? 0 : 1);
+}
@@ -0,0 +1,55 @@
+/*!
+LTC2946 SPSC Queue
+
+Bounded lock-free single-producer/single-consumer ring buffer. One bus worker thread pushes,
+the writer thread pops. Capacity must be a power of two.
+*/
+
+#ifndef LTC2946_SPSCQUEUE_H
+#define LTC2946_SPSCQUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+template <typename T>
+class LTC2946_SpscQueue {
+public:
+    explicit LTC2946_SpscQueue(size_t capacity) //!constructor. capacity is rounded up to a power of two
+    {
+        size_t size = 1;
+        while(size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    //! Producer side. @return false if the queue is full (sample dropped)
+    bool Push(const T &item)
+    {
+        size_t head = write_index.load(std::memory_order_relaxed);
+        if(head - read_index.load(std::memory_order_acquire) > mask) return(false);
+
+        slots[head & mask] = item;
+        write_index.store(head + 1, std::memory_order_release);
+        return(true);
+    }
+
+    //! Consumer side. @return false if the queue is empty
+    bool Pop(T *item)
+    {
+        size_t tail = read_index.load(std::memory_order_relaxed);
+        if(tail == write_index.load(std::memory_order_acquire)) return(false);
+
+        *item = slots[tail & mask];
+        read_index.store(tail + 1, std::memory_order_release);
+        return(true);
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> write_index{0};     //Separate cache lines, producer and consumer do not share writes
+    alignas(64) std::atomic<size_t> read_index{0};
+};
+
+#endif  // LTC2946_SPSCQUEUE_H
@@ -0,0 +1,332 @@
+/*!
+ltc2946d: LTC2946 acquisition daemon for Linux
+
+One worker thread per I2C adapter polls its LTC2946s (ReadAll: VIN, Current, Power, ADIN in one
+transaction) at each device's configured rate. Samples go through a lock-free single-producer/
+single-consumer queue per worker to one writer thread, which prints them as CSV:
+    time_ns,bus,address,ok,vin,current,power,adin
+
+Because every bus has its own thread, aggregate throughput scales with the number of buses instead
+of all devices being serialized in one loop.
+
+Usage:
+    ltc2946d [-q] [-t seconds] bus:address:rate_hz [bus:address:rate_hz ...]
+        Poll real devices, e.g. "1:0x6F:100" polls 0x6F on /dev/i2c-1 at 100Hz.
+    ltc2946d --simulate buses devices_per_bus rate_hz [-b bus_clock_hz] [-q] [-t seconds]
+        Load test against simulated buses (LTC2946_FakeBus with modelled bus timing).
+        Reports throughput and sample latency percentiles on exit.
+    -q  do not print samples (measure only)
+    -t  run for this many seconds, otherwise until Ctrl-C
+
+Build (from this directory):
+    g++ -O2 -std=c++17 -pthread -I../.. ltc2946d.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp \
+        ../../LTC2946_LinuxBus.cpp ../../LTC2946_FakeBus.cpp -o ltc2946d
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "LTC2946.h"
+#include "LTC2946_FakeBus.h"
+#include "LTC2946_LinuxBus.h"
+#include "LTC2946_SpscQueue.h"
+
+#define QUEUE_CAPACITY      4096
+#define MAX_BUSES           LTC2946_LINUX_MAX_ADAPTERS
+
+//! One reading of one device
+struct Sample
+{
+    uint64_t time_ns;    //steady clock time of the read
+    uint8_t bus;
+    uint8_t address;
+    uint8_t ok;          //1 if the transaction was acknowledged
+    float vin;
+    float current;
+    float power;
+    float adin;
+};
+
+//! Simulated bus: LTC2946_FakeBus plus the time the transaction would take on the wire
+class TimedFakeBus : public LTC2946_Bus {
+public:
+    explicit TimedFakeBus(uint32_t clock_hz) : bus_clock(clock_hz) {}
+
+    LTC2946_FakeBus fake;
+
+    int8_t Transfer(uint8_t address, const uint8_t *write_data, uint8_t write_length, uint8_t *read_data, uint8_t read_length)
+    {
+        //! The library's bus time model, as LTC2946_Plan and LTC2946_check_bus use
+        uint32_t wire_ns = LTC2946_transaction_ns(write_length, read_length, bus_clock);
+
+        std::chrono::steady_clock::time_point done = std::chrono::steady_clock::now() + std::chrono::nanoseconds(wire_ns);
+        int8_t ack = fake.Transfer(address, write_data, write_length, read_data, read_length);
+        while(std::chrono::steady_clock::now() < done) {}    //Busy wait, sleep granularity is too coarse for single transactions
+        return(ack);
+    }
+
+    uint32_t ClockHz(){return(bus_clock);}
+
+private:
+    uint32_t bus_clock;
+};
+
+struct Device
+{
+    LTC2946 *monitor;
+    uint8_t address;
+    uint64_t period_ns;
+    uint64_t next_ns;
+};
+
+struct BusWorker
+{
+    uint8_t bus;
+    std::vector<Device> devices;
+    LTC2946_SpscQueue<Sample> queue{QUEUE_CAPACITY};
+    std::atomic<uint64_t> polled{0};
+    std::atomic<uint64_t> dropped{0};
+    std::thread thread;
+};
+
+static std::atomic<bool> running(true);
+
+static uint64_t now_ns()
+{
+    return((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void on_signal(int)
+{
+    running = false;
+}
+
+static void bus_loop(BusWorker *worker)
+{
+    while(running)
+    {
+        //! 1) Earliest due device on this bus
+        Device *due = &worker->devices[0];
+        for(size_t i = 1; i < worker->devices.size(); i++)
+        {
+            if(worker->devices[i].next_ns < due->next_ns) due = &worker->devices[i];
+        }
+
+        uint64_t now = now_ns();
+        if(due->next_ns > now)
+        {
+            uint64_t wait = due->next_ns - now;
+            if(wait > 1000000) wait = 1000000;      //Wake at least every 1ms to notice shutdown
+            std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+            continue;
+        }
+
+        //! 2) Read it and hand the sample to the writer
+        Sample sample;
+        sample.time_ns = now;
+        sample.bus = worker->bus;
+        sample.address = due->address;
+        due->monitor->ReadAll(&sample.vin, &sample.current, &sample.power, &sample.adin);
+        sample.ok = due->monitor->ErrorCheck() ? 1 : 0;
+
+        worker->polled++;
+        if(!worker->queue.Push(sample)) worker->dropped++;
+
+        //! 3) Schedule the next poll. When behind, skip ahead instead of bursting.
+        due->next_ns += due->period_ns;
+        if(due->next_ns < now) due->next_ns = now + due->period_ns;
+    }
+}
+
+static void writer_loop(std::vector<BusWorker *> *workers, bool quiet, std::vector<uint32_t> *latencies_us)
+// latencies_us is only collected in load test mode, a long running daemon would grow it without bound
+{
+    Sample sample;
+
+    while(true)
+    {
+        bool any = false;
+        for(size_t i = 0; i < workers->size(); i++)
+        {
+            //Bounded batch per worker so one busy bus cannot starve the others
+            for(int n = 0; n < 256 && (*workers)[i]->queue.Pop(&sample); n++)
+            {
+                any = true;
+                if(latencies_us) latencies_us->push_back((uint32_t)((now_ns() - sample.time_ns)/1000));
+                if(!quiet)
+                {
+                    printf("%llu,%u,0x%02X,%u,%.4f,%.5f,%.4f,%.5f\n", (unsigned long long)sample.time_ns, sample.bus, sample.address,
+                           sample.ok, sample.vin, sample.current, sample.power, sample.adin);
+                }
+            }
+        }
+
+        if(!any)
+        {
+            if(!running) break;     //Drained after the workers stopped
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+    fflush(stdout);
+}
+
+static double percentile(std::vector<uint32_t> &values, double p)
+{
+    if(values.empty()) return(0);
+    size_t index = (size_t)(p*(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return(values[index]);
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: ltc2946d [-q] [-t seconds] bus:address:rate_hz ...\n"
+                    "       ltc2946d --simulate buses devices_per_bus rate_hz [-b bus_clock_hz] [-q] [-t seconds]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    bool quiet = false;
+    bool simulate = false;
+    double seconds = 0;
+    uint32_t bus_clock = 100000;
+    unsigned sim_buses = 0, sim_devices = 0;
+    double sim_rate = 0;
+    std::vector<BusWorker *> workers(MAX_BUSES, (BusWorker *)0);
+    std::vector<TimedFakeBus *> fake_buses;
+
+    //! 1) Parse options and device list
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-q") == 0){
+            quiet = true;
+        }else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc){
+            seconds = atof(argv[++i]);
+        }else if(strcmp(argv[i], "-b") == 0 && i + 1 < argc){
+            bus_clock = (uint32_t)strtoul(argv[++i], 0, 0);
+        }else if(strcmp(argv[i], "--simulate") == 0 && i + 3 < argc){
+            simulate = true;
+            sim_buses = (unsigned)atoi(argv[++i]);
+            sim_devices = (unsigned)atoi(argv[++i]);
+            sim_rate = atof(argv[++i]);
+        }else{
+            unsigned bus, address;
+            double rate;
+            if(sscanf(argv[i], "%u:%i:%lf", &bus, (int *)&address, &rate) != 3 || bus >= MAX_BUSES || rate <= 0) usage();
+
+            if(workers[bus] == 0)
+            {
+                workers[bus] = new BusWorker();
+                workers[bus]->bus = (uint8_t)bus;
+            }
+            Device device;
+            device.monitor = new LTC2946((uint8_t)bus, (uint8_t)address);
+            device.address = (uint8_t)address;
+            device.period_ns = (uint64_t)(1e9/rate);
+            workers[bus]->devices.push_back(device);
+        }
+    }
+
+    if(simulate)
+    {
+        if(sim_buses == 0 || sim_buses > MAX_BUSES || sim_devices == 0 || sim_devices > LTC2946_FAKEBUS_MAX_DEVICES || sim_rate <= 0) usage();
+
+        for(unsigned b = 0; b < sim_buses; b++)
+        {
+            TimedFakeBus *fake = new TimedFakeBus(bus_clock);
+            fake_buses.push_back(fake);
+
+            workers[b] = new BusWorker();
+            workers[b]->bus = (uint8_t)b;
+            for(unsigned d = 0; d < sim_devices; d++)
+            {
+                uint8_t address = (uint8_t)(0x67 + d);
+                fake->fake.AddDevice(address);
+                fake->fake.SetRegister(address, LTC2946_VIN_MSB_REG, 0x1E, 0x00);
+                fake->fake.SetRegister(address, LTC2946_DELTA_SENSE_MSB_REG, 0x34, 0x50);
+
+                Device device;
+                device.monitor = new LTC2946(*fake, address);
+                device.address = address;
+                device.period_ns = (uint64_t)(1e9/sim_rate);
+                workers[b]->devices.push_back(device);
+            }
+        }
+    }
+
+    std::vector<BusWorker *> active;
+    for(size_t b = 0; b < workers.size(); b++)
+    {
+        if(workers[b] != 0) active.push_back(workers[b]);
+    }
+    if(active.empty()) usage();
+
+    //! 2) Configure every device from the main thread, before any worker runs
+    uint64_t start = now_ns();
+    for(size_t w = 0; w < active.size(); w++)
+    {
+        for(size_t d = 0; d < active[w]->devices.size(); d++)
+        {
+            Device &device = active[w]->devices[d];
+            device.monitor->Setup();
+            device.monitor->SetContinuous();
+            device.monitor->EnableConversion(true);
+            if(!device.monitor->ErrorCheck())
+            {
+                fprintf(stderr, "warning: no acknowledge from 0x%02X on bus %u\n", device.address, active[w]->bus);
+            }
+            device.next_ns = start;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    //! 3) Run one thread per bus and the writer until stopped
+    std::vector<uint32_t> latencies_us;
+    latencies_us.reserve(1 << 20);
+
+    std::thread writer(writer_loop, &active, quiet, simulate ? &latencies_us : (std::vector<uint32_t> *)0);
+    for(size_t w = 0; w < active.size(); w++)
+    {
+        active[w]->thread = std::thread(bus_loop, active[w]);
+    }
+
+    while(running)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if(seconds > 0 && (now_ns() - start) >= (uint64_t)(seconds*1e9)) running = false;
+    }
+
+    for(size_t w = 0; w < active.size(); w++) active[w]->thread.join();
+    writer.join();
+
+    //! 4) Report
+    double elapsed = (now_ns() - start)/1e9;
+    uint64_t polled = 0, dropped = 0;
+    for(size_t w = 0; w < active.size(); w++)
+    {
+        polled += active[w]->polled;
+        dropped += active[w]->dropped;
+        fprintf(stderr, "bus %u: %zu devices, %llu samples, %.1f samples/s\n", active[w]->bus, active[w]->devices.size(),
+                (unsigned long long)active[w]->polled.load(), active[w]->polled/elapsed);
+    }
+    fprintf(stderr, "total: %llu samples in %.2fs, %.1f samples/s, %llu dropped\n",
+            (unsigned long long)polled, elapsed, polled/elapsed, (unsigned long long)dropped);
+    if(simulate)
+    {
+        fprintf(stderr, "queue latency us: p50 %.0f  p90 %.0f  p99 %.0f  max %.0f\n",
+                percentile(latencies_us, 0.50), percentile(latencies_us, 0.90), percentile(latencies_us, 0.99), percentile(latencies_us, 1.0));
+    }
+
+    return(0);
+}
@@ -0,0 +1,250 @@
+/*!
+LTC2946 Telemetry Client
+
+See LTC2946_TelemetryClient.h.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include "LTC2946_TelemetryClient.h"
+
+static void put32(uint8_t *p, uint32_t value)
+{
+    for(uint8_t i = 0; i < 4; i++) p[i] = (uint8_t)(value >> (8*i));
+}
+
+static uint16_t get16(const uint8_t *p){return((uint16_t)(p[0] | (p[1] << 8)));}
+static uint32_t get32(const uint8_t *p){return(get16(p) | ((uint32_t)get16(p + 2) << 16));}
+
+static uint32_t now_ms()
+{
+    return((uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+LTC2946_TelemetryClient::LTC2946_TelemetryClient(LTC2946_Link &link) //!constructor
+    : link(link)
+{
+}
+
+void LTC2946_TelemetryClient::SetTimeout(uint32_t timeout){timeout_ms = timeout;}
+
+void LTC2946_TelemetryClient::OnSample(void (*sample_callback)(const LTC2946_TelemetrySample &sample, void *context), void *sample_context)
+{
+    callback = sample_callback;
+    context = sample_context;
+}
+
+int8_t LTC2946_TelemetryClient::Ping(LTC2946_TelemetryInfo *info)
+{
+    uint8_t out[8];
+    uint16_t length;
+
+    int8_t error = Command(LTC2946_TELEMETRY_PING, 0, 0, out, &length);
+    if(error != 0) return(error);
+    if(length < 8) return(LTC2946_TELEMETRY_E_LENGTH);
+
+    info->version = out[0];
+    info->devices = out[1];
+    info->max_payload = get16(out + 2);
+    info->time_us = get32(out + 4);
+    return(0);
+}
+
+int8_t LTC2946_TelemetryClient::Subscribe(uint8_t device, uint64_t quantities, uint64_t *planned)
+// The layout is taken from the response as it arrives (Dispatch), ahead of the samples behind it.
+{
+    uint8_t request[9];
+
+    request[0] = device;
+    put32(request + 1, (uint32_t)quantities);
+    put32(request + 5, (uint32_t)(quantities >> 32));
+
+    int8_t error = Command(LTC2946_TELEMETRY_SUBSCRIBE, request, sizeof(request));
+    if(error == 0 && planned != 0) *planned = layouts[device].quantities;
+    return(error);
+}
+
+int8_t LTC2946_TelemetryClient::SetRate(uint8_t device, float rate_hz)
+{
+    uint8_t request[5];
+
+    request[0] = device;
+    put32(request + 1, rate_hz > 0 ? (uint32_t)(1e6f/rate_hz + 0.5f) : 0);
+    return(Command(LTC2946_TELEMETRY_RATE, request, sizeof(request)));
+}
+
+int8_t LTC2946_TelemetryClient::Read(LTC2946_TelemetryRead *reads, uint8_t count)
+{
+    uint8_t request[LTC2946_TELEMETRY_MAX_PAYLOAD];
+    uint8_t out[LTC2946_TELEMETRY_MAX_PAYLOAD];
+    uint16_t length;
+
+    if(1 + 3*count > LTC2946_TELEMETRY_MAX_PAYLOAD) return(LTC2946_TELEMETRY_E_LENGTH);
+
+    request[0] = count;
+    for(uint8_t i = 0; i < count; i++)
+    {
+        request[1 + 3*i] = reads[i].device;
+        request[2 + 3*i] = reads[i].reg;
+        request[3 + 3*i] = reads[i].length;
+    }
+    int8_t error = Command(LTC2946_TELEMETRY_READ, request, 1 + 3*count, out, &length);
+    if(error != 0) return(error);
+
+    const uint8_t *p = out + 1;
+    for(uint8_t i = 0; i < count; i++)
+    {
+        if(p + 1 + reads[i].length > out + length) return(LTC2946_TELEMETRY_E_LENGTH);
+        reads[i].ack = (int8_t)p[0];
+        memcpy(reads[i].data, p + 1, reads[i].length);
+        p += 1 + reads[i].length;
+    }
+    return(0);
+}
+
+int8_t LTC2946_TelemetryClient::Stats(LTC2946_TelemetryStats *stats, bool clear)
+{
+    uint8_t request = clear ? 1 : 0;
+    uint8_t out[LTC2946_TELEMETRY_STATS_SIZE];
+    uint16_t length;
+
+    int8_t error = Command(LTC2946_TELEMETRY_STATS, &request, 1, out, &length);
+    if(error != 0) return(error);
+    if(length < LTC2946_TELEMETRY_STATS_SIZE) return(LTC2946_TELEMETRY_E_LENGTH);
+
+    uint32_t *fields[] = {&stats->uptime_us, &stats->commands, &stats->bad_frames, &stats->errors, &stats->frames,
+                          &stats->bytes, &stats->samples, &stats->dropped, &stats->late, &stats->bus_errors};
+    for(uint8_t i = 0; i < LTC2946_TELEMETRY_STATS_SIZE/4; i++) *fields[i] = get32(out + 4*i);
+    return(0);
+}
+
+uint32_t LTC2946_TelemetryClient::Poll(uint32_t timeout)
+{
+    uint32_t before = samples;
+
+    Pump(timeout, false);
+    return(samples - before);
+}
+
+uint32_t LTC2946_TelemetryClient::Samples(){return(samples);}
+uint32_t LTC2946_TelemetryClient::LostFrames(){return(lost_frames);}
+uint32_t LTC2946_TelemetryClient::BadFrames(){return(parser.BadFrames());}
+
+int8_t LTC2946_TelemetryClient::Command(uint8_t type, const uint8_t *payload, uint16_t length, uint8_t *out, uint16_t *out_length)
+{
+    uint8_t frame[LTC2946_TELEMETRY_MAX_PAYLOAD + LTC2946_TELEMETRY_OVERHEAD];
+
+    //! 1) Send
+    if(length > LTC2946_TELEMETRY_MAX_PAYLOAD) return(LTC2946_TELEMETRY_E_LENGTH);
+    expected_type = type;
+    expected_sequence = ++sequence;
+    responded = false;
+    if(link.Write(frame, LTC2946_telemetry_frame(type, expected_sequence, payload, length, frame)) != 0)
+    {
+        return(LTC2946_TELEMETRY_E_LINK);
+    }
+
+    //! 2) Wait for the response, taking samples meanwhile
+    int8_t error = Pump(timeout_ms, true);
+    if(error != 0) return(error);
+    if(response_type == LTC2946_TELEMETRY_ERROR) return(response_length >= 2 ? response[1] : LTC2946_TELEMETRY_E_LENGTH);
+
+    if(out != 0) memcpy(out, response, response_length);
+    if(out_length != 0) *out_length = response_length;
+    return(0);
+}
+
+int8_t LTC2946_TelemetryClient::Pump(uint32_t timeout, bool waiting)
+{
+    uint32_t start = now_ms();
+
+    for(;;)
+    {
+        uint8_t buffer[512];
+        int16_t n = link.Read(buffer, sizeof(buffer));
+        if(n < 0) return(LTC2946_TELEMETRY_E_LINK);
+
+        //All of it: the bytes after a response may be samples
+        for(int16_t i = 0; i < n; i++)
+        {
+            for(bool good = parser.Push(buffer[i]); good; good = parser.Next())
+            {
+                Dispatch(parser.Type(), parser.Sequence(), parser.Payload(), parser.Length());
+            }
+        }
+        if(waiting && responded) return(0);
+        if(n > 0) continue;
+
+        uint32_t elapsed = now_ms() - start;
+        if(elapsed >= timeout) return(waiting ? LTC2946_TELEMETRY_E_TIMEOUT : 0);
+        link.Wait(timeout - elapsed);
+    }
+}
+
+void LTC2946_TelemetryClient::Dispatch(uint8_t type, uint8_t frame_sequence, const uint8_t *payload, uint16_t length)
+{
+    if(type == LTC2946_TELEMETRY_SAMPLES)
+    {
+        Decode(payload, length, frame_sequence);
+        return;
+    }
+
+    //! Responses to anything but the command waiting are stale (it timed out earlier)
+    if(responded || frame_sequence != expected_sequence) return;
+    if(type != (expected_type | LTC2946_TELEMETRY_RESPONSE) && type != LTC2946_TELEMETRY_ERROR) return;
+
+    if(type == (LTC2946_TELEMETRY_SUBSCRIBE | LTC2946_TELEMETRY_RESPONSE) && length >= 11 &&
+       payload[0] < LTC2946_TELEMETRY_MAX_DEVICES && length >= 11 + 2*payload[10])
+    {
+        Layout &l = layouts[payload[0]];
+        l.quantities = get32(payload + 1) | ((uint64_t)get32(payload + 5) << 32);
+        l.bytes = payload[9];
+        l.count = payload[10] <= LTC2946_Map::REGISTER_COUNT ? payload[10] : 0;
+        for(uint8_t i = 0; i < l.count; i++)
+        {
+            l.bursts[i].reg = payload[11 + 2*i];
+            l.bursts[i].length = payload[12 + 2*i];
+            if(l.bursts[i].reg + l.bursts[i].length > LTC2946_REGISTER_COUNT) l.count = 0;     //not ours to decode
+        }
+    }
+
+    memcpy(response, payload, length);
+    response_length = length;
+    response_type = type;
+    responded = true;
+}
+
+void LTC2946_TelemetryClient::Decode(const uint8_t *payload, uint16_t length, uint8_t frame_sequence)
+{
+    //! 1) Stream sequence: a gap is frames the server dropped or the link corrupted
+    if(stream_started) lost_frames += (uint8_t)(frame_sequence - stream_sequence - 1);
+    stream_started = true;
+    stream_sequence = frame_sequence;
+
+    //! 2) Records. Their length comes from the device's layout; an unknown one ends the frame
+    const uint8_t *p = payload, *end = payload + length;
+    while(p + LTC2946_TELEMETRY_RECORD <= end)
+    {
+        if(p[0] >= LTC2946_TELEMETRY_MAX_DEVICES) return;
+        const Layout &l = layouts[p[0]];
+        if(l.count == 0 || p + LTC2946_TELEMETRY_RECORD + l.bytes > end) return;
+
+        LTC2946_TelemetrySample sample;
+        memset(sample.image, 0, sizeof(sample.image));
+        sample.device = p[0];
+        sample.ack = (int8_t)p[1];
+        sample.time_us = get32(p + 2);
+        sample.quantities = l.quantities;
+        p += LTC2946_TELEMETRY_RECORD;
+        for(uint8_t i = 0; i < l.count; i++)
+        {
+            memcpy(sample.image + l.bursts[i].reg, p, l.bursts[i].length);
+            p += l.bursts[i].length;
+        }
+
+        samples++;
+        if(callback != 0) callback(sample, context);
+    }
+}
@@ -0,0 +1,129 @@
+/*!
+LTC2946 Telemetry Client
+
+Host side of the LTC2946_Telemetry protocol (see LTC2946_Telemetry.h for the frames). Commands are
+synchronous: each sends one frame and waits for its response, handing any SAMPLES frames that
+arrive meanwhile to the sample callback. Poll waits for samples when no command is running.
+
+Samples are decoded into a register image (indexed by register address, like LTC2946_Plan::Read),
+so the LTC2946_unpack_* helpers and the register #defines apply as on the device:
+
+    LTC2946_SerialLink link("/dev/ttyACM0");
+    link.Begin();
+    LTC2946_TelemetryClient client(link);
+    client.Subscribe(0, LTC2946_PLAN_VIN | LTC2946_PLAN_POWER);
+    client.SetRate(0, 1000);
+    client.OnSample([](const LTC2946_TelemetrySample &s, void *){
+        printf("%u %u\n", s.time_us, LTC2946_unpack_12(s.image + LTC2946_VIN_MSB_REG));
+    });
+    for(;;) client.Poll(100);
+
+Every call returns 0 or an LTC2946_TELEMETRY_E_* error.
+*/
+
+#ifndef LTC2946_TELEMETRYCLIENT_H
+#define LTC2946_TELEMETRYCLIENT_H
+
+#include <stdint.h>
+#include "LTC2946_Telemetry.h"
+
+#define LTC2946_CLIENT_TIMEOUT_MS       1000
+
+//! PING response
+struct LTC2946_TelemetryInfo
+{
+    uint8_t version;
+    uint8_t devices;
+    uint16_t max_payload;
+    uint32_t time_us;           //!< Server clock when it answered
+};
+
+//! One streamed sample
+struct LTC2946_TelemetrySample
+{
+    uint8_t device;
+    int8_t ack;                 //!< 0 = the reads were acknowledged
+    uint32_t time_us;           //!< Server clock at the read
+    uint64_t quantities;        //!< Subscription it was read for
+    uint8_t image[LTC2946_REGISTER_COUNT];     //!< Registers of the subscription by address, others 0
+};
+
+//! One read of a READ batch
+struct LTC2946_TelemetryRead
+{
+    uint8_t device;
+    uint8_t reg;
+    uint8_t length;
+    uint8_t *data;              //!< length bytes, filled in
+    int8_t ack;                 //!< Filled in
+};
+
+class LTC2946_TelemetryClient {
+public:
+    LTC2946_TelemetryClient(LTC2946_Link &link); //!constructor
+
+    void SetTimeout(uint32_t timeout_ms); //! <Response timeout (default LTC2946_CLIENT_TIMEOUT_MS)>
+
+    //! Called for each sample, from inside whichever call received it
+    void OnSample(void (*callback)(const LTC2946_TelemetrySample &sample, void *context), void *context = 0);
+
+    int8_t Ping(LTC2946_TelemetryInfo *info);
+
+    //! Stream quantities (LTC2946_PLAN_* bits) of a device; 0 stops it. planned, if given, gets
+    //! the quantities the server will send
+    int8_t Subscribe(uint8_t device, uint64_t quantities, uint64_t *planned = 0);
+
+    //! Samples per second of a device, 0 = stop
+    int8_t SetRate(uint8_t device, float rate_hz);
+
+    //! Read a batch of registers, any devices, in one round trip. @return 0 even if some reads
+    //! were not acknowledged (see each ack)
+    int8_t Read(LTC2946_TelemetryRead *reads, uint8_t count);
+
+    int8_t Stats(LTC2946_TelemetryStats *stats, bool clear = false);
+
+    //! Handle the frames that arrive within timeout_ms. @return samples received
+    uint32_t Poll(uint32_t timeout_ms);
+
+    uint32_t Samples(); //! <Samples received>
+    uint32_t LostFrames(); //! <SAMPLES frames missing from the stream sequence (dropped by the server or corrupted)>
+    uint32_t BadFrames(); //! <Frames dropped for CRC or length>
+
+    //! Send an arbitrary frame and wait for its response, for tests. @return as the commands
+    int8_t Command(uint8_t type, const uint8_t *payload, uint16_t length, uint8_t *response = 0, uint16_t *response_length = 0);
+
+private:
+    struct Layout
+    {
+        uint64_t quantities;
+        uint8_t bytes;
+        uint8_t count;
+        LTC2946_Burst bursts[LTC2946_Map::REGISTER_COUNT];
+    };
+
+    int8_t Pump(uint32_t timeout_ms, bool waiting); //read and dispatch frames until the response or the timeout
+    void Dispatch(uint8_t type, uint8_t sequence, const uint8_t *payload, uint16_t length);
+    void Decode(const uint8_t *payload, uint16_t length, uint8_t sequence);
+
+    LTC2946_Link &link;
+    LTC2946_FrameParser parser;
+    uint32_t timeout_ms = LTC2946_CLIENT_TIMEOUT_MS;
+    uint8_t sequence = 0;
+    void (*callback)(const LTC2946_TelemetrySample &sample, void *context) = 0;
+    void *context = 0;
+    Layout layouts[LTC2946_TELEMETRY_MAX_DEVICES] = {};
+
+    uint8_t expected_type = 0;              //command waiting for its response
+    uint8_t expected_sequence = 0;
+    bool responded = false;
+    uint8_t response_type = 0;
+    uint8_t response[LTC2946_TELEMETRY_MAX_PAYLOAD];
+    uint16_t response_length = 0;
+
+    bool stream_started = false;
+    uint8_t stream_sequence = 0;
+    uint32_t samples = 0;
+    uint32_t lost_frames = 0;
+};
+
+#endif  // LTC2946_TELEMETRYCLIENT_H
@@ -0,0 +1,255 @@
+/*!
+ltc2946_telemetry_test: LTC2946_TelemetryServer and LTC2946_TelemetryClient over a Linux pty
+
+The server runs in a thread on the pty master, serving three LTC2946s on an LTC2946_FakeBus with
+random register contents; the client opens the pty slave as it would /dev/ttyACM0. Checks:
+    ping        version and device count
+    read        one READ batch of the whole register file of every device
+    stream      a different subscription per device at 1kHz for a second: every sample's registers
+                match, rates and timestamps are right, nothing lost
+    errors      unknown command, bad device, oversized batch
+    resync      garbage and a corrupted frame on the link, then commands still work; frames inside
+                a bad one are all handled
+    throughput  measurements of every device as fast as the server loop goes, against the text the
+                example prints at 115200 baud
+Fails on any mismatch; throughput is reported, not judged (a pty is not USB).
+
+Build (from this directory):
+    g++ -O2 -pthread -I../.. -I. ltc2946_telemetry_test.cpp LTC2946_TelemetryClient.cpp ../../LTC2946_Telemetry.cpp ../../LTC2946_Link.cpp ../../LTC2946_Plan.cpp ../../LTC2946_FakeBus.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_telemetry_test
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "LTC2946_Telemetry.h"
+#include "LTC2946_TelemetryClient.h"
+#include "LTC2946_FakeBus.h"
+
+#define DEVICES         3
+#define RATE_HZ         1000
+#define TEXT_BAUD       115200
+#define TEXT_SAMPLE     52      //!< Bytes of one "VIN(v):... | Power: ... | Current: ...\r\n" line
+
+static const uint8_t addresses[DEVICES] = {0x6F, 0x6A, 0x67};
+static const uint64_t subscriptions[DEVICES] = {
+    LTC2946_PLAN_MEASUREMENTS,
+    LTC2946_PLAN_VIN | LTC2946_PLAN_POWER | LTC2946_PLAN_STATUS,
+    LTC2946_PLAN_ACCUMULATORS,
+};
+
+static uint8_t expected[DEVICES][LTC2946_REGISTER_COUNT];
+static int failures = 0;
+
+static uint32_t micros_now()
+{
+    return((uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void check(bool ok, const char *what)
+{
+    printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+    if(!ok) failures++;
+}
+
+//! Per-device tally of the stream
+struct Tally
+{
+    uint32_t samples[DEVICES];
+    uint32_t wrong;
+    uint32_t errors;
+    uint32_t last_us[DEVICES];
+    uint64_t gap_us[DEVICES];           //sum of time between samples
+};
+
+static void on_sample(const LTC2946_TelemetrySample &s, void *context)
+{
+    Tally &t = *(Tally *)context;
+    if(s.device >= DEVICES) { t.wrong++; return; }
+
+    if(s.ack != 0) t.errors++;
+    for(uint8_t i = 0; i < LTC2946_Map::REGISTER_COUNT; i++)
+    {
+        if(!(s.quantities & (1ULL << i))) continue;
+        const LTC2946_Register &r = LTC2946_Map::REGISTERS[i];
+        if(memcmp(s.image + r.address, expected[s.device] + r.address, r.width) != 0) t.wrong++;
+    }
+    if(t.samples[s.device] > 0) t.gap_us[s.device] += s.time_us - t.last_us[s.device];
+    t.last_us[s.device] = s.time_us;
+    t.samples[s.device]++;
+}
+
+int main()
+{
+    //! 1) Devices with random registers
+    LTC2946_FakeBus bus;
+    uint32_t seed = 3;
+    for(uint8_t d = 0; d < DEVICES; d++)
+    {
+        bus.AddDevice(addresses[d]);
+        for(uint8_t i = 0; i < LTC2946_REGISTER_COUNT; i++)
+        {
+            seed = seed*1664525 + 1013904223;
+            expected[d][i] = (uint8_t)(seed >> 24);
+        }
+        memcpy(bus.Registers(addresses[d]), expected[d], LTC2946_REGISTER_COUNT);
+    }
+
+    //! 2) pty pair: the server on the master, the client on the slave
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        printf("no pty\n");
+        return(1);
+    }
+    LTC2946_SerialLink server_link(master);
+    LTC2946_SerialLink client_link(ptsname(master));
+    if(server_link.Begin() != 0 || client_link.Begin() != 0)
+    {
+        printf("cannot open %s\n", ptsname(master));
+        return(1);
+    }
+
+    std::atomic<bool> running(true);
+    std::thread server_thread([&](){
+        LTC2946 monitor_0(bus, addresses[0]), monitor_1(bus, addresses[1]), monitor_2(bus, addresses[2]);
+        LTC2946_TelemetryServer server(server_link);
+        server.Add(monitor_0);
+        server.Add(monitor_1);
+        server.Add(monitor_2);
+        while(running)
+        {
+            server.Update(micros_now());
+            std::this_thread::sleep_for(std::chrono::microseconds(20));    //leave the client a CPU
+        }
+    });
+
+    LTC2946_TelemetryClient client(client_link);
+    Tally tally;
+    memset(&tally, 0, sizeof(tally));
+    client.OnSample(on_sample, &tally);
+
+    //! 3) Ping
+    LTC2946_TelemetryInfo info;
+    check(client.Ping(&info) == 0 && info.version == LTC2946_TELEMETRY_VERSION && info.devices == DEVICES, "ping");
+
+    //! 4) One batch: every register of every device
+    uint8_t registers[DEVICES][LTC2946_REGISTER_COUNT];
+    LTC2946_TelemetryRead reads[DEVICES];
+    for(uint8_t d = 0; d < DEVICES; d++) reads[d] = {d, 0x00, LTC2946_REGISTER_COUNT, registers[d], -1};
+    bool read_ok = client.Read(reads, DEVICES) == 0;
+    for(uint8_t d = 0; d < DEVICES; d++) read_ok &= reads[d].ack == 0 && memcmp(registers[d], expected[d], LTC2946_REGISTER_COUNT) == 0;
+    check(read_ok, "batch read of 3 register files");
+
+    //! 5) Stream
+    LTC2946_TelemetryStats stats;
+    client.Stats(&stats, true);
+    uint32_t received = client.Samples();
+    bool subscribed = true;
+    for(uint8_t d = 0; d < DEVICES; d++)
+    {
+        uint64_t planned = 0;
+        subscribed &= client.Subscribe(d, subscriptions[d], &planned) == 0 && planned == subscriptions[d];
+        subscribed &= client.SetRate(d, RATE_HZ) == 0;
+    }
+    check(subscribed, "subscribe and set rate");
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while(std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) client.Poll(50);
+    for(uint8_t d = 0; d < DEVICES; d++) client.SetRate(d, 0);
+    client.Stats(&stats);
+    received = client.Samples() - received;
+
+    bool rates_ok = true;
+    for(uint8_t d = 0; d < DEVICES; d++)
+    {
+        double period = tally.gap_us[d]/(double)(tally.samples[d] - 1);
+        printf("    device %u: %u samples, mean period %.1f us\n", d, tally.samples[d], period);
+        rates_ok &= tally.samples[d] > RATE_HZ*0.9 && tally.samples[d] < RATE_HZ*1.1 && period > 1e6/RATE_HZ*0.9 && period < 1e6/RATE_HZ*1.1;
+    }
+    printf("    %u samples in %u frames, %u bytes; %u dropped, %u late\n", stats.samples, stats.frames, stats.bytes,
+           stats.dropped, stats.late);
+    check(tally.wrong == 0 && tally.errors == 0, "every streamed register matches");
+    check(rates_ok, "1kHz per device, timestamps 1ms apart (within 10%)");
+    check(received == stats.samples && stats.dropped == 0 && client.LostFrames() == 0, "nothing lost");
+
+    //! 6) Errors
+    uint8_t bad_device[9] = {DEVICES};
+    uint8_t too_big[1 + 3*4] = {4, 0, 0, 0xFF, 1, 0, 0xFF, 2, 0, 0xFF, 0, 0, 0xFF};
+    check(client.Command(0x33, 0, 0) == LTC2946_TELEMETRY_E_UNKNOWN, "unknown command");
+    check(client.Command(LTC2946_TELEMETRY_SUBSCRIBE, bad_device, sizeof(bad_device)) == LTC2946_TELEMETRY_E_DEVICE, "bad device");
+    check(client.Command(LTC2946_TELEMETRY_READ, too_big, sizeof(too_big)) == LTC2946_TELEMETRY_E_LENGTH, "batch larger than a frame");
+
+    //! 7) Garbage, a frame with a bad CRC and one with a bad length, then a command; then a bad header over good frames
+    uint8_t noise[64];
+    for(uint8_t i = 0; i < sizeof(noise); i++) noise[i] = (i % 7 == 0) ? LTC2946_TELEMETRY_SYNC : (uint8_t)(i*37);
+    uint8_t corrupt[LTC2946_TELEMETRY_OVERHEAD + 1];
+    uint8_t zero = 0;
+    LTC2946_telemetry_frame(LTC2946_TELEMETRY_STATS, 0, &zero, 1, corrupt);
+    corrupt[LTC2946_TELEMETRY_HEADER] ^= 0x01;
+    const uint8_t huge[] = {LTC2946_TELEMETRY_SYNC, LTC2946_TELEMETRY_PING, 0, 0xFF, 0xFF};
+    client_link.Write(noise, sizeof(noise));
+    client_link.Write(corrupt, sizeof(corrupt));
+    client_link.Write(huge, sizeof(huge));
+    check(client.Ping(&info) == 0 && client.Stats(&stats) == 0 && stats.bad_frames > 0, "resynchronizes after garbage");
+    printf("    %u bad frames\n", stats.bad_frames);
+
+    //A bad header whose length swallows a PING and the start of a STATS: both are found in the replay
+    LTC2946_TelemetryStats before;
+    uint8_t swallowed[5 + 2*LTC2946_TELEMETRY_OVERHEAD] = {LTC2946_TELEMETRY_SYNC, 0, 0, 8, 0};
+    LTC2946_telemetry_frame(LTC2946_TELEMETRY_PING, 7, 0, 0, swallowed + 5);
+    LTC2946_telemetry_frame(LTC2946_TELEMETRY_STATS, 8, 0, 0, swallowed + 5 + LTC2946_TELEMETRY_OVERHEAD);
+    LTC2946_FrameParser parser;
+    uint8_t found[2];
+    uint8_t found_count = 0;
+    for(uint8_t i = 0; i < sizeof(swallowed); i++)
+    {
+        for(bool good = parser.Push(swallowed[i]); good; good = parser.Next())
+        {
+            if(found_count < sizeof(found)) found[found_count] = parser.Sequence();
+            found_count++;
+        }
+    }
+    check(found_count == 2 && found[0] == 7 && found[1] == 8 && parser.BadFrames() == 1, "frames inside a bad frame are all found");
+    client.Stats(&before);
+    client_link.Write(swallowed, sizeof(swallowed));
+    client.Poll(50);
+    client.Stats(&stats);
+    check(stats.commands - before.commands == 3 && stats.bad_frames - before.bad_frames == 1, "server handles both");
+
+    //! 8) Throughput: every device every server loop
+    memset(&tally, 0, sizeof(tally));
+    client.Stats(&stats, true);
+    received = client.Samples();
+    uint32_t lost = client.LostFrames();
+    for(uint8_t d = 0; d < DEVICES; d++)
+    {
+        client.Subscribe(d, LTC2946_PLAN_MEASUREMENTS);
+        const uint8_t every_loop[5] = {d, 1, 0, 0, 0};     //1us period
+        client.Command(LTC2946_TELEMETRY_RATE, every_loop, sizeof(every_loop));
+    }
+    start = std::chrono::steady_clock::now();
+    while(std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) client.Poll(50);
+    for(uint8_t d = 0; d < DEVICES; d++) client.SetRate(d, 0);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    client.Stats(&stats);
+    received = client.Samples() - received;
+
+    double text_rate = TEXT_BAUD/10.0/TEXT_SAMPLE;
+    printf("    %.0f samples/s received, %.0f kB/s, %u dropped by the server (%u frames)\n", received/elapsed,
+           stats.bytes/elapsed/1000, stats.dropped, client.LostFrames() - lost);
+    printf("    text at %u baud: %.0f samples/s\n", TEXT_BAUD, text_rate);
+    check(tally.wrong == 0 && received == stats.samples && received > text_rate, "throughput run intact and above text rate");
+
+    running = false;
+    server_thread.join();
+
+    printf("%s, %d failures\n", failures ? "FAIL" : "PASS", failures);
+    return(failures ? 1 : 0);
+}
@@ -0,0 +1,365 @@
+/*!
+LTC2946 Trace
+
+Columnar trace writer and memory-mapped reader. See LTC2946_Trace.h.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "LTC2946_Trace.h"
+
+// Column offsets within a chunk of n rows
+#define TIME_OFFSET(n)      0
+#define POWER_OFFSET(n)     ((size_t)(n)*8)
+#define CURRENT_OFFSET(n)   ((size_t)(n)*12)
+#define VIN_OFFSET(n)       ((size_t)(n)*14)
+#define ADIN_OFFSET(n)      ((size_t)(n)*16)
+
+size_t LTC2946_trace_chunk_bytes(uint32_t chunk_samples)
+{
+    return(((size_t)chunk_samples*18 + 7) & ~(size_t)7);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Writer
+
+LTC2946_TraceWriter::LTC2946_TraceWriter() //!constructor
+{
+    memset(&header, 0, sizeof(header));
+}
+
+LTC2946_TraceWriter::~LTC2946_TraceWriter()
+{
+    if(file != 0) Close();
+}
+
+bool LTC2946_TraceWriter::Open(const char *path, float vin_gain, float current_gain, float power_gain, float adin_gain)
+{
+    file = fopen(path, "wb");
+    if(file == 0) return(false);
+
+    memset(&header, 0, sizeof(header));
+    header.magic = LTC2946_TRACE_MAGIC;
+    header.version = LTC2946_TRACE_VERSION;
+    header.chunk_samples = LTC2946_TRACE_CHUNK_SAMPLES;
+    header.vin_gain = vin_gain;
+    header.current_gain = current_gain;
+    header.power_gain = power_gain;
+    header.adin_gain = adin_gain;
+
+    chunk = (uint8_t *)calloc(1, LTC2946_trace_chunk_bytes(header.chunk_samples));
+    count = 0;
+    last_time = 0;
+    ok = (chunk != 0);
+
+    //Placeholder header, rewritten by Close
+    ok = ok && fwrite(&header, sizeof(header), 1, file) == 1;
+    return(ok);
+}
+
+bool LTC2946_TraceWriter::Append(uint64_t time_ns, uint16_t vin, uint16_t current, uint32_t power, uint16_t adin)
+{
+    uint32_t n = header.chunk_samples;
+
+    if(!ok || file == 0) return(false);
+    if(header.samples > 0 && time_ns < last_time) return(false);
+
+    //! 1) Previous sample's power holds until this sample. It is in the chunk being filled, or the last flushed one.
+    if(header.samples > 0)
+    {
+        LTC2946_TraceChunk &previous = index[count > 0 ? header.chunks : header.chunks - 1];
+        previous.energy += (double)last_power*(double)(time_ns - last_time)*1e-9;
+        previous.end_ns = time_ns;
+    }
+
+    //! 2) Start a chunk summary
+    if(count == 0)
+    {
+        if(header.chunks + 1 > index_capacity)
+        {
+            uint64_t capacity = index_capacity ? index_capacity*2 : 256;
+            LTC2946_TraceChunk *grown = (LTC2946_TraceChunk *)realloc(index, capacity*sizeof(LTC2946_TraceChunk));
+            if(grown == 0)
+            {
+                ok = false;
+                return(false);
+            }
+            index = grown;
+            index_capacity = capacity;
+        }
+
+        LTC2946_TraceChunk &c = index[header.chunks];
+        memset(&c, 0, sizeof(c));
+        c.first_ns = time_ns;
+        c.power_min = 0xFFFFFFFF;
+        c.current_min = 0xFFFF;
+        c.vin_min = 0xFFFF;
+        c.adin_min = 0xFFFF;
+    }
+
+    //! 3) Store the row and update the summary
+    ((uint64_t *)(chunk + TIME_OFFSET(n)))[count] = time_ns;
+    ((uint32_t *)(chunk + POWER_OFFSET(n)))[count] = power;
+    ((uint16_t *)(chunk + CURRENT_OFFSET(n)))[count] = current;
+    ((uint16_t *)(chunk + VIN_OFFSET(n)))[count] = vin;
+    ((uint16_t *)(chunk + ADIN_OFFSET(n)))[count] = adin;
+
+    LTC2946_TraceChunk &c = index[header.chunks];
+    c.last_ns = time_ns;
+    c.end_ns = time_ns;
+    c.count++;
+    if(power < c.power_min) c.power_min = power;
+    if(power > c.power_max) c.power_max = power;
+    if(current < c.current_min) c.current_min = current;
+    if(current > c.current_max) c.current_max = current;
+    if(vin < c.vin_min) c.vin_min = vin;
+    if(vin > c.vin_max) c.vin_max = vin;
+    if(adin < c.adin_min) c.adin_min = adin;
+    if(adin > c.adin_max) c.adin_max = adin;
+    c.power_sum += power;
+    c.current_sum += current;
+    c.vin_sum += vin;
+    c.adin_sum += adin;
+
+    count++;
+    header.samples++;
+    last_time = time_ns;
+    last_power = power;
+
+    if(count == n) return(FlushChunk());
+    return(true);
+}
+
+bool LTC2946_TraceWriter::FlushChunk()
+{
+    size_t bytes = LTC2946_trace_chunk_bytes(header.chunk_samples);
+
+    ok = ok && fwrite(chunk, bytes, 1, file) == 1;
+    memset(chunk, 0, bytes);
+    header.chunks++;
+    count = 0;
+    return(ok);
+}
+
+bool LTC2946_TraceWriter::Close()
+{
+    if(file == 0) return(false);
+
+    if(count > 0) FlushChunk();
+
+    //! Index after the last chunk, then the final header at the start
+    header.index_offset = sizeof(header) + header.chunks*LTC2946_trace_chunk_bytes(header.chunk_samples);
+    if(header.chunks > 0)
+    {
+        ok = ok && fwrite(index, sizeof(LTC2946_TraceChunk), header.chunks, file) == header.chunks;
+    }
+    ok = ok && fseek(file, 0, SEEK_SET) == 0;
+    ok = ok && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+
+    file = 0;
+    free(chunk);
+    free(index);
+    chunk = 0;
+    index = 0;
+    index_capacity = 0;
+    return(ok);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Reader
+
+LTC2946_TraceReader::LTC2946_TraceReader() //!constructor
+{
+}
+
+LTC2946_TraceReader::~LTC2946_TraceReader()
+{
+    Close();
+}
+
+bool LTC2946_TraceReader::Open(const char *path)
+{
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return(false);
+
+    if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(LTC2946_TraceHeader))
+    {
+        close(fd);
+        return(false);
+    }
+
+    map_length = (size_t)info.st_size;
+    void *mapped = mmap(0, map_length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED) return(false);
+    map = (const uint8_t *)mapped;
+
+    //! Validate before trusting any offset
+    header = (const LTC2946_TraceHeader *)map;
+    chunk_bytes = LTC2946_trace_chunk_bytes(header->chunk_samples);
+    if(header->magic != LTC2946_TRACE_MAGIC || header->version != LTC2946_TRACE_VERSION || header->chunk_samples == 0 ||
+       header->index_offset + header->chunks*sizeof(LTC2946_TraceChunk) > map_length ||
+       sizeof(LTC2946_TraceHeader) + header->chunks*chunk_bytes > header->index_offset)
+    {
+        Close();
+        return(false);
+    }
+    index = (const LTC2946_TraceChunk *)(map + header->index_offset);
+
+    madvise((void *)map, map_length, MADV_RANDOM);      //Queries touch the index and a few edge chunks
+    return(true);
+}
+
+void LTC2946_TraceReader::Close()
+{
+    if(map != 0) munmap((void *)map, map_length);
+    map = 0;
+    header = 0;
+    index = 0;
+}
+
+const LTC2946_TraceHeader *LTC2946_TraceReader::Header(){return(header);}
+const LTC2946_TraceChunk *LTC2946_TraceReader::Chunk(uint64_t c){return(&index[c]);}
+
+const uint64_t *LTC2946_TraceReader::Time(uint64_t c)
+{
+    return((const uint64_t *)(map + sizeof(LTC2946_TraceHeader) + c*chunk_bytes + TIME_OFFSET(header->chunk_samples)));
+}
+
+const uint32_t *LTC2946_TraceReader::Power(uint64_t c)
+{
+    return((const uint32_t *)(map + sizeof(LTC2946_TraceHeader) + c*chunk_bytes + POWER_OFFSET(header->chunk_samples)));
+}
+
+const uint16_t *LTC2946_TraceReader::Current(uint64_t c)
+{
+    return((const uint16_t *)(map + sizeof(LTC2946_TraceHeader) + c*chunk_bytes + CURRENT_OFFSET(header->chunk_samples)));
+}
+
+const uint16_t *LTC2946_TraceReader::VIN(uint64_t c)
+{
+    return((const uint16_t *)(map + sizeof(LTC2946_TraceHeader) + c*chunk_bytes + VIN_OFFSET(header->chunk_samples)));
+}
+
+const uint16_t *LTC2946_TraceReader::ADIN(uint64_t c)
+{
+    return((const uint16_t *)(map + sizeof(LTC2946_TraceHeader) + c*chunk_bytes + ADIN_OFFSET(header->chunk_samples)));
+}
+
+uint64_t LTC2946_TraceReader::FirstChunkEnding(uint64_t t_ns)
+// Binary search on the index; chunks are in time order.
+{
+    uint64_t low = 0, high = header->chunks;
+    while(low < high)
+    {
+        uint64_t middle = (low + high)/2;
+        if(index[middle].end_ns <= t_ns && index[middle].last_ns < t_ns){
+            low = middle + 1;
+        }else{
+            high = middle;
+        }
+    }
+    return(low);
+}
+
+double LTC2946_TraceReader::ChunkEnergy(uint64_t c, uint64_t t0_ns, uint64_t t1_ns)
+{
+    const uint64_t *time = Time(c);
+    const uint32_t *power = Power(c);
+    double energy = 0;
+
+    for(uint32_t i = 0; i < index[c].count; i++)
+    {
+        uint64_t start = time[i];
+        uint64_t end = (i + 1 < index[c].count) ? time[i + 1] : index[c].end_ns;
+        if(start < t0_ns) start = t0_ns;
+        if(end > t1_ns) end = t1_ns;
+        if(end > start) energy += (double)power[i]*(double)(end - start)*1e-9;
+    }
+    return(energy);
+}
+
+double LTC2946_TraceReader::Energy(uint64_t t0_ns, uint64_t t1_ns)
+{
+    double energy = 0;
+
+    for(uint64_t c = FirstChunkEnding(t0_ns); c < header->chunks && index[c].first_ns < t1_ns; c++)
+    {
+        if(index[c].first_ns >= t0_ns && index[c].end_ns <= t1_ns){
+            energy += index[c].energy;                  //Whole chunk, from the summary
+        }else{
+            energy += ChunkEnergy(c, t0_ns, t1_ns);     //Edge chunk, scan
+        }
+    }
+    return(energy*header->power_gain);
+}
+
+bool LTC2946_TraceReader::ChunkPeak(uint64_t c, uint64_t t0_ns, uint64_t t1_ns, uint32_t *peak_code)
+{
+    const uint64_t *time = Time(c);
+    const uint32_t *power = Power(c);
+    bool found = false;
+
+    for(uint32_t i = 0; i < index[c].count; i++)
+    {
+        if(time[i] >= t0_ns && time[i] <= t1_ns && (!found || power[i] > *peak_code))
+        {
+            *peak_code = power[i];
+            found = true;
+        }
+    }
+    return(found);
+}
+
+bool LTC2946_TraceReader::PeakPower(uint64_t t0_ns, uint64_t t1_ns, uint32_t *peak_code)
+{
+    bool found = false;
+    uint32_t peak = 0;
+
+    for(uint64_t c = FirstChunkEnding(t0_ns); c < header->chunks && index[c].first_ns <= t1_ns; c++)
+    {
+        uint32_t chunk_peak;
+        if(index[c].first_ns >= t0_ns && index[c].last_ns <= t1_ns){
+            chunk_peak = index[c].power_max;            //Whole chunk, from the summary
+        }else if(!ChunkPeak(c, t0_ns, t1_ns, &chunk_peak)){
+            continue;
+        }
+
+        if(!found || chunk_peak > peak) peak = chunk_peak;
+        found = true;
+    }
+
+    *peak_code = peak;
+    return(found);
+}
+
+double LTC2946_TraceReader::EnergyScan(uint64_t t0_ns, uint64_t t1_ns)
+{
+    double energy = 0;
+    for(uint64_t c = 0; c < header->chunks; c++) energy += ChunkEnergy(c, t0_ns, t1_ns);
+    return(energy*header->power_gain);
+}
+
+bool LTC2946_TraceReader::PeakPowerScan(uint64_t t0_ns, uint64_t t1_ns, uint32_t *peak_code)
+{
+    bool found = false;
+    uint32_t peak = 0;
+    for(uint64_t c = 0; c < header->chunks; c++)
+    {
+        uint32_t chunk_peak;
+        if(ChunkPeak(c, t0_ns, t1_ns, &chunk_peak) && (!found || chunk_peak > peak))
+        {
+            peak = chunk_peak;
+            found = true;
+        }
+    }
+    *peak_code = peak;
+    return(found);
+}
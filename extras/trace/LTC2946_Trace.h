@@ -0,0 +1,146 @@
+/*!
+LTC2946 Trace
+
+Columnar on-disk format for long LTC2946 captures, with a memory-mapped reader that answers range
+queries from per-chunk summaries instead of scanning every sample.
+
+File layout (little endian):
+    LTC2946_TraceHeader                       56 bytes
+    chunk 0 .. chunk N-1                      chunk_samples rows each, last one zero padded
+        time_ns[chunk_samples]     uint64     sample time
+        power[chunk_samples]       uint32     24-bit power code
+        current[chunk_samples]     uint16     12-bit delta sense code
+        vin[chunk_samples]         uint16     12-bit VIN code
+        adin[chunk_samples]        uint16     12-bit ADIN code
+        (pad to 8 bytes)
+    LTC2946_TraceChunk[N]                     index: time range and min/max/sum per chunk
+
+Codes are stored raw; the header carries the gain of each channel (engineering unit per code, as
+set with SetVINConst etc.) so readers can convert. Energy uses sample-and-hold integration:
+sample i's power applies from time_ns[i] until time_ns[i+1].
+*/
+
+#ifndef LTC2946_TRACE_H
+#define LTC2946_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define LTC2946_TRACE_MAGIC             0x543634393243544CULL   //"LTC2946T" on disk
+#define LTC2946_TRACE_VERSION           1
+#define LTC2946_TRACE_CHUNK_SAMPLES     4096
+
+//! File header
+struct LTC2946_TraceHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t chunk_samples;     //!< Rows per chunk
+    uint64_t samples;           //!< Total rows
+    uint64_t chunks;            //!< Number of chunks (and index entries)
+    uint64_t index_offset;      //!< File offset of the chunk index
+    float vin_gain;             //!< Volts per VIN code
+    float current_gain;         //!< Amps per delta sense code
+    float power_gain;           //!< Watts per power code
+    float adin_gain;            //!< Volts per ADIN code
+};
+
+//! Per-chunk summary, one per chunk in the index
+struct LTC2946_TraceChunk
+{
+    uint64_t first_ns;          //!< Time of the first sample
+    uint64_t last_ns;           //!< Time of the last sample
+    uint64_t end_ns;            //!< Time the last sample's power stops applying (first_ns of the next chunk)
+    uint32_t count;             //!< Rows in this chunk
+    uint32_t power_min;
+    uint32_t power_max;
+    uint16_t current_min;
+    uint16_t current_max;
+    uint16_t vin_min;
+    uint16_t vin_max;
+    uint16_t adin_min;
+    uint16_t adin_max;
+    uint64_t power_sum;         //!< Sum of power codes
+    uint64_t current_sum;
+    uint64_t vin_sum;
+    uint64_t adin_sum;
+    double energy;              //!< Sum of power code * hold time, code*seconds
+};
+
+//! Streams samples into a trace file, one chunk in memory at a time
+class LTC2946_TraceWriter {
+public:
+    LTC2946_TraceWriter();
+    ~LTC2946_TraceWriter();
+
+    //! Create path. Gains are stored in the header for conversion by readers.
+    //! @return true on success
+    bool Open(const char *path, float vin_gain, float current_gain, float power_gain, float adin_gain);
+
+    //! Append one sample. time_ns must not decrease.
+    //! @return false on write error or out of order time
+    bool Append(uint64_t time_ns, uint16_t vin, uint16_t current, uint32_t power, uint16_t adin);
+
+    //! Flush the last chunk, write index and header. @return true on success
+    bool Close();
+
+private:
+    bool FlushChunk();
+
+    FILE *file = 0;
+    LTC2946_TraceHeader header;
+    LTC2946_TraceChunk *index = 0;
+    uint64_t index_capacity = 0;
+    uint64_t last_time = 0;
+    uint32_t last_power = 0;
+    uint32_t count = 0;         //rows in the current chunk
+    uint8_t *chunk = 0;         //column buffers of the current chunk
+    bool ok = true;
+};
+
+//! Memory-mapped reader with summary-accelerated range queries
+class LTC2946_TraceReader {
+public:
+    LTC2946_TraceReader();
+    ~LTC2946_TraceReader();
+
+    bool Open(const char *path); //! <Map path read-only. @return true on success>
+    void Close();
+
+    const LTC2946_TraceHeader *Header();
+    const LTC2946_TraceChunk *Chunk(uint64_t chunk);
+
+    //! Column pointers of a chunk
+    const uint64_t *Time(uint64_t chunk);
+    const uint32_t *Power(uint64_t chunk);
+    const uint16_t *Current(uint64_t chunk);
+    const uint16_t *VIN(uint64_t chunk);
+    const uint16_t *ADIN(uint64_t chunk);
+
+    //! Energy in joules delivered between t0_ns and t1_ns (sample-and-hold power)
+    double Energy(uint64_t t0_ns, uint64_t t1_ns);
+
+    //! Largest power code of samples taken in [t0_ns, t1_ns]. @return false if there are none
+    bool PeakPower(uint64_t t0_ns, uint64_t t1_ns, uint32_t *peak_code);
+
+    //! Same queries by scanning every sample, for checking and benchmarking the summaries
+    double EnergyScan(uint64_t t0_ns, uint64_t t1_ns);
+    bool PeakPowerScan(uint64_t t0_ns, uint64_t t1_ns, uint32_t *peak_code);
+
+private:
+    uint64_t FirstChunkEnding(uint64_t t_ns);   //first chunk whose hold period ends after t_ns
+    double ChunkEnergy(uint64_t chunk, uint64_t t0_ns, uint64_t t1_ns);
+    bool ChunkPeak(uint64_t chunk, uint64_t t0_ns, uint64_t t1_ns, uint32_t *peak_code);
+
+    const uint8_t *map = 0;
+    size_t map_length = 0;
+    const LTC2946_TraceHeader *header = 0;
+    const LTC2946_TraceChunk *index = 0;
+    size_t chunk_bytes = 0;
+};
+
+//! Bytes taken by one chunk of chunk_samples rows
+size_t LTC2946_trace_chunk_bytes(uint32_t chunk_samples);
+
+#endif  // LTC2946_TRACE_H
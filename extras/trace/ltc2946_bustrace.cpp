@@ -0,0 +1,230 @@
+/*!
+ltc2946_bustrace: record, summarize and replay LTC2946 bus traces (LTC2946_Record)
+
+Usage:
+    ltc2946_bustrace record <file> [workload] [seconds]     Run a workload on LTC2946_SimBus and record it
+    ltc2946_bustrace summary <file>                         Transactions/s, bytes, per-register hit counts
+    ltc2946_bustrace replay <file> [workload] [passes]      Replay a trace through the driver
+
+Workloads (one LTC2946 at 0x6F, polled at 50 Hz):
+    all         ReadAll, plus ReadStatus every 10th poll
+    separate    ReadVIN, ReadCurrent, ReadPower, ReadADIN, plus ReadStatus every 10th poll
+
+Replaying a trace with the workload that recorded it matches every transaction. A driver change that
+adds, drops or reshapes transactions shows up as extra and skipped counts; replay time per
+transaction benchmarks the driver's own cost with the bus taken out.
+
+Build (from this directory):
+    g++ -O2 -I../.. ltc2946_bustrace.cpp ../../LTC2946_Record.cpp ../../LTC2946_SimBus.cpp ../../LTC2946.cpp ../../LTC2946_Unpack.cpp ../../LTC2946_Bus.cpp ../../LTC2946_LinuxBus.cpp -o ltc2946_bustrace
+
+Example:
+    ./ltc2946_bustrace record separate.bus separate 60 && ./ltc2946_bustrace replay separate.bus all
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "LTC2946_Record.h"
+#include "LTC2946_SimBus.h"
+
+#define ADDRESS         0x6F
+#define BUS_HZ          400000
+#define POLL_NS         20000000ULL     //50 Hz
+
+static LTC2946_SimBus *sim = 0;
+
+static uint32_t sim_clock()
+{
+    return((uint32_t)(sim->Now()/1000));
+}
+
+//! One poll of the workload
+static void poll(LTC2946 &monitor, bool separate, uint32_t count)
+{
+    float vin, current, power, adin;
+    uint8_t status1, fault1;
+
+    if(separate)
+    {
+        monitor.ReadVIN();
+        monitor.ReadCurrent();
+        monitor.ReadPower();
+        monitor.ReadADIN();
+    }
+    else
+    {
+        monitor.ReadAll(&vin, &current, &power, &adin);
+    }
+    if(count % 10 == 0) monitor.ReadStatus(&status1, &fault1);
+}
+
+static int record(const char *path, bool separate, double seconds)
+{
+    static uint8_t trace[16*1024*1024];
+    LTC2946_SimBus bus(BUS_HZ);
+    sim = &bus;
+    bus.AddDevice(ADDRESS);
+
+    LTC2946_RecordBus recorder(bus, trace, sizeof(trace));
+    recorder.SetClock(sim_clock);
+    recorder.Restart();
+
+    LTC2946 monitor(recorder, ADDRESS);
+    monitor.Setup();
+    monitor.SetContinuous();
+
+    uint64_t end = (uint64_t)(seconds*1e9);
+    uint32_t seed = 1;
+    for(uint32_t count = 0; bus.Now() < end; count++)
+    {
+        //Load current wanders, VIN sags with it
+        seed = seed*1664525 + 1013904223;
+        uint16_t sense = (uint16_t)(800 + ((seed >> 16) & 0x1FF));
+        bus.SetInputs(ADDRESS, sense, 1800, (uint16_t)(2100 - sense/8), 500);
+
+        uint64_t next = bus.Now() + POLL_NS;
+        poll(monitor, separate, count);
+        if(bus.Now() < next) bus.Advance(next - bus.Now());
+    }
+
+    if(recorder.Dropped() != 0 || !recorder.Save(path))
+    {
+        fprintf(stderr, "cannot write %s (%u transactions dropped)\n", path, recorder.Dropped());
+        return(1);
+    }
+    printf("%u transactions, %zu bytes written to %s\n", recorder.Records(), recorder.Length(), path);
+    return(0);
+}
+
+static uint8_t *load(const char *path, size_t *length)
+{
+    FILE *file = fopen(path, "rb");
+    if(file == 0) return(0);
+
+    fseek(file, 0, SEEK_END);
+    *length = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = (uint8_t *)malloc(*length + 1);
+    if(data != 0 && fread(data, 1, *length, file) != *length)
+    {
+        free(data);
+        data = 0;
+    }
+    fclose(file);
+    return(data);
+}
+
+static int summary(const char *path)
+{
+    size_t length;
+    uint8_t *data = load(path, &length);
+    LTC2946_BusTraceReader reader;
+    if(data == 0 || !reader.Open(data, length))
+    {
+        fprintf(stderr, "cannot open %s as an LTC2946 bus trace\n", path);
+        free(data);
+        return(1);
+    }
+
+    uint64_t transactions = 0, nacks = 0, written = 0, read = 0, busy_us = 0;
+    uint64_t hits[256] = {0}, hit_bytes[256] = {0}, hit_us[256] = {0};
+    uint32_t addresses[128] = {0};
+    uint32_t first = 0, last = 0;
+    LTC2946_BusRecord r;
+
+    while(reader.Next(&r))
+    {
+        if(transactions == 0) first = r.time_us;
+        last = r.time_us + r.duration_us;
+        transactions++;
+        nacks += r.ack != 0;
+        written += r.write_length;
+        read += r.read_length;
+        busy_us += r.duration_us;
+        addresses[r.address & 0x7F]++;
+
+        //Register hits by start register; address-only transactions count under 0xFF
+        uint8_t reg = r.write_length ? r.write_data[0] : 0xFF;
+        hits[reg]++;
+        hit_bytes[reg] += r.write_length + r.read_length;
+        hit_us[reg] += r.duration_us;
+    }
+
+    double seconds = (last - first)*1e-6;
+    printf("%llu transactions over %.3f s, %.1f transactions/s\n", (unsigned long long)transactions, seconds,
+           seconds > 0 ? transactions/seconds : 0.0);
+    printf("bytes written %llu, read %llu, %.1f bytes/s, %llu not acknowledged\n", (unsigned long long)written,
+           (unsigned long long)read, seconds > 0 ? (written + read)/seconds : 0.0, (unsigned long long)nacks);
+    printf("bus busy %.3f s (%.1f%%)\n", busy_us*1e-6, seconds > 0 ? busy_us*1e-4/seconds : 0.0);
+    for(int a = 0; a < 128; a++)
+    {
+        if(addresses[a]) printf("address 0x%02X: %u transactions\n", a, addresses[a]);
+    }
+    printf("register  hits        bytes/hit  us/hit\n");
+    for(int reg = 0; reg < 256; reg++)
+    {
+        if(hits[reg] == 0) continue;
+        printf("0x%02X      %-10llu  %-9.1f  %.1f\n", reg, (unsigned long long)hits[reg],
+               (double)hit_bytes[reg]/hits[reg], (double)hit_us[reg]/hits[reg]);
+    }
+    free(data);
+    return(0);
+}
+
+static int replay(const char *path, bool separate, int passes)
+{
+    LTC2946_ReplayBus bus;
+    if(!bus.Load(path))
+    {
+        fprintf(stderr, "cannot open %s as an LTC2946 bus trace\n", path);
+        return(1);
+    }
+
+    LTC2946 monitor(bus, ADDRESS);
+    uint64_t transactions = 0;
+    double elapsed = 0;
+
+    for(int pass = 0; pass < passes; pass++)
+    {
+        bus.Rewind();
+        monitor.Setup();
+        monitor.ErrorCheck();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        monitor.SetContinuous();
+        for(uint32_t count = 0; !bus.Done(); count++) poll(monitor, separate, count);
+        elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        transactions += bus.Matched() + bus.Extra();
+    }
+
+    printf("matched %u, extra %u, skipped %u\n", bus.Matched(), bus.Extra(), bus.Skipped());
+    printf("%.1f ns per transaction (driver and replay, %d passes)\n", elapsed*1e9/transactions, passes);
+    return((bus.Extra() || bus.Skipped()) ? 1 : 0);
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: ltc2946_bustrace record <file> [all|separate] [seconds]\n"
+                    "       ltc2946_bustrace summary <file>\n"
+                    "       ltc2946_bustrace replay <file> [all|separate] [passes]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 3) usage();
+    bool separate = argc > 3 && strcmp(argv[3], "separate") == 0;
+    if(argc > 3 && !separate && strcmp(argv[3], "all") != 0) usage();
+
+    if(strcmp(argv[1], "record") == 0){
+        return(record(argv[2], separate, argc > 4 ? atof(argv[4]) : 10));
+    }else if(strcmp(argv[1], "summary") == 0){
+        return(summary(argv[2]));
+    }else if(strcmp(argv[1], "replay") == 0){
+        return(replay(argv[2], separate, argc > 4 ? atoi(argv[4]) : 20));
+    }
+    usage();
+    return(2);
+}
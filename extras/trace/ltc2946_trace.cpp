@@ -0,0 +1,194 @@
+/*!
+ltc2946_trace: create, inspect and query LTC2946 columnar trace files
+
+Usage:
+    ltc2946_trace gen <file> <samples> [rate_hz]    Write a synthetic trace (default 1000 samples/s)
+    ltc2946_trace info <file>                       Header and chunk summary totals
+    ltc2946_trace query <file> <t0_s> <t1_s>        Energy and peak power between t0 and t1 (seconds from start)
+    ltc2946_trace bench <file> [queries]            Time summary queries against full scans on random ranges
+
+Build (from this directory):
+    g++ -O2 -std=c++11 ltc2946_trace.cpp LTC2946_Trace.cpp -o ltc2946_trace
+
+Example:
+    ./ltc2946_trace gen big.trc 20000000 && ./ltc2946_trace bench big.trc 200
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include "LTC2946_Trace.h"
+
+//Experimental constants of the LTC2946 class, R = 0.02 ohm
+#define VIN_GAIN        0.02485474f
+#define CURRENT_GAIN    0.00119677419f
+#define POWER_GAIN      0.00003171126055f
+#define ADIN_GAIN       5.001221E-04f
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+static int generate(const char *path, uint64_t samples, double rate)
+{
+    LTC2946_TraceWriter writer;
+    uint64_t period_ns = (uint64_t)(1e9/rate);
+    uint32_t seed = 1;
+
+    if(!writer.Open(path, VIN_GAIN, CURRENT_GAIN, POWER_GAIN, ADIN_GAIN))
+    {
+        fprintf(stderr, "cannot create %s\n", path);
+        return(1);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(uint64_t i = 0; i < samples; i++)
+    {
+        //12V rail, slowly varying load with noise and an occasional spike
+        seed = seed*1664525 + 1013904223;
+        uint16_t vin = (uint16_t)(483 + ((seed >> 8) & 3));
+        double load = 800 + 400*sin((double)i*2e-5) + ((seed >> 12) & 15);
+        if(((seed >> 20) & 0xFFF) == 0) load = 4000;
+        uint16_t current = (uint16_t)load;
+        uint16_t adin = (uint16_t)(1500 + ((seed >> 16) & 7));
+
+        if(!writer.Append(i*period_ns, vin, current, (uint32_t)vin*current, adin))
+        {
+            fprintf(stderr, "write failed\n");
+            return(1);
+        }
+    }
+    if(!writer.Close())
+    {
+        fprintf(stderr, "write failed\n");
+        return(1);
+    }
+
+    printf("%llu samples written in %.2fs\n", (unsigned long long)samples, seconds_since(start));
+    return(0);
+}
+
+static int info(LTC2946_TraceReader &reader)
+{
+    const LTC2946_TraceHeader *h = reader.Header();
+    double energy = 0;
+    uint32_t peak = 0;
+
+    for(uint64_t c = 0; c < h->chunks; c++)
+    {
+        energy += reader.Chunk(c)->energy;
+        if(reader.Chunk(c)->power_max > peak) peak = reader.Chunk(c)->power_max;
+    }
+
+    printf("samples %llu, chunks %llu of %u\n", (unsigned long long)h->samples, (unsigned long long)h->chunks, h->chunk_samples);
+    if(h->chunks > 0)
+    {
+        printf("time %.6fs to %.6fs\n", reader.Chunk(0)->first_ns*1e-9, reader.Chunk(h->chunks - 1)->last_ns*1e-9);
+    }
+    printf("energy %.6f J, peak power %.4f W\n", energy*h->power_gain, peak*h->power_gain);
+    return(0);
+}
+
+static int query(LTC2946_TraceReader &reader, double t0, double t1)
+{
+    const LTC2946_TraceHeader *h = reader.Header();
+    uint64_t base = h->chunks ? reader.Chunk(0)->first_ns : 0;
+    uint64_t t0_ns = base + (uint64_t)(t0*1e9);
+    uint64_t t1_ns = base + (uint64_t)(t1*1e9);
+    uint32_t peak;
+
+    printf("energy %.6f J\n", reader.Energy(t0_ns, t1_ns));
+    if(reader.PeakPower(t0_ns, t1_ns, &peak))
+    {
+        printf("peak power %.4f W\n", peak*h->power_gain);
+    }
+    else
+    {
+        printf("no samples in range\n");
+    }
+    return(0);
+}
+
+static int bench(LTC2946_TraceReader &reader, int queries)
+{
+    const LTC2946_TraceHeader *h = reader.Header();
+    if(h->chunks == 0) return(1);
+
+    uint64_t first = reader.Chunk(0)->first_ns;
+    uint64_t span = reader.Chunk(h->chunks - 1)->last_ns - first;
+    uint32_t seed = 7;
+    double summary_time = 0, scan_time = 0, worst = 0;
+    int mismatches = 0;
+
+    for(int q = 0; q < queries; q++)
+    {
+        seed = seed*1664525 + 1013904223;
+        uint64_t a = first + (uint64_t)((double)seed/4294967296.0*span);
+        seed = seed*1664525 + 1013904223;
+        uint64_t b = first + (uint64_t)((double)seed/4294967296.0*span);
+        if(a > b){ uint64_t t = a; a = b; b = t; }
+
+        uint32_t peak_summary, peak_scan;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        double energy_summary = reader.Energy(a, b);
+        reader.PeakPower(a, b, &peak_summary);
+        summary_time += seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        double energy_scan = reader.EnergyScan(a, b);
+        reader.PeakPowerScan(a, b, &peak_scan);
+        scan_time += seconds_since(start);
+
+        double error = fabs(energy_summary - energy_scan)/(fabs(energy_scan) + 1e-12);
+        if(error > worst) worst = error;
+        if(error > 1e-9 || peak_summary != peak_scan) mismatches++;
+    }
+
+    printf("%d queries over %llu samples\n", queries, (unsigned long long)h->samples);
+    printf("summary: %.3f ms/query\n", summary_time*1e3/queries);
+    printf("scan:    %.3f ms/query\n", scan_time*1e3/queries);
+    printf("speedup %.0fx, worst relative energy difference %.2e, %d mismatches\n", scan_time/summary_time, worst, mismatches);
+    return(mismatches ? 1 : 0);
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: ltc2946_trace gen <file> <samples> [rate_hz]\n"
+                    "       ltc2946_trace info <file>\n"
+                    "       ltc2946_trace query <file> <t0_s> <t1_s>\n"
+                    "       ltc2946_trace bench <file> [queries]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 3) usage();
+
+    if(strcmp(argv[1], "gen") == 0)
+    {
+        if(argc < 4) usage();
+        return(generate(argv[2], strtoull(argv[3], 0, 0), argc > 4 ? atof(argv[4]) : 1000));
+    }
+
+    LTC2946_TraceReader reader;
+    if(!reader.Open(argv[2]))
+    {
+        fprintf(stderr, "cannot open %s as an LTC2946 trace\n", argv[2]);
+        return(1);
+    }
+
+    if(strcmp(argv[1], "info") == 0){
+        return(info(reader));
+    }else if(strcmp(argv[1], "query") == 0 && argc >= 5){
+        return(query(reader, atof(argv[3]), atof(argv[4])));
+    }else if(strcmp(argv[1], "bench") == 0){
+        return(bench(reader, argc > 3 ? atoi(argv[3]) : 100));
+    }
+    usage();
+    return(2);
+}